@@ -0,0 +1,199 @@
+//*****************************************************************************
+// dns_cache.c
+//
+// Host name resolution cache with time to live
+//
+// Resolved broker addresses are kept for a configured time so reconnects
+// can skip the DNS round trip. The cache has no dependency on SimpleLink;
+// the caller resolves names and supplies the time base.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup dns_cache
+//! @{
+//
+//*****************************************************************************
+
+// Standard includes
+#include <string.h>
+
+#include "dns_cache.h"
+
+//*****************************************************************************
+//
+//! Finds the entry of a host name
+//
+//*****************************************************************************
+static DnsCacheEntry_t *
+FindEntry(DnsCache_t *pCache, const char *pcName)
+{
+    int iEntry;
+
+    for(iEntry = 0; iEntry < DNS_CACHE_ENTRIES; iEntry++)
+    {
+        if(strcmp(pCache->Entries[iEntry].cName, pcName) == 0)
+        {
+            return &pCache->Entries[iEntry];
+        }
+    }
+    return NULL;
+}
+
+//*****************************************************************************
+//
+//! Initializes an empty cache
+//!
+//! \param pCache is the cache
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+DnsCache_Init(DnsCache_t *pCache)
+{
+    memset(pCache, 0, sizeof(DnsCache_t));
+}
+
+//*****************************************************************************
+//
+//! Looks up the address of a host name
+//!
+//! \param pCache is the cache
+//! \param pcName is the host name
+//! \param ulNowMs is the current time
+//! \param pulAddr receives the address
+//!
+//! \return 0 on a hit, -1 if the name is not cached or its entry expired
+//
+//*****************************************************************************
+int
+DnsCache_Lookup(DnsCache_t *pCache, const char *pcName,
+                unsigned long ulNowMs, unsigned long *pulAddr)
+{
+    DnsCacheEntry_t *pEntry = FindEntry(pCache, pcName);
+
+    if(pcName[0] == '\0' || pEntry == NULL ||
+       (long)(pEntry->ulExpiresMs - ulNowMs) <= 0)
+    {
+        pCache->ulMisses++;
+        return -1;
+    }
+
+    *pulAddr = pEntry->ulAddr;
+    pCache->ulHits++;
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Caches the address of a host name. An existing entry of the name is
+//! updated; otherwise a free entry, or else the one expiring first, is used.
+//!
+//! \param pCache is the cache
+//! \param pcName is the host name
+//! \param ulAddr is the resolved address
+//! \param ulNowMs is the current time
+//! \param ulTtlMs is how long the address stays valid
+//!
+//! \return 0 on success, -1 if the name is too long to be cached
+//
+//*****************************************************************************
+int
+DnsCache_Store(DnsCache_t *pCache, const char *pcName, unsigned long ulAddr,
+               unsigned long ulNowMs, unsigned long ulTtlMs)
+{
+    DnsCacheEntry_t *pEntry;
+    int iEntry;
+
+    if(pcName[0] == '\0' || strlen(pcName) >= DNS_CACHE_NAME_LEN)
+    {
+        return -1;
+    }
+
+    pEntry = FindEntry(pCache, pcName);
+    if(pEntry == NULL)
+    {
+        pEntry = &pCache->Entries[0];
+        for(iEntry = 0; iEntry < DNS_CACHE_ENTRIES; iEntry++)
+        {
+            if(pCache->Entries[iEntry].cName[0] == '\0')
+            {
+                pEntry = &pCache->Entries[iEntry];
+                break;
+            }
+            if((long)(pCache->Entries[iEntry].ulExpiresMs -
+                      pEntry->ulExpiresMs) < 0)
+            {
+                pEntry = &pCache->Entries[iEntry];
+            }
+        }
+        strcpy(pEntry->cName, pcName);
+    }
+
+    pEntry->ulAddr = ulAddr;
+    pEntry->ulExpiresMs = ulNowMs + ulTtlMs;
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Drops the cached address of a host name, e.g. after connecting to it
+//! failed
+//!
+//! \param pCache is the cache
+//! \param pcName is the host name
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+DnsCache_Invalidate(DnsCache_t *pCache, const char *pcName)
+{
+    DnsCacheEntry_t *pEntry = FindEntry(pCache, pcName);
+
+    if(pEntry != NULL && pcName[0] != '\0')
+    {
+        memset(pEntry, 0, sizeof(DnsCacheEntry_t));
+    }
+}
+
+//*****************************************************************************
+//
+//! Formats an address in dotted decimal notation
+//!
+//! \param ulAddr is the address in host byte order
+//! \param pcBuf receives the string, DNS_ADDR_STR_LEN bytes
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+DnsCache_FormatAddr(unsigned long ulAddr, char *pcBuf)
+{
+    unsigned int uiOctet;
+    int iShift;
+
+    for(iShift = 24; iShift >= 0; iShift -= 8)
+    {
+        uiOctet = (ulAddr >> iShift) & 0xFF;
+        if(uiOctet >= 100)
+        {
+            *pcBuf++ = '0' + uiOctet / 100;
+        }
+        if(uiOctet >= 10)
+        {
+            *pcBuf++ = '0' + (uiOctet / 10) % 10;
+        }
+        *pcBuf++ = '0' + uiOctet % 10;
+        *pcBuf++ = (iShift > 0) ? '.' : '\0';
+    }
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
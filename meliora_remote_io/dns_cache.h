@@ -0,0 +1,46 @@
+//*****************************************************************************
+// dns_cache.h
+//
+// Host name resolution cache with time to live
+//
+//*****************************************************************************
+
+#ifndef __DNS_CACHE_H__
+#define __DNS_CACHE_H__
+
+#define DNS_CACHE_ENTRIES       4
+#define DNS_CACHE_NAME_LEN      64      /* including the terminator */
+#define DNS_ADDR_STR_LEN        16      /* "255.255.255.255" */
+
+//*****************************************************************************
+//
+//! A cached IPv4 address, in host byte order as returned by SimpleLink
+//
+//*****************************************************************************
+typedef struct
+{
+    char cName[DNS_CACHE_NAME_LEN];     /* empty when the entry is free */
+    unsigned long ulAddr;
+    unsigned long ulExpiresMs;
+}DnsCacheEntry_t;
+
+typedef struct
+{
+    DnsCacheEntry_t Entries[DNS_CACHE_ENTRIES];
+    unsigned long ulHits;
+    unsigned long ulMisses;
+}DnsCache_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern void DnsCache_Init(DnsCache_t *pCache);
+extern int DnsCache_Lookup(DnsCache_t *pCache, const char *pcName,
+                           unsigned long ulNowMs, unsigned long *pulAddr);
+extern int DnsCache_Store(DnsCache_t *pCache, const char *pcName,
+                          unsigned long ulAddr, unsigned long ulNowMs,
+                          unsigned long ulTtlMs);
+extern void DnsCache_Invalidate(DnsCache_t *pCache, const char *pcName);
+extern void DnsCache_FormatAddr(unsigned long ulAddr, char *pcBuf);
+
+#endif //  __DNS_CACHE_H__
@@ -0,0 +1,467 @@
+//*****************************************************************************
+// mb_bench.c
+//
+// Modbus TCP load generator and latency benchmark
+//
+// Opens a number of connections to a Modbus TCP server, keeps a configured
+// number of requests outstanding on each and reports the throughput and
+// the response time distribution. Reads and writes are mixed at random in
+// the configured proportion; every request is matched to its response by
+// the MBAP transaction id.
+//
+// Build from the project folder, see host_sim/readme.txt.
+//
+//*****************************************************************************
+
+#define _GNU_SOURCE
+
+// Standard includes
+#include <errno.h>
+#include <getopt.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "modbus_tcp.h"
+#include "latency.h"
+
+#define BENCH_MAX_CONNS         64
+#define BENCH_MAX_DEPTH         64
+#define BENCH_MAX_SAMPLES       (16 * 1024 * 1024)
+#define BENCH_POLL_MS           100
+#define BENCH_DRAIN_US          1000000UL
+#define BENCH_SIM_PORT_OFFSET   10000
+
+typedef struct
+{
+    const char *pcHost;
+    unsigned short usPort;
+    int iConns;
+    int iDepth;
+    int iSeconds;
+    int iWritePct;
+    unsigned char ucReadFc;
+    unsigned short usAddr;
+    unsigned short usQuantity;
+    unsigned char ucUnit;
+}BenchCfg_t;
+
+typedef struct
+{
+    int iSock;
+    int iOutstanding;
+    unsigned short usNextTid;
+    unsigned long ulSentUs[BENCH_MAX_DEPTH];
+    unsigned char ucRx[MB_MAX_ADU_LEN * 4];
+    int iRxLen;
+}BenchConn_t;
+
+typedef struct
+{
+    unsigned long ulRequests;
+    unsigned long ulResponses;
+    unsigned long ulExceptions;
+    unsigned long ulUnmatched;
+    unsigned long ulDisconnects;
+    unsigned long *pulSamples;
+    unsigned long ulNumSamples;
+    unsigned long ulMaxSamples;
+    LatencyHist_t Hist;
+}BenchStats_t;
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+static BenchConn_t g_Conns[BENCH_MAX_CONNS];
+static BenchStats_t g_Stats;
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+static void
+Usage(const char *pcProg)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -H host      server address (127.0.0.1)\n"
+            "  -p port      server port (502, 10502 when not root, as the\n"
+            "               host simulation binds it)\n"
+            "  -c conns     concurrent connections (4)\n"
+            "  -d depth     requests outstanding per connection (1)\n"
+            "  -t seconds   duration (10)\n"
+            "  -w percent   share of writes, FC 06 to the holding register\n"
+            "               at -a (0)\n"
+            "  -f fc        read function code, 1 to 4 (3)\n"
+            "  -a addr      first address (0)\n"
+            "  -q count     registers or bits per read (1)\n"
+            "  -u unit      unit identifier (1)\n", pcProg);
+    exit(2);
+}
+
+//*****************************************************************************
+//
+//! Connects one client socket
+//!
+//! \return the socket, or -1 on failure
+//
+//*****************************************************************************
+static int
+BenchConnect(const BenchCfg_t *pCfg)
+{
+    struct addrinfo sHints;
+    struct addrinfo *pResult;
+    char cPort[8];
+    int iSock;
+
+    memset(&sHints, 0, sizeof(sHints));
+    sHints.ai_family = AF_INET;
+    sHints.ai_socktype = SOCK_STREAM;
+    snprintf(cPort, sizeof(cPort), "%u", pCfg->usPort);
+    if(getaddrinfo(pCfg->pcHost, cPort, &sHints, &pResult) != 0)
+    {
+        return -1;
+    }
+    iSock = socket(AF_INET, SOCK_STREAM, 0);
+    if(iSock >= 0 &&
+       connect(iSock, pResult->ai_addr, pResult->ai_addrlen) < 0)
+    {
+        close(iSock);
+        iSock = -1;
+    }
+    freeaddrinfo(pResult);
+    return iSock;
+}
+
+//*****************************************************************************
+//
+//! Sends the next request on a connection
+//
+//*****************************************************************************
+static int
+BenchSendRequest(const BenchCfg_t *pCfg, BenchConn_t *pConn)
+{
+    unsigned char ucAdu[12];
+    unsigned short usTid = pConn->usNextTid++;
+    unsigned short usValue;
+
+    ucAdu[0] = (unsigned char)(usTid >> 8);
+    ucAdu[1] = (unsigned char)usTid;
+    ucAdu[2] = 0;
+    ucAdu[3] = 0;
+    ucAdu[4] = 0;
+    ucAdu[5] = 6;
+    ucAdu[6] = pCfg->ucUnit;
+    ucAdu[8] = (unsigned char)(pCfg->usAddr >> 8);
+    ucAdu[9] = (unsigned char)pCfg->usAddr;
+    if(rand() % 100 < pCfg->iWritePct)
+    {
+        usValue = (unsigned short)(rand() & 0x7);
+        ucAdu[7] = MB_FC_WRITE_SINGLE_REGISTER;
+        ucAdu[10] = (unsigned char)(usValue >> 8);
+        ucAdu[11] = (unsigned char)usValue;
+    }
+    else
+    {
+        ucAdu[7] = pCfg->ucReadFc;
+        ucAdu[10] = (unsigned char)(pCfg->usQuantity >> 8);
+        ucAdu[11] = (unsigned char)pCfg->usQuantity;
+    }
+
+    pConn->ulSentUs[usTid % BENCH_MAX_DEPTH] = Latency_Stamp();
+    if(send(pConn->iSock, ucAdu, sizeof(ucAdu), MSG_NOSIGNAL) !=
+       sizeof(ucAdu))
+    {
+        return -1;
+    }
+    pConn->iOutstanding++;
+    g_Stats.ulRequests++;
+    return 0;
+}
+
+static void
+BenchRecord(unsigned long ulUs)
+{
+    unsigned long *pulNew;
+
+    Latency_RecordUs(&g_Stats.Hist, ulUs);
+    if(g_Stats.ulNumSamples == g_Stats.ulMaxSamples)
+    {
+        if(g_Stats.ulMaxSamples >= BENCH_MAX_SAMPLES)
+        {
+            return;
+        }
+        pulNew = realloc(g_Stats.pulSamples,
+                         (g_Stats.ulMaxSamples * 2 + 1024) *
+                         sizeof(unsigned long));
+        if(pulNew == NULL)
+        {
+            return;
+        }
+        g_Stats.pulSamples = pulNew;
+        g_Stats.ulMaxSamples = g_Stats.ulMaxSamples * 2 + 1024;
+    }
+    g_Stats.pulSamples[g_Stats.ulNumSamples++] = ulUs;
+}
+
+//*****************************************************************************
+//
+//! Reads the responses waiting on a connection
+//!
+//! \return 0, or -1 if the connection was closed or a frame is malformed
+//
+//*****************************************************************************
+static int
+BenchReceive(BenchConn_t *pConn)
+{
+    unsigned long ulNow;
+    unsigned short usTid;
+    int iRead;
+    int iAduLen;
+    int iPos = 0;
+
+    iRead = recv(pConn->iSock, &pConn->ucRx[pConn->iRxLen],
+                 sizeof(pConn->ucRx) - pConn->iRxLen, MSG_DONTWAIT);
+    if(iRead < 0 && (errno == EAGAIN || errno == EINTR))
+    {
+        return 0;
+    }
+    if(iRead <= 0)
+    {
+        return -1;
+    }
+    pConn->iRxLen += iRead;
+    ulNow = Latency_Stamp();
+
+    while(pConn->iRxLen - iPos >= MB_MBAP_LEN + 1)
+    {
+        iAduLen = 6 + ((pConn->ucRx[iPos + 4] << 8) | pConn->ucRx[iPos + 5]);
+        if(iAduLen < MB_MBAP_LEN + 1 || iAduLen > MB_MAX_ADU_LEN)
+        {
+            return -1;
+        }
+        if(pConn->iRxLen - iPos < iAduLen)
+        {
+            break;
+        }
+
+        usTid = (pConn->ucRx[iPos] << 8) | pConn->ucRx[iPos + 1];
+        if(pConn->iOutstanding > 0 &&
+           (unsigned short)(pConn->usNextTid - usTid - 1) <
+           (unsigned short)pConn->iOutstanding)
+        {
+            BenchRecord(ulNow - pConn->ulSentUs[usTid % BENCH_MAX_DEPTH]);
+            pConn->iOutstanding--;
+            g_Stats.ulResponses++;
+            if(pConn->ucRx[iPos + 7] & 0x80)
+            {
+                g_Stats.ulExceptions++;
+            }
+        }
+        else
+        {
+            g_Stats.ulUnmatched++;
+        }
+        iPos += iAduLen;
+    }
+
+    memmove(pConn->ucRx, &pConn->ucRx[iPos], pConn->iRxLen - iPos);
+    pConn->iRxLen -= iPos;
+    return 0;
+}
+
+static int
+CompareUlong(const void *pvA, const void *pvB)
+{
+    unsigned long ulA = *(const unsigned long *)pvA;
+    unsigned long ulB = *(const unsigned long *)pvB;
+
+    return (ulA > ulB) - (ulA < ulB);
+}
+
+static unsigned long
+Percentile(double dFraction)
+{
+    unsigned long ulIndex;
+
+    if(g_Stats.ulNumSamples == 0)
+    {
+        return 0;
+    }
+    ulIndex = (unsigned long)(dFraction * g_Stats.ulNumSamples);
+    if(ulIndex >= g_Stats.ulNumSamples)
+    {
+        ulIndex = g_Stats.ulNumSamples - 1;
+    }
+    return g_Stats.pulSamples[ulIndex];
+}
+
+//*****************************************************************************
+//
+//! Prints the results
+//
+//*****************************************************************************
+static void
+BenchReport(const BenchCfg_t *pCfg, unsigned long ulElapsedUs)
+{
+    double dSeconds = ulElapsedUs / 1000000.0;
+    unsigned long ulLow;
+    int iBucket;
+
+    qsort(g_Stats.pulSamples, g_Stats.ulNumSamples, sizeof(unsigned long),
+          CompareUlong);
+
+    printf("Modbus TCP benchmark: %s:%u, %d connections, depth %d, "
+           "%d%% writes, %.1f s\n", pCfg->pcHost, pCfg->usPort,
+           pCfg->iConns, pCfg->iDepth, pCfg->iWritePct, dSeconds);
+    printf("requests    %lu sent, %lu answered, %.1f/s\n",
+           g_Stats.ulRequests, g_Stats.ulResponses,
+           g_Stats.ulResponses / dSeconds);
+    printf("errors      %lu exceptions, %lu unmatched, %lu disconnects\n",
+           g_Stats.ulExceptions, g_Stats.ulUnmatched, g_Stats.ulDisconnects);
+    printf("latency us  min %lu p50 %lu p99 %lu p999 %lu max %lu\n",
+           g_Stats.Hist.ulMinUs, Percentile(0.50), Percentile(0.99),
+           Percentile(0.999), g_Stats.Hist.ulMaxUs);
+    printf("histogram   us, count\n");
+    for(iBucket = 0; iBucket < LAT_NUM_BUCKETS; iBucket++)
+    {
+        if(g_Stats.Hist.ulBuckets[iBucket] == 0)
+        {
+            continue;
+        }
+        ulLow = (iBucket == 0) ? 0 : (1UL << iBucket);
+        if(iBucket == LAT_NUM_BUCKETS - 1)
+        {
+            printf("  >= %-8lu %lu\n", ulLow, g_Stats.Hist.ulBuckets[iBucket]);
+        }
+        else
+        {
+            printf("  %6lu-%-6lu %lu\n", ulLow, (2UL << iBucket) - 1,
+                   g_Stats.Hist.ulBuckets[iBucket]);
+        }
+    }
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct pollfd sPoll[BENCH_MAX_CONNS];
+    BenchCfg_t sCfg;
+    unsigned long ulStart;
+    unsigned long ulEnd;
+    unsigned long ulNow;
+    int iOpen = 0;
+    int iIndex;
+    int iOpt;
+
+    memset(&sCfg, 0, sizeof(sCfg));
+    sCfg.pcHost = "127.0.0.1";
+    sCfg.usPort = MB_TCP_PORT + (geteuid() == 0 ? 0 : BENCH_SIM_PORT_OFFSET);
+    sCfg.iConns = 4;
+    sCfg.iDepth = 1;
+    sCfg.iSeconds = 10;
+    sCfg.ucReadFc = MB_FC_READ_HOLDING_REGISTERS;
+    sCfg.usQuantity = 1;
+    sCfg.ucUnit = 1;
+    while((iOpt = getopt(argc, argv, "H:p:c:d:t:w:f:a:q:u:")) != -1)
+    {
+        switch(iOpt)
+        {
+            case 'H': sCfg.pcHost = optarg; break;
+            case 'p': sCfg.usPort = atoi(optarg); break;
+            case 'c': sCfg.iConns = atoi(optarg); break;
+            case 'd': sCfg.iDepth = atoi(optarg); break;
+            case 't': sCfg.iSeconds = atoi(optarg); break;
+            case 'w': sCfg.iWritePct = atoi(optarg); break;
+            case 'f': sCfg.ucReadFc = atoi(optarg); break;
+            case 'a': sCfg.usAddr = atoi(optarg); break;
+            case 'q': sCfg.usQuantity = atoi(optarg); break;
+            case 'u': sCfg.ucUnit = atoi(optarg); break;
+            default: Usage(argv[0]);
+        }
+    }
+    if(sCfg.iConns < 1 || sCfg.iConns > BENCH_MAX_CONNS ||
+       sCfg.iDepth < 1 || sCfg.iDepth > BENCH_MAX_DEPTH ||
+       sCfg.iSeconds < 1 || sCfg.ucReadFc < MB_FC_READ_COILS ||
+       sCfg.ucReadFc > MB_FC_READ_INPUT_REGISTERS)
+    {
+        Usage(argv[0]);
+    }
+
+    Latency_Init(0);
+    g_Stats.Hist.pcName = "Modbus rsp";
+    for(iIndex = 0; iIndex < sCfg.iConns; iIndex++)
+    {
+        g_Conns[iIndex].iSock = BenchConnect(&sCfg);
+        if(g_Conns[iIndex].iSock < 0)
+        {
+            fprintf(stderr, "connect %s:%u failed\n", sCfg.pcHost,
+                    sCfg.usPort);
+            return 1;
+        }
+        iOpen++;
+    }
+
+    //
+    // Keep every connection at the configured depth until the time is up,
+    // then give the outstanding requests a moment to complete
+    //
+    ulStart = Latency_Stamp();
+    ulEnd = ulStart + sCfg.iSeconds * 1000000UL;
+    ulNow = ulStart;
+    while(iOpen > 0)
+    {
+        bool bRunning = (ulNow < ulEnd);
+        int iPending = 0;
+
+        for(iIndex = 0; iIndex < sCfg.iConns; iIndex++)
+        {
+            BenchConn_t *pConn = &g_Conns[iIndex];
+
+            while(bRunning && pConn->iSock >= 0 &&
+                  pConn->iOutstanding < sCfg.iDepth)
+            {
+                if(BenchSendRequest(&sCfg, pConn) < 0)
+                {
+                    close(pConn->iSock);
+                    pConn->iSock = -1;
+                    g_Stats.ulDisconnects++;
+                    iOpen--;
+                }
+            }
+            if(pConn->iSock >= 0)
+            {
+                iPending += pConn->iOutstanding;
+            }
+            sPoll[iIndex].fd = pConn->iSock;
+            sPoll[iIndex].events = POLLIN;
+            sPoll[iIndex].revents = 0;
+        }
+        if(!bRunning && (iPending == 0 || ulNow >= ulEnd + BENCH_DRAIN_US))
+        {
+            break;
+        }
+
+        poll(sPoll, sCfg.iConns, BENCH_POLL_MS);
+        for(iIndex = 0; iIndex < sCfg.iConns; iIndex++)
+        {
+            if(g_Conns[iIndex].iSock >= 0 &&
+               (sPoll[iIndex].revents & (POLLIN | POLLERR | POLLHUP)) &&
+               BenchReceive(&g_Conns[iIndex]) < 0)
+            {
+                close(g_Conns[iIndex].iSock);
+                g_Conns[iIndex].iSock = -1;
+                g_Stats.ulDisconnects++;
+                iOpen--;
+            }
+        }
+        ulNow = Latency_Stamp();
+    }
+
+    BenchReport(&sCfg, ulNow - ulStart);
+    return (g_Stats.ulResponses > 0) ? 0 : 1;
+}
@@ -0,0 +1,1094 @@
+//*****************************************************************************
+// mqtt_bench.c
+//
+// MQTT throughput, command latency and reconnect benchmark
+//
+// Runs a minimal MQTT 3.1.1 broker on loopback and, optionally, starts the
+// host simulation connected to it. Being the broker, the harness sees every
+// message of the device as it arrives and injects commands itself, so no
+// broker fan-out is part of the figures. Three measurements are made:
+//
+//   command latency  a publish to the command topic until the red LED
+//                    changes, seen in the simulation's SIM_TRACE_LEDS output
+//   throughput       messages per second the device publishes at each QoS,
+//                    driven by the .../cmd/bench command, with losses and
+//                    reordering checked by the sequence numbers
+//   reconnect        closing the device connections until the device is
+//                    connected and subscribed again
+//
+// Progress goes to stderr, the results to stdout as one JSON object.
+//
+// Build from the project folder, see host_sim/readme.txt.
+//
+//*****************************************************************************
+
+#define _GNU_SOURCE
+
+// Standard includes
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "latency.h"
+
+#define BENCH_MAX_SESSIONS      8
+#define BENCH_MAX_FILTERS       8
+#define BENCH_TOPIC_LEN         96
+#define BENCH_ID_LEN            32
+#define BENCH_RX_LEN            4096
+#define BENCH_POLL_MS           50
+#define BENCH_CMD_TIMEOUT_US    1000000UL
+#define BENCH_STALL_US          3000000UL
+#define BENCH_RECONNECT_US      60000000UL
+#define BENCH_SETTLE_US         1000000UL
+#define BENCH_CHILD_EXIT_MS     2000
+
+/* MQTT control packet types, high nibble of the fixed header */
+#define MQTT_CONNECT            0x10
+#define MQTT_CONNACK            0x20
+#define MQTT_PUBLISH            0x30
+#define MQTT_PUBACK             0x40
+#define MQTT_PUBREC             0x50
+#define MQTT_PUBREL             0x60
+#define MQTT_PUBCOMP            0x70
+#define MQTT_SUBSCRIBE          0x80
+#define MQTT_SUBACK             0x90
+#define MQTT_UNSUBSCRIBE        0xA0
+#define MQTT_UNSUBACK           0xB0
+#define MQTT_PINGREQ            0xC0
+#define MQTT_PINGRESP           0xD0
+#define MQTT_DISCONNECT         0xE0
+
+typedef struct
+{
+    unsigned short usPort;
+    int iCommands;
+    unsigned long ulMessages;
+    int iLength;
+    const char *pcQosList;
+    int iReconnects;
+    const char *pcCmdTopic;
+    int iWaitSeconds;
+    bool bVerbose;
+}BenchCfg_t;
+
+typedef struct
+{
+    int iSock;
+    char cClientId[BENCH_ID_LEN];
+    char cFilters[BENCH_MAX_FILTERS][BENCH_TOPIC_LEN];
+    unsigned char ucGranted[BENCH_MAX_FILTERS];
+    int iNumFilters;
+    unsigned char ucRx[BENCH_RX_LEN];
+    int iRxLen;
+}BenchSession_t;
+
+typedef struct
+{
+    unsigned long ulExpected;
+    unsigned long ulReceived;
+    unsigned long ulNextSeq;
+    unsigned long ulOutOfOrder;
+    unsigned long ulDuplicates;
+    unsigned long ulLastUs;
+    unsigned char *pucSeen;
+}BenchStream_t;
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+static BenchSession_t g_Sessions[BENCH_MAX_SESSIONS];
+static BenchStream_t g_Stream;
+static char g_cBenchTopic[BENCH_TOPIC_LEN];
+static char g_cDeviceId[BENCH_ID_LEN];
+static const char *g_pcCmdTopic;
+static int g_iListen = -1;
+static unsigned short g_usNextMsgId = 1;
+
+static pid_t g_ChildPid = -1;
+static int g_iChildIn = -1;
+static int g_iChildOut = -1;
+static char g_cChildLine[256];
+static int g_iChildLineLen;
+static bool g_bVerbose;
+
+static unsigned long g_ulLedChanges;
+static unsigned long g_ulLedUs;
+static unsigned long g_ulConnects;
+static unsigned long g_ulFirstConnectUs;
+static unsigned long g_ulSubscribes;
+static unsigned long g_ulSubscribeUs;
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+static void
+Usage(const char *pcProg)
+{
+    fprintf(stderr,
+            "usage: %s [options] [-- simulation [args]]\n"
+            "  -p port      broker port (1883)\n"
+            "  -n count     command latency samples (100)\n"
+            "  -m count     messages per QoS level (2000)\n"
+            "  -l length    message length, 4 to 176 bytes (32)\n"
+            "  -q levels    QoS levels to measure (012)\n"
+            "  -r count     reconnects (3)\n"
+            "  -T topic     command topic toggling the red LED\n"
+            "               (/cc3200/ToggleLEDCmdL1)\n"
+            "  -w seconds   time for the device to subscribe (30)\n"
+            "  -v           copy the simulation's output to stderr\n"
+            "The simulation is started with SIM_MQTT_BROKER pointing to the\n"
+            "broker and SIM_TRACE_LEDS set. Without it the command latency\n"
+            "is not measured.\n", pcProg);
+    exit(2);
+}
+
+//*****************************************************************************
+//
+//! Tells whether a topic matches a subscription filter with + and #
+//
+//*****************************************************************************
+static bool
+TopicMatch(const char *pcFilter, const char *pcTopic, int iTopicLen)
+{
+    const char *pcEnd = pcTopic + iTopicLen;
+
+    while(*pcFilter != '\0')
+    {
+        if(*pcFilter == '#')
+        {
+            return true;
+        }
+        if(*pcFilter == '+')
+        {
+            while(pcTopic < pcEnd && *pcTopic != '/')
+            {
+                pcTopic++;
+            }
+            pcFilter++;
+            continue;
+        }
+        if(pcTopic == pcEnd || *pcFilter != *pcTopic)
+        {
+            return false;
+        }
+        pcFilter++;
+        pcTopic++;
+    }
+    return pcTopic == pcEnd;
+}
+
+static void
+SessionClose(BenchSession_t *pSess)
+{
+    if(pSess->iSock >= 0)
+    {
+        close(pSess->iSock);
+    }
+    memset(pSess, 0, sizeof(BenchSession_t));
+    pSess->iSock = -1;
+}
+
+static void
+SessionSend(BenchSession_t *pSess, const unsigned char *pucBuf, int iLen)
+{
+    if(send(pSess->iSock, pucBuf, iLen, MSG_NOSIGNAL) != iLen)
+    {
+        SessionClose(pSess);
+    }
+}
+
+static void
+SessionSendAck(BenchSession_t *pSess, unsigned char ucType,
+               unsigned short usMsgId)
+{
+    unsigned char ucPkt[4];
+
+    ucPkt[0] = ucType;
+    ucPkt[1] = 2;
+    ucPkt[2] = (unsigned char)(usMsgId >> 8);
+    ucPkt[3] = (unsigned char)usMsgId;
+    SessionSend(pSess, ucPkt, sizeof(ucPkt));
+}
+
+//*****************************************************************************
+//
+//! Publishes a message to the subscribers, once per client id: the host
+//! simulation opens every broker connection of the device with the same id
+//! and would otherwise act on a command twice
+//
+//*****************************************************************************
+static void
+BrokerDeliver(const char *pcTopic, const char *pcPayload, unsigned char ucQos)
+{
+    unsigned char ucPkt[512];
+    const char *pcDone[BENCH_MAX_SESSIONS];
+    int iNumDone = 0;
+    int iTopicLen = strlen(pcTopic);
+    int iPayLen = strlen(pcPayload);
+    int iRemLen;
+    int iPos;
+    int iSess;
+    int iFilter;
+    int iDone;
+    unsigned char ucSubQos;
+
+    for(iSess = 0; iSess < BENCH_MAX_SESSIONS; iSess++)
+    {
+        BenchSession_t *pSess = &g_Sessions[iSess];
+
+        for(iDone = 0; iDone < iNumDone; iDone++)
+        {
+            if(strcmp(pcDone[iDone], pSess->cClientId) == 0)
+            {
+                break;
+            }
+        }
+        if(pSess->iSock < 0 || iDone < iNumDone)
+        {
+            continue;
+        }
+        for(iFilter = 0; iFilter < pSess->iNumFilters; iFilter++)
+        {
+            if(TopicMatch(pSess->cFilters[iFilter], pcTopic, iTopicLen))
+            {
+                break;
+            }
+        }
+        if(iFilter == pSess->iNumFilters)
+        {
+            continue;
+        }
+
+        ucSubQos = pSess->ucGranted[iFilter];
+        if(ucSubQos > ucQos)
+        {
+            ucSubQos = ucQos;
+        }
+        iRemLen = 2 + iTopicLen + (ucSubQos ? 2 : 0) + iPayLen;
+        ucPkt[0] = MQTT_PUBLISH | (ucSubQos << 1);
+        iPos = 1;
+        if(iRemLen >= 128)
+        {
+            ucPkt[iPos++] = (unsigned char)(iRemLen | 0x80);
+            iRemLen >>= 7;
+        }
+        ucPkt[iPos++] = (unsigned char)iRemLen;
+        ucPkt[iPos++] = (unsigned char)(iTopicLen >> 8);
+        ucPkt[iPos++] = (unsigned char)iTopicLen;
+        memcpy(&ucPkt[iPos], pcTopic, iTopicLen);
+        iPos += iTopicLen;
+        if(ucSubQos)
+        {
+            ucPkt[iPos++] = (unsigned char)(g_usNextMsgId >> 8);
+            ucPkt[iPos++] = (unsigned char)g_usNextMsgId;
+            g_usNextMsgId = (g_usNextMsgId == 0xFFFF) ? 1 : g_usNextMsgId + 1;
+        }
+        memcpy(&ucPkt[iPos], pcPayload, iPayLen);
+        pcDone[iNumDone++] = pSess->cClientId;
+        SessionSend(pSess, ucPkt, iPos + iPayLen);
+    }
+}
+
+//*****************************************************************************
+//
+//! Accounts for a message published by the device on the benchmark topic.
+//! The payload starts with the sequence number, most significant byte first.
+//
+//*****************************************************************************
+static void
+StreamReceive(const unsigned char *pucPayload, int iLen)
+{
+    unsigned long ulSeq;
+
+    if(iLen < 4 || g_Stream.pucSeen == NULL)
+    {
+        return;
+    }
+    ulSeq = ((unsigned long)pucPayload[0] << 24) |
+            ((unsigned long)pucPayload[1] << 16) |
+            ((unsigned long)pucPayload[2] << 8) | pucPayload[3];
+    if(ulSeq >= g_Stream.ulExpected)
+    {
+        return;
+    }
+    if(g_Stream.pucSeen[ulSeq / 8] & (1 << (ulSeq % 8)))
+    {
+        g_Stream.ulDuplicates++;
+        return;
+    }
+    g_Stream.pucSeen[ulSeq / 8] |= 1 << (ulSeq % 8);
+    if(ulSeq < g_Stream.ulNextSeq)
+    {
+        // overtaken by a later message
+        g_Stream.ulOutOfOrder++;
+    }
+    else
+    {
+        g_Stream.ulNextSeq = ulSeq + 1;
+    }
+    g_Stream.ulReceived++;
+    g_Stream.ulLastUs = Latency_Stamp();
+}
+
+//*****************************************************************************
+//
+//! Handles one control packet of a session
+//!
+//! \return 0, or -1 if the session is to be closed
+//
+//*****************************************************************************
+static int
+SessionPacket(BenchSession_t *pSess, unsigned char ucHdr,
+              const unsigned char *pucBody, int iLen)
+{
+    unsigned short usMsgId;
+    unsigned char ucSubAck[4 + BENCH_MAX_FILTERS];
+    unsigned char ucQos;
+    int iPos;
+    int iStrLen;
+    int iNumAcks = 0;
+    bool bCmdTopic = false;
+
+    switch(ucHdr & 0xF0)
+    {
+        case MQTT_CONNECT:
+            // protocol name, level, flags and keep alive, then the client id
+            if(iLen < 2)
+            {
+                return -1;
+            }
+            iPos = 2 + ((pucBody[0] << 8) | pucBody[1]) + 4;
+            if(iPos + 2 > iLen)
+            {
+                return -1;
+            }
+            iStrLen = (pucBody[iPos] << 8) | pucBody[iPos + 1];
+            if(iStrLen >= BENCH_ID_LEN || iPos + 2 + iStrLen > iLen)
+            {
+                return -1;
+            }
+            memcpy(pSess->cClientId, &pucBody[iPos + 2], iStrLen);
+            pSess->cClientId[iStrLen] = '\0';
+            SessionSendAck(pSess, MQTT_CONNACK, 0);
+            g_ulConnects++;
+            if(g_ulFirstConnectUs == 0)
+            {
+                g_ulFirstConnectUs = Latency_Stamp();
+            }
+            break;
+
+        case MQTT_PUBLISH:
+            ucQos = (ucHdr >> 1) & 3;
+            if(iLen < 2)
+            {
+                return -1;
+            }
+            iStrLen = (pucBody[0] << 8) | pucBody[1];
+            iPos = 2 + iStrLen + (ucQos ? 2 : 0);
+            if(iPos > iLen)
+            {
+                return -1;
+            }
+            if(ucQos)
+            {
+                usMsgId = (pucBody[iPos - 2] << 8) | pucBody[iPos - 1];
+                SessionSendAck(pSess, (ucQos == 1) ? MQTT_PUBACK : MQTT_PUBREC,
+                               usMsgId);
+            }
+            if(iStrLen == (int)strlen(g_cBenchTopic) &&
+               memcmp(&pucBody[2], g_cBenchTopic, iStrLen) == 0)
+            {
+                StreamReceive(&pucBody[iPos], iLen - iPos);
+            }
+            break;
+
+        case MQTT_PUBREC:
+        case MQTT_PUBREL:
+            if(iLen < 2)
+            {
+                return -1;
+            }
+            usMsgId = (pucBody[0] << 8) | pucBody[1];
+            SessionSendAck(pSess, ((ucHdr & 0xF0) == MQTT_PUBREC) ?
+                                  (MQTT_PUBREL | 0x02) : MQTT_PUBCOMP,
+                           usMsgId);
+            break;
+
+        case MQTT_SUBSCRIBE:
+            if(iLen < 2)
+            {
+                return -1;
+            }
+            iPos = 2;
+            while(iPos + 2 < iLen && iNumAcks < BENCH_MAX_FILTERS)
+            {
+                iStrLen = (pucBody[iPos] << 8) | pucBody[iPos + 1];
+                if(iPos + 2 + iStrLen >= iLen)
+                {
+                    return -1;
+                }
+                ucQos = pucBody[iPos + 2 + iStrLen] & 3;
+                if(ucQos > 2)
+                {
+                    ucQos = 2;
+                }
+                if(iStrLen < BENCH_TOPIC_LEN &&
+                   pSess->iNumFilters < BENCH_MAX_FILTERS)
+                {
+                    memcpy(pSess->cFilters[pSess->iNumFilters],
+                           &pucBody[iPos + 2], iStrLen);
+                    pSess->cFilters[pSess->iNumFilters][iStrLen] = '\0';
+                    pSess->ucGranted[pSess->iNumFilters] = ucQos;
+                    if(strcmp(pSess->cFilters[pSess->iNumFilters],
+                              g_pcCmdTopic) == 0)
+                    {
+                        bCmdTopic = true;
+                    }
+                    pSess->iNumFilters++;
+                }
+                else
+                {
+                    ucQos = 0x80;
+                }
+                ucSubAck[4 + iNumAcks++] = ucQos;
+                iPos += 3 + iStrLen;
+            }
+            ucSubAck[0] = MQTT_SUBACK;
+            ucSubAck[1] = (unsigned char)(2 + iNumAcks);
+            ucSubAck[2] = pucBody[0];
+            ucSubAck[3] = pucBody[1];
+            SessionSend(pSess, ucSubAck, 4 + iNumAcks);
+            if(bCmdTopic)
+            {
+                strcpy(g_cDeviceId, pSess->cClientId);
+                g_ulSubscribes++;
+                g_ulSubscribeUs = Latency_Stamp();
+            }
+            break;
+
+        case MQTT_UNSUBSCRIBE:
+            if(iLen < 2)
+            {
+                return -1;
+            }
+            SessionSendAck(pSess, MQTT_UNSUBACK,
+                           (pucBody[0] << 8) | pucBody[1]);
+            break;
+
+        case MQTT_PINGREQ:
+            ucSubAck[0] = MQTT_PINGRESP;
+            ucSubAck[1] = 0;
+            SessionSend(pSess, ucSubAck, 2);
+            break;
+
+        case MQTT_DISCONNECT:
+            return -1;
+
+        default:
+            // acks of the commands need no answer
+            break;
+    }
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Reads the packets waiting on a session
+//
+//*****************************************************************************
+static void
+SessionReceive(BenchSession_t *pSess)
+{
+    unsigned long ulRemLen;
+    int iRead;
+    int iPos = 0;
+    int iHdrLen;
+    int iShift;
+
+    iRead = recv(pSess->iSock, &pSess->ucRx[pSess->iRxLen],
+                 sizeof(pSess->ucRx) - pSess->iRxLen, MSG_DONTWAIT);
+    if(iRead < 0 && (errno == EAGAIN || errno == EINTR))
+    {
+        return;
+    }
+    if(iRead <= 0)
+    {
+        SessionClose(pSess);
+        return;
+    }
+    pSess->iRxLen += iRead;
+
+    for(;;)
+    {
+        // fixed header: type and flags, remaining length in 1 to 4 bytes
+        ulRemLen = 0;
+        iShift = 0;
+        for(iHdrLen = 1; iHdrLen <= 4 && iPos + iHdrLen < pSess->iRxLen;
+            iHdrLen++)
+        {
+            ulRemLen |= (unsigned long)(pSess->ucRx[iPos + iHdrLen] & 0x7F)
+                        << iShift;
+            iShift += 7;
+            if((pSess->ucRx[iPos + iHdrLen] & 0x80) == 0)
+            {
+                break;
+            }
+        }
+        if(iHdrLen > 4 || ulRemLen > BENCH_RX_LEN - 5)
+        {
+            SessionClose(pSess);
+            return;
+        }
+        if(iPos + iHdrLen >= pSess->iRxLen ||
+           iPos + iHdrLen + 1 + (int)ulRemLen > pSess->iRxLen)
+        {
+            break;
+        }
+        if(SessionPacket(pSess, pSess->ucRx[iPos],
+                         &pSess->ucRx[iPos + iHdrLen + 1], ulRemLen) < 0)
+        {
+            SessionClose(pSess);
+            return;
+        }
+        if(pSess->iSock < 0)
+        {
+            return;
+        }
+        iPos += iHdrLen + 1 + ulRemLen;
+    }
+
+    memmove(pSess->ucRx, &pSess->ucRx[iPos], pSess->iRxLen - iPos);
+    pSess->iRxLen -= iPos;
+}
+
+//*****************************************************************************
+//
+//! Takes the lines the simulation prints and notes the changes of the red
+//! LED
+//
+//*****************************************************************************
+static void
+ChildReceive(void)
+{
+    char cBuf[1024];
+    int iRead;
+    int iIndex;
+    char cChar;
+
+    iRead = read(g_iChildOut, cBuf, sizeof(cBuf));
+    if(iRead <= 0)
+    {
+        if(iRead == 0 || errno != EAGAIN)
+        {
+            close(g_iChildOut);
+            g_iChildOut = -1;
+        }
+        return;
+    }
+
+    for(iIndex = 0; iIndex < iRead; iIndex++)
+    {
+        cChar = cBuf[iIndex];
+        if(cChar != '\n' && g_iChildLineLen < (int)sizeof(g_cChildLine) - 1)
+        {
+            if(cChar != '\r')
+            {
+                g_cChildLine[g_iChildLineLen++] = cChar;
+            }
+            continue;
+        }
+        g_cChildLine[g_iChildLineLen] = '\0';
+        g_iChildLineLen = 0;
+        if(strstr(g_cChildLine, "[sim] red LED") != NULL)
+        {
+            g_ulLedChanges++;
+            g_ulLedUs = Latency_Stamp();
+        }
+        if(g_bVerbose && g_cChildLine[0] != '\0')
+        {
+            fprintf(stderr, "  | %s\n", g_cChildLine);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! Serves the broker and the simulation's output for up to iTimeoutMs
+//
+//*****************************************************************************
+static void
+BrokerPoll(int iTimeoutMs)
+{
+    struct pollfd sPoll[BENCH_MAX_SESSIONS + 2];
+    int iSess;
+    int iSock;
+
+    for(iSess = 0; iSess < BENCH_MAX_SESSIONS; iSess++)
+    {
+        sPoll[iSess].fd = g_Sessions[iSess].iSock;
+        sPoll[iSess].events = POLLIN;
+        sPoll[iSess].revents = 0;
+    }
+    sPoll[BENCH_MAX_SESSIONS].fd = g_iListen;
+    sPoll[BENCH_MAX_SESSIONS].events = POLLIN;
+    sPoll[BENCH_MAX_SESSIONS].revents = 0;
+    sPoll[BENCH_MAX_SESSIONS + 1].fd = g_iChildOut;
+    sPoll[BENCH_MAX_SESSIONS + 1].events = POLLIN;
+    sPoll[BENCH_MAX_SESSIONS + 1].revents = 0;
+    if(poll(sPoll, BENCH_MAX_SESSIONS + 2, iTimeoutMs) <= 0)
+    {
+        return;
+    }
+
+    if(sPoll[BENCH_MAX_SESSIONS + 1].revents)
+    {
+        ChildReceive();
+    }
+    for(iSess = 0; iSess < BENCH_MAX_SESSIONS; iSess++)
+    {
+        if(g_Sessions[iSess].iSock >= 0 && sPoll[iSess].revents)
+        {
+            SessionReceive(&g_Sessions[iSess]);
+        }
+    }
+    if(sPoll[BENCH_MAX_SESSIONS].revents & POLLIN)
+    {
+        iSock = accept(g_iListen, NULL, NULL);
+        for(iSess = 0; iSess < BENCH_MAX_SESSIONS; iSess++)
+        {
+            if(g_Sessions[iSess].iSock < 0)
+            {
+                g_Sessions[iSess].iSock = iSock;
+                iSock = -1;
+                break;
+            }
+        }
+        if(iSock >= 0)
+        {
+            close(iSock);
+        }
+    }
+}
+
+static int
+BrokerListen(unsigned short usPort)
+{
+    struct sockaddr_in sAddr;
+    int iOne = 1;
+    int iSess;
+
+    for(iSess = 0; iSess < BENCH_MAX_SESSIONS; iSess++)
+    {
+        g_Sessions[iSess].iSock = -1;
+    }
+    g_iListen = socket(AF_INET, SOCK_STREAM, 0);
+    if(g_iListen < 0)
+    {
+        return -1;
+    }
+    setsockopt(g_iListen, SOL_SOCKET, SO_REUSEADDR, &iOne, sizeof(iOne));
+    memset(&sAddr, 0, sizeof(sAddr));
+    sAddr.sin_family = AF_INET;
+    sAddr.sin_port = htons(usPort);
+    sAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(g_iListen, (struct sockaddr *)&sAddr, sizeof(sAddr)) < 0 ||
+       listen(g_iListen, BENCH_MAX_SESSIONS) < 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Starts the simulation with its stdin and stdout on pipes
+//
+//*****************************************************************************
+static int
+ChildStart(char *argv[], unsigned short usPort)
+{
+    char cBroker[32];
+    int iIn[2];
+    int iOut[2];
+
+    if(pipe(iIn) < 0 || pipe(iOut) < 0)
+    {
+        return -1;
+    }
+    snprintf(cBroker, sizeof(cBroker), "127.0.0.1:%u", usPort);
+
+    g_ChildPid = fork();
+    if(g_ChildPid < 0)
+    {
+        return -1;
+    }
+    if(g_ChildPid == 0)
+    {
+        dup2(iIn[0], STDIN_FILENO);
+        dup2(iOut[1], STDOUT_FILENO);
+        close(iIn[0]);
+        close(iIn[1]);
+        close(iOut[0]);
+        close(iOut[1]);
+        close(g_iListen);
+        setenv("SIM_MQTT_BROKER", cBroker, 1);
+        setenv("SIM_TRACE_LEDS", "1", 1);
+        execvp(argv[0], argv);
+        perror(argv[0]);
+        _exit(127);
+    }
+
+    close(iIn[0]);
+    close(iOut[1]);
+    g_iChildIn = iIn[1];
+    g_iChildOut = iOut[0];
+    fcntl(g_iChildOut, F_SETFL, O_NONBLOCK);
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Quits the simulation, killing it if it does not exit in time
+//
+//*****************************************************************************
+static void
+ChildStop(void)
+{
+    int iWaited;
+
+    if(g_ChildPid < 0)
+    {
+        return;
+    }
+    if(write(g_iChildIn, "q\n", 2) != 2)
+    {
+        kill(g_ChildPid, SIGTERM);
+    }
+    for(iWaited = 0; iWaited < BENCH_CHILD_EXIT_MS; iWaited += BENCH_POLL_MS)
+    {
+        if(waitpid(g_ChildPid, NULL, WNOHANG) == g_ChildPid)
+        {
+            g_ChildPid = -1;
+            return;
+        }
+        BrokerPoll(BENCH_POLL_MS);
+    }
+    kill(g_ChildPid, SIGKILL);
+    waitpid(g_ChildPid, NULL, 0);
+    g_ChildPid = -1;
+}
+
+static int
+CompareUlong(const void *pvA, const void *pvB)
+{
+    unsigned long ulA = *(const unsigned long *)pvA;
+    unsigned long ulB = *(const unsigned long *)pvB;
+
+    return (ulA > ulB) - (ulA < ulB);
+}
+
+//*****************************************************************************
+//
+//! Prints the distribution of a set of samples as a JSON object
+//
+//*****************************************************************************
+static void
+PrintSamples(const char *pcName, unsigned long *pulSamples, int iNum,
+             int iLost)
+{
+    unsigned long long ullSum = 0;
+    int iIndex;
+
+    printf("  \"%s\": {\"samples\": %d, \"lost\": %d", pcName, iNum, iLost);
+    if(iNum > 0)
+    {
+        qsort(pulSamples, iNum, sizeof(unsigned long), CompareUlong);
+        for(iIndex = 0; iIndex < iNum; iIndex++)
+        {
+            ullSum += pulSamples[iIndex];
+        }
+        printf(", \"min\": %lu, \"avg\": %llu, \"p50\": %lu, \"p99\": %lu, "
+               "\"max\": %lu", pulSamples[0], ullSum / iNum,
+               pulSamples[iNum / 2], pulSamples[(iNum * 99) / 100],
+               pulSamples[iNum - 1]);
+    }
+    printf("}");
+}
+
+//*****************************************************************************
+//
+//! Waits for a subscription to the command topic
+//!
+//! \param ulSubscribes is the number of subscriptions seen so far
+//! \param ulTimeoutUs is the time to wait
+//!
+//! \return true once a further subscription was made
+//
+//*****************************************************************************
+static bool
+WaitSubscribed(unsigned long ulSubscribes, unsigned long ulTimeoutUs)
+{
+    unsigned long ulStart = Latency_Stamp();
+
+    while(g_ulSubscribes == ulSubscribes)
+    {
+        if(Latency_Stamp() - ulStart >= ulTimeoutUs)
+        {
+            return false;
+        }
+        BrokerPoll(BENCH_POLL_MS);
+    }
+    return true;
+}
+
+//*****************************************************************************
+//
+//! Publishes commands toggling the red LED, one at a time, and times them
+//! until the simulation reports the change
+//
+//*****************************************************************************
+static void
+BenchCommands(const BenchCfg_t *pCfg)
+{
+    unsigned long *pulSamples = calloc(pCfg->iCommands,
+                                       sizeof(unsigned long));
+    unsigned long ulChanges;
+    unsigned long ulStart;
+    int iNum = 0;
+    int iLost = 0;
+    int iCmd;
+
+    fprintf(stderr, "command latency: %d commands on %s\n",
+            pCfg->iCommands, pCfg->pcCmdTopic);
+    for(iCmd = 0; iCmd < pCfg->iCommands && pulSamples != NULL; iCmd++)
+    {
+        ulChanges = g_ulLedChanges;
+        ulStart = Latency_Stamp();
+        BrokerDeliver(pCfg->pcCmdTopic, "toggle", 1);
+        while(g_ulLedChanges == ulChanges &&
+              Latency_Stamp() - ulStart < BENCH_CMD_TIMEOUT_US)
+        {
+            BrokerPoll(BENCH_POLL_MS);
+        }
+        if(g_ulLedChanges == ulChanges)
+        {
+            iLost++;
+            continue;
+        }
+        pulSamples[iNum++] = g_ulLedUs - ulStart;
+    }
+    PrintSamples("command_latency_us", pulSamples, iNum, iLost);
+    printf(",\n");
+    free(pulSamples);
+}
+
+//*****************************************************************************
+//
+//! Has the device publish a burst at one QoS level and counts the messages
+//! as they arrive
+//
+//*****************************************************************************
+static void
+BenchThroughput(const BenchCfg_t *pCfg, unsigned char ucQos, bool bLast)
+{
+    char cTopic[BENCH_TOPIC_LEN];
+    char cArgs[48];
+    unsigned long ulStart;
+    unsigned long ulLastSeen;
+    unsigned long ulReceived = 0;
+    double dSeconds;
+
+    memset(&g_Stream, 0, sizeof(g_Stream));
+    g_Stream.ulExpected = pCfg->ulMessages;
+    g_Stream.pucSeen = calloc(pCfg->ulMessages / 8 + 1, 1);
+    snprintf(cTopic, sizeof(cTopic), "/cc3200/%s/cmd/bench", g_cDeviceId);
+    snprintf(cArgs, sizeof(cArgs), "%lu %u %d", pCfg->ulMessages, ucQos,
+             pCfg->iLength);
+
+    fprintf(stderr, "throughput: %lu messages at QoS%u\n", pCfg->ulMessages,
+            ucQos);
+    ulStart = Latency_Stamp();
+    ulLastSeen = ulStart;
+    BrokerDeliver(cTopic, cArgs, 1);
+    while(g_Stream.ulReceived < g_Stream.ulExpected &&
+          Latency_Stamp() - ulLastSeen < BENCH_STALL_US)
+    {
+        BrokerPoll(BENCH_POLL_MS);
+        if(g_Stream.ulReceived != ulReceived)
+        {
+            ulReceived = g_Stream.ulReceived;
+            ulLastSeen = Latency_Stamp();
+        }
+    }
+
+    dSeconds = (g_Stream.ulReceived > 0) ?
+               (g_Stream.ulLastUs - ulStart) / 1000000.0 : 0.0;
+    printf("    {\"qos\": %u, \"messages\": %lu, \"length\": %d, "
+           "\"received\": %lu, \"lost\": %lu, \"out_of_order\": %lu, "
+           "\"duplicates\": %lu, \"seconds\": %.3f, \"per_second\": %.1f}%s\n",
+           ucQos, g_Stream.ulExpected, pCfg->iLength, g_Stream.ulReceived,
+           g_Stream.ulExpected - g_Stream.ulReceived, g_Stream.ulOutOfOrder,
+           g_Stream.ulDuplicates, dSeconds,
+           (dSeconds > 0) ? g_Stream.ulReceived / dSeconds : 0.0,
+           bLast ? "" : ",");
+    free(g_Stream.pucSeen);
+    g_Stream.pucSeen = NULL;
+}
+
+//*****************************************************************************
+//
+//! Closes the device's connections and times its way back: the first
+//! CONNECT and the subscription to the command topic
+//
+//*****************************************************************************
+static void
+BenchReconnects(const BenchCfg_t *pCfg)
+{
+    unsigned long *pulConnect = calloc(pCfg->iReconnects + 1,
+                                       sizeof(unsigned long));
+    unsigned long *pulSubscribe = calloc(pCfg->iReconnects + 1,
+                                         sizeof(unsigned long));
+    unsigned long ulConnects;
+    unsigned long ulSubscribes;
+    unsigned long ulStart;
+    int iNum = 0;
+    int iLost = 0;
+    int iRound;
+    int iSess;
+
+    fprintf(stderr, "reconnect: %d times\n", pCfg->iReconnects);
+    for(iRound = 0; iRound < pCfg->iReconnects && pulConnect != NULL &&
+        pulSubscribe != NULL; iRound++)
+    {
+        for(iSess = 0; iSess < BENCH_MAX_SESSIONS; iSess++)
+        {
+            if(g_Sessions[iSess].iSock >= 0 &&
+               strcmp(g_Sessions[iSess].cClientId, g_cDeviceId) == 0)
+            {
+                SessionClose(&g_Sessions[iSess]);
+            }
+        }
+        ulStart = Latency_Stamp();
+        ulConnects = g_ulConnects;
+        ulSubscribes = g_ulSubscribes;
+        g_ulFirstConnectUs = 0;
+        if(!WaitSubscribed(ulSubscribes, BENCH_RECONNECT_US) ||
+           g_ulConnects == ulConnects)
+        {
+            iLost++;
+            continue;
+        }
+        pulConnect[iNum] = g_ulFirstConnectUs - ulStart;
+        pulSubscribe[iNum] = g_ulSubscribeUs - ulStart;
+        iNum++;
+
+        // let the other connections of the device come back as well
+        WaitSubscribed(g_ulSubscribes, BENCH_SETTLE_US);
+    }
+    PrintSamples("reconnect_connect_us", pulConnect, iNum, iLost);
+    printf(",\n");
+    PrintSamples("reconnect_subscribed_us", pulSubscribe, iNum, iLost);
+    printf("\n");
+    free(pulConnect);
+    free(pulSubscribe);
+}
+
+int
+main(int argc, char *argv[])
+{
+    BenchCfg_t sCfg;
+    const char *pcQos;
+    int iOpt;
+
+    memset(&sCfg, 0, sizeof(sCfg));
+    sCfg.usPort = 1883;
+    sCfg.iCommands = 100;
+    sCfg.ulMessages = 2000;
+    sCfg.iLength = 32;
+    sCfg.pcQosList = "012";
+    sCfg.iReconnects = 3;
+    sCfg.pcCmdTopic = "/cc3200/ToggleLEDCmdL1";
+    sCfg.iWaitSeconds = 30;
+    while((iOpt = getopt(argc, argv, "+p:n:m:l:q:r:T:w:v")) != -1)
+    {
+        switch(iOpt)
+        {
+            case 'p': sCfg.usPort = atoi(optarg); break;
+            case 'n': sCfg.iCommands = atoi(optarg); break;
+            case 'm': sCfg.ulMessages = strtoul(optarg, NULL, 0); break;
+            case 'l': sCfg.iLength = atoi(optarg); break;
+            case 'q': sCfg.pcQosList = optarg; break;
+            case 'r': sCfg.iReconnects = atoi(optarg); break;
+            case 'T': sCfg.pcCmdTopic = optarg; break;
+            case 'w': sCfg.iWaitSeconds = atoi(optarg); break;
+            case 'v': sCfg.bVerbose = true; break;
+            default: Usage(argv[0]);
+        }
+    }
+    if(sCfg.iCommands < 0 || sCfg.iLength < 4 || sCfg.iLength > 176 ||
+       sCfg.iReconnects < 0 || strlen(sCfg.pcCmdTopic) >= BENCH_TOPIC_LEN ||
+       strspn(sCfg.pcQosList, "012") != strlen(sCfg.pcQosList))
+    {
+        Usage(argv[0]);
+    }
+    g_pcCmdTopic = sCfg.pcCmdTopic;
+    g_bVerbose = sCfg.bVerbose;
+
+    Latency_Init(0);
+    if(BrokerListen(sCfg.usPort) < 0)
+    {
+        fprintf(stderr, "cannot listen on port %u\n", sCfg.usPort);
+        return 1;
+    }
+    if(optind < argc && ChildStart(&argv[optind], sCfg.usPort) < 0)
+    {
+        fprintf(stderr, "cannot start %s\n", argv[optind]);
+        return 1;
+    }
+
+    fprintf(stderr, "waiting for the device on port %u\n", sCfg.usPort);
+    if(!WaitSubscribed(0, sCfg.iWaitSeconds * 1000000UL))
+    {
+        fprintf(stderr, "no device subscribed to %s\n", sCfg.pcCmdTopic);
+        ChildStop();
+        return 1;
+    }
+    snprintf(g_cBenchTopic, sizeof(g_cBenchTopic), "/cc3200/%s/bench",
+             g_cDeviceId);
+    fprintf(stderr, "device %s connected\n", g_cDeviceId);
+
+    //
+    // Give the second broker connection of the device time to come up, so
+    // that its connect does not fall into the measurements
+    //
+    WaitSubscribed(g_ulSubscribes, BENCH_SETTLE_US);
+
+    printf("{\n  \"client_id\": \"%s\",\n  \"port\": %u,\n", g_cDeviceId,
+           sCfg.usPort);
+    if(g_ChildPid >= 0 && sCfg.iCommands > 0)
+    {
+        BenchCommands(&sCfg);
+    }
+    printf("  \"throughput\": [\n");
+    for(pcQos = sCfg.pcQosList; *pcQos != '\0'; pcQos++)
+    {
+        BenchThroughput(&sCfg, *pcQos - '0', pcQos[1] == '\0');
+    }
+    printf("  ],\n");
+    BenchReconnects(&sCfg);
+    printf("}\n");
+
+    ChildStop();
+    return 0;
+}
@@ -0,0 +1,346 @@
+//*****************************************************************************
+// tlm_check.c
+//
+// Telemetry encoder and decoder round trip checks, and payload decoder
+//
+// Without arguments, encodes messages covering the edge cases of the
+// format and decodes them again: every quality, point ids and values at
+// the width limits, time offsets at each LEB128 length limit in both
+// directions and across the 32 bit wrap, a full buffer, the record count
+// limit, every truncation of a message and an unknown version byte. Each
+// decode works on an exact sized heap copy, so building with
+// -fsanitize=address also catches reads past the end of a message.
+//
+// With a hex string argument, e.g. a payload captured from the broker,
+// decodes it and prints its records.
+//
+// Build from the project folder, see host_sim/readme.txt.
+//
+//*****************************************************************************
+
+// Standard includes
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+#define CHECK_BUF_LEN           4096
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+static int g_iChecks;
+static int g_iFailures;
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+static void
+Check(bool bOk, const char *pcWhat, unsigned long ulDetail)
+{
+    g_iChecks++;
+    if(!bOk)
+    {
+        g_iFailures++;
+        printf("FAIL %s (%lu)\n", pcWhat, ulDetail);
+    }
+}
+
+//*****************************************************************************
+//
+//! Decodes a message from an exact sized copy
+//!
+//! \return the number of records decoded, or -1 if the decoder refused
+//!         the message
+//
+//*****************************************************************************
+static int
+Decode(const unsigned char *pucMsg, int iLen, TelemetryRecord_t *pRecords,
+       int iMaxRecords)
+{
+    TelemetryReader_t sReader;
+    unsigned char *pucCopy = malloc(iLen > 0 ? iLen : 1);
+    int iNum = 0;
+    int iRet;
+
+    memcpy(pucCopy, pucMsg, iLen);
+    if(Telemetry_ReaderInit(&sReader, pucCopy, iLen) < 0)
+    {
+        free(pucCopy);
+        return -1;
+    }
+    while((iRet = Telemetry_Next(&sReader, &pRecords[iNum])) == 1)
+    {
+        if(++iNum == iMaxRecords)
+        {
+            break;
+        }
+    }
+    free(pucCopy);
+    return (iRet < 0) ? -1 : iNum;
+}
+
+//*****************************************************************************
+//
+//! Encodes the records, decodes them again and compares
+//!
+//! \return the message length
+//
+//*****************************************************************************
+static int
+RoundTrip(const char *pcWhat, const TelemetryRecord_t *pRecords,
+          int iNumRecords, unsigned long ulBaseTime, unsigned char *pucMsg)
+{
+    static TelemetryRecord_t sDecoded[TLM_MAX_RECORDS];
+    TelemetryWriter_t sWriter;
+    int iLen;
+    int iNum;
+    int iIndex;
+
+    Telemetry_Begin(&sWriter, pucMsg, CHECK_BUF_LEN, ulBaseTime);
+    for(iIndex = 0; iIndex < iNumRecords; iIndex++)
+    {
+        Check(Telemetry_Add(&sWriter, &pRecords[iIndex]) == 0, pcWhat,
+              iIndex);
+    }
+    iLen = Telemetry_End(&sWriter);
+
+    iNum = Decode(pucMsg, iLen, sDecoded, TLM_MAX_RECORDS);
+    Check(iNum == iNumRecords, pcWhat, iNum);
+    for(iIndex = 0; iIndex < iNum && iIndex < iNumRecords; iIndex++)
+    {
+        Check(sDecoded[iIndex].usPointId == pRecords[iIndex].usPointId &&
+              sDecoded[iIndex].usValue == pRecords[iIndex].usValue &&
+              sDecoded[iIndex].ucQuality == pRecords[iIndex].ucQuality &&
+              sDecoded[iIndex].ulTimestamp == pRecords[iIndex].ulTimestamp,
+              pcWhat, iIndex);
+    }
+    return iLen;
+}
+
+static void
+CheckQualities(unsigned char *pucMsg)
+{
+    TelemetryRecord_t sRecords[3] =
+    {
+        {1, 1, TLM_QUALITY_GOOD, 1000},
+        {2, 0, TLM_QUALITY_UNCERTAIN, 1000},
+        {3, 1, TLM_QUALITY_BAD, 1000}
+    };
+
+    RoundTrip("quality", sRecords, 3, 1000, pucMsg);
+}
+
+static void
+CheckWidths(unsigned char *pucMsg)
+{
+    TelemetryRecord_t sRecords[4] =
+    {
+        {0xFF, 0xFF, TLM_QUALITY_GOOD, 0},
+        {0x100, 0x100, TLM_QUALITY_GOOD, 0},
+        {0xFFFF, 0xFFFF, TLM_QUALITY_GOOD, 0},
+        {0, 0, TLM_QUALITY_GOOD, 0}
+    };
+    int iLen;
+
+    // 4, 6, 6 and 4 bytes past the header
+    iLen = RoundTrip("id and value width", sRecords, 4, 0, pucMsg);
+    Check(iLen == TLM_HEADER_LEN + 20, "id and value width length", iLen);
+}
+
+//*****************************************************************************
+//
+//! Time offsets on both sides of every LEB128 length step. The zigzag
+//! value of an offset d is 2d, or -2d - 1 for negative d; a time field of
+//! n bytes holds zigzag values below 2^(7n).
+//
+//*****************************************************************************
+static void
+CheckTimeOffsets(unsigned char *pucMsg)
+{
+    static const struct
+    {
+        long lOffset;
+        int iTimeLen;
+    }sOffsets[] =
+    {
+        {0, 1}, {63, 1}, {64, 2}, {-64, 1}, {-65, 2},
+        {8191, 2}, {8192, 3}, {-8192, 2}, {-8193, 3},
+        {1048575, 3}, {1048576, 4}, {-1048576, 3}, {-1048577, 4},
+        {134217727, 4}, {134217728, 5}, {-134217728, 4}, {-134217729, 5},
+        {2147483647L, 5}, {-2147483647L - 1, 5}
+    };
+    static const unsigned long ulBases[] = {0, 0x80000000UL, 0xFFFFFFFFUL};
+    TelemetryRecord_t sRecord = {7, 1, TLM_QUALITY_GOOD, 0};
+    int iBase;
+    int iIndex;
+    int iLen;
+
+    for(iBase = 0; iBase < sizeof(ulBases)/sizeof(unsigned long); iBase++)
+    {
+        for(iIndex = 0; iIndex < sizeof(sOffsets)/sizeof(sOffsets[0]);
+            iIndex++)
+        {
+            sRecord.ulTimestamp = (ulBases[iBase] +
+                                   (unsigned long)sOffsets[iIndex].lOffset) &
+                                  0xFFFFFFFFUL;
+            iLen = RoundTrip("time offset", &sRecord, 1, ulBases[iBase],
+                             pucMsg);
+            Check(iLen == TLM_HEADER_LEN + 3 + sOffsets[iIndex].iTimeLen,
+                  "time offset length", iIndex);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! A buffer filled up: records are refused once fewer than
+//! TLM_MAX_RECORD_LEN bytes are left, and the records taken decode
+//
+//*****************************************************************************
+static void
+CheckFullBuffer(unsigned char *pucMsg)
+{
+    static TelemetryRecord_t sDecoded[TLM_MAX_RECORDS];
+    TelemetryRecord_t sRecord = {0x1234, 0x5678, TLM_QUALITY_GOOD, 100000};
+    TelemetryWriter_t sWriter;
+    int iBufLen = 176;
+    int iAdded = 0;
+    int iNum;
+
+    Check(Telemetry_Begin(&sWriter, pucMsg, TLM_HEADER_LEN - 1, 0) < 0,
+          "buffer below the header", 0);
+
+    Telemetry_Begin(&sWriter, pucMsg, iBufLen, 0);
+    while(Telemetry_Add(&sWriter, &sRecord) == 0)
+    {
+        iAdded++;
+        sRecord.usPointId++;
+    }
+    Check(Telemetry_End(&sWriter) <= iBufLen, "full buffer length",
+          Telemetry_End(&sWriter));
+    Check(iBufLen - Telemetry_End(&sWriter) < TLM_MAX_RECORD_LEN,
+          "full buffer use", Telemetry_End(&sWriter));
+
+    iNum = Decode(pucMsg, Telemetry_End(&sWriter), sDecoded, TLM_MAX_RECORDS);
+    Check(iNum == iAdded, "full buffer decode", iNum);
+    Check(iNum > 0 && sDecoded[iNum - 1].usPointId == 0x1234 + iNum - 1,
+          "full buffer last record", iNum);
+
+    // the count byte limits a message with room to spare
+    Telemetry_Begin(&sWriter, pucMsg, CHECK_BUF_LEN, 0);
+    for(iAdded = 0; Telemetry_Add(&sWriter, &sRecord) == 0; iAdded++)
+    {
+    }
+    Check(iAdded == TLM_MAX_RECORDS, "record count limit", iAdded);
+    iNum = Decode(pucMsg, Telemetry_End(&sWriter), sDecoded, TLM_MAX_RECORDS);
+    Check(iNum == TLM_MAX_RECORDS, "record count limit decode", iNum);
+}
+
+//*****************************************************************************
+//
+//! Every prefix of a message is refused, either by the header check or by
+//! a record running past the end
+//
+//*****************************************************************************
+static void
+CheckTruncated(unsigned char *pucMsg)
+{
+    static TelemetryRecord_t sDecoded[TLM_MAX_RECORDS];
+    TelemetryRecord_t sRecords[3] =
+    {
+        {0x0102, 0x0304, TLM_QUALITY_GOOD, 0x12345678UL},
+        {5, 1, TLM_QUALITY_BAD, 0},
+        {6, 0x200, TLM_QUALITY_UNCERTAIN, 0x7FFFFFFFUL}
+    };
+    int iLen;
+    int iCut;
+
+    iLen = RoundTrip("truncated source", sRecords, 3, 1000, pucMsg);
+    for(iCut = 0; iCut < iLen; iCut++)
+    {
+        Check(Decode(pucMsg, iCut, sDecoded, TLM_MAX_RECORDS) < 0,
+              "truncated", iCut);
+    }
+}
+
+static void
+CheckVersion(unsigned char *pucMsg)
+{
+    static TelemetryRecord_t sDecoded[TLM_MAX_RECORDS];
+    TelemetryRecord_t sRecord = {1, 1, TLM_QUALITY_GOOD, 0};
+    int iLen;
+
+    iLen = RoundTrip("version source", &sRecord, 1, 0, pucMsg);
+    pucMsg[0] = TLM_VERSION + 1;
+    Check(Decode(pucMsg, iLen, sDecoded, TLM_MAX_RECORDS) < 0,
+          "wrong version", pucMsg[0]);
+    pucMsg[0] = 0;
+    Check(Decode(pucMsg, iLen, sDecoded, TLM_MAX_RECORDS) < 0,
+          "wrong version", pucMsg[0]);
+}
+
+//*****************************************************************************
+//
+//! Decodes a message given in hex and prints its records
+//
+//*****************************************************************************
+static int
+DecodeHex(const char *pcHex)
+{
+    static unsigned char ucMsg[CHECK_BUF_LEN];
+    TelemetryReader_t sReader;
+    TelemetryRecord_t sRecord;
+    unsigned int uiByte;
+    int iLen = 0;
+    int iRet;
+
+    while(pcHex[0] != 0 && pcHex[1] != 0 && iLen < CHECK_BUF_LEN &&
+          sscanf(pcHex, "%2x", &uiByte) == 1)
+    {
+        ucMsg[iLen++] = (unsigned char)uiByte;
+        pcHex += 2;
+    }
+
+    if(Telemetry_ReaderInit(&sReader, ucMsg, iLen) < 0)
+    {
+        printf("invalid header or version\n");
+        return 1;
+    }
+    printf("base time %lu ms, %d records\n", sReader.ulBaseTime,
+           sReader.iRemaining);
+    while((iRet = Telemetry_Next(&sReader, &sRecord)) == 1)
+    {
+        printf("point %u value %u quality %u time %lu\n", sRecord.usPointId,
+               sRecord.usValue, sRecord.ucQuality, sRecord.ulTimestamp);
+    }
+    if(iRet < 0)
+    {
+        printf("truncated or malformed at byte %d\n", sReader.iPos);
+        return 1;
+    }
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static unsigned char ucMsg[CHECK_BUF_LEN];
+
+    if(argc > 1)
+    {
+        return DecodeHex(argv[1]);
+    }
+
+    CheckQualities(ucMsg);
+    CheckWidths(ucMsg);
+    CheckTimeOffsets(ucMsg);
+    CheckFullBuffer(ucMsg);
+    CheckTruncated(ucMsg);
+    CheckVersion(ucMsg);
+
+    printf("%d checks, %d failed\n", g_iChecks, g_iFailures);
+    return (g_iFailures == 0) ? 0 : 1;
+}
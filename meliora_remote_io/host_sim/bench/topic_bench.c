@@ -0,0 +1,225 @@
+//*****************************************************************************
+// topic_bench.c
+//
+// MQTT topic dispatch benchmark and allocation check
+//
+// Builds the application's topic table and dispatches a mix of exact
+// topics, wildcard matches and unrouted topics through it. malloc, calloc,
+// realloc and free are interposed and counted while the messages are
+// dispatched; the run fails unless none was called and every message
+// reached the expected handler.
+//
+// Build from the project folder, see host_sim/readme.txt.
+//
+//*****************************************************************************
+
+#define _GNU_SOURCE
+
+// Standard includes
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mqtt_topic.h"
+#include "latency.h"
+
+/* The routes of the application, see g_MqttRoutes in main.c */
+#define BENCH_TOPIC1            "/cc3200/ToggleLEDCmdL1"
+#define BENCH_TOPIC2            "/cc3200/ToggleLEDCmdL2"
+#define BENCH_TOPIC3            "/cc3200/ToggleLEDCmdL3"
+#define BENCH_TOPIC_DEVICE_CMD  "/cc3200/user1/cmd/+"
+
+#define BENCH_NUM_HANDLERS      4
+#define BENCH_UNROUTED          BENCH_NUM_HANDLERS
+
+typedef struct
+{
+    const char *pcTopic;
+    int iHandler;               /* route expected to take it */
+}BenchTopic_t;
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+static unsigned long g_ulCalls[BENCH_NUM_HANDLERS];
+static volatile bool g_bCounting;
+static unsigned long g_ulAllocs;
+static unsigned long g_ulFrees;
+
+static void BenchHandler(const char *pcTopic, long lTopLen,
+                         const void *pvPayload, long lPayLen,
+                         unsigned long ulArg);
+
+static const MqttTopicRoute_t g_BenchRoutes[] =
+{
+    {BENCH_TOPIC1, BenchHandler, 0},
+    {BENCH_TOPIC2, BenchHandler, 1},
+    {BENCH_TOPIC3, BenchHandler, 2},
+    {BENCH_TOPIC_DEVICE_CMD, BenchHandler, 3}
+};
+
+static const BenchTopic_t g_BenchTopics[] =
+{
+    {BENCH_TOPIC1, 0},
+    {BENCH_TOPIC2, 1},
+    {BENCH_TOPIC3, 2},
+    {"/cc3200/user1/cmd/led1", 3},
+    {"/cc3200/user1/cmd/diag", 3},
+    {"/cc3200/user1/cmd/bench", 3},
+    {"/cc3200/user2/cmd/led1", BENCH_UNROUTED},
+    {"/cc3200/user1/cmd/led1/x", BENCH_UNROUTED},
+    {"/cc3200/ToggleLEDCmdL4", BENCH_UNROUTED}
+};
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+extern void *__libc_malloc(size_t uiSize);
+extern void *__libc_calloc(size_t uiNum, size_t uiSize);
+extern void *__libc_realloc(void *pvBlock, size_t uiSize);
+extern void __libc_free(void *pvBlock);
+
+//*****************************************************************************
+//
+//! Allocator of the process, counting the calls made while g_bCounting is
+//! set
+//
+//*****************************************************************************
+void *
+malloc(size_t uiSize)
+{
+    if(g_bCounting)
+    {
+        g_ulAllocs++;
+    }
+    return __libc_malloc(uiSize);
+}
+
+void *
+calloc(size_t uiNum, size_t uiSize)
+{
+    if(g_bCounting)
+    {
+        g_ulAllocs++;
+    }
+    return __libc_calloc(uiNum, uiSize);
+}
+
+void *
+realloc(void *pvBlock, size_t uiSize)
+{
+    if(g_bCounting)
+    {
+        g_ulAllocs++;
+    }
+    return __libc_realloc(pvBlock, uiSize);
+}
+
+void
+free(void *pvBlock)
+{
+    if(g_bCounting && pvBlock != NULL)
+    {
+        g_ulFrees++;
+    }
+    __libc_free(pvBlock);
+}
+
+static void
+BenchHandler(const char *pcTopic, long lTopLen, const void *pvPayload,
+             long lPayLen, unsigned long ulArg)
+{
+    g_ulCalls[ulArg]++;
+}
+
+static void
+Usage(const char *pcProg)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -n count     messages dispatched (1000000)\n",
+            pcProg);
+    exit(2);
+}
+
+int
+main(int argc, char *argv[])
+{
+    unsigned long ulExpected[BENCH_NUM_HANDLERS + 1];
+    unsigned long ulMessages = 1000000;
+    unsigned long ulStart;
+    unsigned long ulUs;
+    unsigned long ulIndex;
+    int iNumTopics = sizeof(g_BenchTopics)/sizeof(BenchTopic_t);
+    long lTopLens[sizeof(g_BenchTopics)/sizeof(BenchTopic_t)];
+    const BenchTopic_t *pTopic;
+    bool bPass = true;
+    int iIndex;
+    int iOpt;
+
+    while((iOpt = getopt(argc, argv, "n:")) != -1)
+    {
+        switch(iOpt)
+        {
+            case 'n': ulMessages = strtoul(optarg, NULL, 10); break;
+            default: Usage(argv[0]);
+        }
+    }
+    if(ulMessages == 0)
+    {
+        Usage(argv[0]);
+    }
+
+    if(MqttTopic_Init(g_BenchRoutes,
+                      sizeof(g_BenchRoutes)/sizeof(MqttTopicRoute_t)) < 0)
+    {
+        fprintf(stderr, "topic table initialization failed\n");
+        return 1;
+    }
+
+    memset(ulExpected, 0, sizeof(ulExpected));
+    for(iIndex = 0; iIndex < iNumTopics; iIndex++)
+    {
+        lTopLens[iIndex] = strlen(g_BenchTopics[iIndex].pcTopic);
+    }
+    Latency_Init(0);
+
+    //
+    // The topics are not NUL terminated for the library either, so only
+    // their lengths are passed
+    //
+    g_bCounting = true;
+    ulStart = Latency_Stamp();
+    for(ulIndex = 0; ulIndex < ulMessages; ulIndex++)
+    {
+        iIndex = ulIndex % iNumTopics;
+        pTopic = &g_BenchTopics[iIndex];
+        MqttTopic_Dispatch(pTopic->pcTopic, lTopLens[iIndex], "1", 1);
+        ulExpected[pTopic->iHandler]++;
+    }
+    ulUs = Latency_Stamp() - ulStart;
+    g_bCounting = false;
+
+    for(iIndex = 0; iIndex < BENCH_NUM_HANDLERS; iIndex++)
+    {
+        if(g_ulCalls[iIndex] != ulExpected[iIndex])
+        {
+            bPass = false;
+        }
+    }
+    if(g_ulAllocs != 0 || g_ulFrees != 0)
+    {
+        bPass = false;
+    }
+
+    printf("messages %lu, %lu routed, %lu unrouted\n", ulMessages,
+           ulMessages - ulExpected[BENCH_UNROUTED],
+           ulExpected[BENCH_UNROUTED]);
+    printf("time %lu us, %.1f ns per message\n", ulUs,
+           ulUs * 1000.0 / ulMessages);
+    printf("allocations %lu, frees %lu\n", g_ulAllocs, g_ulFrees);
+    printf("%s\n", bPass ? "PASS" : "FAIL");
+    return bPass ? 0 : 1;
+}
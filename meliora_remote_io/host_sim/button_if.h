@@ -0,0 +1,21 @@
+//*****************************************************************************
+// button_if.h
+//
+// Host simulation: push buttons, pressed from stdin
+//
+//*****************************************************************************
+
+#ifndef __BUTTON_IF_H__
+#define __BUTTON_IF_H__
+
+#define SW2                     0x1
+#define SW3                     0x2
+
+typedef void (*P_INT_HANDLER)(void);
+
+extern void Button_IF_Init(P_INT_HANDLER S2InterruptHdl,
+                           P_INT_HANDLER S3InterruptHdl);
+extern void Button_IF_EnableInterrupt(unsigned char ucSwitch);
+extern void Button_IF_DisableInterrupt(unsigned char ucSwitch);
+
+#endif //  __BUTTON_IF_H__
@@ -0,0 +1,60 @@
+//*****************************************************************************
+// common.h
+//
+// Host simulation: application configuration and status helpers
+//
+//*****************************************************************************
+
+#ifndef __COMMON_H__
+#define __COMMON_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "osi.h"
+
+#define SSID_NAME               "simulated-ap"
+#define SECURITY_TYPE           SL_SEC_TYPE_WPA_WPA2
+#define SECURITY_KEY            "simulated"
+
+#define SPAWN_TASK_PRIORITY     9
+
+//
+// The firmware parks the MCU on fatal errors; the simulation exits instead
+//
+#define LOOP_FOREVER() \
+            { \
+                fflush(stdout); \
+                fprintf(stderr, "%s:%d: halted\n", __FILE__, __LINE__); \
+                exit(1); \
+            }
+
+#define ASSERT_ON_ERROR(error_code) \
+            { \
+                if(error_code < 0) \
+                { \
+                    ERR_PRINT(error_code); \
+                    return error_code; \
+                } \
+            }
+
+#define ERR_PRINT(x)            Report("Error [%d] at line [%d] in function " \
+                                       "[%s]  \n\r", (int)(x), __LINE__, \
+                                       __FUNCTION__)
+
+#define STATUS_BIT_CONNECTION   0
+#define STATUS_BIT_IP_AQUIRED   2
+
+#define SET_STATUS_BIT(status_variable, bit) \
+            status_variable |= ((unsigned long)1 << (bit))
+#define CLR_STATUS_BIT(status_variable, bit) \
+            status_variable &= ~((unsigned long)1 << (bit))
+#define GET_STATUS_BIT(status_variable, bit) \
+            (0 != (status_variable & ((unsigned long)1 << (bit))))
+
+#define IS_CONNECTED(status_variable) \
+            GET_STATUS_BIT(status_variable, STATUS_BIT_CONNECTION)
+#define IS_IP_ACQUIRED(status_variable) \
+            GET_STATUS_BIT(status_variable, STATUS_BIT_IP_AQUIRED)
+
+#endif //  __COMMON_H__
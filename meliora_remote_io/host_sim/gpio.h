@@ -0,0 +1,19 @@
+//*****************************************************************************
+// gpio.h
+//
+// Host simulation: GPIO driver, pins of the simulated push buttons
+//
+//*****************************************************************************
+
+#ifndef __GPIO_H__
+#define __GPIO_H__
+
+#define GPIO_FALLING_EDGE       0x00000000
+#define GPIO_RISING_EDGE        0x00000004
+#define GPIO_BOTH_EDGES         0x00000001
+
+extern long GPIOPinRead(unsigned long ulPort, unsigned char ucPins);
+extern void GPIOIntTypeSet(unsigned long ulPort, unsigned char ucPins,
+                           unsigned long ulIntType);
+
+#endif //  __GPIO_H__
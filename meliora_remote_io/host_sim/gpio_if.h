@@ -0,0 +1,41 @@
+//*****************************************************************************
+// gpio_if.h
+//
+// Host simulation: LEDs, their state is kept in memory
+//
+//*****************************************************************************
+
+#ifndef __GPIO_IF_H__
+#define __GPIO_IF_H__
+
+typedef enum
+{
+    NO_LED = 0x0,
+    LED1 = 0x1,     /* RED LED D7/GP9/Pin64 */
+    LED2 = 0x2,     /* Orange LED D6/GP10/Pin1 */
+    LED3 = 0x4      /* Green LED D5/GP11/Pin2 */
+}ledEnum;
+
+typedef enum
+{
+    NO_LED_IND = NO_LED,
+    MCU_SENDING_DATA_IND = LED1,
+    MCU_ASSOCIATED_IND,
+    MCU_IP_ALLOC_IND,
+    MCU_SERVER_INIT_IND,
+    MCU_CLIENT_CONNECTED_IND,
+    MCU_ON_IND,
+    MCU_EXECUTE_SUCCESS_IND,
+    MCU_EXECUTE_FAIL_IND,
+    MCU_RED_LED_GPIO,
+    MCU_ORANGE_LED_GPIO,
+    MCU_GREEN_LED_GPIO,
+    MCU_ALL_LED_IND
+}ledNames;
+
+extern void GPIO_IF_LedConfigure(unsigned char ucPins);
+extern void GPIO_IF_LedOn(char ledNum);
+extern void GPIO_IF_LedOff(char ledNum);
+extern unsigned char GPIO_IF_LedStatus(unsigned char ucGPIONum);
+
+#endif //  __GPIO_IF_H__
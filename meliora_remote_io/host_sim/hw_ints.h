@@ -0,0 +1,11 @@
+//*****************************************************************************
+// hw_ints.h
+//
+// Host simulation: interrupt numbers, nothing is needed
+//
+//*****************************************************************************
+
+#ifndef __HW_INTS_H__
+#define __HW_INTS_H__
+
+#endif //  __HW_INTS_H__
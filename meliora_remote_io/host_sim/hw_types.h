@@ -0,0 +1,11 @@
+//*****************************************************************************
+// hw_types.h
+//
+// Host simulation: driverlib register access types, nothing is needed
+//
+//*****************************************************************************
+
+#ifndef __HW_TYPES_H__
+#define __HW_TYPES_H__
+
+#endif //  __HW_TYPES_H__
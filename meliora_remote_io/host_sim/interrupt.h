@@ -0,0 +1,18 @@
+//*****************************************************************************
+// interrupt.h
+//
+// Host simulation: NVIC control, interrupts are simulation threads
+//
+//*****************************************************************************
+
+#ifndef __INTERRUPT_H__
+#define __INTERRUPT_H__
+
+#define FAULT_SYSTICK           15
+
+extern void IntMasterEnable(void);
+extern unsigned char IntMasterDisable(void);
+extern void IntEnable(unsigned long ulInterrupt);
+extern void IntVTableBaseSet(unsigned long ulVtableBase);
+
+#endif //  __INTERRUPT_H__
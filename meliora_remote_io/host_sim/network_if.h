@@ -0,0 +1,21 @@
+//*****************************************************************************
+// network_if.h
+//
+// Host simulation: network bring-up, the host network is always up
+//
+//*****************************************************************************
+
+#ifndef __NETWORK_IF_H__
+#define __NETWORK_IF_H__
+
+#include "simplelink.h"
+
+extern volatile unsigned long g_ulStatus;
+
+extern long Network_IF_InitDriver(unsigned int uiMode);
+extern long Network_IF_DeInitDriver(void);
+extern long Network_IF_ConnectAP(char *pcSsid, SlSecParams_t SecurityParams);
+extern void Network_IF_ResetMCUStateMachine(void);
+extern unsigned long Network_IF_CurrentMCUState(void);
+
+#endif //  __NETWORK_IF_H__
@@ -0,0 +1,80 @@
+//*****************************************************************************
+// osi.h
+//
+// Host simulation: OS abstraction layer on POSIX threads
+//
+// Tasks are threads scheduled by the host kernel, so task priorities are
+// only recorded. Critical sections and osi_TaskDisable take one global
+// recursive mutex instead of masking interrupts.
+//
+//*****************************************************************************
+
+#ifndef __OSI_H__
+#define __OSI_H__
+
+#define OSI_WAIT_FOREVER        (0xFFFFFFFF)
+#define OSI_NO_WAIT             (0)
+
+typedef enum
+{
+    OSI_OK = 0,
+    OSI_FAILURE = -1,
+    OSI_OPERATION_FAILED = -2,
+    OSI_ABORTED = -3,
+    OSI_INVALID_PARAMS = -4,
+    OSI_MEMORY_ALLOCATION_FAILURE = -5,
+    OSI_TIMEOUT = -6,
+    OSI_EVENTS_IN_USE = -7,
+    OSI_EVENT_OPEARTION_FAILURE = -8
+}OsiReturnVal_e;
+
+typedef void *OsiTaskHandle;
+typedef void *OsiMsgQ_t;
+typedef void *OsiSyncObj_t;
+typedef void *OsiLockObj_t;
+typedef unsigned int OsiTime_t;
+
+typedef void (*P_OSI_TASK_ENTRY)(void *pValue);
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern OsiReturnVal_e osi_TaskCreate(P_OSI_TASK_ENTRY pEntry,
+                                     const signed char * const pcName,
+                                     unsigned short usStackDepth,
+                                     void *pvParameters,
+                                     unsigned long uxPriority,
+                                     OsiTaskHandle *pTaskHandle);
+extern void osi_TaskDelete(OsiTaskHandle *pTaskHandle);
+extern void osi_Sleep(unsigned int MilliSecs);
+extern void osi_start(void);
+extern void osi_TaskDisable(void);
+extern void osi_TaskEnable(void);
+extern unsigned long osi_EnterCritical(void);
+extern void osi_ExitCritical(unsigned long ulKey);
+extern long VStartSimpleLinkSpawnTask(unsigned long uxPriority);
+
+extern OsiReturnVal_e osi_MsgQCreate(OsiMsgQ_t *pMsgQ, char *pMsgQName,
+                                     unsigned long MsgSize,
+                                     unsigned long MaxMsgs);
+extern OsiReturnVal_e osi_MsgQDelete(OsiMsgQ_t *pMsgQ);
+extern OsiReturnVal_e osi_MsgQWrite(OsiMsgQ_t *pMsgQ, void *pMsg,
+                                    OsiTime_t Timeout);
+extern OsiReturnVal_e osi_MsgQRead(OsiMsgQ_t *pMsgQ, void *pMsg,
+                                   OsiTime_t Timeout);
+
+extern OsiReturnVal_e osi_SyncObjCreate(OsiSyncObj_t *pSyncObj);
+extern OsiReturnVal_e osi_SyncObjDelete(OsiSyncObj_t *pSyncObj);
+extern OsiReturnVal_e osi_SyncObjSignal(OsiSyncObj_t *pSyncObj);
+extern OsiReturnVal_e osi_SyncObjSignalFromISR(OsiSyncObj_t *pSyncObj);
+extern OsiReturnVal_e osi_SyncObjWait(OsiSyncObj_t *pSyncObj,
+                                      OsiTime_t Timeout);
+extern OsiReturnVal_e osi_SyncObjClear(OsiSyncObj_t *pSyncObj);
+
+extern OsiReturnVal_e osi_LockObjCreate(OsiLockObj_t *pLockObj);
+extern OsiReturnVal_e osi_LockObjDelete(OsiLockObj_t *pLockObj);
+extern OsiReturnVal_e osi_LockObjLock(OsiLockObj_t *pLockObj,
+                                      OsiTime_t Timeout);
+extern OsiReturnVal_e osi_LockObjUnlock(OsiLockObj_t *pLockObj);
+
+#endif //  __OSI_H__
@@ -0,0 +1,19 @@
+//*****************************************************************************
+// prcm.h
+//
+// Host simulation: power and clock management
+//
+//*****************************************************************************
+
+#ifndef __PRCM_H__
+#define __PRCM_H__
+
+#define PRCM_TIMERA0            0x00000010
+#define PRCM_TIMERA1            0x00000011
+#define PRCM_TIMERA2            0x0000000D
+#define PRCM_TIMERA3            0x0000000E
+
+extern void PRCMCC3200MCUInit(void);
+extern unsigned long long PRCMSlowClkCtrGet(void);
+
+#endif //  __PRCM_H__
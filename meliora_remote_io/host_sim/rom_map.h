@@ -0,0 +1,21 @@
+//*****************************************************************************
+// rom_map.h
+//
+// Host simulation: ROM function mapping, every call goes to the simulation
+//
+//*****************************************************************************
+
+#ifndef __ROM_MAP_H__
+#define __ROM_MAP_H__
+
+#define MAP_IntMasterEnable     IntMasterEnable
+#define MAP_IntMasterDisable    IntMasterDisable
+#define MAP_IntEnable           IntEnable
+#define MAP_UtilsDelay          UtilsDelay
+#define MAP_GPIOPinRead         GPIOPinRead
+#define MAP_GPIOIntTypeSet      GPIOIntTypeSet
+#define MAP_TimerIntStatus      TimerIntStatus
+#define MAP_TimerIntClear       TimerIntClear
+#define MAP_PRCMSlowClkCtrGet   PRCMSlowClkCtrGet
+
+#endif //  __ROM_MAP_H__
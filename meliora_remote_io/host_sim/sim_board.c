@@ -0,0 +1,533 @@
+//*****************************************************************************
+// sim_board.c
+//
+// Host simulation: board support of the CC3200 LaunchPad
+//
+// The terminal is stdout. The push buttons are pressed from stdin: a line
+// "2" or "3" holds SW2 or SW3 down for SIM_BUTTON_HOLD_MS and raises its
+// interrupt on the press, and on the release too once both edges are
+// selected, "q" ends the simulation. LED changes are printed when the
+// SIM_TRACE_LEDS environment variable is set. The timers run on threads.
+//
+//*****************************************************************************
+
+#define _GNU_SOURCE
+
+// Standard includes
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Simulated driverlib and board headers
+#include "hw_memmap.h"
+#include "interrupt.h"
+#include "prcm.h"
+#include "timer.h"
+#include "gpio.h"
+#include "utils.h"
+#include "uart_if.h"
+#include "button_if.h"
+#include "gpio_if.h"
+#include "timer_if.h"
+#include "pinmux.h"
+#include "osi.h"
+
+#define SIM_BUTTON_HOLD_MS      200
+#define SIM_NUM_TIMERS          4
+#define SIM_NUM_LEDS            3
+
+typedef struct
+{
+    unsigned long ulBase;
+    void (*pfnHandler)(void);
+    unsigned long ulPeriodMs;
+    bool bPeriodic;
+    bool bRunning;
+    bool bThread;
+    pthread_t Thread;
+    pthread_mutex_t Mutex;
+    pthread_cond_t Cond;
+}SimTimer_t;
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+static pthread_mutex_t g_SimPrintLock = PTHREAD_MUTEX_INITIALIZER;
+static P_INT_HANDLER g_pfnSimButton[2];
+static volatile bool g_bSimButtonEnabled[2];
+static volatile bool g_bSimButtonDown[2];
+static volatile bool g_bSimButtonBothEdges[2];
+static volatile unsigned char g_ucSimLeds;
+static pthread_once_t g_SimClockOnce = PTHREAD_ONCE_INIT;
+static struct timespec g_SimClockStart;
+static SimTimer_t g_SimTimers[SIM_NUM_TIMERS] =
+{
+    {TIMERA0_BASE}, {TIMERA1_BASE}, {TIMERA2_BASE}, {TIMERA3_BASE}
+};
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! Terminal
+//
+//*****************************************************************************
+void
+InitTerm(void)
+{
+}
+
+void
+Message(const char *pcStr)
+{
+    pthread_mutex_lock(&g_SimPrintLock);
+    fputs(pcStr, stdout);
+    fflush(stdout);
+    pthread_mutex_unlock(&g_SimPrintLock);
+}
+
+int
+Report(const char *pcFormat, ...)
+{
+    va_list vaArgs;
+    int iRet;
+
+    va_start(vaArgs, pcFormat);
+    pthread_mutex_lock(&g_SimPrintLock);
+    iRet = vprintf(pcFormat, vaArgs);
+    fflush(stdout);
+    pthread_mutex_unlock(&g_SimPrintLock);
+    va_end(vaArgs);
+    return iRet;
+}
+
+//*****************************************************************************
+//
+//! Processor, clock and pin setup, nothing to do on the host
+//
+//*****************************************************************************
+void
+IntMasterEnable(void)
+{
+}
+
+unsigned char
+IntMasterDisable(void)
+{
+    return 0;
+}
+
+void
+IntEnable(unsigned long ulInterrupt)
+{
+    (void)ulInterrupt;
+}
+
+void
+IntVTableBaseSet(unsigned long ulVtableBase)
+{
+    (void)ulVtableBase;
+}
+
+void
+PRCMCC3200MCUInit(void)
+{
+}
+
+void
+PinMuxConfig(void)
+{
+}
+
+void
+UtilsDelay(unsigned long ulCount)
+{
+    (void)ulCount;
+}
+
+//*****************************************************************************
+//
+//! Slow clock counter, 32768 Hz since the first read, as the counter of
+//! the board starts at power on
+//
+//*****************************************************************************
+static void
+SimClockInit(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &g_SimClockStart);
+}
+
+unsigned long long
+PRCMSlowClkCtrGet(void)
+{
+    struct timespec sNow;
+    long long llNs;
+
+    pthread_once(&g_SimClockOnce, SimClockInit);
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+    llNs = (long long)(sNow.tv_sec - g_SimClockStart.tv_sec) * 1000000000 +
+           (sNow.tv_nsec - g_SimClockStart.tv_nsec);
+    return ((unsigned long long)llNs * 32768) / 1000000000;
+}
+
+//*****************************************************************************
+//
+//! LEDs
+//
+//*****************************************************************************
+static int
+SimLedIndex(char ledNum)
+{
+    switch(ledNum)
+    {
+        case MCU_RED_LED_GPIO:
+            return 0;
+        case MCU_ORANGE_LED_GPIO:
+            return 1;
+        case MCU_GREEN_LED_GPIO:
+            return 2;
+        default:
+            return -1;
+    }
+}
+
+static void
+SimLedSet(char ledNum, bool bOn)
+{
+    static const char * const pcNames[SIM_NUM_LEDS] =
+    {
+        "red", "orange", "green"
+    };
+    int iLed = SimLedIndex(ledNum);
+    unsigned char ucOld = g_ucSimLeds;
+
+    if(iLed < 0)
+    {
+        return;
+    }
+    if(bOn)
+    {
+        g_ucSimLeds |= 1 << iLed;
+    }
+    else
+    {
+        g_ucSimLeds &= ~(1 << iLed);
+    }
+    if(g_ucSimLeds != ucOld && getenv("SIM_TRACE_LEDS") != NULL)
+    {
+        Report("[sim] %s LED %s\n\r", pcNames[iLed], bOn ? "on" : "off");
+    }
+}
+
+void
+GPIO_IF_LedConfigure(unsigned char ucPins)
+{
+    (void)ucPins;
+}
+
+void
+GPIO_IF_LedOn(char ledNum)
+{
+    SimLedSet(ledNum, true);
+}
+
+void
+GPIO_IF_LedOff(char ledNum)
+{
+    SimLedSet(ledNum, false);
+}
+
+unsigned char
+GPIO_IF_LedStatus(unsigned char ucGPIONum)
+{
+    int iLed = SimLedIndex(ucGPIONum);
+
+    return (iLed >= 0 && (g_ucSimLeds & (1 << iLed))) ? 1 : 0;
+}
+
+//*****************************************************************************
+//
+//! Push buttons. SW2 is GPIO 22 (GPIOA2 pin 0x40), SW3 is GPIO 13 (GPIOA1
+//! pin 0x20). As on the board, the interrupt of a button is disabled before
+//! its handler runs and the application enables it again. Only the rising
+//! and both edge types are told apart.
+//
+//*****************************************************************************
+long
+GPIOPinRead(unsigned long ulPort, unsigned char ucPins)
+{
+    long lValue = 0;
+
+    if(ulPort == GPIOA2_BASE && g_bSimButtonDown[0])
+    {
+        lValue |= 0x40;
+    }
+    if(ulPort == GPIOA1_BASE && g_bSimButtonDown[1])
+    {
+        lValue |= 0x20;
+    }
+    return lValue & ucPins;
+}
+
+void
+GPIOIntTypeSet(unsigned long ulPort, unsigned char ucPins,
+               unsigned long ulIntType)
+{
+    if(ulPort == GPIOA2_BASE && (ucPins & 0x40))
+    {
+        g_bSimButtonBothEdges[0] = (ulIntType == GPIO_BOTH_EDGES);
+    }
+    if(ulPort == GPIOA1_BASE && (ucPins & 0x20))
+    {
+        g_bSimButtonBothEdges[1] = (ulIntType == GPIO_BOTH_EDGES);
+    }
+}
+
+static void
+SimButtonEdge(int iButton)
+{
+    if(g_bSimButtonEnabled[iButton] && g_pfnSimButton[iButton] != NULL)
+    {
+        g_bSimButtonEnabled[iButton] = false;
+        g_pfnSimButton[iButton]();
+    }
+}
+
+static void
+SimButtonPress(int iButton)
+{
+    g_bSimButtonDown[iButton] = true;
+    SimButtonEdge(iButton);
+    osi_Sleep(SIM_BUTTON_HOLD_MS);
+    g_bSimButtonDown[iButton] = false;
+    if(g_bSimButtonBothEdges[iButton])
+    {
+        SimButtonEdge(iButton);
+    }
+}
+
+static void *
+SimStdinThread(void *pvArg)
+{
+    char cLine[32];
+
+    (void)pvArg;
+    while(fgets(cLine, sizeof(cLine), stdin) != NULL)
+    {
+        switch(cLine[0])
+        {
+            case '2':
+                SimButtonPress(0);
+                break;
+            case '3':
+                SimButtonPress(1);
+                break;
+            case 'q':
+                fflush(stdout);
+                exit(0);
+            default:
+                break;
+        }
+    }
+    return NULL;
+}
+
+void
+Button_IF_Init(P_INT_HANDLER S2InterruptHdl, P_INT_HANDLER S3InterruptHdl)
+{
+    pthread_t Thread;
+
+    g_pfnSimButton[0] = S2InterruptHdl;
+    g_pfnSimButton[1] = S3InterruptHdl;
+    g_bSimButtonEnabled[0] = true;
+    g_bSimButtonEnabled[1] = true;
+    if(pthread_create(&Thread, NULL, SimStdinThread, NULL) == 0)
+    {
+        pthread_detach(Thread);
+    }
+}
+
+void
+Button_IF_EnableInterrupt(unsigned char ucSwitch)
+{
+    if(ucSwitch & SW2)
+    {
+        g_bSimButtonEnabled[0] = true;
+    }
+    if(ucSwitch & SW3)
+    {
+        g_bSimButtonEnabled[1] = true;
+    }
+}
+
+void
+Button_IF_DisableInterrupt(unsigned char ucSwitch)
+{
+    if(ucSwitch & SW2)
+    {
+        g_bSimButtonEnabled[0] = false;
+    }
+    if(ucSwitch & SW3)
+    {
+        g_bSimButtonEnabled[1] = false;
+    }
+}
+
+//*****************************************************************************
+//
+//! Timers. Each timer has a thread that calls the interrupt handler every
+//! period while the timer runs; the handler may stop its own timer.
+//
+//*****************************************************************************
+static SimTimer_t *
+SimTimerGet(unsigned long ulBase)
+{
+    int iIndex;
+
+    for(iIndex = 0; iIndex < SIM_NUM_TIMERS; iIndex++)
+    {
+        if(g_SimTimers[iIndex].ulBase == ulBase)
+        {
+            return &g_SimTimers[iIndex];
+        }
+    }
+    return NULL;
+}
+
+static void *
+SimTimerThread(void *pvArg)
+{
+    SimTimer_t *pTimer = pvArg;
+    void (*pfnHandler)(void);
+
+    for(;;)
+    {
+        pthread_mutex_lock(&pTimer->Mutex);
+        while(!pTimer->bRunning)
+        {
+            pthread_cond_wait(&pTimer->Cond, &pTimer->Mutex);
+        }
+        pthread_mutex_unlock(&pTimer->Mutex);
+
+        osi_Sleep(pTimer->ulPeriodMs);
+
+        pthread_mutex_lock(&pTimer->Mutex);
+        pfnHandler = pTimer->bRunning ? pTimer->pfnHandler : NULL;
+        if(!pTimer->bPeriodic)
+        {
+            pTimer->bRunning = false;
+        }
+        pthread_mutex_unlock(&pTimer->Mutex);
+
+        if(pfnHandler != NULL)
+        {
+            pfnHandler();
+        }
+    }
+    return NULL;
+}
+
+void
+Timer_IF_Init(unsigned long ePeripheralc, unsigned long ulBase,
+              unsigned long ulConfig, unsigned long ulTimer,
+              unsigned long ulValue)
+{
+    SimTimer_t *pTimer = SimTimerGet(ulBase);
+
+    (void)ePeripheralc;
+    (void)ulTimer;
+    (void)ulValue;
+    if(pTimer == NULL)
+    {
+        return;
+    }
+    if(!pTimer->bThread)
+    {
+        pthread_mutex_init(&pTimer->Mutex, NULL);
+        pthread_cond_init(&pTimer->Cond, NULL);
+        pTimer->bThread = (pthread_create(&pTimer->Thread, NULL,
+                                          SimTimerThread, pTimer) == 0);
+    }
+    pthread_mutex_lock(&pTimer->Mutex);
+    pTimer->bPeriodic = (ulConfig == TIMER_CFG_PERIODIC);
+    pTimer->bRunning = false;
+    pthread_mutex_unlock(&pTimer->Mutex);
+}
+
+void
+Timer_IF_IntSetup(unsigned long ulBase, unsigned long ulTimer,
+                  void (*TimerBaseIntHandler)(void))
+{
+    SimTimer_t *pTimer = SimTimerGet(ulBase);
+
+    (void)ulTimer;
+    if(pTimer != NULL && pTimer->bThread)
+    {
+        pthread_mutex_lock(&pTimer->Mutex);
+        pTimer->pfnHandler = TimerBaseIntHandler;
+        pthread_mutex_unlock(&pTimer->Mutex);
+    }
+}
+
+void
+Timer_IF_InterruptClear(unsigned long ulBase)
+{
+    (void)ulBase;
+}
+
+void
+Timer_IF_Start(unsigned long ulBase, unsigned long ulTimer,
+               unsigned long ulValue)
+{
+    SimTimer_t *pTimer = SimTimerGet(ulBase);
+
+    (void)ulTimer;
+    if(pTimer != NULL && pTimer->bThread)
+    {
+        pthread_mutex_lock(&pTimer->Mutex);
+        pTimer->ulPeriodMs = ulValue;
+        pTimer->bRunning = true;
+        pthread_cond_signal(&pTimer->Cond);
+        pthread_mutex_unlock(&pTimer->Mutex);
+    }
+}
+
+void
+Timer_IF_Stop(unsigned long ulBase, unsigned long ulTimer)
+{
+    SimTimer_t *pTimer = SimTimerGet(ulBase);
+
+    (void)ulTimer;
+    if(pTimer != NULL && pTimer->bThread)
+    {
+        pthread_mutex_lock(&pTimer->Mutex);
+        pTimer->bRunning = false;
+        pthread_mutex_unlock(&pTimer->Mutex);
+    }
+}
+
+void
+Timer_IF_DeInit(unsigned long ulBase, unsigned long ulTimer)
+{
+    Timer_IF_Stop(ulBase, ulTimer);
+}
+
+unsigned long
+TimerIntStatus(unsigned long ulBase, int bMasked)
+{
+    (void)ulBase;
+    (void)bMasked;
+    return TIMER_TIMA_TIMEOUT;
+}
+
+void
+TimerIntClear(unsigned long ulBase, unsigned long ulIntFlags)
+{
+    (void)ulBase;
+    (void)ulIntFlags;
+}
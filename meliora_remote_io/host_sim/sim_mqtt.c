@@ -0,0 +1,827 @@
+//*****************************************************************************
+// sim_mqtt.c
+//
+// Host simulation: MQTT client library on host sockets
+//
+// Connect, subscribe and the QoS 1/2 handshakes follow MQTT 3.1.1 (or 3.1
+// with mqtt_mode31). Sends never wait for the broker; acknowledgements are
+// reported through the event callback like the library does in non-blocking
+// mode. Connect and subscribe wait for CONNACK and SUBACK.
+//
+//*****************************************************************************
+
+#define _GNU_SOURCE
+
+// Standard includes
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sl_mqtt_client.h"
+
+#define SIM_MQTT_MAX_CTX        4
+#define SIM_MQTT_MAX_PACKET     4096
+#define SIM_MQTT_STR_LEN        128
+#define SIM_MQTT_POLL_MS        200
+#define SIM_MQTT_RESP_SEC       30
+
+//
+// Control packet types, high nibble of the fixed header
+//
+#define MQTT_CONNECT            0x10
+#define MQTT_CONNACK            0x20
+#define MQTT_PUBLISH            0x30
+#define MQTT_PUBACK             0x40
+#define MQTT_PUBREC             0x50
+#define MQTT_PUBREL             0x60
+#define MQTT_PUBCOMP            0x70
+#define MQTT_SUBSCRIBE          0x80
+#define MQTT_SUBACK             0x90
+#define MQTT_UNSUBSCRIBE        0xA0
+#define MQTT_UNSUBACK           0xB0
+#define MQTT_PINGREQ            0xC0
+#define MQTT_PINGRESP           0xD0
+#define MQTT_DISCONNECT         0xE0
+
+typedef struct
+{
+    bool bUsed;
+    int iSock;
+    SlMqttClientCtxCfg_t Cfg;
+    SlMqttClientCbs_t Cbs;
+    void *pvApp;
+    char cClientId[SIM_MQTT_STR_LEN];
+    char cUser[SIM_MQTT_STR_LEN];
+    char cPass[SIM_MQTT_STR_LEN];
+    SlMqttWill_t Will;
+    bool bWill;
+    unsigned short usKeepAlive;
+    unsigned short usNextId;
+    time_t LastTx;
+    time_t RxDeadline;              /* 0 when a read may wait forever */
+    pthread_t RxThread;
+    bool bRxRunning;
+    volatile bool bClosing;
+    pthread_mutex_t TxLock;
+    pthread_mutex_t SubLock;
+    pthread_cond_t SubCond;
+    bool bSubAck;
+    unsigned char ucRx[SIM_MQTT_MAX_PACKET];
+}SimMqttCtx_t;
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+static SimMqttCtx_t g_SimMqttCtx[SIM_MQTT_MAX_CTX];
+static pthread_mutex_t g_SimMqttLock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long g_ulSimMqttRespSec = SIM_MQTT_RESP_SEC;
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! Appends a length prefixed string to a packet
+//
+//*****************************************************************************
+static int
+SimPutString(unsigned char *pucBuf, int iPos, const char *pcStr, int iLen)
+{
+    pucBuf[iPos++] = (unsigned char)(iLen >> 8);
+    pucBuf[iPos++] = (unsigned char)iLen;
+    memcpy(&pucBuf[iPos], pcStr, iLen);
+    return iPos + iLen;
+}
+
+//*****************************************************************************
+//
+//! Prepends the fixed header to a packet whose variable part starts at
+//! pucBuf[5]
+//!
+//! \return the offset of the packet in pucBuf
+//
+//*****************************************************************************
+static int
+SimFixedHeader(unsigned char *pucBuf, unsigned char ucType, int iRemLen)
+{
+    unsigned char ucLen[4];
+    int iNumLen = 0;
+    int iStart;
+
+    do
+    {
+        ucLen[iNumLen] = iRemLen & 0x7F;
+        iRemLen >>= 7;
+        if(iRemLen > 0)
+        {
+            ucLen[iNumLen] |= 0x80;
+        }
+        iNumLen++;
+    }while(iRemLen > 0);
+
+    iStart = 5 - 1 - iNumLen;
+    pucBuf[iStart] = ucType;
+    memcpy(&pucBuf[iStart + 1], ucLen, iNumLen);
+    return iStart;
+}
+
+//*****************************************************************************
+//
+//! Writes a whole packet to the broker
+//
+//*****************************************************************************
+static int
+SimSendAll(SimMqttCtx_t *pCtx, const unsigned char *pucBuf, int iLen)
+{
+    int iSent;
+    int iRet = 0;
+
+    pthread_mutex_lock(&pCtx->TxLock);
+    while(iLen > 0)
+    {
+        iSent = send(pCtx->iSock, pucBuf, iLen, MSG_NOSIGNAL);
+        if(iSent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(iSent <= 0)
+        {
+            iRet = -1;
+            break;
+        }
+        pucBuf += iSent;
+        iLen -= iSent;
+    }
+    pCtx->LastTx = time(NULL);
+    pthread_mutex_unlock(&pCtx->TxLock);
+    return iRet;
+}
+
+static int
+SimSendAck(SimMqttCtx_t *pCtx, unsigned char ucType, unsigned short usId)
+{
+    unsigned char ucPkt[4];
+
+    ucPkt[0] = ucType;
+    ucPkt[1] = 2;
+    ucPkt[2] = (unsigned char)(usId >> 8);
+    ucPkt[3] = (unsigned char)usId;
+    return SimSendAll(pCtx, ucPkt, sizeof(ucPkt));
+}
+
+//*****************************************************************************
+//
+//! Reads exactly iLen bytes, waiting at most SIM_MQTT_POLL_MS at a time so
+//! the caller can send keep-alives and notice a shutdown or RxDeadline
+//!
+//! \return 0 on success, -1 once the connection is gone
+//
+//*****************************************************************************
+static int
+SimRecvAll(SimMqttCtx_t *pCtx, unsigned char *pucBuf, int iLen)
+{
+    static const unsigned char ucPing[2] = {MQTT_PINGREQ, 0};
+    struct pollfd sPoll;
+    int iRead;
+
+    while(iLen > 0)
+    {
+        if(pCtx->bClosing ||
+           (pCtx->RxDeadline != 0 && time(NULL) >= pCtx->RxDeadline))
+        {
+            return -1;
+        }
+        sPoll.fd = pCtx->iSock;
+        sPoll.events = POLLIN;
+        if(poll(&sPoll, 1, SIM_MQTT_POLL_MS) == 0)
+        {
+            if(pCtx->usKeepAlive != 0 &&
+               time(NULL) - pCtx->LastTx >= pCtx->usKeepAlive)
+            {
+                SimSendAll(pCtx, ucPing, sizeof(ucPing));
+            }
+            continue;
+        }
+        iRead = recv(pCtx->iSock, pucBuf, iLen, 0);
+        if(iRead < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(iRead <= 0)
+        {
+            return -1;
+        }
+        pucBuf += iRead;
+        iLen -= iRead;
+    }
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Reads the next packet into the receive buffer
+//!
+//! \return the remaining length, the packet type in *pucType, or -1
+//
+//*****************************************************************************
+static int
+SimRecvPacket(SimMqttCtx_t *pCtx, unsigned char *pucType)
+{
+    unsigned char ucByte;
+    int iRemLen = 0;
+    int iShift = 0;
+
+    if(SimRecvAll(pCtx, pucType, 1) < 0)
+    {
+        return -1;
+    }
+    do
+    {
+        if(SimRecvAll(pCtx, &ucByte, 1) < 0 || iShift > 21)
+        {
+            return -1;
+        }
+        iRemLen |= (ucByte & 0x7F) << iShift;
+        iShift += 7;
+    }while(ucByte & 0x80);
+
+    if(iRemLen > SIM_MQTT_MAX_PACKET ||
+       SimRecvAll(pCtx, pCtx->ucRx, iRemLen) < 0)
+    {
+        return -1;
+    }
+    return iRemLen;
+}
+
+static void
+SimEvent(SimMqttCtx_t *pCtx, long lEvt, const void *pvBuf, unsigned long ulLen)
+{
+    if(pCtx->Cbs.sl_ExtLib_MqttEvent != NULL)
+    {
+        pCtx->Cbs.sl_ExtLib_MqttEvent(pCtx->pvApp, lEvt, pvBuf, ulLen);
+    }
+}
+
+//*****************************************************************************
+//
+//! Delivers a PUBLISH to the receive callback and acknowledges it
+//
+//*****************************************************************************
+static void
+SimHandlePublish(SimMqttCtx_t *pCtx, unsigned char ucFlags, int iLen)
+{
+    unsigned char *pucRx = pCtx->ucRx;
+    unsigned char ucQos = (ucFlags >> 1) & 0x3;
+    unsigned short usId = 0;
+    int iTopicLen;
+    int iPos;
+
+    if(iLen < 2)
+    {
+        return;
+    }
+    iTopicLen = (pucRx[0] << 8) | pucRx[1];
+    iPos = 2 + iTopicLen;
+    if(ucQos > 0)
+    {
+        usId = (pucRx[iPos] << 8) | pucRx[iPos + 1];
+        iPos += 2;
+    }
+    if(iPos > iLen)
+    {
+        return;
+    }
+
+    if(pCtx->Cbs.sl_ExtLib_MqttRecv != NULL)
+    {
+        pCtx->Cbs.sl_ExtLib_MqttRecv(pCtx->pvApp, (const char *)&pucRx[2],
+                                     iTopicLen, &pucRx[iPos], iLen - iPos,
+                                     (ucFlags & 0x8) != 0, ucQos,
+                                     (ucFlags & 0x1) != 0);
+    }
+    if(ucQos == 1)
+    {
+        SimSendAck(pCtx, MQTT_PUBACK, usId);
+    }
+    else if(ucQos == 2)
+    {
+        SimSendAck(pCtx, MQTT_PUBREC, usId);
+    }
+}
+
+//*****************************************************************************
+//
+//! Receive thread of a connected context
+//
+//*****************************************************************************
+static void *
+SimRxThread(void *pvArg)
+{
+    SimMqttCtx_t *pCtx = pvArg;
+    unsigned short usId;
+    unsigned char ucType;
+    int iLen;
+
+    for(;;)
+    {
+        iLen = SimRecvPacket(pCtx, &ucType);
+        if(iLen < 0)
+        {
+            break;
+        }
+        usId = (iLen >= 2) ? ((pCtx->ucRx[0] << 8) | pCtx->ucRx[1]) : 0;
+
+        switch(ucType & 0xF0)
+        {
+            case MQTT_PUBLISH:
+                SimHandlePublish(pCtx, ucType & 0x0F, iLen);
+                break;
+            case MQTT_PUBACK:
+                SimEvent(pCtx, SL_MQTT_CL_EVT_PUBACK, &usId, sizeof(usId));
+                break;
+            case MQTT_PUBREC:
+                SimSendAck(pCtx, MQTT_PUBREL | 0x2, usId);
+                break;
+            case MQTT_PUBREL:
+                SimSendAck(pCtx, MQTT_PUBCOMP, usId);
+                break;
+            case MQTT_PUBCOMP:
+                SimEvent(pCtx, SL_MQTT_CL_EVT_PUBCOMP, &usId, sizeof(usId));
+                break;
+            case MQTT_SUBACK:
+                if(iLen > 2)
+                {
+                    SimEvent(pCtx, SL_MQTT_CL_EVT_SUBACK, &pCtx->ucRx[2],
+                             iLen - 2);
+                }
+                pthread_mutex_lock(&pCtx->SubLock);
+                pCtx->bSubAck = true;
+                pthread_cond_signal(&pCtx->SubCond);
+                pthread_mutex_unlock(&pCtx->SubLock);
+                break;
+            case MQTT_UNSUBACK:
+                SimEvent(pCtx, SL_MQTT_CL_EVT_UNSUBACK, &usId, sizeof(usId));
+                break;
+            default:
+                break;
+        }
+    }
+
+    if(!pCtx->bClosing && pCtx->Cbs.sl_ExtLib_MqttDisconn != NULL)
+    {
+        pCtx->Cbs.sl_ExtLib_MqttDisconn(pCtx->pvApp);
+    }
+    return NULL;
+}
+
+//*****************************************************************************
+//
+//! Opens a TCP connection to the broker of the context, or to the one in
+//! SIM_MQTT_BROKER
+//
+//*****************************************************************************
+static int
+SimConnectBroker(SimMqttCtx_t *pCtx)
+{
+    struct addrinfo sHints;
+    struct addrinfo *pResult;
+    const char *pcEnv = getenv("SIM_MQTT_BROKER");
+    char cHost[SIM_MQTT_STR_LEN];
+    char cPort[8];
+    char *pcColon;
+    int iSock;
+
+    if(pcEnv != NULL && pcEnv[0] != '\0')
+    {
+        snprintf(cHost, sizeof(cHost), "%s", pcEnv);
+        pcColon = strrchr(cHost, ':');
+        if(pcColon != NULL)
+        {
+            *pcColon = '\0';
+            snprintf(cPort, sizeof(cPort), "%s", pcColon + 1);
+        }
+        else
+        {
+            snprintf(cPort, sizeof(cPort), "1883");
+        }
+    }
+    else
+    {
+        snprintf(cHost, sizeof(cHost), "%s",
+                 pCtx->Cfg.server_info.server_addr);
+        snprintf(cPort, sizeof(cPort), "%u",
+                 pCtx->Cfg.server_info.port_number);
+    }
+
+    memset(&sHints, 0, sizeof(sHints));
+    sHints.ai_family = AF_INET;
+    sHints.ai_socktype = SOCK_STREAM;
+    if(getaddrinfo(cHost, cPort, &sHints, &pResult) != 0)
+    {
+        return -1;
+    }
+    iSock = socket(AF_INET, SOCK_STREAM, 0);
+    if(iSock >= 0 &&
+       connect(iSock, pResult->ai_addr, pResult->ai_addrlen) < 0)
+    {
+        close(iSock);
+        iSock = -1;
+    }
+    freeaddrinfo(pResult);
+    return iSock;
+}
+
+//*****************************************************************************
+//
+//! Stops the receive thread and closes the broker connection
+//
+//*****************************************************************************
+static void
+SimCloseCtx(SimMqttCtx_t *pCtx)
+{
+    if(pCtx->iSock < 0)
+    {
+        return;
+    }
+    pCtx->bClosing = true;
+    shutdown(pCtx->iSock, SHUT_RDWR);
+    if(pCtx->bRxRunning)
+    {
+        if(pthread_equal(pCtx->RxThread, pthread_self()))
+        {
+            pthread_detach(pCtx->RxThread);
+        }
+        else
+        {
+            pthread_join(pCtx->RxThread, NULL);
+        }
+        pCtx->bRxRunning = false;
+    }
+    close(pCtx->iSock);
+    pCtx->iSock = -1;
+}
+
+long
+sl_ExtLib_MqttClientInit(const SlMqttClientLibCfg_t *cfg)
+{
+    if(cfg != NULL && cfg->resp_time != 0)
+    {
+        g_ulSimMqttRespSec = cfg->resp_time;
+    }
+    return 0;
+}
+
+long
+sl_ExtLib_MqttClientExit(void)
+{
+    int iIndex;
+
+    for(iIndex = 0; iIndex < SIM_MQTT_MAX_CTX; iIndex++)
+    {
+        if(g_SimMqttCtx[iIndex].bUsed)
+        {
+            sl_ExtLib_MqttClientCtxDelete(&g_SimMqttCtx[iIndex]);
+        }
+    }
+    return 0;
+}
+
+void *
+sl_ExtLib_MqttClientCtxCreate(const SlMqttClientCtxCfg_t *ctx_cfg,
+                              const SlMqttClientCbs_t *msg_cbs,
+                              void *app_hndl)
+{
+    SimMqttCtx_t *pCtx = NULL;
+    int iIndex;
+
+    pthread_mutex_lock(&g_SimMqttLock);
+    for(iIndex = 0; iIndex < SIM_MQTT_MAX_CTX; iIndex++)
+    {
+        if(!g_SimMqttCtx[iIndex].bUsed)
+        {
+            pCtx = &g_SimMqttCtx[iIndex];
+            memset(pCtx, 0, sizeof(SimMqttCtx_t));
+            pCtx->bUsed = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_SimMqttLock);
+    if(pCtx == NULL)
+    {
+        return NULL;
+    }
+
+    pCtx->iSock = -1;
+    pCtx->Cfg = *ctx_cfg;
+    pCtx->Cbs = *msg_cbs;
+    pCtx->pvApp = app_hndl;
+    pCtx->usNextId = 1;
+    pthread_mutex_init(&pCtx->TxLock, NULL);
+    pthread_mutex_init(&pCtx->SubLock, NULL);
+    pthread_cond_init(&pCtx->SubCond, NULL);
+    return pCtx;
+}
+
+long
+sl_ExtLib_MqttClientCtxDelete(void *cli_ctx)
+{
+    SimMqttCtx_t *pCtx = cli_ctx;
+
+    if(pCtx == NULL || !pCtx->bUsed)
+    {
+        return -1;
+    }
+    SimCloseCtx(pCtx);
+    pthread_mutex_destroy(&pCtx->TxLock);
+    pthread_mutex_destroy(&pCtx->SubLock);
+    pthread_cond_destroy(&pCtx->SubCond);
+    pthread_mutex_lock(&g_SimMqttLock);
+    pCtx->bUsed = false;
+    pthread_mutex_unlock(&g_SimMqttLock);
+    return 0;
+}
+
+long
+sl_ExtLib_MqttClientSet(void *cli_ctx, long param, const void *value,
+                        unsigned long len)
+{
+    SimMqttCtx_t *pCtx = cli_ctx;
+    char *pcDest;
+
+    switch(param)
+    {
+        case SL_MQTT_PARAM_CLIENT_ID:
+            pcDest = pCtx->cClientId;
+            break;
+        case SL_MQTT_PARAM_USER_NAME:
+            pcDest = pCtx->cUser;
+            break;
+        case SL_MQTT_PARAM_PASS_WORD:
+            pcDest = pCtx->cPass;
+            break;
+        case SL_MQTT_PARAM_WILL_PARAM:
+            pCtx->Will = *(const SlMqttWill_t *)value;
+            pCtx->bWill = true;
+            return 0;
+        default:
+            return -1;
+    }
+    if(len >= SIM_MQTT_STR_LEN)
+    {
+        return -1;
+    }
+    memcpy(pcDest, value, len);
+    pcDest[len] = '\0';
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Connects to the broker and waits for the CONNACK
+//!
+//! \return the CONNACK return code in the low byte and the session present
+//!         flag in the next one, or -1 if the broker did not answer
+//
+//*****************************************************************************
+long
+sl_ExtLib_MqttClientConnect(void *cli_ctx, bool clean,
+                            unsigned short keep_alive_time)
+{
+    SimMqttCtx_t *pCtx = cli_ctx;
+    unsigned char ucPkt[SIM_MQTT_MAX_PACKET];
+    unsigned char ucFlags = clean ? 0x02 : 0x00;
+    unsigned char ucType;
+    int iPos = 5;
+    int iStart;
+    int iLen;
+
+    if(pCtx->iSock >= 0)
+    {
+        return -1;
+    }
+    pCtx->iSock = SimConnectBroker(pCtx);
+    if(pCtx->iSock < 0)
+    {
+        return -1;
+    }
+    pCtx->bClosing = false;
+    pCtx->usKeepAlive = keep_alive_time;
+
+    if(pCtx->Cfg.mqtt_mode31)
+    {
+        iPos = SimPutString(ucPkt, iPos, "MQIsdp", 6);
+        ucPkt[iPos++] = 3;
+    }
+    else
+    {
+        iPos = SimPutString(ucPkt, iPos, "MQTT", 4);
+        ucPkt[iPos++] = 4;
+    }
+    if(pCtx->bWill)
+    {
+        ucFlags |= 0x04 | ((pCtx->Will.will_qos & 0x3) << 3) |
+                   (pCtx->Will.retain ? 0x20 : 0);
+    }
+    if(pCtx->cUser[0] != '\0')
+    {
+        ucFlags |= 0x80 | (pCtx->cPass[0] != '\0' ? 0x40 : 0);
+    }
+    ucPkt[iPos++] = ucFlags;
+    ucPkt[iPos++] = (unsigned char)(keep_alive_time >> 8);
+    ucPkt[iPos++] = (unsigned char)keep_alive_time;
+    iPos = SimPutString(ucPkt, iPos, pCtx->cClientId,
+                        strlen(pCtx->cClientId));
+    if(pCtx->bWill)
+    {
+        iPos = SimPutString(ucPkt, iPos, pCtx->Will.will_topic,
+                            strlen(pCtx->Will.will_topic));
+        iPos = SimPutString(ucPkt, iPos, pCtx->Will.will_msg,
+                            strlen(pCtx->Will.will_msg));
+    }
+    if(ucFlags & 0x80)
+    {
+        iPos = SimPutString(ucPkt, iPos, pCtx->cUser, strlen(pCtx->cUser));
+    }
+    if(ucFlags & 0x40)
+    {
+        iPos = SimPutString(ucPkt, iPos, pCtx->cPass, strlen(pCtx->cPass));
+    }
+    iStart = SimFixedHeader(ucPkt, MQTT_CONNECT, iPos - 5);
+
+    pCtx->RxDeadline = time(NULL) + g_ulSimMqttRespSec;
+    iLen = -1;
+    if(SimSendAll(pCtx, &ucPkt[iStart], iPos - iStart) == 0)
+    {
+        iLen = SimRecvPacket(pCtx, &ucType);
+    }
+    pCtx->RxDeadline = 0;
+    if(iLen < 2 || (ucType & 0xF0) != MQTT_CONNACK)
+    {
+        SimCloseCtx(pCtx);
+        return -1;
+    }
+    if(pCtx->ucRx[1] != 0)
+    {
+        SimCloseCtx(pCtx);
+        return pCtx->ucRx[1];
+    }
+
+    if(pthread_create(&pCtx->RxThread, NULL, SimRxThread, pCtx) != 0)
+    {
+        SimCloseCtx(pCtx);
+        return -1;
+    }
+    pCtx->bRxRunning = true;
+    return ((pCtx->ucRx[0] & 0x1) << 8) | pCtx->ucRx[1];
+}
+
+long
+sl_ExtLib_MqttClientDisconnect(void *cli_ctx)
+{
+    static const unsigned char ucPkt[2] = {MQTT_DISCONNECT, 0};
+    SimMqttCtx_t *pCtx = cli_ctx;
+
+    if(pCtx->iSock < 0)
+    {
+        return -1;
+    }
+    SimSendAll(pCtx, ucPkt, sizeof(ucPkt));
+    SimCloseCtx(pCtx);
+    return 0;
+}
+
+static unsigned short
+SimNextId(SimMqttCtx_t *pCtx)
+{
+    unsigned short usId;
+
+    pthread_mutex_lock(&pCtx->TxLock);
+    usId = pCtx->usNextId++;
+    if(pCtx->usNextId == 0)
+    {
+        pCtx->usNextId = 1;
+    }
+    pthread_mutex_unlock(&pCtx->TxLock);
+    return usId;
+}
+
+long
+sl_ExtLib_MqttClientSub(void *cli_ctx, char **topics, unsigned char *qos,
+                        long count)
+{
+    SimMqttCtx_t *pCtx = cli_ctx;
+    unsigned char ucPkt[SIM_MQTT_MAX_PACKET];
+    unsigned short usId = SimNextId(pCtx);
+    struct timespec sDeadline;
+    int iPos = 5;
+    int iStart;
+    long lIndex;
+    int iRet = 0;
+
+    ucPkt[iPos++] = (unsigned char)(usId >> 8);
+    ucPkt[iPos++] = (unsigned char)usId;
+    for(lIndex = 0; lIndex < count; lIndex++)
+    {
+        if(iPos + 3 + (int)strlen(topics[lIndex]) > SIM_MQTT_MAX_PACKET)
+        {
+            return -1;
+        }
+        iPos = SimPutString(ucPkt, iPos, topics[lIndex],
+                            strlen(topics[lIndex]));
+        ucPkt[iPos++] = qos[lIndex];
+    }
+    iStart = SimFixedHeader(ucPkt, MQTT_SUBSCRIBE | 0x2, iPos - 5);
+
+    pthread_mutex_lock(&pCtx->SubLock);
+    pCtx->bSubAck = false;
+    pthread_mutex_unlock(&pCtx->SubLock);
+    if(SimSendAll(pCtx, &ucPkt[iStart], iPos - iStart) < 0)
+    {
+        return -1;
+    }
+
+    clock_gettime(CLOCK_REALTIME, &sDeadline);
+    sDeadline.tv_sec += g_ulSimMqttRespSec;
+    pthread_mutex_lock(&pCtx->SubLock);
+    while(!pCtx->bSubAck && iRet == 0)
+    {
+        iRet = pthread_cond_timedwait(&pCtx->SubCond, &pCtx->SubLock,
+                                      &sDeadline);
+    }
+    pthread_mutex_unlock(&pCtx->SubLock);
+    return pCtx->bSubAck ? 0 : -1;
+}
+
+long
+sl_ExtLib_MqttClientUnsub(void *cli_ctx, char **topics, long count)
+{
+    SimMqttCtx_t *pCtx = cli_ctx;
+    unsigned char ucPkt[SIM_MQTT_MAX_PACKET];
+    unsigned short usId = SimNextId(pCtx);
+    int iPos = 5;
+    int iStart;
+    long lIndex;
+
+    ucPkt[iPos++] = (unsigned char)(usId >> 8);
+    ucPkt[iPos++] = (unsigned char)usId;
+    for(lIndex = 0; lIndex < count; lIndex++)
+    {
+        if(iPos + 2 + (int)strlen(topics[lIndex]) > SIM_MQTT_MAX_PACKET)
+        {
+            return -1;
+        }
+        iPos = SimPutString(ucPkt, iPos, topics[lIndex],
+                            strlen(topics[lIndex]));
+    }
+    iStart = SimFixedHeader(ucPkt, MQTT_UNSUBSCRIBE | 0x2, iPos - 5);
+    return SimSendAll(pCtx, &ucPkt[iStart], iPos - iStart);
+}
+
+//*****************************************************************************
+//
+//! Publishes a message without waiting for its acknowledgement
+//!
+//! \return the message id, 0 for QoS0, or -1 if the connection is gone
+//
+//*****************************************************************************
+long
+sl_ExtLib_MqttClientSend(void *cli_ctx, const char *topic, const void *data,
+                         long len, char qos, bool retain)
+{
+    SimMqttCtx_t *pCtx = cli_ctx;
+    unsigned char ucPkt[SIM_MQTT_MAX_PACKET];
+    unsigned short usId = 0;
+    int iTopicLen = strlen(topic);
+    int iPos = 5;
+    int iStart;
+
+    if(pCtx == NULL || pCtx->iSock < 0 || pCtx->bClosing ||
+       iPos + 4 + iTopicLen + len > SIM_MQTT_MAX_PACKET)
+    {
+        return -1;
+    }
+    iPos = SimPutString(ucPkt, iPos, topic, iTopicLen);
+    if(qos > 0)
+    {
+        usId = SimNextId(pCtx);
+        ucPkt[iPos++] = (unsigned char)(usId >> 8);
+        ucPkt[iPos++] = (unsigned char)usId;
+    }
+    memcpy(&ucPkt[iPos], data, len);
+    iPos += len;
+    iStart = SimFixedHeader(ucPkt, MQTT_PUBLISH | ((qos & 0x3) << 1) |
+                                   (retain ? 0x1 : 0), iPos - 5);
+
+    if(SimSendAll(pCtx, &ucPkt[iStart], iPos - iStart) < 0)
+    {
+        return -1;
+    }
+    return usId;
+}
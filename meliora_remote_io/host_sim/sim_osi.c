@@ -0,0 +1,392 @@
+//*****************************************************************************
+// sim_osi.c
+//
+// Host simulation: OS abstraction layer on POSIX threads
+//
+//*****************************************************************************
+
+#define _GNU_SOURCE
+
+// Standard includes
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "osi.h"
+
+typedef struct
+{
+    P_OSI_TASK_ENTRY pEntry;
+    void *pvParameters;
+}SimTask_t;
+
+typedef struct
+{
+    pthread_mutex_t Mutex;
+    pthread_cond_t Cond;
+    unsigned char *pucBuf;
+    unsigned long ulMsgSize;
+    unsigned long ulMaxMsgs;
+    unsigned long ulHead;
+    unsigned long ulCount;
+}SimMsgQ_t;
+
+typedef struct
+{
+    pthread_mutex_t Mutex;
+    pthread_cond_t Cond;
+    int bSignaled;
+}SimSyncObj_t;
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+static pthread_mutex_t g_SimCritical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! Converts a relative timeout in ms to the absolute time of a timed wait
+//
+//*****************************************************************************
+static void
+SimDeadline(OsiTime_t Timeout, struct timespec *pDeadline)
+{
+    clock_gettime(CLOCK_REALTIME, pDeadline);
+    pDeadline->tv_sec += Timeout / 1000;
+    pDeadline->tv_nsec += (long)(Timeout % 1000) * 1000000;
+    if(pDeadline->tv_nsec >= 1000000000)
+    {
+        pDeadline->tv_sec++;
+        pDeadline->tv_nsec -= 1000000000;
+    }
+}
+
+//*****************************************************************************
+//
+//! Waits on a condition variable for at most Timeout ms
+//!
+//! \return 0 when signaled, ETIMEDOUT otherwise
+//
+//*****************************************************************************
+static int
+SimWait(pthread_cond_t *pCond, pthread_mutex_t *pMutex, OsiTime_t Timeout,
+        const struct timespec *pDeadline)
+{
+    if(Timeout == OSI_WAIT_FOREVER)
+    {
+        return pthread_cond_wait(pCond, pMutex);
+    }
+    if(Timeout == OSI_NO_WAIT)
+    {
+        return ETIMEDOUT;
+    }
+    return pthread_cond_timedwait(pCond, pMutex, pDeadline);
+}
+
+/* The start block stays allocated like a FreeRTOS TCB: freeing it here, in
+   the new thread, could come after the heap has been sealed */
+static void *
+SimTaskEntry(void *pvArg)
+{
+    SimTask_t *pTask = pvArg;
+
+    pTask->pEntry(pTask->pvParameters);
+    return NULL;
+}
+
+OsiReturnVal_e
+osi_TaskCreate(P_OSI_TASK_ENTRY pEntry, const signed char * const pcName,
+               unsigned short usStackDepth, void *pvParameters,
+               unsigned long uxPriority, OsiTaskHandle *pTaskHandle)
+{
+    pthread_t *pThread = malloc(sizeof(pthread_t));
+    SimTask_t *pTask = malloc(sizeof(SimTask_t));
+
+    if(pThread == NULL || pTask == NULL)
+    {
+        free(pThread);
+        free(pTask);
+        return OSI_MEMORY_ALLOCATION_FAILURE;
+    }
+    pTask->pEntry = pEntry;
+    pTask->pvParameters = pvParameters;
+    if(pthread_create(pThread, NULL, SimTaskEntry, pTask) != 0)
+    {
+        free(pThread);
+        free(pTask);
+        return OSI_OPERATION_FAILED;
+    }
+    pthread_setname_np(*pThread, (const char *)pcName);
+    pthread_detach(*pThread);
+
+    if(pTaskHandle != NULL)
+    {
+        *pTaskHandle = pThread;
+    }
+    return OSI_OK;
+}
+
+void
+osi_TaskDelete(OsiTaskHandle *pTaskHandle)
+{
+    if(pTaskHandle == NULL || *pTaskHandle == NULL)
+    {
+        pthread_exit(NULL);
+    }
+    pthread_cancel(*(pthread_t *)*pTaskHandle);
+}
+
+void
+osi_Sleep(unsigned int MilliSecs)
+{
+    struct timespec Delay;
+
+    Delay.tv_sec = MilliSecs / 1000;
+    Delay.tv_nsec = (long)(MilliSecs % 1000) * 1000000;
+    while(nanosleep(&Delay, &Delay) != 0 && errno == EINTR)
+    {
+    }
+}
+
+void
+osi_start(void)
+{
+    for(;;)
+    {
+        pause();
+    }
+}
+
+void
+osi_TaskDisable(void)
+{
+    pthread_mutex_lock(&g_SimCritical);
+}
+
+void
+osi_TaskEnable(void)
+{
+    pthread_mutex_unlock(&g_SimCritical);
+}
+
+unsigned long
+osi_EnterCritical(void)
+{
+    pthread_mutex_lock(&g_SimCritical);
+    return 0;
+}
+
+void
+osi_ExitCritical(unsigned long ulKey)
+{
+    (void)ulKey;
+    pthread_mutex_unlock(&g_SimCritical);
+}
+
+OsiReturnVal_e
+osi_MsgQCreate(OsiMsgQ_t *pMsgQ, char *pMsgQName, unsigned long MsgSize,
+               unsigned long MaxMsgs)
+{
+    SimMsgQ_t *pQ = calloc(1, sizeof(SimMsgQ_t));
+
+    if(pQ == NULL || (pQ->pucBuf = malloc(MsgSize * MaxMsgs)) == NULL)
+    {
+        free(pQ);
+        return OSI_MEMORY_ALLOCATION_FAILURE;
+    }
+    pthread_mutex_init(&pQ->Mutex, NULL);
+    pthread_cond_init(&pQ->Cond, NULL);
+    pQ->ulMsgSize = MsgSize;
+    pQ->ulMaxMsgs = MaxMsgs;
+    *pMsgQ = pQ;
+    return OSI_OK;
+}
+
+OsiReturnVal_e
+osi_MsgQDelete(OsiMsgQ_t *pMsgQ)
+{
+    SimMsgQ_t *pQ = *pMsgQ;
+
+    pthread_mutex_destroy(&pQ->Mutex);
+    pthread_cond_destroy(&pQ->Cond);
+    free(pQ->pucBuf);
+    free(pQ);
+    *pMsgQ = NULL;
+    return OSI_OK;
+}
+
+OsiReturnVal_e
+osi_MsgQWrite(OsiMsgQ_t *pMsgQ, void *pMsg, OsiTime_t Timeout)
+{
+    SimMsgQ_t *pQ = *pMsgQ;
+    struct timespec Deadline;
+    unsigned long ulSlot;
+
+    SimDeadline(Timeout, &Deadline);
+    pthread_mutex_lock(&pQ->Mutex);
+    while(pQ->ulCount == pQ->ulMaxMsgs)
+    {
+        if(SimWait(&pQ->Cond, &pQ->Mutex, Timeout, &Deadline) == ETIMEDOUT)
+        {
+            pthread_mutex_unlock(&pQ->Mutex);
+            return OSI_TIMEOUT;
+        }
+    }
+    ulSlot = (pQ->ulHead + pQ->ulCount) % pQ->ulMaxMsgs;
+    memcpy(&pQ->pucBuf[ulSlot * pQ->ulMsgSize], pMsg, pQ->ulMsgSize);
+    pQ->ulCount++;
+    pthread_cond_broadcast(&pQ->Cond);
+    pthread_mutex_unlock(&pQ->Mutex);
+    return OSI_OK;
+}
+
+OsiReturnVal_e
+osi_MsgQRead(OsiMsgQ_t *pMsgQ, void *pMsg, OsiTime_t Timeout)
+{
+    SimMsgQ_t *pQ = *pMsgQ;
+    struct timespec Deadline;
+
+    SimDeadline(Timeout, &Deadline);
+    pthread_mutex_lock(&pQ->Mutex);
+    while(pQ->ulCount == 0)
+    {
+        if(SimWait(&pQ->Cond, &pQ->Mutex, Timeout, &Deadline) == ETIMEDOUT)
+        {
+            pthread_mutex_unlock(&pQ->Mutex);
+            return OSI_TIMEOUT;
+        }
+    }
+    memcpy(pMsg, &pQ->pucBuf[pQ->ulHead * pQ->ulMsgSize], pQ->ulMsgSize);
+    pQ->ulHead = (pQ->ulHead + 1) % pQ->ulMaxMsgs;
+    pQ->ulCount--;
+    pthread_cond_broadcast(&pQ->Cond);
+    pthread_mutex_unlock(&pQ->Mutex);
+    return OSI_OK;
+}
+
+OsiReturnVal_e
+osi_SyncObjCreate(OsiSyncObj_t *pSyncObj)
+{
+    SimSyncObj_t *pObj = calloc(1, sizeof(SimSyncObj_t));
+
+    if(pObj == NULL)
+    {
+        return OSI_MEMORY_ALLOCATION_FAILURE;
+    }
+    pthread_mutex_init(&pObj->Mutex, NULL);
+    pthread_cond_init(&pObj->Cond, NULL);
+    *pSyncObj = pObj;
+    return OSI_OK;
+}
+
+OsiReturnVal_e
+osi_SyncObjDelete(OsiSyncObj_t *pSyncObj)
+{
+    SimSyncObj_t *pObj = *pSyncObj;
+
+    pthread_mutex_destroy(&pObj->Mutex);
+    pthread_cond_destroy(&pObj->Cond);
+    free(pObj);
+    *pSyncObj = NULL;
+    return OSI_OK;
+}
+
+OsiReturnVal_e
+osi_SyncObjSignal(OsiSyncObj_t *pSyncObj)
+{
+    SimSyncObj_t *pObj = *pSyncObj;
+
+    pthread_mutex_lock(&pObj->Mutex);
+    pObj->bSignaled = 1;
+    pthread_cond_signal(&pObj->Cond);
+    pthread_mutex_unlock(&pObj->Mutex);
+    return OSI_OK;
+}
+
+OsiReturnVal_e
+osi_SyncObjSignalFromISR(OsiSyncObj_t *pSyncObj)
+{
+    return osi_SyncObjSignal(pSyncObj);
+}
+
+OsiReturnVal_e
+osi_SyncObjWait(OsiSyncObj_t *pSyncObj, OsiTime_t Timeout)
+{
+    SimSyncObj_t *pObj = *pSyncObj;
+    struct timespec Deadline;
+
+    SimDeadline(Timeout, &Deadline);
+    pthread_mutex_lock(&pObj->Mutex);
+    while(!pObj->bSignaled)
+    {
+        if(SimWait(&pObj->Cond, &pObj->Mutex, Timeout, &Deadline) == ETIMEDOUT)
+        {
+            pthread_mutex_unlock(&pObj->Mutex);
+            return OSI_TIMEOUT;
+        }
+    }
+    pObj->bSignaled = 0;
+    pthread_mutex_unlock(&pObj->Mutex);
+    return OSI_OK;
+}
+
+OsiReturnVal_e
+osi_SyncObjClear(OsiSyncObj_t *pSyncObj)
+{
+    SimSyncObj_t *pObj = *pSyncObj;
+
+    pthread_mutex_lock(&pObj->Mutex);
+    pObj->bSignaled = 0;
+    pthread_mutex_unlock(&pObj->Mutex);
+    return OSI_OK;
+}
+
+OsiReturnVal_e
+osi_LockObjCreate(OsiLockObj_t *pLockObj)
+{
+    pthread_mutex_t *pMutex = malloc(sizeof(pthread_mutex_t));
+
+    if(pMutex == NULL)
+    {
+        return OSI_MEMORY_ALLOCATION_FAILURE;
+    }
+    pthread_mutex_init(pMutex, NULL);
+    *pLockObj = pMutex;
+    return OSI_OK;
+}
+
+OsiReturnVal_e
+osi_LockObjDelete(OsiLockObj_t *pLockObj)
+{
+    pthread_mutex_destroy(*pLockObj);
+    free(*pLockObj);
+    *pLockObj = NULL;
+    return OSI_OK;
+}
+
+OsiReturnVal_e
+osi_LockObjLock(OsiLockObj_t *pLockObj, OsiTime_t Timeout)
+{
+    struct timespec Deadline;
+
+    if(Timeout == OSI_WAIT_FOREVER)
+    {
+        return pthread_mutex_lock(*pLockObj) == 0 ? OSI_OK : OSI_FAILURE;
+    }
+    SimDeadline(Timeout, &Deadline);
+    return pthread_mutex_timedlock(*pLockObj, &Deadline) == 0 ? OSI_OK :
+                                                                OSI_TIMEOUT;
+}
+
+OsiReturnVal_e
+osi_LockObjUnlock(OsiLockObj_t *pLockObj)
+{
+    pthread_mutex_unlock(*pLockObj);
+    return OSI_OK;
+}
@@ -0,0 +1,562 @@
+//*****************************************************************************
+// sim_simplelink.c
+//
+// Host simulation: SimpleLink sockets, file system and Wi-Fi profiles, and
+// the network interface helpers of the SDK common files
+//
+//*****************************************************************************
+
+#define _GNU_SOURCE
+
+// Standard includes
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "simplelink.h"
+#include "network_if.h"
+#include "uart_if.h"
+#include "common.h"
+
+#define SIM_FS_DEFAULT_DIR      "sim_fs"
+#define SIM_PROFILE_FILE        "wlan_profile"
+#define SIM_POLICY_FILE         "wlan_policy"
+#define SIM_PATH_LEN            256
+#define SIM_SSID_LEN            32
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+volatile unsigned long g_ulStatus = 0;
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! Builds the host path of a file of the simulated serial flash
+//
+//*****************************************************************************
+static void
+SimFsPath(const char *pcName, char *pcPath)
+{
+    const char *pcDir = getenv("SIM_FS_DIR");
+
+    if(pcDir == NULL || pcDir[0] == '\0')
+    {
+        pcDir = SIM_FS_DEFAULT_DIR;
+    }
+    mkdir(pcDir, 0755);
+    snprintf(pcPath, SIM_PATH_LEN, "%s/%s", pcDir, pcName);
+}
+
+//*****************************************************************************
+//
+//! Converts a SimpleLink IPv4 address to the host representation. Ports
+//! below 1024 are moved up by SIM_PRIV_PORT_OFFSET unless running as root.
+//
+//*****************************************************************************
+static void
+SimToHostAddr(const SlSockAddr_t *pAddr, struct sockaddr_in *pHost,
+              bool bBind)
+{
+    const SlSockAddrIn_t *pIn = (const SlSockAddrIn_t *)pAddr;
+    unsigned short usPort = ntohs(pIn->sin_port);
+
+    memset(pHost, 0, sizeof(struct sockaddr_in));
+    pHost->sin_family = AF_INET;
+    pHost->sin_addr.s_addr = (in_addr_t)pIn->sin_addr.s_addr;
+    if(bBind && usPort != 0 && usPort < 1024 && geteuid() != 0)
+    {
+        usPort += SIM_PRIV_PORT_OFFSET;
+    }
+    pHost->sin_port = htons(usPort);
+}
+
+static void
+SimFromHostAddr(const struct sockaddr_in *pHost, SlSockAddr_t *pAddr)
+{
+    SlSockAddrIn_t *pIn = (SlSockAddrIn_t *)pAddr;
+
+    memset(pIn, 0, sizeof(SlSockAddrIn_t));
+    pIn->sin_family = SL_AF_INET;
+    pIn->sin_port = pHost->sin_port;
+    pIn->sin_addr.s_addr = pHost->sin_addr.s_addr;
+}
+
+//*****************************************************************************
+//
+//! Maps the result of a host socket call to a SimpleLink status
+//
+//*****************************************************************************
+static _i16
+SimSockStatus(long lRet)
+{
+    if(lRet >= 0)
+    {
+        return (_i16)lRet;
+    }
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? SL_EAGAIN :
+                                                       SL_SOC_ERROR;
+}
+
+_i16
+sl_Socket(_i16 Domain, _i16 Type, _i16 Protocol)
+{
+    int iType = (Type == SL_SOCK_DGRAM) ? SOCK_DGRAM : SOCK_STREAM;
+
+    (void)Domain;
+    (void)Protocol;
+    return SimSockStatus(socket(AF_INET, iType, 0));
+}
+
+_i16
+sl_Close(_i16 sd)
+{
+    return SimSockStatus(close(sd));
+}
+
+_i16
+sl_Bind(_i16 sd, const SlSockAddr_t *addr, _i16 addrlen)
+{
+    struct sockaddr_in sHost;
+    int iOne = 1;
+
+    (void)addrlen;
+    SimToHostAddr(addr, &sHost, true);
+    setsockopt(sd, SOL_SOCKET, SO_REUSEADDR, &iOne, sizeof(iOne));
+    return SimSockStatus(bind(sd, (struct sockaddr *)&sHost, sizeof(sHost)));
+}
+
+_i16
+sl_Listen(_i16 sd, _i16 backlog)
+{
+    return SimSockStatus(listen(sd, backlog));
+}
+
+_i16
+sl_Accept(_i16 sd, SlSockAddr_t *addr, SlSocklen_t *addrlen)
+{
+    struct sockaddr_in sHost;
+    socklen_t iLen = sizeof(sHost);
+    int iNewSd;
+
+    iNewSd = accept(sd, (struct sockaddr *)&sHost, &iLen);
+    if(iNewSd >= 0 && addr != NULL)
+    {
+        SimFromHostAddr(&sHost, addr);
+        if(addrlen != NULL)
+        {
+            *addrlen = sizeof(SlSockAddrIn_t);
+        }
+    }
+    return SimSockStatus(iNewSd);
+}
+
+_i16
+sl_Connect(_i16 sd, const SlSockAddr_t *addr, _i16 addrlen)
+{
+    struct sockaddr_in sHost;
+
+    (void)addrlen;
+    SimToHostAddr(addr, &sHost, false);
+    return SimSockStatus(connect(sd, (struct sockaddr *)&sHost,
+                                 sizeof(sHost)));
+}
+
+_i16
+sl_Recv(_i16 sd, void *buf, _i16 Len, _i16 flags)
+{
+    (void)flags;
+    return SimSockStatus(recv(sd, buf, Len, 0));
+}
+
+_i16
+sl_Send(_i16 sd, const void *buf, _i16 Len, _i16 flags)
+{
+    (void)flags;
+    return SimSockStatus(send(sd, buf, Len, MSG_NOSIGNAL));
+}
+
+_i16
+sl_RecvFrom(_i16 sd, void *buf, _i16 Len, _i16 flags, SlSockAddr_t *from,
+            SlSocklen_t *fromlen)
+{
+    struct sockaddr_in sHost;
+    socklen_t iLen = sizeof(sHost);
+    ssize_t lRead;
+
+    (void)flags;
+    lRead = recvfrom(sd, buf, Len, 0, (struct sockaddr *)&sHost, &iLen);
+    if(lRead >= 0 && from != NULL)
+    {
+        SimFromHostAddr(&sHost, from);
+        if(fromlen != NULL)
+        {
+            *fromlen = sizeof(SlSockAddrIn_t);
+        }
+    }
+    return SimSockStatus(lRead);
+}
+
+_i16
+sl_SendTo(_i16 sd, const void *buf, _i16 Len, _i16 flags,
+          const SlSockAddr_t *to, SlSocklen_t tolen)
+{
+    struct sockaddr_in sHost;
+
+    (void)flags;
+    (void)tolen;
+    SimToHostAddr(to, &sHost, false);
+    return SimSockStatus(sendto(sd, buf, Len, MSG_NOSIGNAL,
+                                (struct sockaddr *)&sHost, sizeof(sHost)));
+}
+
+_i16
+sl_SetSockOpt(_i16 sd, _i16 level, _i16 optname, const void *optval,
+              SlSocklen_t optlen)
+{
+    _u32 ulValue = 0;
+    int iFlags;
+
+    (void)level;
+    if(optname == SL_SO_NONBLOCKING)
+    {
+        memcpy(&ulValue, optval,
+               (size_t)optlen < sizeof(ulValue) ? (size_t)optlen :
+                                                  sizeof(ulValue));
+        iFlags = fcntl(sd, F_GETFL, 0);
+        if(iFlags < 0)
+        {
+            return SL_SOC_ERROR;
+        }
+        iFlags = ulValue ? (iFlags | O_NONBLOCK) : (iFlags & ~O_NONBLOCK);
+        return SimSockStatus(fcntl(sd, F_SETFL, iFlags));
+    }
+    if(optname == SL_SO_RCVTIMEO)
+    {
+        const SlTimeval_t *pTimeout = optval;
+        struct timeval sHost;
+
+        sHost.tv_sec = pTimeout->tv_sec;
+        sHost.tv_usec = pTimeout->tv_usec;
+        return SimSockStatus(setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &sHost,
+                                        sizeof(sHost)));
+    }
+    return 0;
+}
+
+_i16
+sl_Select(_i16 nfds, SlFdSet_t *readsds, SlFdSet_t *writesds,
+          SlFdSet_t *exceptsds, SlTimeval_t *timeout)
+{
+    struct timeval sHost;
+
+    if(timeout != NULL)
+    {
+        sHost.tv_sec = timeout->tv_sec + timeout->tv_usec / 1000000;
+        sHost.tv_usec = timeout->tv_usec % 1000000;
+    }
+    return SimSockStatus(select(nfds,
+                                readsds ? &readsds->Set : NULL,
+                                writesds ? &writesds->Set : NULL,
+                                exceptsds ? &exceptsds->Set : NULL,
+                                timeout ? &sHost : NULL));
+}
+
+_u32
+sl_Htonl(_u32 val)
+{
+    return htonl((uint32_t)val);
+}
+
+_u16
+sl_Htons(_u16 val)
+{
+    return htons(val);
+}
+
+//*****************************************************************************
+//
+//! Resolves a host name with the host resolver
+//!
+//! \return 0 with the address in host byte order, negative on failure
+//
+//*****************************************************************************
+_i16
+sl_NetAppDnsGetHostByName(_i8 *hostname, _u16 usNameLen, _u32 *out_ip_addr,
+                          _u8 family)
+{
+    struct addrinfo sHints;
+    struct addrinfo *pResult;
+    char cName[256];
+
+    (void)family;
+    if(usNameLen >= sizeof(cName))
+    {
+        return -1;
+    }
+    memcpy(cName, hostname, usNameLen);
+    cName[usNameLen] = '\0';
+
+    memset(&sHints, 0, sizeof(sHints));
+    sHints.ai_family = AF_INET;
+    if(getaddrinfo(cName, NULL, &sHints, &pResult) != 0)
+    {
+        return -1;
+    }
+    *out_ip_addr =
+        ntohl(((struct sockaddr_in *)pResult->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(pResult);
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! File system calls, one host file per serial flash file
+//
+//*****************************************************************************
+_i32
+sl_FsOpen(_u8 *pFileName, _u32 AccessModeAndMaxSize, _u32 *pToken,
+          _i32 *pFileHandle)
+{
+    char cPath[SIM_PATH_LEN];
+    int iFlags;
+    int iFd;
+
+    (void)pToken;
+    switch(AccessModeAndMaxSize & 0xFF)
+    {
+        case FS_MODE_OPEN_READ:
+            iFlags = O_RDONLY;
+            break;
+        case FS_MODE_OPEN_WRITE:
+            iFlags = O_RDWR;
+            break;
+        default:
+            iFlags = O_RDWR | O_CREAT;
+            break;
+    }
+    SimFsPath((const char *)pFileName, cPath);
+    iFd = open(cPath, iFlags, 0644);
+    if(iFd < 0)
+    {
+        return -1;
+    }
+    *pFileHandle = iFd;
+    return 0;
+}
+
+_i16
+sl_FsClose(_i32 FileHdl, _u8 *pCeritificateFileName, _u8 *pSignature,
+           _u32 SignatureLen)
+{
+    (void)pCeritificateFileName;
+    (void)pSignature;
+    (void)SignatureLen;
+    return (close((int)FileHdl) == 0) ? 0 : -1;
+}
+
+_i32
+sl_FsRead(_i32 FileHdl, _u32 Offset, _u8 *pData, _u32 Len)
+{
+    return pread((int)FileHdl, pData, Len, Offset);
+}
+
+_i32
+sl_FsWrite(_i32 FileHdl, _u32 Offset, _u8 *pData, _u32 Len)
+{
+    return pwrite((int)FileHdl, pData, Len, Offset);
+}
+
+_i16
+sl_FsDel(_u8 *pFileName, _u32 Token)
+{
+    char cPath[SIM_PATH_LEN];
+
+    (void)Token;
+    SimFsPath((const char *)pFileName, cPath);
+    return (unlink(cPath) == 0) ? 0 : -1;
+}
+
+//*****************************************************************************
+//
+//! Wi-Fi profiles. A single profile is kept, as the name of the network in
+//! SIM_PROFILE_FILE; the connection policy is kept in SIM_POLICY_FILE.
+//
+//*****************************************************************************
+static int
+SimFsReadFile(const char *pcName, void *pvBuf, int iMax)
+{
+    char cPath[SIM_PATH_LEN];
+    int iFd;
+    int iLen;
+
+    SimFsPath(pcName, cPath);
+    iFd = open(cPath, O_RDONLY);
+    if(iFd < 0)
+    {
+        return -1;
+    }
+    iLen = read(iFd, pvBuf, iMax);
+    close(iFd);
+    return iLen;
+}
+
+static int
+SimFsWriteFile(const char *pcName, const void *pvBuf, int iLen)
+{
+    char cPath[SIM_PATH_LEN];
+    int iFd;
+    int iRet;
+
+    SimFsPath(pcName, cPath);
+    iFd = open(cPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(iFd < 0)
+    {
+        return -1;
+    }
+    iRet = (write(iFd, pvBuf, iLen) == iLen) ? 0 : -1;
+    close(iFd);
+    return iRet;
+}
+
+_i16
+sl_WlanProfileAdd(const _i8 *pName, _i16 NameLen, const _u8 *pMacAddr,
+                  const SlSecParams_t *pSecParams, const void *pSecExtParams,
+                  _u32 Priority, _u32 Options)
+{
+    (void)pMacAddr;
+    (void)pSecParams;
+    (void)pSecExtParams;
+    (void)Priority;
+    (void)Options;
+    if(NameLen <= 0 || NameLen > SIM_SSID_LEN)
+    {
+        return -1;
+    }
+    return (SimFsWriteFile(SIM_PROFILE_FILE, pName, NameLen) == 0) ? 0 : -1;
+}
+
+_i16
+sl_WlanProfileGet(_i16 Index, _i8 *pName, _i16 *pNameLen, _u8 *pMacAddr,
+                  SlSecParams_t *pSecParams, void *pSecExtParams,
+                  _u32 *pPriority)
+{
+    int iLen;
+
+    (void)pSecExtParams;
+    if(Index != 0)
+    {
+        return -1;
+    }
+    iLen = SimFsReadFile(SIM_PROFILE_FILE, pName, SIM_SSID_LEN);
+    if(iLen <= 0)
+    {
+        return -1;
+    }
+    *pNameLen = iLen;
+    memset(pMacAddr, 0, 6);
+    pSecParams->Type = SECURITY_TYPE;
+    pSecParams->Key = NULL;
+    pSecParams->KeyLen = 0;
+    *pPriority = 0;
+    return 0;
+}
+
+_i16
+sl_WlanProfileDel(_i16 Index)
+{
+    char cPath[SIM_PATH_LEN];
+
+    if(Index != 0 && Index != 0xFF)
+    {
+        return -1;
+    }
+    SimFsPath(SIM_PROFILE_FILE, cPath);
+    unlink(cPath);
+    return 0;
+}
+
+_i16
+sl_WlanPolicySet(_u8 Type, _u8 Policy, _u8 *pVal, _u8 ValLen)
+{
+    (void)pVal;
+    (void)ValLen;
+    if(Type != SL_POLICY_CONNECTION)
+    {
+        return 0;
+    }
+    return (SimFsWriteFile(SIM_POLICY_FILE, &Policy, 1) == 0) ? 0 : -1;
+}
+
+//*****************************************************************************
+//
+//! Network interface helpers. The host network is always there, so the
+//! device is connected as soon as it is asked to be. With a stored profile
+//! and the auto connection policy, starting the driver connects, as the
+//! NWP would rejoin the network by itself.
+//
+//*****************************************************************************
+long
+VStartSimpleLinkSpawnTask(unsigned long uxPriority)
+{
+    (void)uxPriority;
+    return 0;
+}
+
+void
+Network_IF_ResetMCUStateMachine(void)
+{
+    g_ulStatus = 0;
+}
+
+unsigned long
+Network_IF_CurrentMCUState(void)
+{
+    return g_ulStatus;
+}
+
+long
+Network_IF_InitDriver(unsigned int uiMode)
+{
+    char cName[SIM_SSID_LEN];
+    unsigned char ucPolicy = 0;
+
+    (void)uiMode;
+    g_ulStatus = 0;
+    if(SimFsReadFile(SIM_PROFILE_FILE, cName, sizeof(cName)) > 0 &&
+       SimFsReadFile(SIM_POLICY_FILE, &ucPolicy, 1) == 1 &&
+       (ucPolicy & SL_CONNECTION_POLICY(1, 0, 0, 0, 0)) != 0)
+    {
+        SET_STATUS_BIT(g_ulStatus, STATUS_BIT_CONNECTION);
+        SET_STATUS_BIT(g_ulStatus, STATUS_BIT_IP_AQUIRED);
+    }
+    return ROLE_STA;
+}
+
+long
+Network_IF_DeInitDriver(void)
+{
+    g_ulStatus = 0;
+    return 0;
+}
+
+long
+Network_IF_ConnectAP(char *pcSsid, SlSecParams_t SecurityParams)
+{
+    (void)SecurityParams;
+    Report("Connected to AP: %s\n\r", pcSsid);
+    SET_STATUS_BIT(g_ulStatus, STATUS_BIT_CONNECTION);
+    SET_STATUS_BIT(g_ulStatus, STATUS_BIT_IP_AQUIRED);
+    return 0;
+}
@@ -0,0 +1,160 @@
+//*****************************************************************************
+// simplelink.h
+//
+// Host simulation: the SimpleLink API subset used by the application
+//
+// Sockets are host BSD sockets, their ids the host descriptors. Privileged
+// ports are bound SIM_PRIV_PORT_OFFSET higher unless running as root. The
+// serial flash file system is the directory named by SIM_FS_DIR, ./sim_fs
+// by default. The Wi-Fi profile and policy calls keep one stored profile
+// in that directory, so a second run takes the fast connect path.
+//
+//*****************************************************************************
+
+#ifndef __SIMPLELINK_H__
+#define __SIMPLELINK_H__
+
+#include <stdbool.h>
+#include <string.h>
+#include <sys/select.h>
+
+#define SIM_PRIV_PORT_OFFSET    10000
+
+typedef signed char _i8;
+typedef unsigned char _u8;
+typedef short _i16;
+typedef unsigned short _u16;
+typedef long _i32;
+typedef unsigned long _u32;
+
+//*****************************************************************************
+// Sockets
+//*****************************************************************************
+#define SL_AF_INET              2
+#define SL_SOCK_STREAM          1
+#define SL_SOCK_DGRAM           2
+#define SL_IPPROTO_TCP          6
+#define SL_IPPROTO_UDP          17
+#define SL_SOL_SOCKET           1
+#define SL_SO_RCVTIMEO          20
+#define SL_SO_NONBLOCKING       24
+#define SL_INADDR_ANY           0
+#define SL_MAX_SOCKETS          8
+#define SL_EAGAIN               (-11)
+#define SL_SOC_ERROR            (-1)
+
+typedef struct
+{
+    _u16 sa_family;
+    _u8 sa_data[14];
+}SlSockAddr_t;
+
+typedef struct
+{
+    _u32 s_addr;
+}SlInAddr_t;
+
+typedef struct
+{
+    _u16 sin_family;
+    _u16 sin_port;
+    SlInAddr_t sin_addr;
+    _i8 sin_zero[8];
+}SlSockAddrIn_t;
+
+typedef _i16 SlSocklen_t;
+
+typedef struct
+{
+    _i32 tv_sec;
+    _i32 tv_usec;
+}SlTimeval_t;
+
+typedef struct
+{
+    _u32 NonblockingEnabled;
+}SlSockNonblocking_t;
+
+typedef struct
+{
+    fd_set Set;
+}SlFdSet_t;
+
+#define SL_FD_SET(fd, p)        FD_SET((fd), &(p)->Set)
+#define SL_FD_CLR(fd, p)        FD_CLR((fd), &(p)->Set)
+#define SL_FD_ISSET(fd, p)      FD_ISSET((fd), &(p)->Set)
+#define SL_FD_ZERO(p)           FD_ZERO(&(p)->Set)
+
+//*****************************************************************************
+// Wlan
+//*****************************************************************************
+#define ROLE_STA                0
+#define SL_SEC_TYPE_OPEN        0
+#define SL_SEC_TYPE_WEP         1
+#define SL_SEC_TYPE_WPA         2
+#define SL_SEC_TYPE_WPA_WPA2    2
+#define SL_POLICY_CONNECTION    0x10
+#define SL_CONNECTION_POLICY(Auto, Fast, Open, AnyP2P, AutoSmart) \
+            (((Auto) << 0) | ((Fast) << 1) | ((Open) << 2) | \
+             ((AnyP2P) << 3) | ((AutoSmart) << 4))
+
+typedef struct
+{
+    _u8 Type;
+    _i8 *Key;
+    _u8 KeyLen;
+}SlSecParams_t;
+
+//*****************************************************************************
+// File system
+//*****************************************************************************
+#define FS_MODE_OPEN_READ               0
+#define FS_MODE_OPEN_WRITE              1
+#define FS_MODE_OPEN_CREATE(max, flags) (2 | ((unsigned long)(max) << 8))
+#define _FS_FILE_OPEN_FLAG_COMMIT       0x1
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern _i16 sl_Socket(_i16 Domain, _i16 Type, _i16 Protocol);
+extern _i16 sl_Close(_i16 sd);
+extern _i16 sl_Bind(_i16 sd, const SlSockAddr_t *addr, _i16 addrlen);
+extern _i16 sl_Listen(_i16 sd, _i16 backlog);
+extern _i16 sl_Accept(_i16 sd, SlSockAddr_t *addr, SlSocklen_t *addrlen);
+extern _i16 sl_Connect(_i16 sd, const SlSockAddr_t *addr, _i16 addrlen);
+extern _i16 sl_Recv(_i16 sd, void *buf, _i16 Len, _i16 flags);
+extern _i16 sl_Send(_i16 sd, const void *buf, _i16 Len, _i16 flags);
+extern _i16 sl_RecvFrom(_i16 sd, void *buf, _i16 Len, _i16 flags,
+                        SlSockAddr_t *from, SlSocklen_t *fromlen);
+extern _i16 sl_SendTo(_i16 sd, const void *buf, _i16 Len, _i16 flags,
+                      const SlSockAddr_t *to, SlSocklen_t tolen);
+extern _i16 sl_SetSockOpt(_i16 sd, _i16 level, _i16 optname,
+                          const void *optval, SlSocklen_t optlen);
+extern _i16 sl_Select(_i16 nfds, SlFdSet_t *readsds, SlFdSet_t *writesds,
+                      SlFdSet_t *exceptsds, SlTimeval_t *timeout);
+extern _u32 sl_Htonl(_u32 val);
+extern _u16 sl_Htons(_u16 val);
+
+extern _i16 sl_NetAppDnsGetHostByName(_i8 *hostname, _u16 usNameLen,
+                                      _u32 *out_ip_addr, _u8 family);
+
+extern _i32 sl_FsOpen(_u8 *pFileName, _u32 AccessModeAndMaxSize,
+                      _u32 *pToken, _i32 *pFileHandle);
+extern _i16 sl_FsClose(_i32 FileHdl, _u8 *pCeritificateFileName,
+                       _u8 *pSignature, _u32 SignatureLen);
+extern _i32 sl_FsRead(_i32 FileHdl, _u32 Offset, _u8 *pData, _u32 Len);
+extern _i32 sl_FsWrite(_i32 FileHdl, _u32 Offset, _u8 *pData, _u32 Len);
+extern _i16 sl_FsDel(_u8 *pFileName, _u32 Token);
+
+extern _i16 sl_WlanProfileAdd(const _i8 *pName, _i16 NameLen,
+                              const _u8 *pMacAddr,
+                              const SlSecParams_t *pSecParams,
+                              const void *pSecExtParams,
+                              _u32 Priority, _u32 Options);
+extern _i16 sl_WlanProfileGet(_i16 Index, _i8 *pName, _i16 *pNameLen,
+                              _u8 *pMacAddr, SlSecParams_t *pSecParams,
+                              void *pSecExtParams, _u32 *pPriority);
+extern _i16 sl_WlanProfileDel(_i16 Index);
+extern _i16 sl_WlanPolicySet(_u8 Type, _u8 Policy, _u8 *pVal, _u8 ValLen);
+
+#endif //  __SIMPLELINK_H__
@@ -0,0 +1,108 @@
+//*****************************************************************************
+// sl_mqtt_client.h
+//
+// Host simulation: MQTT client library API
+//
+// A minimal MQTT 3.1 / 3.1.1 client over host sockets with the interface of
+// the SimpleLink MQTT client library. Every context runs a receive thread
+// that invokes the callbacks, as the library's receive task does. The
+// broker of every context can be redirected with the SIM_MQTT_BROKER
+// environment variable, "host[:port]", e.g. to a local mosquitto.
+//
+//*****************************************************************************
+
+#ifndef __SL_MQTT_CLIENT_H__
+#define __SL_MQTT_CLIENT_H__
+
+#include <stdbool.h>
+
+#define SL_MQTT_NETCONN_IP4     0x01
+#define SL_MQTT_NETCONN_IP6     0x02
+#define SL_MQTT_NETCONN_URL     0x04
+#define SL_MQTT_NETCONN_SEC     0x08
+
+//
+// Events of the sl_ExtLib_MqttEvent callback
+//
+#define SL_MQTT_CL_EVT_PUBACK   0x04
+#define SL_MQTT_CL_EVT_PUBCOMP  0x07
+#define SL_MQTT_CL_EVT_SUBACK   0x09
+#define SL_MQTT_CL_EVT_UNSUBACK 0x0B
+
+//
+// Parameters of sl_ExtLib_MqttClientSet
+//
+#define SL_MQTT_PARAM_CLIENT_ID 0x01
+#define SL_MQTT_PARAM_USER_NAME 0x02
+#define SL_MQTT_PARAM_PASS_WORD 0x03
+#define SL_MQTT_PARAM_WILL_PARAM 0x04
+
+typedef struct
+{
+    unsigned long netconn_info;
+    const char *server_addr;
+    unsigned short port_number;
+    unsigned char method;
+    unsigned long cipher;
+    unsigned long n_files;
+    char * const *secure_files;
+}SlMqttServer_t;
+
+typedef struct
+{
+    SlMqttServer_t server_info;
+    bool mqtt_mode31;
+    bool blocking_send;
+}SlMqttClientCtxCfg_t;
+
+typedef struct
+{
+    void (*sl_ExtLib_MqttRecv)(void *app_hndl, const char *topstr,
+                               long top_len, const void *payload,
+                               long pay_len, bool dup, unsigned char qos,
+                               bool retain);
+    void (*sl_ExtLib_MqttEvent)(void *app_hndl, long evt, const void *buf,
+                                unsigned long len);
+    void (*sl_ExtLib_MqttDisconn)(void *app_hndl);
+}SlMqttClientCbs_t;
+
+typedef struct
+{
+    const char *will_topic;
+    const char *will_msg;
+    char will_qos;
+    bool retain;
+}SlMqttWill_t;
+
+typedef struct
+{
+    unsigned short loopback_port;
+    unsigned long rx_tsk_priority;
+    unsigned long resp_time;
+    bool aux_debug_en;
+    long (*dbg_print)(const char *pcFormat, ...);
+}SlMqttClientLibCfg_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern long sl_ExtLib_MqttClientInit(const SlMqttClientLibCfg_t *cfg);
+extern long sl_ExtLib_MqttClientExit(void);
+extern void *sl_ExtLib_MqttClientCtxCreate(const SlMqttClientCtxCfg_t *ctx_cfg,
+                                           const SlMqttClientCbs_t *msg_cbs,
+                                           void *app_hndl);
+extern long sl_ExtLib_MqttClientCtxDelete(void *cli_ctx);
+extern long sl_ExtLib_MqttClientSet(void *cli_ctx, long param,
+                                    const void *value, unsigned long len);
+extern long sl_ExtLib_MqttClientConnect(void *cli_ctx, bool clean,
+                                        unsigned short keep_alive_time);
+extern long sl_ExtLib_MqttClientDisconnect(void *cli_ctx);
+extern long sl_ExtLib_MqttClientSub(void *cli_ctx, char **topics,
+                                    unsigned char *qos, long count);
+extern long sl_ExtLib_MqttClientUnsub(void *cli_ctx, char **topics,
+                                      long count);
+extern long sl_ExtLib_MqttClientSend(void *cli_ctx, const char *topic,
+                                     const void *data, long len, char qos,
+                                     bool retain);
+
+#endif //  __SL_MQTT_CLIENT_H__
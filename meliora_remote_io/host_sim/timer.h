@@ -0,0 +1,19 @@
+//*****************************************************************************
+// timer.h
+//
+// Host simulation: general purpose timer driver
+//
+//*****************************************************************************
+
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+#define TIMER_CFG_ONE_SHOT      0x00000021
+#define TIMER_CFG_PERIODIC      0x00000022
+#define TIMER_A                 0x000000FF
+#define TIMER_TIMA_TIMEOUT      0x00000001
+
+extern unsigned long TimerIntStatus(unsigned long ulBase, int bMasked);
+extern void TimerIntClear(unsigned long ulBase, unsigned long ulIntFlags);
+
+#endif //  __TIMER_H__
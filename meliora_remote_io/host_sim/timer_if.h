@@ -0,0 +1,22 @@
+//*****************************************************************************
+// timer_if.h
+//
+// Host simulation: hardware timers, run on a simulation thread
+//
+//*****************************************************************************
+
+#ifndef __TIMER_IF_H__
+#define __TIMER_IF_H__
+
+extern void Timer_IF_Init(unsigned long ePeripheralc, unsigned long ulBase,
+                          unsigned long ulConfig, unsigned long ulTimer,
+                          unsigned long ulValue);
+extern void Timer_IF_IntSetup(unsigned long ulBase, unsigned long ulTimer,
+                              void (*TimerBaseIntHandler)(void));
+extern void Timer_IF_InterruptClear(unsigned long ulBase);
+extern void Timer_IF_Start(unsigned long ulBase, unsigned long ulTimer,
+                           unsigned long ulValue);
+extern void Timer_IF_Stop(unsigned long ulBase, unsigned long ulTimer);
+extern void Timer_IF_DeInit(unsigned long ulBase, unsigned long ulTimer);
+
+#endif //  __TIMER_IF_H__
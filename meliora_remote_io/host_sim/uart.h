@@ -0,0 +1,11 @@
+//*****************************************************************************
+// uart.h
+//
+// Host simulation: UART driver, the terminal is stdout
+//
+//*****************************************************************************
+
+#ifndef __UART_H__
+#define __UART_H__
+
+#endif //  __UART_H__
@@ -0,0 +1,15 @@
+//*****************************************************************************
+// uart_if.h
+//
+// Host simulation: terminal, printed to stdout
+//
+//*****************************************************************************
+
+#ifndef __UART_IF_H__
+#define __UART_IF_H__
+
+extern int Report(const char *pcFormat, ...);
+extern void Message(const char *pcStr);
+extern void InitTerm(void);
+
+#endif //  __UART_IF_H__
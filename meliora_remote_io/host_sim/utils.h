@@ -0,0 +1,13 @@
+//*****************************************************************************
+// utils.h
+//
+// Host simulation: driverlib delay loop
+//
+//*****************************************************************************
+
+#ifndef __UTILS_H__
+#define __UTILS_H__
+
+extern void UtilsDelay(unsigned long ulCount);
+
+#endif //  __UTILS_H__
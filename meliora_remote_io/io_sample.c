@@ -0,0 +1,211 @@
+//*****************************************************************************
+// io_sample.c
+//
+// Change-of-state detection and batching of I/O point updates
+//
+// Every poll samples all configured points, debounces them and appends the
+// points whose stable value moved past the deadband to the pending batch.
+// A batch is ready once its oldest change is a window old or it holds the
+// configured number of changes, so a burst of input activity produces one
+// message instead of one per edge. Points with an edge interrupt also
+// report their edges, which dates a change from the edge instead of from
+// the poll that first saw it; the polls stay the source of the level.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup io_sample
+//! @{
+//
+//*****************************************************************************
+
+#include "io_sample.h"
+
+//*****************************************************************************
+//
+//! Distance between two point values
+//
+//*****************************************************************************
+static unsigned short
+ValueDelta(unsigned short usA, unsigned short usB)
+{
+    return (usA > usB) ? (usA - usB) : (usB - usA);
+}
+
+//*****************************************************************************
+//
+//! Initializes a sampler and takes the current point values as reported
+//!
+//! \param pSampler is the sampler to initialize
+//! \param pCfg is the point configuration, must stay valid
+//! \param iNumPoints is the number of entries in pCfg
+//! \param ulWindowMs is the maximum age of a change before the batch is due
+//! \param iMaxChanges is the number of changes that makes a batch due
+//! \param ulNowMs is the current time in ms
+//!
+//! \return 0 on success, -1 if the configuration exceeds the sampler limits
+//
+//*****************************************************************************
+int
+IoSample_Init(IoSampler_t *pSampler, const IoPointCfg_t *pCfg,
+              int iNumPoints, unsigned long ulWindowMs,
+              int iMaxChanges, unsigned long ulNowMs)
+{
+    int iPoint;
+
+    if(iNumPoints > IO_MAX_POINTS || iMaxChanges < 1 ||
+       iMaxChanges > IO_MAX_CHANGES)
+    {
+        return -1;
+    }
+
+    pSampler->pCfg = pCfg;
+    pSampler->iNumPoints = iNumPoints;
+    pSampler->ulWindowMs = ulWindowMs;
+    pSampler->iMaxChanges = iMaxChanges;
+    pSampler->iNumChanges = 0;
+    pSampler->ulFirstChange = ulNowMs;
+
+    for(iPoint = 0; iPoint < iNumPoints; iPoint++)
+    {
+        pSampler->State[iPoint].usReported =
+                                    pCfg[iPoint].pfnRead(pCfg[iPoint].usPointId);
+        pSampler->State[iPoint].usCandidate = pSampler->State[iPoint].usReported;
+        pSampler->State[iPoint].ulCandidateSince = ulNowMs;
+    }
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Samples all points and records their changes of state
+//!
+//! \param pSampler is the sampler
+//! \param ulNowMs is the current time in ms
+//!
+//! Once the batch holds iMaxChanges changes, further changes stay pending
+//! in the point state and are recorded by the first poll after the batch
+//! was cleared.
+//!
+//! \return 1 if the pending batch is due for publishing, 0 otherwise
+//
+//*****************************************************************************
+int
+IoSample_Poll(IoSampler_t *pSampler, unsigned long ulNowMs)
+{
+    const IoPointCfg_t *pCfg;
+    IoPointState_t *pState;
+    IoChange_t *pChange;
+    unsigned short usValue;
+    int iPoint;
+
+    for(iPoint = 0; iPoint < pSampler->iNumPoints; iPoint++)
+    {
+        pCfg = &pSampler->pCfg[iPoint];
+        pState = &pSampler->State[iPoint];
+
+        usValue = pCfg->pfnRead(pCfg->usPointId);
+        if(ValueDelta(usValue, pState->usCandidate) > pCfg->usDeadband)
+        {
+            // value moved, restart the debounce interval
+            pState->usCandidate = usValue;
+            pState->ulCandidateSince = ulNowMs;
+        }
+
+        if(ulNowMs - pState->ulCandidateSince < pCfg->usDebounceMs ||
+           ValueDelta(pState->usCandidate, pState->usReported) <=
+                                                            pCfg->usDeadband ||
+           pSampler->iNumChanges >= pSampler->iMaxChanges)
+        {
+            continue;
+        }
+
+        if(pSampler->iNumChanges == 0)
+        {
+            pSampler->ulFirstChange = ulNowMs;
+        }
+        pChange = &pSampler->Changes[pSampler->iNumChanges++];
+        pChange->usPointId = pCfg->usPointId;
+        pChange->usValue = pState->usCandidate;
+        pChange->ulTimestamp = pState->ulCandidateSince;
+        pState->usReported = pState->usCandidate;
+    }
+
+    return (pSampler->iNumChanges > 0 &&
+            (pSampler->iNumChanges >= pSampler->iMaxChanges ||
+             ulNowMs - pSampler->ulFirstChange >= pSampler->ulWindowMs));
+}
+
+//*****************************************************************************
+//
+//! Records an edge of a point, time stamped by its interrupt
+//!
+//! \param pSampler is the sampler
+//! \param usPointId is the point
+//! \param usValue is the point value after the edge
+//! \param ulAtMs is the time of the edge in ms
+//!
+//! An edge to a new value restarts the debounce interval from ulAtMs. An
+//! edge to the value a poll already saw moves the start back to ulAtMs,
+//! since the edges usually reach the sampler after the next poll. Edges
+//! older than the pending value are ignored.
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+IoSample_Edge(IoSampler_t *pSampler, unsigned short usPointId,
+              unsigned short usValue, unsigned long ulAtMs)
+{
+    IoPointState_t *pState;
+    int iPoint;
+
+    for(iPoint = 0; iPoint < pSampler->iNumPoints; iPoint++)
+    {
+        if(pSampler->pCfg[iPoint].usPointId == usPointId)
+        {
+            break;
+        }
+    }
+    if(iPoint == pSampler->iNumPoints)
+    {
+        return;
+    }
+
+    pState = &pSampler->State[iPoint];
+    if(usValue != pState->usCandidate)
+    {
+        if((long)(ulAtMs - pState->ulCandidateSince) >= 0)
+        {
+            pState->usCandidate = usValue;
+            pState->ulCandidateSince = ulAtMs;
+        }
+    }
+    else if((long)(ulAtMs - pState->ulCandidateSince) < 0)
+    {
+        pState->ulCandidateSince = ulAtMs;
+    }
+}
+
+//*****************************************************************************
+//
+//! Discards the pending batch once it has been published
+//!
+//! \param pSampler is the sampler
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+IoSample_Clear(IoSampler_t *pSampler)
+{
+    pSampler->iNumChanges = 0;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,69 @@
+//*****************************************************************************
+// io_sample.h
+//
+// Change-of-state detection and batching of I/O point updates
+//
+//*****************************************************************************
+
+#ifndef __IO_SAMPLE_H__
+#define __IO_SAMPLE_H__
+
+/* Points tracked by one sampler */
+#define IO_MAX_POINTS           8
+
+/* Changes buffered per batch */
+#define IO_MAX_CHANGES          16
+
+//*****************************************************************************
+//
+//! Static configuration of an I/O point. A new value is reported once it
+//! has been stable for usDebounceMs and differs from the last reported
+//! value by more than usDeadband (0 for digital points).
+//
+//*****************************************************************************
+typedef struct
+{
+    unsigned short usPointId;
+    unsigned short usDeadband;
+    unsigned short usDebounceMs;
+    unsigned short (*pfnRead)(unsigned short usPointId);
+}IoPointCfg_t;
+
+typedef struct
+{
+    unsigned short usPointId;
+    unsigned short usValue;
+    unsigned long ulTimestamp;          /* ms, start of the stable value */
+}IoChange_t;
+
+typedef struct
+{
+    unsigned short usReported;
+    unsigned short usCandidate;
+    unsigned long ulCandidateSince;
+}IoPointState_t;
+
+typedef struct
+{
+    const IoPointCfg_t *pCfg;
+    int iNumPoints;
+    unsigned long ulWindowMs;
+    int iMaxChanges;
+    IoPointState_t State[IO_MAX_POINTS];
+    IoChange_t Changes[IO_MAX_CHANGES];
+    int iNumChanges;
+    unsigned long ulFirstChange;
+}IoSampler_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern int IoSample_Init(IoSampler_t *pSampler, const IoPointCfg_t *pCfg,
+                         int iNumPoints, unsigned long ulWindowMs,
+                         int iMaxChanges, unsigned long ulNowMs);
+extern int IoSample_Poll(IoSampler_t *pSampler, unsigned long ulNowMs);
+extern void IoSample_Edge(IoSampler_t *pSampler, unsigned short usPointId,
+                          unsigned short usValue, unsigned long ulAtMs);
+extern void IoSample_Clear(IoSampler_t *pSampler);
+
+#endif //  __IO_SAMPLE_H__
@@ -0,0 +1,127 @@
+//*****************************************************************************
+// isr_ring.c
+//
+// Lock-free single producer, single consumer ring of interrupt events
+//
+// Interrupt handlers post time stamped events straight into a ring of
+// preallocated slots; a task drains them in batches. The producer only
+// advances the head and the consumer only the tail, each after its slot
+// access, so a single core needs no lock. Several interrupt handlers count
+// as one producer as long as they run at the same priority and so cannot
+// preempt one another. When the ring is full the new event is dropped and
+// counted, and the next stored event carries ISR_EVT_AFTER_LOSS.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup isr_ring
+//! @{
+//
+//*****************************************************************************
+
+// Standard includes
+#include <string.h>
+
+#include "isr_ring.h"
+
+//*****************************************************************************
+//
+//! Initializes an empty ring
+//!
+//! \param pRing is the ring
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+IsrRing_Init(IsrRing_t *pRing)
+{
+    memset((void *)pRing, 0, sizeof(IsrRing_t));
+}
+
+//*****************************************************************************
+//
+//! Posts an event, from interrupt context
+//!
+//! \param pRing is the ring
+//! \param ucSource identifies the interrupt source
+//! \param ucEdge is ISR_EDGE_RISING or ISR_EDGE_FALLING
+//! \param ulStamp is the time stamp of the event
+//!
+//! \return true, or false if the ring is full and the event was dropped
+//
+//*****************************************************************************
+bool
+IsrRing_Post(IsrRing_t *pRing, unsigned char ucSource, unsigned char ucEdge,
+             unsigned long ulStamp)
+{
+    unsigned int uiHead = pRing->uiHead;
+    volatile IsrEvent_t *pEvent;
+
+    if(uiHead - pRing->uiTail >= ISR_RING_LEN)
+    {
+        pRing->ulOverflows++;
+        pRing->bLost = true;
+        return false;
+    }
+
+    pEvent = &pRing->Events[uiHead & (ISR_RING_LEN - 1)];
+    pEvent->ulStamp = ulStamp;
+    pEvent->ucSource = ucSource;
+    pEvent->ucEdge = ucEdge;
+    pEvent->ucFlags = pRing->bLost ? ISR_EVT_AFTER_LOSS : 0;
+    pRing->bLost = false;
+    pRing->ulPosted++;
+
+    // publish the slot only once it is complete
+    pRing->uiHead = uiHead + 1;
+    return true;
+}
+
+//*****************************************************************************
+//
+//! Takes the oldest events off the ring, from task context
+//!
+//! \param pRing is the ring
+//! \param pEvents receives the events, oldest first
+//! \param iMax is the number of events pEvents holds
+//!
+//! \return the number of events taken, 0 if the ring is empty
+//
+//*****************************************************************************
+int
+IsrRing_Drain(IsrRing_t *pRing, IsrEvent_t *pEvents, int iMax)
+{
+    unsigned int uiTail = pRing->uiTail;
+    unsigned int uiHead = pRing->uiHead;
+    volatile IsrEvent_t *pEvent;
+    int iNum = 0;
+
+    while(uiTail != uiHead && iNum < iMax)
+    {
+        pEvent = &pRing->Events[uiTail & (ISR_RING_LEN - 1)];
+        pEvents[iNum].ulStamp = pEvent->ulStamp;
+        pEvents[iNum].ucSource = pEvent->ucSource;
+        pEvents[iNum].ucEdge = pEvent->ucEdge;
+        pEvents[iNum].ucFlags = pEvent->ucFlags;
+        uiTail++;
+        iNum++;
+    }
+
+    // hand the slots back to the producer
+    pRing->uiTail = uiTail;
+    pRing->ulDrained += iNum;
+    if((unsigned int)iNum > pRing->uiMaxBatch)
+    {
+        pRing->uiMaxBatch = iNum;
+    }
+    return iNum;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,63 @@
+//*****************************************************************************
+// isr_ring.h
+//
+// Lock-free single producer, single consumer ring of interrupt events
+//
+//*****************************************************************************
+
+#ifndef __ISR_RING_H__
+#define __ISR_RING_H__
+
+#include <stdbool.h>
+
+/* Events held, power of two */
+#define ISR_RING_LEN            32
+
+#define ISR_EDGE_FALLING        0
+#define ISR_EDGE_RISING         1
+
+/* Event flags */
+#define ISR_EVT_AFTER_LOSS      0x01    /* events were dropped before it */
+
+//*****************************************************************************
+//
+//! An interrupt event. The stamp is taken in the interrupt handler, in the
+//! time base of the producer; the button handlers use ms.
+//
+//*****************************************************************************
+typedef struct
+{
+    unsigned long ulStamp;
+    unsigned char ucSource;
+    unsigned char ucEdge;
+    unsigned char ucFlags;
+}IsrEvent_t;
+
+//*****************************************************************************
+//
+//! The ring. uiHead and the producer counters are written by the interrupt
+//! handlers only, uiTail and the consumer counters by the draining task
+//! only, so neither side needs a lock or a critical section.
+//
+//*****************************************************************************
+typedef struct
+{
+    volatile IsrEvent_t Events[ISR_RING_LEN];
+    volatile unsigned int uiHead;
+    volatile unsigned int uiTail;
+    volatile unsigned long ulPosted;
+    volatile unsigned long ulOverflows;
+    volatile bool bLost;
+    unsigned long ulDrained;
+    unsigned int uiMaxBatch;
+}IsrRing_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern void IsrRing_Init(IsrRing_t *pRing);
+extern bool IsrRing_Post(IsrRing_t *pRing, unsigned char ucSource,
+                         unsigned char ucEdge, unsigned long ulStamp);
+extern int IsrRing_Drain(IsrRing_t *pRing, IsrEvent_t *pEvents, int iMax);
+
+#endif //  __ISR_RING_H__
@@ -0,0 +1,220 @@
+//*****************************************************************************
+// latency.c
+//
+// Latency histograms timed with the Cortex-M4 DWT cycle counter
+//
+// The cycle counter wraps after 2^32 cycles, 53 s at 80 MHz, so only
+// shorter durations are measured correctly.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup latency
+//! @{
+//
+//*****************************************************************************
+
+#ifdef LATENCY_HOST_CLOCK
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#endif
+
+// Standard includes
+#include <string.h>
+
+#include "latency.h"
+
+#ifndef LATENCY_HOST_CLOCK
+// Cortex-M4 debug registers
+#define LAT_DEMCR               (*(volatile unsigned long *)0xE000EDFC)
+#define LAT_DEMCR_TRCENA        0x01000000
+#define LAT_DWT_CTRL            (*(volatile unsigned long *)0xE0001000)
+#define LAT_DWT_CTRL_CYCCNTENA  0x00000001
+#define LAT_DWT_CYCCNT          (*(volatile unsigned long *)0xE0001004)
+#endif
+
+static unsigned long g_ulTicksPerUs = 1;
+
+static unsigned char *
+Put32(unsigned char *pucOut, unsigned long ulValue)
+{
+    *pucOut++ = (unsigned char)(ulValue >> 24);
+    *pucOut++ = (unsigned char)(ulValue >> 16);
+    *pucOut++ = (unsigned char)(ulValue >> 8);
+    *pucOut++ = (unsigned char)ulValue;
+    return pucOut;
+}
+
+//*****************************************************************************
+//
+//! Starts the time stamp clock
+//!
+//! \param ulCpuHz is the core clock, the rate of the cycle counter. The
+//!        host clock always counts in us.
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+Latency_Init(unsigned long ulCpuHz)
+{
+#ifdef LATENCY_HOST_CLOCK
+    (void)ulCpuHz;
+    g_ulTicksPerUs = 1;
+#else
+    g_ulTicksPerUs = ulCpuHz / 1000000;
+    LAT_DEMCR |= LAT_DEMCR_TRCENA;
+    LAT_DWT_CYCCNT = 0;
+    LAT_DWT_CTRL |= LAT_DWT_CTRL_CYCCNTENA;
+#endif
+}
+
+//*****************************************************************************
+//
+//! Returns the current time stamp, in clock ticks
+//
+//*****************************************************************************
+unsigned long
+Latency_Stamp(void)
+{
+#ifdef LATENCY_HOST_CLOCK
+    struct timespec sNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+    return (unsigned long)sNow.tv_sec * 1000000UL +
+           (unsigned long)(sNow.tv_nsec / 1000);
+#else
+    return LAT_DWT_CYCCNT;
+#endif
+}
+
+//*****************************************************************************
+//
+//! Returns the time elapsed since a stamp
+//!
+//! \param ulStart is the Latency_Stamp value at the start
+//!
+//! \return the elapsed time in us
+//
+//*****************************************************************************
+unsigned long
+Latency_ElapsedUs(unsigned long ulStart)
+{
+    unsigned long ulTicks = (Latency_Stamp() - ulStart) & 0xFFFFFFFF;
+
+    return ulTicks / g_ulTicksPerUs;
+}
+
+//*****************************************************************************
+//
+//! Records the time elapsed since a stamp
+//!
+//! \param pHist is the histogram
+//! \param ulStart is the Latency_Stamp value at the start
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+Latency_Record(LatencyHist_t *pHist, unsigned long ulStart)
+{
+    Latency_RecordUs(pHist, Latency_ElapsedUs(ulStart));
+}
+
+//*****************************************************************************
+//
+//! Records a duration
+//!
+//! \param pHist is the histogram
+//! \param ulUs is the duration in us
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+Latency_RecordUs(LatencyHist_t *pHist, unsigned long ulUs)
+{
+    unsigned long ulRest = ulUs >> 1;
+    int iBucket = 0;
+
+    while(ulRest != 0 && iBucket < LAT_NUM_BUCKETS - 1)
+    {
+        ulRest >>= 1;
+        iBucket++;
+    }
+    pHist->ulBuckets[iBucket]++;
+
+    if(pHist->ulCount == 0 || ulUs < pHist->ulMinUs)
+    {
+        pHist->ulMinUs = ulUs;
+    }
+    if(ulUs > pHist->ulMaxUs)
+    {
+        pHist->ulMaxUs = ulUs;
+    }
+    pHist->ulSumUs += ulUs;
+    pHist->ulCount++;
+}
+
+//*****************************************************************************
+//
+//! Clears the counters of a histogram, its name is kept
+//!
+//! \param pHist is the histogram
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+Latency_Reset(LatencyHist_t *pHist)
+{
+    const char *pcName = pHist->pcName;
+
+    memset(pHist, 0, sizeof(LatencyHist_t));
+    pHist->pcName = pcName;
+}
+
+//*****************************************************************************
+//
+//! Encodes a histogram for export
+//!
+//! \param pHist is the histogram
+//! \param ucId identifies the histogram to the receiver
+//! \param pucBuf is the output buffer
+//! \param iBufLen is the size of pucBuf
+//!
+//! \return LAT_EXPORT_LEN, or -1 if the buffer is too small
+//
+//*****************************************************************************
+int
+Latency_Encode(const LatencyHist_t *pHist, unsigned char ucId,
+               unsigned char *pucBuf, int iBufLen)
+{
+    unsigned char *pucOut = pucBuf;
+    int iBucket;
+
+    if(iBufLen < LAT_EXPORT_LEN)
+    {
+        return -1;
+    }
+
+    *pucOut++ = LAT_VERSION;
+    *pucOut++ = ucId;
+    pucOut = Put32(pucOut, pHist->ulCount);
+    pucOut = Put32(pucOut, pHist->ulMinUs);
+    pucOut = Put32(pucOut, pHist->ulMaxUs);
+    pucOut = Put32(pucOut, pHist->ulSumUs);
+    for(iBucket = 0; iBucket < LAT_NUM_BUCKETS; iBucket++)
+    {
+        pucOut = Put32(pucOut, pHist->ulBuckets[iBucket]);
+    }
+    return LAT_EXPORT_LEN;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,56 @@
+//*****************************************************************************
+// latency.h
+//
+// Latency histograms timed with the Cortex-M4 DWT cycle counter
+//
+// Stamps are taken with Latency_Stamp and turned into a duration in us by
+// Latency_Record. Durations are counted in power of two buckets: bucket 0
+// holds 0 and 1 us, bucket n holds [2^n, 2^(n+1)) us and the last bucket
+// everything longer. A build with LATENCY_HOST_CLOCK defined uses the
+// POSIX monotonic clock instead of the DWT, so the module runs on a host.
+//
+// Each histogram must have a single writer; readers may see a record
+// half applied, which is fine for diagnostics.
+//
+// Export layout, multi byte fields big endian:
+//
+//   version     1 byte   LAT_VERSION
+//   id          1 byte   histogram number
+//   count       4 bytes
+//   min         4 bytes  us
+//   max         4 bytes  us
+//   sum         4 bytes  us, wraps
+//   buckets     LAT_NUM_BUCKETS times 4 bytes
+//
+//*****************************************************************************
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#define LAT_VERSION             1
+#define LAT_NUM_BUCKETS         16
+#define LAT_EXPORT_LEN          (18 + 4 * LAT_NUM_BUCKETS)
+
+typedef struct
+{
+    const char *pcName;
+    unsigned long ulCount;
+    unsigned long ulMinUs;
+    unsigned long ulMaxUs;
+    unsigned long ulSumUs;
+    unsigned long ulBuckets[LAT_NUM_BUCKETS];
+}LatencyHist_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern void Latency_Init(unsigned long ulCpuHz);
+extern unsigned long Latency_Stamp(void);
+extern unsigned long Latency_ElapsedUs(unsigned long ulStart);
+extern void Latency_Record(LatencyHist_t *pHist, unsigned long ulStart);
+extern void Latency_RecordUs(LatencyHist_t *pHist, unsigned long ulUs);
+extern void Latency_Reset(LatencyHist_t *pHist);
+extern int Latency_Encode(const LatencyHist_t *pHist, unsigned char ucId,
+                          unsigned char *pucBuf, int iBufLen);
+
+#endif //  __LATENCY_H__
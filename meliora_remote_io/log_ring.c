@@ -0,0 +1,201 @@
+//*****************************************************************************
+// log_ring.c
+//
+// Deferred logging through a ring of binary records
+//
+// Writers claim a slot by advancing the head index inside a critical
+// section of a few instructions, fill it outside and mark it ready; they
+// never wait for the reader or for each other. The single reader prints
+// the ready slots in order and stops at the first one still being filled.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup log_ring
+//! @{
+//
+//*****************************************************************************
+
+// Standard includes
+#include <stdarg.h>
+#include <stddef.h>
+
+#include "log_ring.h"
+
+typedef struct
+{
+    const char *pcFmt;
+    unsigned long ulArgs[LOG_MAX_ARGS];
+    volatile unsigned char ucReady;
+}LogRecord_t;
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+static LogRecord_t g_LogSlots[LOG_NUM_SLOTS];
+static volatile unsigned int g_uiLogHead;
+static volatile unsigned int g_uiLogTail;
+static volatile unsigned long g_ulLogDropped;
+static unsigned long g_ulLogDroppedShown;
+static unsigned long (*g_pfnLogEnter)(void);
+static void (*g_pfnLogExit)(unsigned long);
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! Initializes the ring
+//!
+//! \param pfnEnter enters a critical section and returns a key
+//! \param pfnExit leaves the critical section entered with the key
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+LogRing_Init(unsigned long (*pfnEnter)(void), void (*pfnExit)(unsigned long))
+{
+    g_pfnLogEnter = pfnEnter;
+    g_pfnLogExit = pfnExit;
+}
+
+//*****************************************************************************
+//
+//! Queues a log record
+//!
+//! \param pcFmt is a printf format string with static lifetime
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+LogRing_Write(const char *pcFmt, ...)
+{
+    LogRecord_t *pRecord = NULL;
+    const char *pcScan = pcFmt;
+    unsigned long ulKey = 0;
+    va_list vaArgs;
+    int iArg = 0;
+
+    if(g_pfnLogEnter != NULL)
+    {
+        ulKey = g_pfnLogEnter();
+    }
+    if(g_uiLogHead - g_uiLogTail < LOG_NUM_SLOTS)
+    {
+        pRecord = &g_LogSlots[g_uiLogHead & (LOG_NUM_SLOTS - 1)];
+        g_uiLogHead++;
+    }
+    else
+    {
+        g_ulLogDropped++;
+    }
+    if(g_pfnLogExit != NULL)
+    {
+        g_pfnLogExit(ulKey);
+    }
+    if(pRecord == NULL)
+    {
+        return;
+    }
+
+    //
+    // Fetch one argument per conversion, in the width the caller passed it
+    //
+    va_start(vaArgs, pcFmt);
+    while(*pcScan != '\0' && iArg < LOG_MAX_ARGS)
+    {
+        if(*pcScan++ != '%')
+        {
+            continue;
+        }
+        while(*pcScan == '-' || *pcScan == '+' || *pcScan == ' ' ||
+              *pcScan == '#' || *pcScan == '.' ||
+              (*pcScan >= '0' && *pcScan <= '9'))
+        {
+            pcScan++;
+        }
+        if(*pcScan == '%')
+        {
+            pcScan++;
+        }
+        else if(*pcScan == 'l')
+        {
+            pRecord->ulArgs[iArg++] = va_arg(vaArgs, unsigned long);
+        }
+        else if(*pcScan == 's' || *pcScan == 'p')
+        {
+            pRecord->ulArgs[iArg++] = (unsigned long)va_arg(vaArgs, void *);
+        }
+        else if(*pcScan != '\0')
+        {
+            pRecord->ulArgs[iArg++] = va_arg(vaArgs, unsigned int);
+        }
+    }
+    va_end(vaArgs);
+
+    pRecord->pcFmt = pcFmt;
+    pRecord->ucReady = 1;
+}
+
+//*****************************************************************************
+//
+//! Prints the queued records, oldest first, and reports records dropped
+//! since the last call. Called by a single task.
+//!
+//! \param pfnPrint is the printf style output function
+//!
+//! \return the number of records printed
+//
+//*****************************************************************************
+int
+LogRing_Drain(int (*pfnPrint)(const char *pcFmt, ...))
+{
+    LogRecord_t *pRecord;
+    unsigned long ulDropped;
+    int iCount = 0;
+
+    while(g_uiLogTail != g_uiLogHead)
+    {
+        pRecord = &g_LogSlots[g_uiLogTail & (LOG_NUM_SLOTS - 1)];
+        if(!pRecord->ucReady)
+        {
+            break;
+        }
+        pfnPrint(pRecord->pcFmt, pRecord->ulArgs[0], pRecord->ulArgs[1],
+                 pRecord->ulArgs[2], pRecord->ulArgs[3], pRecord->ulArgs[4],
+                 pRecord->ulArgs[5]);
+        pRecord->ucReady = 0;
+        g_uiLogTail++;
+        iCount++;
+    }
+
+    ulDropped = g_ulLogDropped;
+    if(ulDropped != g_ulLogDroppedShown)
+    {
+        pfnPrint("[%lu log records dropped]\n\r",
+                 ulDropped - g_ulLogDroppedShown);
+        g_ulLogDroppedShown = ulDropped;
+    }
+    return iCount;
+}
+
+//*****************************************************************************
+//
+//! Returns the number of records dropped because the ring was full
+//
+//*****************************************************************************
+unsigned long
+LogRing_Dropped(void)
+{
+    return g_ulLogDropped;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,62 @@
+//*****************************************************************************
+// log_ring.h
+//
+// Deferred logging through a ring of binary records
+//
+// A log call stores the format string pointer and its arguments in a ring
+// slot; the text is only formatted when a low priority task drains the
+// ring to the UART. Arguments are stored as unsigned long, so they must be
+// integers or pointers to strings with static lifetime, and at most
+// LOG_MAX_ARGS of them. '*' widths are not supported. When the ring is
+// full the record is dropped and counted.
+//
+//*****************************************************************************
+
+#ifndef __LOG_RING_H__
+#define __LOG_RING_H__
+
+#define LOG_NUM_SLOTS           32      /* power of two */
+#define LOG_MAX_ARGS            6
+
+#define LOG_LEVEL_NONE          0
+#define LOG_LEVEL_ERROR         1
+#define LOG_LEVEL_WARN          2
+#define LOG_LEVEL_INFO          3
+#define LOG_LEVEL_DEBUG         4
+
+/* Calls above this level are compiled out */
+#ifndef LOG_LEVEL
+#define LOG_LEVEL               LOG_LEVEL_INFO
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...)          LogRing_Write(__VA_ARGS__)
+#else
+#define LOG_ERROR(...)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...)           LogRing_Write(__VA_ARGS__)
+#else
+#define LOG_WARN(...)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...)           LogRing_Write(__VA_ARGS__)
+#else
+#define LOG_INFO(...)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...)          LogRing_Write(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...)
+#endif
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern void LogRing_Init(unsigned long (*pfnEnter)(void),
+                         void (*pfnExit)(unsigned long));
+extern void LogRing_Write(const char *pcFmt, ...);
+extern int LogRing_Drain(int (*pfnPrint)(const char *pcFmt, ...));
+extern unsigned long LogRing_Dropped(void);
+
+#endif //  __LOG_RING_H__
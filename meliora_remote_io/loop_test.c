@@ -0,0 +1,254 @@
+//*****************************************************************************
+// loop_test.c
+//
+// Link test service: modes, counters and rate reports
+//
+// Bookkeeping of the TCP/UDP test service on LOOPBACK_PORT, which lets a
+// technician measure a node's Wi-Fi link and socket stack in place. The
+// sockets are served by the application; this module parses the mode
+// requests and turns the traffic counters into per second rates. The
+// turnaround, the time from a packet received to its echo handed back to
+// the stack, separates the firmware's share from the round trip a client
+// measures.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup loop_test
+//! @{
+//
+//*****************************************************************************
+
+// Standard includes
+#include <string.h>
+
+#include "loop_test.h"
+
+static const char * const g_pcModeNames[] = {"off", "echo", "sink", "source"};
+
+//*****************************************************************************
+//
+//! Per second rate of a count over an interval, without overflowing for
+//! byte counts of a few seconds
+//
+//*****************************************************************************
+static unsigned long
+PerSecond(unsigned long ulCount, unsigned long ulMs)
+{
+    return (ulCount / ulMs) * 1000 + ((ulCount % ulMs) * 1000) / ulMs;
+}
+
+//*****************************************************************************
+//
+//! Tells whether the next word of a request is the given one
+//
+//*****************************************************************************
+static int
+IsWord(const char *pcWord, long lWordLen, const char *pcName)
+{
+    return (lWordLen == (long)strlen(pcName) &&
+            strncmp(pcWord, pcName, lWordLen) == 0);
+}
+
+//*****************************************************************************
+//
+//! Parses a mode request, "<off|echo|sink|source> [tcp|udp]"
+//!
+//! \param pcArgs points to the request, not NUL terminated
+//! \param lArgsLen is its length
+//! \param pucMode receives the LOOP_MODE_ value
+//! \param pucProto receives the LOOP_PROTO_ value, TCP if none is given
+//!
+//! \return 0, or -1 if the request is malformed
+//
+//*****************************************************************************
+int
+LoopTest_Parse(const char *pcArgs, long lArgsLen, unsigned char *pucMode,
+               unsigned char *pucProto)
+{
+    const char *pcEnd = pcArgs + lArgsLen;
+    const char *pcWord;
+    unsigned char ucMode;
+    int iWord = 0;
+
+    *pucProto = LOOP_PROTO_TCP;
+    while(pcArgs < pcEnd)
+    {
+        if(*pcArgs == ' ')
+        {
+            pcArgs++;
+            continue;
+        }
+        pcWord = pcArgs;
+        while(pcArgs < pcEnd && *pcArgs != ' ')
+        {
+            pcArgs++;
+        }
+
+        if(iWord == 0)
+        {
+            for(ucMode = 0; ucMode < sizeof(g_pcModeNames)/sizeof(char *);
+                ucMode++)
+            {
+                if(IsWord(pcWord, pcArgs - pcWord, g_pcModeNames[ucMode]))
+                {
+                    break;
+                }
+            }
+            if(ucMode == sizeof(g_pcModeNames)/sizeof(char *))
+            {
+                return -1;
+            }
+            *pucMode = ucMode;
+        }
+        else if(iWord == 1 && IsWord(pcWord, pcArgs - pcWord, "tcp"))
+        {
+            *pucProto = LOOP_PROTO_TCP;
+        }
+        else if(iWord == 1 && IsWord(pcWord, pcArgs - pcWord, "udp"))
+        {
+            *pucProto = LOOP_PROTO_UDP;
+        }
+        else
+        {
+            return -1;
+        }
+        iWord++;
+    }
+    return (iWord > 0) ? 0 : -1;
+}
+
+//*****************************************************************************
+//
+//! Returns the name of a mode
+//
+//*****************************************************************************
+const char *
+LoopTest_ModeName(unsigned char ucMode)
+{
+    if(ucMode >= sizeof(g_pcModeNames)/sizeof(char *))
+    {
+        return "?";
+    }
+    return g_pcModeNames[ucMode];
+}
+
+//*****************************************************************************
+//
+//! Starts a session, clearing all counters
+//!
+//! \param pTest is the service state
+//! \param ucMode is the LOOP_MODE_ value
+//! \param ucProto is the LOOP_PROTO_ value
+//! \param ulNowMs is the current time
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+LoopTest_Start(LoopTest_t *pTest, unsigned char ucMode, unsigned char ucProto,
+               unsigned long ulNowMs)
+{
+    memset(pTest, 0, sizeof(LoopTest_t));
+    pTest->ucMode = ucMode;
+    pTest->ucProto = ucProto;
+    pTest->ulStartMs = ulNowMs;
+    pTest->ulWindowMs = ulNowMs;
+    pTest->Turnaround.pcName = "Loop turn";
+}
+
+//*****************************************************************************
+//
+//! Counts a received packet
+//
+//*****************************************************************************
+void
+LoopTest_CountRx(LoopTest_t *pTest, unsigned long ulBytes)
+{
+    pTest->Session.ulRxBytes += ulBytes;
+    pTest->Session.ulRxPackets++;
+    pTest->Window.ulRxBytes += ulBytes;
+    pTest->Window.ulRxPackets++;
+}
+
+//*****************************************************************************
+//
+//! Counts a sent packet
+//
+//*****************************************************************************
+void
+LoopTest_CountTx(LoopTest_t *pTest, unsigned long ulBytes)
+{
+    pTest->Session.ulTxBytes += ulBytes;
+    pTest->Session.ulTxPackets++;
+    pTest->Window.ulTxBytes += ulBytes;
+    pTest->Window.ulTxPackets++;
+}
+
+//*****************************************************************************
+//
+//! Counts a failed send or receive
+//
+//*****************************************************************************
+void
+LoopTest_CountError(LoopTest_t *pTest)
+{
+    pTest->Session.ulErrors++;
+    pTest->Window.ulErrors++;
+}
+
+//*****************************************************************************
+//
+//! Closes the report window once it is ulPeriodMs old and computes its rates
+//!
+//! \param pTest is the service state
+//! \param ulNowMs is the current time
+//! \param ulPeriodMs is the length of a report window
+//! \param pReport receives the rates of the window
+//!
+//! \return 1 if pReport was filled, 0 if the window is still open or had
+//!         no traffic
+//
+//*****************************************************************************
+int
+LoopTest_Report(LoopTest_t *pTest, unsigned long ulNowMs,
+                unsigned long ulPeriodMs, LoopReport_t *pReport)
+{
+    unsigned long ulMs = ulNowMs - pTest->ulWindowMs;
+    LoopCounters_t *pWin = &pTest->Window;
+    int iTraffic;
+
+    if(ulMs < ulPeriodMs || ulMs == 0)
+    {
+        return 0;
+    }
+
+    iTraffic = (pWin->ulRxPackets != 0 || pWin->ulTxPackets != 0 ||
+                pWin->ulErrors != 0);
+    if(iTraffic)
+    {
+        pReport->ulRxBytesPerSec = PerSecond(pWin->ulRxBytes, ulMs);
+        pReport->ulTxBytesPerSec = PerSecond(pWin->ulTxBytes, ulMs);
+        pReport->ulRxPacketsPerSec = PerSecond(pWin->ulRxPackets, ulMs);
+        pReport->ulTxPacketsPerSec = PerSecond(pWin->ulTxPackets, ulMs);
+        pReport->ulErrors = pWin->ulErrors;
+        pReport->ulTurnCount = pTest->Turnaround.ulCount;
+        pReport->ulTurnAvgUs = pTest->Turnaround.ulCount ?
+                               pTest->Turnaround.ulSumUs /
+                               pTest->Turnaround.ulCount : 0;
+        pReport->ulTurnMaxUs = pTest->Turnaround.ulMaxUs;
+    }
+
+    memset(pWin, 0, sizeof(LoopCounters_t));
+    Latency_Reset(&pTest->Turnaround);
+    pTest->ulWindowMs = ulNowMs;
+    return iTraffic;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,75 @@
+//*****************************************************************************
+// loop_test.h
+//
+// Link test service: modes, counters and rate reports
+//
+//*****************************************************************************
+
+#ifndef __LOOP_TEST_H__
+#define __LOOP_TEST_H__
+
+#include "latency.h"
+
+/* Modes: echo sends every packet back, sink discards what it receives and
+   source sends as fast as the socket takes it */
+#define LOOP_MODE_OFF           0
+#define LOOP_MODE_ECHO          1
+#define LOOP_MODE_SINK          2
+#define LOOP_MODE_SOURCE        3
+
+#define LOOP_PROTO_TCP          0
+#define LOOP_PROTO_UDP          1
+
+typedef struct
+{
+    unsigned long ulRxBytes;
+    unsigned long ulTxBytes;
+    unsigned long ulRxPackets;
+    unsigned long ulTxPackets;
+    unsigned long ulErrors;
+}LoopCounters_t;
+
+//*****************************************************************************
+//
+//! State of the service. The session counters run from LoopTest_Start, the
+//! window counters and the turnaround times from the last report.
+//
+//*****************************************************************************
+typedef struct
+{
+    unsigned char ucMode;
+    unsigned char ucProto;
+    unsigned long ulStartMs;
+    unsigned long ulWindowMs;
+    LoopCounters_t Session;
+    LoopCounters_t Window;
+    LatencyHist_t Turnaround;   /* packet received to answered, echo mode */
+}LoopTest_t;
+
+typedef struct
+{
+    unsigned long ulRxBytesPerSec;
+    unsigned long ulTxBytesPerSec;
+    unsigned long ulRxPacketsPerSec;
+    unsigned long ulTxPacketsPerSec;
+    unsigned long ulErrors;
+    unsigned long ulTurnCount;
+    unsigned long ulTurnAvgUs;
+    unsigned long ulTurnMaxUs;
+}LoopReport_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern int LoopTest_Parse(const char *pcArgs, long lArgsLen,
+                          unsigned char *pucMode, unsigned char *pucProto);
+extern const char *LoopTest_ModeName(unsigned char ucMode);
+extern void LoopTest_Start(LoopTest_t *pTest, unsigned char ucMode,
+                           unsigned char ucProto, unsigned long ulNowMs);
+extern void LoopTest_CountRx(LoopTest_t *pTest, unsigned long ulBytes);
+extern void LoopTest_CountTx(LoopTest_t *pTest, unsigned long ulBytes);
+extern void LoopTest_CountError(LoopTest_t *pTest);
+extern int LoopTest_Report(LoopTest_t *pTest, unsigned long ulNowMs,
+                           unsigned long ulPeriodMs, LoopReport_t *pReport);
+
+#endif //  __LOOP_TEST_H__
@@ -30,11 +30,23 @@
 //*****************************************************************************
 
 // Standard includes
+#include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 // simplelink includes
 #include "simplelink.h"
 
+#ifdef USE_FREERTOS
+// free-rtos includes, for the task stack and heap high-water marks
+#include "FreeRTOS.h"
+#include "task.h"
+
+#if !INCLUDE_uxTaskGetStackHighWaterMark
+#error "DiagReport needs INCLUDE_uxTaskGetStackHighWaterMark set to 1"
+#endif
+#endif
+
 
 // driverlib includes
 #include "hw_types.h"
@@ -45,6 +57,7 @@
 #include "prcm.h"
 #include "uart.h"
 #include "timer.h"
+#include "gpio.h"
 
 // common interface includes
 #include "network_if.h"
@@ -63,6 +76,19 @@
 
 // application specific includes
 #include "pinmux.h"
+#include "modbus_tcp.h"
+#include "mqtt_topic.h"
+#include "io_sample.h"
+#include "telemetry.h"
+#include "pub_queue.h"
+#include "store_fwd.h"
+#include "dns_cache.h"
+#include "mem_pool.h"
+#include "sys_diag.h"
+#include "latency.h"
+#include "log_ring.h"
+#include "loop_test.h"
+#include "isr_ring.h"
 
 typedef enum{
     // Choosing -0x7D0 to avoid overlap w/ host-driver's error codes
@@ -87,7 +113,7 @@ typedef enum{
 
 #define WILL_TOPIC              "Client"
 #define WILL_MSG                "Client Stopped"
-#define WILL_QOS                QOS2
+#define WILL_QOS                QOS_STATE
 #define WILL_RETAIN             false
 
 /*Defining Broker IP address and port Number*/
@@ -95,11 +121,46 @@ typedef enum{
 #define SERVER_IP_ADDRESS        "192.168.178.67"
 #define PORT_NUMBER              1883
 #define SECURED_PORT_NUMBER      8883
-#define LOOPBACK_PORT            1882
 
-#define MAX_BROKER_CONN         1
-
-#define SERVER_MODE             MQTT_3_1
+/*Broker name resolution: resolved addresses are reused for DNS_CACHE_TTL_MS
+  and saved to serial flash, so reconnects and the first connect after a
+  reset skip DNS; a failed connect to a cached address drops it. Set
+  SERVER_STATIC_IP to a dotted address to connect there when the name
+  cannot be resolved*/
+#define SERVER_STATIC_IP         NULL
+#define DNS_CACHE_TTL_MS         (60UL * 60 * 1000)
+#define DNS_CACHE_FILE_NAME      "dns_cache.bin"
+
+/*Link test service for qualifying the Wi-Fi link in place. The MQTT library
+  runs without its loopback socket, so LOOPBACK_PORT is free. The service is
+  off until a .../cmd/loop request "<off|echo|sink|source> [tcp|udp]" picks
+  a mode, and logs its rates every LOOP_REPORT_MS. Its socket is served by
+  the network manager's sl_Select, a source sending at most
+  LOOP_SOURCE_BURST packets per pass. A TCP test serves one client, with
+  the listener closed meanwhile so that the service holds a single socket.
+  A UDP source sends to the last peer heard from until LOOP_UDP_SOURCE_MS
+  after its last datagram*/
+#define LOOPBACK_PORT            1882
+#define LOOP_BUF_LEN            1460
+#define LOOP_UDP_LEN            1024
+#define LOOP_SOURCE_BURST       8
+#define LOOP_RETRY_MS           1000
+#define LOOP_REPORT_MS          1000
+#define LOOP_UDP_SOURCE_MS      5000
+#define LOOP_REQ_NONE           0xFF
+
+#define MAX_BROKER_CONN         2
+
+/*Publish routing across brokers: a broker whose oldest unacknowledged
+  publish is older than one keep alive interval counts as failed, and the
+  route only moves to a healthy broker whose round trip time is lower by
+  more than ROUTE_SWITCH_MARGIN_MS*/
+#define ROUTE_STALL_MS          (KEEP_ALIVE_TIMER * 1000)
+#define ROUTE_SWITCH_MARGIN_MS  20
+
+/*MQTT 3.1.1, whose CONNACK carries the session present flag that lets a
+  reconnect skip subscribing again*/
+#define SERVER_MODE             MQTT_3_1_1
 /*Specifying Receive time out for the Receive task*/
 #define RCV_TIMEOUT             30
 
@@ -109,33 +170,220 @@ typedef enum{
 /* Keep Alive Timer value*/
 #define KEEP_ALIVE_TIMER        25
 
-/*Clean session flag*/
-#define CLEAN_SESSION           true
+/*Clean session flag; off so that the broker keeps the subscriptions and
+  the queued commands of CLIENT_ID across a reconnect*/
+#define CLEAN_SESSION           false
 
-/*Retain Flag. Used in publish message. */
-#define RETAIN                  1
 
-/*Defining Publish Topic*/
-#define PUB_TOPIC_FOR_SW3       "/cc3200/ButtonPressEvtSw3"
-#define PUB_TOPIC_FOR_SW2       "/cc3200/ButtonPressEvtSw2"
+/*Client ID, also the device level of the per device topics*/
+#define CLIENT_ID               "user1"
 
 /*Defining Number of topics*/
-#define TOPIC_COUNT             3
+#define TOPIC_COUNT             4
 
 /*Defining Subscription Topic Values*/
 #define TOPIC1                  "/cc3200/ToggleLEDCmdL1"
 #define TOPIC2                  "/cc3200/ToggleLEDCmdL2"
 #define TOPIC3                  "/cc3200/ToggleLEDCmdL3"
+/*Per device commands, one subscription for all points: .../cmd/led1 etc*/
+#define TOPIC_DEVICE_CMD        "/cc3200/" CLIENT_ID "/cmd/+"
+
+/*Defining Publish Topic of the batched I/O changes*/
+#define PUB_TOPIC_IO            "/cc3200/" CLIENT_ID "/io"
+/*Memory diagnostics report, also sent on a .../cmd/diag request*/
+#define PUB_TOPIC_DIAG          "/cc3200/" CLIENT_ID "/diag"
+/*Latency histograms, one message each on a .../cmd/lat request*/
+#define PUB_TOPIC_LATENCY       "/cc3200/" CLIENT_ID "/latency"
+/*Publish benchmark: a .../cmd/bench request with the payload
+  "<count> <qos> [<length>]" sends count messages as fast as the broker
+  takes them, each starting with its 32 bit sequence number*/
+#define PUB_TOPIC_BENCH         "/cc3200/" CLIENT_ID "/bench"
+#define PUB_BENCH_MIN_LEN       4
+/*While a benchmark runs the network manager refills the publish queue every
+  PUB_BENCH_POLL_MS instead of every sampling period*/
+#define PUB_BENCH_POLL_MS       1
+
+/*I/O change-of-state sampling: inputs are polled every IO_SAMPLE_PERIOD_MS
+  and changes are published together once the oldest is IO_BATCH_WINDOW_MS
+  old or IO_BATCH_MAX_CHANGES have accumulated*/
+#define IO_SAMPLE_PERIOD_MS     10
+#define IO_BATCH_WINDOW_MS      100
+#define IO_BATCH_MAX_CHANGES    8
+#define IO_DEBOUNCE_MS          20
+
+/*Push button edges are drained from the interrupt ring this many at a time.
+  An edge closer than BUTTON_MIN_EDGE_MS to the last one posted for the same
+  button is contact bounce: it is held instead of posted, replacing the one
+  held before, so a burst costs one ring slot and still ends on its final
+  edge*/
+#define BUTTON_DRAIN_BATCH      8
+#define BUTTON_NUM              2
+#define BUTTON_MIN_EDGE_MS      IO_DEBOUNCE_MS
+
+/*Outbound publish queue: unacknowledged messages handed to the library at
+  once, how often the sender retries while the broker is unreachable, and
+  how long a message waits for its ack before it is sent again*/
+#define PUB_MAX_INFLIGHT        4
+#define PUB_RETRY_MS            100
+#define PUB_ACK_TIMEOUT_MS      10000
+#define PUB_TASK_PRIORITY       2
+
+/*Store-and-forward: batches produced while the broker is unreachable are
+  kept in RAM, spilled to serial flash files one segment per network loop
+  pass once half the RAM is used, and replayed oldest first at most one
+  every SFWD_REPLAY_INTERVAL_MS so the backlog does not starve live traffic
+  after reconnecting*/
+#define SFWD_USE_FLASH          1
+#define SFWD_FILE_NAME          "sfwd_0.bin"
+#define SFWD_FILE_DIGIT         5
+#define SFWD_REPLAY_INTERVAL_MS 20
+
+/*Broker reconnect backoff: the delay between attempts doubles from
+  RECONNECT_MIN_MS up to RECONNECT_MAX_MS, and a random part of up to half
+  of it keeps many devices from reconnecting in lock step*/
+#define RECONNECT_MIN_MS        250
+#define RECONNECT_MAX_MS        30000
+
+/*Each broker is connected by a task of its own, so a connect blocking for a
+  TCP timeout never holds up publishing or the other brokers. The task is
+  woken when its connection is lost and looks at its link every
+  BROKER_POLL_MS otherwise*/
+#define BROKER_TASK_PRIORITY    2
+#define BROKER_POLL_MS          100
 
 /*Defining QOS levels*/
 #define QOS0                    0
 #define QOS1                    1
 #define QOS2                    2
 
+/*QoS policy per message class: high rate telemetry is fire and forget,
+  state changes need delivery, only commands that must not be applied
+  twice (e.g. toggles) pay for the QoS2 four way handshake*/
+#define QOS_TELEMETRY           QOS0
+#define QOS_STATE               QOS1
+#define QOS_COMMAND             QOS2
+
+/*Every broker holds the command subscriptions, so a command bridged or
+  published to both arrives twice. QoS2 only rules out duplicates per
+  broker: a command matching the topic and payload of one received from
+  the other broker within CMD_DUP_WINDOW_MS is dropped as a copy*/
+#define CMD_DUP_ENTRIES         4
+#define CMD_DUP_WINDOW_MS       5000
+
+/*Modbus data tables: coils are the LEDs, discrete inputs the push buttons*/
+#define MB_NUM_COILS            3
+#define MB_NUM_DISCRETE_INPUTS  2
+#define MB_NUM_HOLDING_REGS     1   /* 0: LED bitmask */
+#define MB_NUM_INPUT_REGS       1   /* 0: push button bitmask */
+
+/*Simultaneous Modbus masters. With the Modbus listener, one socket per
+  broker connection and the link test socket, the worst case uses all of
+  the SL_MAX_SOCKETS SimpleLink sockets*/
+#define MB_MAX_CLIENTS          4
+#if MB_MAX_CLIENTS + 1 + MAX_BROKER_CONN + 1 > SL_MAX_SOCKETS
+#error "Modbus, MQTT and link test sockets exceed SL_MAX_SOCKETS"
+#endif
+
+/*With all client slots taken, a new master only replaces a client that has
+  been silent for MB_CLIENT_IDLE_MS, a master that vanished without a FIN.
+  Otherwise the new connection is refused*/
+#define MB_CLIENT_IDLE_MS       60000
+
+/*Per connection reassembly buffer and the shared coalesced response buffer*/
+#define MB_CONN_RX_LEN          512
+#define MB_TX_BUF_LEN           1400
+
+/*Retries of a response send on a socket that is temporarily full*/
+#define MB_SEND_RETRIES         10
+
+/*Wi-Fi fast connect: with the profile stored and the auto + fast connection
+  policy set, the NWP rejoins the last AP by itself right after starting,
+  without a scan. The explicit connect only runs when no profile is stored
+  or the AP was not rejoined within WLAN_FAST_CONNECT_MS*/
+#define WLAN_FAST_CONNECT_MS    3000
+#define WLAN_MAX_PROFILES       7
+
+/*Status LEDs run off the periodic timer so startup never waits for them:
+  the red LED blinks while the AP is searched and is lit for LED_IP_IND_MS
+  once an IP address is acquired. The LEDs are also the Modbus coils, so
+  coil writes land in a shadow while the indication owns the LEDs and the
+  timer restores the coil state from it when the indication ends*/
+#define LED_TIMER_PERIOD_MS     100
+#define LED_IP_IND_MS           750
+#define LED_MODE_SEARCHING      0
+#define LED_MODE_IP_ACQUIRED    1
+
+/*Network manager: the single task owning SimpleLink, the AP connection and
+  the Modbus server; services subscribe to its connection state events*/
+#define NET_TASK_PRIORITY       1
+#define NET_MAX_SUBSCRIBERS     4
+
+/*Fixed-block pools of the runtime buffers, so nothing is taken from the
+  heap once the network manager is up: a reassembly frame per Modbus client
+  and the payload scratch buffers of the store-and-forward path*/
+#define POOL_PAYLOAD_BLOCKS     2
+#define POOL_FRAME_BLOCKS       MB_MAX_CLIENTS
+#define POOL_WORDS(len, num)    ((((len) + 3) / 4) * (num))
+
+/*Memory diagnostics: task stack and heap high-water marks plus the pool
+  counters, reported every DIAG_INTERVAL_MS over UART and MQTT. The heap
+  is the FreeRTOS one; its minimum free figure needs the heap_4 or heap_5
+  allocator. Its fragmentation is only probed on a .../cmd/diag request*/
+#define DIAG_INTERVAL_MS        60000
+#define DIAG_MAX_TASKS          (3 + MAX_BROKER_CONN)
+
+/*Hot path latency histograms, timed with the DWT cycle counter*/
+#define LAT_CPU_HZ              80000000
+#define LAT_MODBUS_RSP          0   /* Modbus request received to answered */
+#define LAT_PUB_SEND            1   /* publish queued to handed to the lib */
+#define LAT_MQTT_RX_CB          2   /* received publish handler */
+
+/*Task draining the deferred log to the UART; below every other task so
+  logging never delays the network*/
+#define LOG_TASK_PRIORITY       0
+#define LOG_DRAIN_PERIOD_MS     20
+/*Longest log line, longer ones are cut*/
+#define LOG_LINE_LEN            160
+
 /*Spawn task priority and OSI Stack Size*/
 #define OSI_STACK_SIZE          2048
 #define UART_PRINT              Report
 
+typedef struct
+{
+    bool bProfileStored;    /* a profile of SSID_NAME was found at boot */
+    short sProfileIndex;    /* and its index */
+    bool bFastConnect;      /* connected through the stored profile */
+    unsigned long ulConnectMs;  /* driver start to IP acquired */
+}wlan_stats;
+
+typedef enum
+{
+    LINK_WAIT_NETWORK,      /* AP or IP lost, wait for the network */
+    LINK_BACKOFF,           /* next connect attempt at ulRetryAtMs */
+    LINK_CONNECTED
+}link_state;
+
+typedef struct
+{
+    link_state eState;
+    unsigned long ulRetryAtMs;
+    unsigned long ulBackoffMs;
+    unsigned long ulDownSinceMs;    /* start of the current outage */
+    unsigned long ulAttempts;       /* attempts in the current outage */
+    unsigned long ulReconnects;
+    unsigned long ulConnectFails;
+    unsigned long ulLastReconnectMs;/* outage durations */
+    unsigned long ulMaxReconnectMs;
+    unsigned long ulTotalReconnectMs;
+    unsigned long ulSession;        /* incremented on every connect */
+    unsigned long ulRttMs;          /* smoothed publish round trip time */
+    bool bProbe;                    /* a publish is timed for ulRttMs */
+    unsigned short usProbeMsgId;
+    unsigned long ulProbeSentMs;
+    OsiSyncObj_t Wake;              /* wakes the connect task */
+}broker_link;
+
 typedef struct connection_config{
     SlMqttClientCtxCfg_t broker_config;
     void *clt_ctx;
@@ -150,39 +398,164 @@ typedef struct connection_config{
     unsigned char qos[TOPIC_COUNT];
     SlMqttWill_t will_params;
     bool is_connected;
+    const char *static_ip;          /* fallback address of a URL broker */
+    broker_link link;
+    const char *host_name;          /* broker URL, NULL if given by IP */
+    char server_ip[DNS_ADDR_STR_LEN];
+    bool cached_addr;               /* server_ip came from g_DnsCache */
 }connect_config;
 
+/*Network connection state changes, published by the network manager*/
 typedef enum
 {
-    PUSH_BUTTON_SW2_PRESSED,
-    PUSH_BUTTON_SW3_PRESSED,
-    BROKER_DISCONNECTION
-}events;
+    NET_EVENT_UP,           /* connected to the AP with an IP address */
+    NET_EVENT_DOWN
+}net_event;
+
+typedef void (*net_event_handler)(net_event eEvent);
+
+typedef struct
+{
+    const char *pcTopic;
+    unsigned char ucQos;
+    bool bRetain;
+    bool bFanOut;           /* copy to every connected broker */
+}publish_policy;
+
+typedef struct
+{
+    unsigned long ulLeft;       /* messages still to be queued */
+    unsigned long ulSeq;        /* sequence number of the next message */
+    unsigned long ulStartMs;
+    unsigned short usLen;
+    unsigned char ucQos;
+}pub_bench;
+
+typedef struct
+{
+    volatile unsigned long ulSeq;   /* bumped by every change */
+    volatile unsigned long ulAtMs;
+    volatile unsigned char ucEdge;
+    volatile bool bHeld;        /* newer than the last posted edge */
+}button_held;
+
+typedef struct
+{
+    unsigned long ulHash;       /* of topic and payload */
+    unsigned long ulRxMs;
+    int iConn;                  /* broker it came from, -1 if free */
+}cmd_seen;
 
 typedef struct
 {
-	void * hndl;
-	events event;
-}event_msg;
+    int iSockID;                /* -1 when the slot is free */
+    unsigned long ulLastActive; /* time of the last activity in ms */
+    int iRxLen;                 /* bytes buffered in pucRx */
+    unsigned char *pucRx;       /* MB_CONN_RX_LEN frame from the pool */
+}modbus_conn;
 
 //*****************************************************************************
 //                      LOCAL FUNCTION PROTOTYPES
 //*****************************************************************************
 static void
-Mqtt_Recv(void *app_hndl, const char  *topstr, long top_len, const void *payload,
-          long pay_len, bool dup,unsigned char qos, bool retain);
+Mqtt_Recv(void *app_hndl, const char  *topstr, long top_len,
+          const void *payload, long pay_len, bool dup,unsigned char qos,
+          bool retain);
 static void sl_MqttEvt(void *app_hndl,long evt, const void *buf,
                        unsigned long len);
 static void sl_MqttDisconnect(void *app_hndl);
+static bool CmdIsCopy(int iConn, const char *pcTopic, long lTopLen,
+                      const void *pvPayload, long lPayLen);
+static void BrokerResolve(connect_config *pConf);
+static void DnsCacheLoad(void);
+static void DnsCacheSave(void);
+static int BrokerConnect(connect_config *pConf);
+static void BrokerLinkDown(connect_config *pConf);
+static void BrokerLinkService(connect_config *pConf, int iConn);
+static void BrokerConnectTask(void *pvParameters);
+static int BrokerSelect(int iCurrent);
+static void BrokerProbe(connect_config *pConf, unsigned short usMsgId);
+static void BrokerFanOut(const PubQueueSlot_t *pSlot, int iRoute);
+static bool BrokerIsHealthy(const connect_config *pConf);
 void pushButtonInterruptHandler2();
 void pushButtonInterruptHandler3();
 void ToggleLedState(ledEnum LedNum);
+static void ToggleLedCmd(const char *pcTopic, long lTopLen,
+                         const void *pvPayload, long lPayLen,
+                         unsigned long ulArg);
+static void DeviceCmd(const char *pcTopic, long lTopLen,
+                      const void *pvPayload, long lPayLen,
+                      unsigned long ulArg);
+static unsigned long GetTimeMs(void);
+static void ApplyPublishPolicy(PubQueueSlot_t *pSlot, const char *pcTopic);
+static unsigned long ParseNumber(const char **ppcPos, const char *pcEnd);
+static void PubBenchStart(const char *pcArgs, long lArgsLen);
+static void PubBenchFill(void);
+static void MqttSendTask(void *pvParameters);
+static unsigned short IoReadInput(unsigned short usPointId);
+static int EncodeIoBatch(const IoSampler_t *pSampler, unsigned char *pucBuf,
+                         int iBufLen);
+static void QueueIoBatch(bool bOnline);
+static void ReplayStored(bool bOnline);
+#if SFWD_USE_FLASH
+static long StoreFwd_FlashOpen(unsigned int uiSegment, bool bWrite);
+static long StoreFwd_FlashWrite(long lHandle, unsigned long ulOffset,
+                                const unsigned char *pucData,
+                                unsigned long ulLen);
+static long StoreFwd_FlashRead(long lHandle, unsigned long ulOffset,
+                               unsigned char *pucData, unsigned long ulLen);
+static void StoreFwd_FlashClose(long lHandle);
+static void StoreFwd_FlashErase(unsigned int uiSegment);
+#endif
 void TimerPeriodicIntHandler(void);
 void LedTimerConfigNStart();
 void LedTimerDeinitStop();
+static void LedIndicateIpAcquired(void);
+static void LedRestoreCoils(void);
+static short WlanProfileFind(void);
+static long WlanConnect(void);
+static void WlanSaveProfile(void);
 void BoardInit(void);
 static void DisplayBanner(char * AppName);
-void MqttClient(void *pvParameters);
+static unsigned char Modbus_CoilRead(unsigned short usAddr);
+static void Modbus_CoilWrite(unsigned short usAddr, unsigned char ucValue);
+static unsigned char Modbus_DiscreteInputRead(unsigned short usAddr);
+static unsigned short Modbus_HoldingRegRead(unsigned short usAddr);
+static void Modbus_HoldingRegWrite(unsigned short usAddr,
+                                   unsigned short usValue);
+static unsigned short Modbus_InputRegRead(unsigned short usAddr);
+static void ModbusAcceptClient(int iListenSockID, modbus_conn *pConn,
+                               unsigned long ulNowMs);
+static int ModbusSend(int iSockID, const unsigned char *pucBuf, int iLen);
+static int ModbusServeClient(modbus_conn *pConn);
+static void ModbusCloseClient(modbus_conn *pConn);
+static int ModbusListen(void);
+static void ModbusPoll(unsigned long ulTimeoutMs);
+static void ModbusNetEvent(net_event eEvent);
+static void LoopServiceStart(void);
+static void LoopNetEvent(net_event eEvent);
+static void LoopTestRequest(const char *pcArgs, long lArgsLen);
+static void LoopTestClose(void);
+static int LoopTestFdSet(SlFdSet_t *pReadSet, int iMaxSockID);
+static void LoopTestServe(SlFdSet_t *pReadSet);
+static void LoopServicePoll(void);
+static void MqttServiceStart(void);
+static void MqttNetEvent(net_event eEvent);
+static void LedNetEvent(net_event eEvent);
+static int NetEventSubscribe(net_event_handler pfnHandler);
+static void NetMonitor(void);
+static long DiagTaskCreate(P_OSI_TASK_ENTRY pEntry, const char *pcName,
+                           unsigned short usStackLen, void *pvParameters,
+                           unsigned long ulPriority);
+static void PrintPoolStats(void);
+static void ButtonEdge(unsigned char ucSource, unsigned long ulAtMs);
+static void ButtonEventsDrain(void);
+static void DiagReport(bool bProbeHeap);
+static void LatencyReport(void);
+static void HeapViolation(size_t uiSize);
+static void NetworkManagerTask(void *pvParameters);
+static int LogPrint(const char *pcFmt, ...);
+static void LogDrainTask(void *pvParameters);
 //*****************************************************************************
 //                 GLOBAL VARIABLES -- Start
 //*****************************************************************************
@@ -196,15 +569,38 @@ extern void (* const g_pfnVectors[])(void);
 #endif
 
 unsigned short g_usTimerInts;
+static volatile unsigned char g_ucLedMode = LED_MODE_SEARCHING;
+static volatile bool g_bLedIndication = true;
 /* AP Security Parameters */
 SlSecParams_t SecurityParams = {0};
 
-/*Message Queue*/
-OsiMsgQ_t g_PBQueue;
+/* Connect path taken at boot */
+static wlan_stats g_WlanStats;
+
+/* Line formatted by LogPrint, only used by LogDrainTask */
+static char g_cLogLine[LOG_LINE_LEN];
+
+/* Push button edges, posted by the button interrupt handlers. Both run at
+   the GPIO interrupt priority and cannot preempt each other, so they are a
+   single producer of the ring. */
+static IsrRing_t g_ButtonRing;
+
+/* Time of the last edge posted per button, the bounce held per button and
+   the bounces held in total, written by the button interrupt handlers only.
+   The drain takes a held edge once, by its sequence number. */
+static unsigned long g_ulButtonLastMs[BUTTON_NUM];
+static bool g_bButtonPosted[BUTTON_NUM];
+static button_held g_ButtonHeld[BUTTON_NUM];
+static volatile unsigned long g_ulButtonBounces;
+static unsigned long g_ulButtonTakenSeq[BUTTON_NUM];
+
+/* Network status bits maintained by network_if */
+extern volatile unsigned long g_ulStatus;
 
 /* connection configuration */
 connect_config usr_connect_config[] =
 {
+    /* primary: cloud broker */
     {
         {
             {
@@ -217,20 +613,50 @@ connect_config usr_connect_config[] =
                 NULL
             },
             SERVER_MODE,
-            true,
+            false,                  /* non-blocking, acks via sl_MqttEvt */
+        },
+        NULL,
+        (unsigned char *)CLIENT_ID,
+        NULL,
+        NULL,
+        CLEAN_SESSION,
+        KEEP_ALIVE_TIMER,
+        {Mqtt_Recv, sl_MqttEvt, sl_MqttDisconnect},
+        TOPIC_COUNT,
+        {TOPIC1, TOPIC2, TOPIC3, TOPIC_DEVICE_CMD},
+        {QOS_COMMAND, QOS_COMMAND, QOS_COMMAND, QOS_COMMAND},
+        {WILL_TOPIC,WILL_MSG,WILL_QOS,WILL_RETAIN},
+        false,
+        SERVER_STATIC_IP
+    },
+    /* secondary: edge broker on the local network */
+    {
+        {
+            {
+                SL_MQTT_NETCONN_IP4,
+                SERVER_IP_ADDRESS,
+                PORT_NUMBER,
+                0,
+                0,
+                0,
+                NULL
+            },
+            SERVER_MODE,
+            false,                  /* non-blocking, acks via sl_MqttEvt */
         },
         NULL,
-        "user1",
+        (unsigned char *)CLIENT_ID,
         NULL,
         NULL,
-        true,
+        CLEAN_SESSION,
         KEEP_ALIVE_TIMER,
         {Mqtt_Recv, sl_MqttEvt, sl_MqttDisconnect},
         TOPIC_COUNT,
-        {TOPIC1, TOPIC2, TOPIC3},
-        {QOS2, QOS2, QOS2},
+        {TOPIC1, TOPIC2, TOPIC3, TOPIC_DEVICE_CMD},
+        {QOS_COMMAND, QOS_COMMAND, QOS_COMMAND, QOS_COMMAND},
         {WILL_TOPIC,WILL_MSG,WILL_QOS,WILL_RETAIN},
-        false
+        false,
+        NULL
     }
 };
 
@@ -243,15 +669,168 @@ SlMqttClientLibCfg_t Mqtt_Client={
     (long(*)(const char *, ...))UART_PRINT
 };
 
-/*Publishing topics and messages*/
-const char *pub_topic_sw2 = PUB_TOPIC_FOR_SW2;
-const char *pub_topic_sw3 = PUB_TOPIC_FOR_SW3;
-unsigned char *data_sw2={"Push button sw2 is pressed on CC32XX device"};
-unsigned char *data_sw3={"Push button sw3 is pressed on CC32XX device"};
+/* Subscribed topic filters and their handlers, compiled by MqttTopic_Init */
+static const MqttTopicRoute_t g_MqttRoutes[] =
+{
+    {TOPIC1, ToggleLedCmd, LED1},
+    {TOPIC2, ToggleLedCmd, LED2},
+    {TOPIC3, ToggleLedCmd, LED3},
+    {TOPIC_DEVICE_CMD, DeviceCmd, 0}
+};
+
+/* Publish QoS and retain per topic; other topics are sent as telemetry.
+   The index is the topic id of records in the store-and-forward buffer.
+   Delivery is only tracked on the route; the fan-out copies to the other
+   brokers are best effort, see BrokerFanOut. */
+#define PUB_POLICY_IO           0
+static const publish_policy g_PublishPolicy[] =
+{
+    {PUB_TOPIC_IO, QOS_STATE, false, true}
+};
+
+/* Outbound publishes, drained by MqttSendTask */
+static PubQueue_t g_PubOutQueue;
+static OsiLockObj_t g_PubOutLock;
+static OsiSyncObj_t g_PubOutSync;
+
+/* Commands received lately, to drop the copies of the other broker */
+static cmd_seen g_CmdSeen[CMD_DUP_ENTRIES];
+static int g_iCmdSeenNext;
+static OsiLockObj_t g_CmdSeenLock;
+
+/* Copy of the message being fanned out, only used by MqttSendTask */
+static PubQueueSlot_t g_PubFanOutCopy;
+
+/* Resolved broker addresses, shared by the broker connect tasks */
+static DnsCache_t g_DnsCache;
+static OsiLockObj_t g_DnsLock;
+
+/* Names of the broker connect tasks, for the diagnostics */
+static const char * const g_pcBrokerTaskNames[MAX_BROKER_CONN] =
+{
+    "MqttConn1",
+    "MqttConn2"
+};
+
+/* Connection the queue is published on, -1 while no broker is usable */
+static volatile int g_iPubRoute = -1;
+
+/* Publishes held back while offline, only used by the network manager */
+#if SFWD_USE_FLASH
+static const StoreFwdFlash_t g_StoreFwdFlash =
+{
+    StoreFwd_FlashOpen,
+    StoreFwd_FlashWrite,
+    StoreFwd_FlashRead,
+    StoreFwd_FlashClose,
+    StoreFwd_FlashErase
+};
+#endif
+static StoreFwd_t g_StoreFwd;
+static unsigned long g_ulLastReplayMs;
+
+/* Sampled I/O points: the SW2 and SW3 push buttons */
+static const IoPointCfg_t g_IoPoints[] =
+{
+    {0, 0, IO_DEBOUNCE_MS, IoReadInput},
+    {1, 0, IO_DEBOUNCE_MS, IoReadInput}
+};
+
+/* Change-of-state sampler of the I/O batches */
+static IoSampler_t g_IoSampler;
 
 void *app_hndl = (void*)usr_connect_config;
 
-OsiSyncObj_t sync_obj;
+/* Connection state event subscribers and the last published state */
+static net_event_handler g_NetSubscribers[NET_MAX_SUBSCRIBERS];
+static int g_iNumNetSubscribers;
+static bool g_bNetUp;
+
+/* Modbus coil number to LED GPIO */
+static const unsigned char g_ucCoilGpio[MB_NUM_COILS] =
+{
+    MCU_RED_LED_GPIO,
+    MCU_ORANGE_LED_GPIO,
+    MCU_GREEN_LED_GPIO
+};
+
+/* Commanded coil state, restored once the status indication ends */
+static volatile unsigned char g_ucCoilState[MB_NUM_COILS];
+
+/* Modbus discrete input number to push button port and pin (SW2, SW3) */
+static const unsigned long g_ulInputPort[MB_NUM_DISCRETE_INPUTS] =
+{
+    GPIOA2_BASE,
+    GPIOA1_BASE
+};
+static const unsigned char g_ucInputPin[MB_NUM_DISCRETE_INPUTS] =
+{
+    0x40,
+    0x20
+};
+
+/* Modbus data map of the board I/O */
+const ModbusDataMap_t g_ModbusDataMap =
+{
+    MB_NUM_COILS,
+    MB_NUM_DISCRETE_INPUTS,
+    MB_NUM_HOLDING_REGS,
+    MB_NUM_INPUT_REGS,
+    Modbus_CoilRead,
+    Modbus_CoilWrite,
+    Modbus_DiscreteInputRead,
+    Modbus_HoldingRegRead,
+    Modbus_HoldingRegWrite,
+    Modbus_InputRegRead
+};
+
+/* Modbus client connections and response buffer, kept off the task stack */
+static modbus_conn g_ModbusConn[MB_MAX_CLIENTS];
+static int g_iModbusListenSock = -1;
+static unsigned char g_ucModbusTx[MB_TX_BUF_LEN];
+
+/* Pool storage, smallest block size first */
+static unsigned long g_ulPoolPayload[POOL_WORDS(PUBQ_MAX_PAYLOAD_LEN,
+                                                POOL_PAYLOAD_BLOCKS)];
+static unsigned long g_ulPoolFrame[POOL_WORDS(MB_CONN_RX_LEN,
+                                              POOL_FRAME_BLOCKS)];
+static const MemPoolClassCfg_t g_PoolClasses[] =
+{
+    {PUBQ_MAX_PAYLOAD_LEN, POOL_PAYLOAD_BLOCKS, g_ulPoolPayload},
+    {MB_CONN_RX_LEN, POOL_FRAME_BLOCKS, g_ulPoolFrame}
+};
+
+/* Memory diagnostics, the tasks are the ones created by DiagTaskCreate */
+static SysDiagTask_t g_DiagTasks[DIAG_MAX_TASKS];
+static OsiTaskHandle g_DiagTaskHandles[DIAG_MAX_TASKS];
+static int g_iNumDiagTasks;
+static SysDiagHeap_t g_DiagHeap;
+static unsigned long g_ulLastDiagMs;
+static volatile bool g_bDiagRequest;
+
+/* Latency histograms, indexed by LAT_MODBUS_RSP etc */
+static LatencyHist_t g_LatHist[] =
+{
+    {"Modbus rsp"},
+    {"Pub send"},
+    {"MQTT rx cb"}
+};
+static volatile bool g_bLatRequest;
+
+/* Publish benchmark in progress, guarded by g_PubOutLock */
+static pub_bench g_PubBench;
+
+/* Link test service; LoopServicePoll takes over the requested mode,
+   encoded as protocol << 4 | mode */
+static LoopTest_t g_LoopTest;
+static volatile unsigned char g_ucLoopRequest = LOOP_REQ_NONE;
+static unsigned long g_ulLoopOpenMs;
+static int g_iLoopListenSock = -1;
+static int g_iLoopSock = -1;
+static SlSockAddrIn_t g_LoopPeer;
+static bool g_bLoopPeer;
+static unsigned long g_ulLoopPeerMs;
+static unsigned char g_ucLoopBuf[LOOP_BUF_LEN];
 
 //*****************************************************************************
 //                 GLOBAL VARIABLES -- End
@@ -274,56 +853,109 @@ OsiSyncObj_t sync_obj;
 //!\return none
 //****************************************************************************
 static void
-Mqtt_Recv(void *app_hndl, const char  *topstr, long top_len, const void *payload,
-                       long pay_len, bool dup,unsigned char qos, bool retain)
+Mqtt_Recv(void *app_hndl, const char  *topstr, long top_len,
+          const void *payload, long pay_len, bool dup,unsigned char qos,
+          bool retain)
 {
-    
-    char *output_str=(char*)malloc(top_len+1);
-    memset(output_str,'\0',top_len+1);
-    strncpy(output_str, (char*)topstr, top_len);
-    output_str[top_len]='\0';
+    connect_config *local_con_conf = (connect_config *)app_hndl;
+    unsigned long ulStart = Latency_Stamp();
+    int iHandled;
 
+    if(CmdIsCopy(local_con_conf - usr_connect_config, topstr, top_len,
+                 payload, pay_len))
+    {
+        LOG_INFO("\n\rCommand already received from the other broker\n\r");
+        return;
+    }
 
-    if(strncmp(output_str,TOPIC1, top_len) == 0)
+    //
+    // Route on the library's buffers; topic and payload are not copied
+    //
+    iHandled = MqttTopic_Dispatch(topstr, top_len, payload, pay_len);
+    Latency_Record(&g_LatHist[LAT_MQTT_RX_CB], ulStart);
+    if(iHandled == 0)
     {
-        ToggleLedState(LED1);
+        LOG_WARN("\n\rNo handler for topic");
     }
-    else if(strncmp(output_str,TOPIC2, top_len) == 0)
+
+    //
+    // The library's buffers are gone by the time the log is printed, so
+    // only the sizes are logged
+    //
+    LOG_INFO("\n\rPublish Message Received: topic %d bytes, data %d bytes "
+             "[Qos: %d]%s%s\n\r", (int)top_len, (int)pay_len, qos,
+             retain ? " [Retained]" : "", dup ? " [Duplicate]" : "");
+    return;
+}
+
+//****************************************************************************
+//
+//! Tells whether a received command is the copy of one that came from
+//! another broker within CMD_DUP_WINDOW_MS, and remembers it otherwise.
+//! Repeats from the same broker are new commands.
+//!
+//! \param iConn is the connection the command came from
+//! \param pcTopic is the topic, not NUL terminated
+//! \param lTopLen is the topic length
+//! \param pvPayload is the payload
+//! \param lPayLen is the payload length
+//!
+//! \return true if the command must be dropped
+//
+//****************************************************************************
+static bool
+CmdIsCopy(int iConn, const char *pcTopic, long lTopLen,
+          const void *pvPayload, long lPayLen)
+{
+    const unsigned char *pucByte = (const unsigned char *)pcTopic;
+    unsigned long ulHash = 2166136261UL;
+    unsigned long ulNow = GetTimeMs();
+    bool bCopy = false;
+    long lIndex;
+    int iEntry;
+
+    // FNV-1a over topic and payload
+    for(lIndex = 0; lIndex < lTopLen; lIndex++)
     {
-        ToggleLedState(LED2);
+        ulHash = ((ulHash ^ pucByte[lIndex]) * 16777619UL) & 0xFFFFFFFF;
     }
-    else if(strncmp(output_str,TOPIC3, top_len) == 0)
+    pucByte = (const unsigned char *)pvPayload;
+    for(lIndex = 0; lIndex < lPayLen; lIndex++)
     {
-        ToggleLedState(LED3);
+        ulHash = ((ulHash ^ pucByte[lIndex]) * 16777619UL) & 0xFFFFFFFF;
     }
 
-    UART_PRINT("\n\rPublish Message Received");
-    UART_PRINT("\n\rTopic: ");
-    UART_PRINT("%s",output_str);
-    free(output_str);
-    UART_PRINT(" [Qos: %d] ",qos);
-    if(retain)
-      UART_PRINT(" [Retained]");
-    if(dup)
-      UART_PRINT(" [Duplicate]");
-    
-    output_str=(char*)malloc(pay_len+1);
-    memset(output_str,'\0',pay_len+1);
-    strncpy(output_str, (char*)payload, pay_len);
-    output_str[pay_len]='\0';
-    UART_PRINT("\n\rData is: ");
-    UART_PRINT("%s",(char*)output_str);
-    UART_PRINT("\n\r");
-    free(output_str);
-    
-    return;
+    osi_LockObjLock(&g_CmdSeenLock, OSI_WAIT_FOREVER);
+    for(iEntry = 0; iEntry < CMD_DUP_ENTRIES; iEntry++)
+    {
+        if(g_CmdSeen[iEntry].iConn >= 0 &&
+           g_CmdSeen[iEntry].iConn != iConn &&
+           g_CmdSeen[iEntry].ulHash == ulHash &&
+           ulNow - g_CmdSeen[iEntry].ulRxMs < CMD_DUP_WINDOW_MS)
+        {
+            // one copy per broker, a third arrival is a new command
+            g_CmdSeen[iEntry].iConn = -1;
+            bCopy = true;
+            break;
+        }
+    }
+    if(!bCopy)
+    {
+        g_CmdSeen[g_iCmdSeenNext].ulHash = ulHash;
+        g_CmdSeen[g_iCmdSeenNext].ulRxMs = ulNow;
+        g_CmdSeen[g_iCmdSeenNext].iConn = iConn;
+        g_iCmdSeenNext = (g_iCmdSeenNext + 1) % CMD_DUP_ENTRIES;
+    }
+    osi_LockObjUnlock(&g_CmdSeenLock);
+    return bCopy;
 }
 
 //****************************************************************************
 //! Defines sl_MqttEvt event handler.
 //! Client App needs to register this event handler with sl_ExtLib_mqtt_Init 
 //! API. Background receive task invokes this handler whenever MQTT Client 
-//! receives an ack(whenever user is in non-blocking mode) or encounters an error.
+//! receives an ack(whenever user is in non-blocking mode) or encounters an
+//! error.
 //!
 //! param[out]      evt => Event that invokes the handler. Event can be of the
 //!                        following types:
@@ -343,22 +975,46 @@ sl_MqttEvt(void *app_hndl, long evt, const void *buf,unsigned long len)
     switch(evt)
     {
       case SL_MQTT_CL_EVT_PUBACK:
-        UART_PRINT("PubAck:\n\r");
-        UART_PRINT("%s\n\r",buf);
+      case SL_MQTT_CL_EVT_PUBCOMP:
+        //
+        // Release the acknowledged message and let the sender fill the
+        // in-flight window again. Acks of best effort fan-out copies and of
+        // a broker the route moved away from, whose messages were sent again
+        // on the new route, only feed the round trip time.
+        //
+        if(len >= sizeof(unsigned short))
+        {
+            connect_config *pConf = (connect_config *)app_hndl;
+            unsigned short usMsgId;
+
+            memcpy(&usMsgId, buf, sizeof(usMsgId));
+            osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+            if(pConf->link.bProbe && pConf->link.usProbeMsgId == usMsgId)
+            {
+                pConf->link.ulRttMs = (pConf->link.ulRttMs * 7 + GetTimeMs() -
+                                       pConf->link.ulProbeSentMs) / 8;
+                pConf->link.bProbe = false;
+            }
+            if(pConf - usr_connect_config == g_iPubRoute)
+            {
+                PubQueue_Ack(&g_PubOutQueue, usMsgId);
+            }
+            osi_LockObjUnlock(&g_PubOutLock);
+            osi_SyncObjSignal(&g_PubOutSync);
+        }
         break;
     
       case SL_MQTT_CL_EVT_SUBACK:
-        UART_PRINT("\n\rGranted QoS Levels are:\n\r");
+        LOG_INFO("\n\rGranted QoS Levels are:\n\r");
         
         for(i=0;i<len;i++)
         {
-          UART_PRINT("QoS %d\n\r",((unsigned char*)buf)[i]);
+          LOG_INFO("QoS %d\n\r",((unsigned char*)buf)[i]);
         }
         break;
         
       case SL_MQTT_CL_EVT_UNSUBACK:
-        UART_PRINT("UnSub Ack \n\r");
-        UART_PRINT("%s\n\r",buf);
+        LOG_INFO("UnSub Ack \n\r");
         break;
     
       default:
@@ -380,710 +1036,3032 @@ static void
 sl_MqttDisconnect(void *app_hndl)
 {
     connect_config *local_con_conf;
-    event_msg msg;
     local_con_conf = app_hndl;
-    msg.hndl = app_hndl;
-    msg.event = BROKER_DISCONNECTION;
 
-    UART_PRINT("disconnect from broker %s\r\n",
-           (local_con_conf->broker_config).server_info.server_addr);
+    LOG_WARN("disconnect from broker %s\r\n",
+             (local_con_conf->broker_config).server_info.server_addr);
     local_con_conf->is_connected = false;
     //
-    // write message indicating publish message
+    // MqttSendTask restarts the connection and moves the publish route
     //
-    osi_MsgQWrite(&g_PBQueue,&msg,OSI_NO_WAIT);
+    osi_SyncObjSignal(&g_PubOutSync);
 
 }
 
 //****************************************************************************
 //
-//! Push Button Handler1(GPIOS2). Press push button2 (GPIOSW2) Whenever user
-//! wants to publish a message. Write message into message queue signaling the
-//!    event publish messages
+//! Sets topic, QoS and retain flag of a queued message from the publish
+//! policy of its topic, and stamps the message for the send latency
 //!
-//! \param none
+//! \param pSlot is the message slot
+//! \param pcTopic is the topic, a string with static lifetime
 //!
-//! return none
+//! \return none
 //
 //****************************************************************************
-void pushButtonInterruptHandler2()
+static void
+ApplyPublishPolicy(PubQueueSlot_t *pSlot, const char *pcTopic)
 {
-	event_msg msg;
+    int iPolicy;
 
-    msg.event = PUSH_BUTTON_SW2_PRESSED;
-    msg.hndl = NULL;
-    //
-    // write message indicating publish message
-    //
-    osi_MsgQWrite(&g_PBQueue,&msg,OSI_NO_WAIT);
+    pSlot->pcTopic = pcTopic;
+    pSlot->ulStamp = Latency_Stamp();
+    pSlot->ucQos = QOS_TELEMETRY;
+    pSlot->bRetain = false;
+    pSlot->bFanOut = false;
+
+    for(iPolicy = 0;
+        iPolicy < sizeof(g_PublishPolicy)/sizeof(publish_policy); iPolicy++)
+    {
+        if(strcmp(g_PublishPolicy[iPolicy].pcTopic, pcTopic) == 0)
+        {
+            pSlot->ucQos = g_PublishPolicy[iPolicy].ucQos;
+            pSlot->bRetain = g_PublishPolicy[iPolicy].bRetain;
+            pSlot->bFanOut = g_PublishPolicy[iPolicy].bFanOut;
+            break;
+        }
+    }
 }
 
 //****************************************************************************
 //
-//! Push Button Handler3(GPIOS3). Press push button3 (GPIOSW3) Whenever user
-//! wants to publish a message. Write message into message queue signaling the
-//!    event publish messages
+//! Chooses the address a broker given by URL is connected to: the cached
+//! address while it is valid, else a fresh DNS resolution, else the static
+//! fallback address. Without any of them the library resolves the URL.
 //!
-//! \param none
+//! \param pConf is the connection
 //!
-//! return none
+//! \return none
 //
 //****************************************************************************
-void pushButtonInterruptHandler3()
+static void
+BrokerResolve(connect_config *pConf)
 {
-	event_msg msg;
-	msg.event = PUSH_BUTTON_SW3_PRESSED;
-    msg.hndl = NULL;
-    //
-    // write message indicating exit from sending loop
-    //
-    osi_MsgQWrite(&g_PBQueue,&msg,OSI_NO_WAIT);
+    SlMqttServer_t *pServer = &pConf->broker_config.server_info;
+    unsigned long ulAddr;
+
+    if(pConf->host_name == NULL)
+    {
+        return;
+    }
+
+    osi_LockObjLock(&g_DnsLock, OSI_WAIT_FOREVER);
+    pConf->cached_addr = (DnsCache_Lookup(&g_DnsCache, pConf->host_name,
+                                          GetTimeMs(), &ulAddr) == 0);
+    osi_LockObjUnlock(&g_DnsLock);
+
+    if(!pConf->cached_addr)
+    {
+        if(sl_NetAppDnsGetHostByName((signed char *)pConf->host_name,
+                                     strlen(pConf->host_name), &ulAddr,
+                                     SL_AF_INET) != 0)
+        {
+            if(pConf->static_ip != NULL)
+            {
+                LOG_WARN("DNS failed for %s, using %s\n\r",
+                         pConf->host_name, pConf->static_ip);
+                pServer->netconn_info = SL_MQTT_NETCONN_IP4;
+                pServer->server_addr = pConf->static_ip;
+            }
+            else
+            {
+                pServer->netconn_info = SL_MQTT_NETCONN_URL;
+                pServer->server_addr = pConf->host_name;
+            }
+            return;
+        }
+        osi_LockObjLock(&g_DnsLock, OSI_WAIT_FOREVER);
+        DnsCache_Store(&g_DnsCache, pConf->host_name, ulAddr, GetTimeMs(),
+                       DNS_CACHE_TTL_MS);
+        DnsCacheSave();
+        osi_LockObjUnlock(&g_DnsLock);
+    }
 
+    DnsCache_FormatAddr(ulAddr, pConf->server_ip);
+    pServer->netconn_info = SL_MQTT_NETCONN_IP4;
+    pServer->server_addr = pConf->server_ip;
 }
 
 //****************************************************************************
 //
-//!    Toggles the state of GPIOs(LEDs)
-//!
-//! \param LedNum is the enumeration for the GPIO to be toggled
+//! Restores the resolver cache saved by DnsCacheSave. Entries get a fresh
+//! time to live since the time base restarted with the reset.
 //!
-//!    \return none
+//! \return none
 //
 //****************************************************************************
-void ToggleLedState(ledEnum LedNum)
+static void
+DnsCacheLoad(void)
 {
-    unsigned char ledstate = 0;
-    switch(LedNum)
+    DnsCacheEntry_t Entries[DNS_CACHE_ENTRIES];
+    unsigned long ulToken = 0;
+    long lFileHandle;
+    int iEntry;
+
+    DnsCache_Init(&g_DnsCache);
+    if(sl_FsOpen((unsigned char *)DNS_CACHE_FILE_NAME, FS_MODE_OPEN_READ,
+                 &ulToken, &lFileHandle) < 0)
     {
-    case LED1:
-        ledstate = GPIO_IF_LedStatus(MCU_RED_LED_GPIO);
-        if(!ledstate)
-        {
-            GPIO_IF_LedOn(MCU_RED_LED_GPIO);
-        }
-        else
-        {
-            GPIO_IF_LedOff(MCU_RED_LED_GPIO);
-        }
-        break;
-    case LED2:
-        ledstate = GPIO_IF_LedStatus(MCU_ORANGE_LED_GPIO);
-        if(!ledstate)
-        {
-            GPIO_IF_LedOn(MCU_ORANGE_LED_GPIO);
-        }
-        else
-        {
-            GPIO_IF_LedOff(MCU_ORANGE_LED_GPIO);
-        }
-        break;
-    case LED3:
-        ledstate = GPIO_IF_LedStatus(MCU_GREEN_LED_GPIO);
-        if(!ledstate)
-        {
-            GPIO_IF_LedOn(MCU_GREEN_LED_GPIO);
-        }
-        else
+        return;
+    }
+    if(sl_FsRead(lFileHandle, 0, (unsigned char *)Entries,
+                 sizeof(Entries)) == sizeof(Entries))
+    {
+        for(iEntry = 0; iEntry < DNS_CACHE_ENTRIES; iEntry++)
         {
-            GPIO_IF_LedOff(MCU_GREEN_LED_GPIO);
+            Entries[iEntry].cName[DNS_CACHE_NAME_LEN - 1] = '\0';
+            DnsCache_Store(&g_DnsCache, Entries[iEntry].cName,
+                           Entries[iEntry].ulAddr, GetTimeMs(),
+                           DNS_CACHE_TTL_MS);
         }
-        break;
-    default:
-        break;
     }
+    sl_FsClose(lFileHandle, NULL, NULL, 0);
 }
 
-//*****************************************************************************
+//****************************************************************************
 //
-//! Periodic Timer Interrupt Handler
-//!
-//! \param None
+//! Saves the resolver cache to serial flash
 //!
-//! \return None
+//! \return none
 //
-//*****************************************************************************
-void
-TimerPeriodicIntHandler(void)
+//****************************************************************************
+static void
+DnsCacheSave(void)
 {
-    unsigned long ulInts;
-
-    //
-    // Clear all pending interrupts from the timer we are
-    // currently using.
-    //
-    ulInts = MAP_TimerIntStatus(TIMERA0_BASE, true);
-    MAP_TimerIntClear(TIMERA0_BASE, ulInts);
+    unsigned long ulToken = 0;
+    long lFileHandle;
 
-    //
-    // Increment our interrupt counter.
-    //
-    g_usTimerInts++;
-    if(!(g_usTimerInts & 0x1))
-    {
-        //
-        // Off Led
-        //
-        GPIO_IF_LedOff(MCU_RED_LED_GPIO);
-    }
-    else
+    sl_FsDel((unsigned char *)DNS_CACHE_FILE_NAME, 0);
+    if(sl_FsOpen((unsigned char *)DNS_CACHE_FILE_NAME,
+                 FS_MODE_OPEN_CREATE(sizeof(g_DnsCache.Entries), 0),
+                 &ulToken, &lFileHandle) < 0)
     {
-        //
-        // On Led
-        //
-        GPIO_IF_LedOn(MCU_RED_LED_GPIO);
+        return;
     }
+    sl_FsWrite(lFileHandle, 0, (unsigned char *)g_DnsCache.Entries,
+               sizeof(g_DnsCache.Entries));
+    sl_FsClose(lFileHandle, NULL, NULL, 0);
 }
 
 //****************************************************************************
 //
-//! Function to configure and start timer to blink the LED while device is
-//! trying to connect to an AP
+//! Creates the client context of a broker connection, connects and, unless
+//! the broker resumed the persistent session, subscribes to the topics
 //!
-//! \param none
+//! \param pConf is the connection
 //!
-//! return none
+//! \return 0 on success, -1 if the connection could not be set up
 //
 //****************************************************************************
-void LedTimerConfigNStart()
+static int
+BrokerConnect(connect_config *pConf)
 {
+    long lRetVal;
+
+    BrokerResolve(pConf);
+
+    //create client context
+    pConf->clt_ctx = sl_ExtLib_MqttClientCtxCreate(&pConf->broker_config,
+                                                   &pConf->CallBAcks, pConf);
+    if(pConf->clt_ctx == NULL)
+    {
+        return -1;
+    }
+
     //
-    // Configure Timer for blinking the LED for IP acquisition
+    // Set Client ID
     //
-    Timer_IF_Init(PRCM_TIMERA0,TIMERA0_BASE,TIMER_CFG_PERIODIC,TIMER_A,0);
-    Timer_IF_IntSetup(TIMERA0_BASE,TIMER_A,TimerPeriodicIntHandler);
-    Timer_IF_Start(TIMERA0_BASE,TIMER_A,100);
-}
+    sl_ExtLib_MqttClientSet((void*)pConf->clt_ctx, SL_MQTT_PARAM_CLIENT_ID,
+                            pConf->client_id,
+                            strlen((char*)(pConf->client_id)));
+
+    //
+    // Set will Params
+    //
+    if(pConf->will_params.will_topic != NULL)
+    {
+        sl_ExtLib_MqttClientSet((void*)pConf->clt_ctx,
+                                SL_MQTT_PARAM_WILL_PARAM,
+                                &(pConf->will_params), sizeof(SlMqttWill_t));
+    }
+
+    //
+    // setting username and password
+    //
+    if(pConf->usr_name != NULL)
+    {
+        sl_ExtLib_MqttClientSet((void*)pConf->clt_ctx,
+                                SL_MQTT_PARAM_USER_NAME, pConf->usr_name,
+                                strlen((char*)pConf->usr_name));
+
+        if(pConf->usr_pwd != NULL)
+        {
+            sl_ExtLib_MqttClientSet((void*)pConf->clt_ctx,
+                                    SL_MQTT_PARAM_PASS_WORD, pConf->usr_pwd,
+                                    strlen((char*)pConf->usr_pwd));
+        }
+    }
+
+    //
+    // connecting to the broker; the low byte is the CONNACK return code,
+    // the next one the session present flag
+    //
+    lRetVal = sl_ExtLib_MqttClientConnect((void*)pConf->clt_ctx,
+                                          pConf->is_clean,
+                                          pConf->keep_alive_time);
+    if(lRetVal < 0 || (lRetVal & 0xFF) != 0)
+    {
+        //delete the context for this connection
+        sl_ExtLib_MqttClientCtxDelete(pConf->clt_ctx);
+
+        // the broker may have moved, resolve again on the next attempt
+        if(pConf->cached_addr)
+        {
+            osi_LockObjLock(&g_DnsLock, OSI_WAIT_FOREVER);
+            DnsCache_Invalidate(&g_DnsCache, pConf->host_name);
+            osi_LockObjUnlock(&g_DnsLock);
+        }
+        return -1;
+    }
+    pConf->is_connected = true;
+
+    //
+    // A resumed persistent session still holds the subscriptions. This
+    // relies on CLIENT_ID being used by this device only: another client
+    // with the same id would take the session over. A broker that expired
+    // the session meanwhile answers without the session present flag, and
+    // the topics are subscribed again below.
+    //
+    if(!pConf->is_clean && (lRetVal & 0x100) != 0)
+    {
+        LOG_INFO("Session resumed, subscriptions kept\n\r");
+        return 0;
+    }
+
+    if(sl_ExtLib_MqttClientSub((void*)pConf->clt_ctx, pConf->topic,
+                               pConf->qos, pConf->num_topics) < 0)
+    {
+        LOG_ERROR("Subscription Error, disconnecting from the broker\r\n");
+        pConf->is_connected = false;
+        sl_ExtLib_MqttClientDisconnect(pConf->clt_ctx);
+        sl_ExtLib_MqttClientCtxDelete(pConf->clt_ctx);
+        return -1;
+    }
+    else
+    {
+        int iSub;
+        LOG_INFO("Client subscribed on following topics:\n\r");
+        for(iSub = 0; iSub < pConf->num_topics; iSub++)
+        {
+            LOG_INFO("%s\n\r", pConf->topic[iSub]);
+        }
+    }
+    return 0;
+}
 
 //****************************************************************************
-//
-//! Disable the LED blinking Timer as Device is connected to AP
-//!
-//! \param none
-//!
-//! return none
-//
-//****************************************************************************
-void LedTimerDeinitStop()
+//
+//! Handles the loss of a broker connection: releases the client context and
+//! starts the outage. The first reconnect attempt is made right away.
+//! BrokerLinkDown must be called from MqttSendTask, the only task sending on
+//! a connected client context.
+//!
+//! \param pConf is the connection
+//!
+//! \return none
+//
+//****************************************************************************
+static void
+BrokerLinkDown(connect_config *pConf)
+{
+    if(pConf->link.eState != LINK_CONNECTED)
+    {
+        return;
+    }
+
+    sl_ExtLib_MqttClientCtxDelete(pConf->clt_ctx);
+    pConf->is_connected = false;
+    pConf->link.ulDownSinceMs = GetTimeMs();
+    pConf->link.ulRetryAtMs = pConf->link.ulDownSinceMs;
+    pConf->link.ulBackoffMs = 0;
+    pConf->link.ulAttempts = 0;
+
+    // hands the link over to its connect task
+    osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+    pConf->link.eState = LINK_BACKOFF;
+    osi_LockObjUnlock(&g_PubOutLock);
+    osi_SyncObjSignal(&pConf->link.Wake);
+}
+
+//****************************************************************************
+//
+//! Runs the reconnect state machine of a broker connection while it is not
+//! connected. Failed attempts are retried with exponential backoff plus
+//! jitter; while the AP or the IP address is missing no attempt is made,
+//! and the first attempt once the network is back is made right away.
+//! Called by the connect task of the broker only, see BrokerConnectTask.
+//!
+//! \param pConf is the connection
+//! \param iConn is the connection number, for the log
+//!
+//! \return none
+//
+//****************************************************************************
+static void
+BrokerLinkService(connect_config *pConf, int iConn)
+{
+    broker_link *pLink = &pConf->link;
+    unsigned long ulNow = GetTimeMs();
+    unsigned long ulStart;
+    unsigned long ulOutage;
+
+    if(pLink->eState == LINK_CONNECTED)
+    {
+        return;
+    }
+
+    if(!IS_CONNECTED(g_ulStatus) || !IS_IP_ACQUIRED(g_ulStatus))
+    {
+        if(pLink->eState != LINK_WAIT_NETWORK)
+        {
+            LOG_WARN("device has disconnected from AP \n\r");
+            pLink->eState = LINK_WAIT_NETWORK;
+        }
+        return;
+    }
+
+    if(pLink->eState == LINK_WAIT_NETWORK)
+    {
+        pLink->eState = LINK_BACKOFF;
+        pLink->ulRetryAtMs = ulNow;
+        pLink->ulBackoffMs = 0;
+    }
+
+    if((long)(ulNow - pLink->ulRetryAtMs) < 0)
+    {
+        return;
+    }
+
+    pLink->ulAttempts++;
+    ulStart = GetTimeMs();
+    if(BrokerConnect(pConf) < 0)
+    {
+        pLink->ulConnectFails++;
+        pLink->ulBackoffMs = (pLink->ulBackoffMs == 0) ? RECONNECT_MIN_MS :
+                             pLink->ulBackoffMs * 2;
+        if(pLink->ulBackoffMs > RECONNECT_MAX_MS)
+        {
+            pLink->ulBackoffMs = RECONNECT_MAX_MS;
+        }
+        pLink->ulRetryAtMs = GetTimeMs() + pLink->ulBackoffMs / 2 +
+                             rand() % (pLink->ulBackoffMs / 2 + 1);
+        LOG_WARN("\n\rBroker connect fail for conn no. %d, retry in %lu ms"
+                 "\n\r", iConn+1, pLink->ulRetryAtMs - GetTimeMs());
+        return;
+    }
+
+    //
+    // The connect handshake time seeds the round trip time until publishes
+    // have been timed
+    //
+    osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+    pLink->ulRttMs = GetTimeMs() - ulStart;
+    pLink->bProbe = false;
+    pLink->ulSession++;
+    pLink->eState = LINK_CONNECTED;
+    osi_LockObjUnlock(&g_PubOutLock);
+
+    ulOutage = GetTimeMs() - pLink->ulDownSinceMs;
+    pLink->ulReconnects++;
+    pLink->ulLastReconnectMs = ulOutage;
+    pLink->ulTotalReconnectMs += ulOutage;
+    if(ulOutage > pLink->ulMaxReconnectMs)
+    {
+        pLink->ulMaxReconnectMs = ulOutage;
+    }
+    LOG_INFO("\n\rSuccess: conn to Broker no. %d after %lu ms, %lu "
+             "attempts (max %lu ms)\n\r", iConn+1, ulOutage,
+             pLink->ulAttempts, pLink->ulMaxReconnectMs);
+    pLink->ulAttempts = 0;
+
+    // publishes held back during the outage can go out now
+    osi_SyncObjSignal(&g_PubOutSync);
+}
+
+//****************************************************************************
+//
+//! Connect task of a broker: makes the connect attempts of its link, which
+//! block for up to a TCP timeout, away from MqttSendTask and the other
+//! brokers. MqttSendTask hands the link back when the connection is lost.
+//!
+//! \param pvParameters is the connection number
+//!
+//! \return none
+//
+//****************************************************************************
+static void
+BrokerConnectTask(void *pvParameters)
+{
+    connect_config *local_con_conf = (connect_config *)app_hndl;
+    int iConn = (int)(long)pvParameters;
+
+    for(;;)
+    {
+        BrokerLinkService(&local_con_conf[iConn], iConn);
+        osi_SyncObjWait(&local_con_conf[iConn].link.Wake, BROKER_POLL_MS);
+    }
+}
+
+//****************************************************************************
+//
+//! Tells whether a broker connection can take publishes: it is up and its
+//! timed publish, if any, has not been waiting for longer than
+//! ROUTE_STALL_MS
+//
+//****************************************************************************
+static bool
+BrokerIsHealthy(const connect_config *pConf)
+{
+    if(!pConf->is_connected || pConf->link.eState != LINK_CONNECTED)
+    {
+        return false;
+    }
+    return !(pConf->link.bProbe &&
+             GetTimeMs() - pConf->link.ulProbeSentMs > ROUTE_STALL_MS);
+}
+
+//****************************************************************************
+//
+//! Picks the connection to publish on: the healthy broker with the lowest
+//! round trip time. The current route is kept while it is healthy and not
+//! slower than the best one by more than ROUTE_SWITCH_MARGIN_MS.
+//!
+//! \param iCurrent is the current route, -1 if none
+//!
+//! \return connection index, or -1 if no broker is healthy
+//
+//****************************************************************************
+static int
+BrokerSelect(int iCurrent)
+{
+    connect_config *local_con_conf = (connect_config *)app_hndl;
+    int iNumBroker = sizeof(usr_connect_config)/sizeof(connect_config);
+    int iBest = -1;
+    int iConn;
+
+    for(iConn = 0; iConn < iNumBroker; iConn++)
+    {
+        if(BrokerIsHealthy(&local_con_conf[iConn]) &&
+           (iBest < 0 || local_con_conf[iConn].link.ulRttMs <
+                         local_con_conf[iBest].link.ulRttMs))
+        {
+            iBest = iConn;
+        }
+    }
+
+    if(iCurrent >= 0 && iBest >= 0 &&
+       BrokerIsHealthy(&local_con_conf[iCurrent]) &&
+       local_con_conf[iCurrent].link.ulRttMs <=
+       local_con_conf[iBest].link.ulRttMs + ROUTE_SWITCH_MARGIN_MS)
+    {
+        return iCurrent;
+    }
+    return iBest;
+}
+
+//****************************************************************************
+//
+//! Times a QoS1/2 publish for the round trip time of its connection, unless
+//! another one is still being timed. Called with g_PubOutLock held.
+//!
+//! \param pConf is the connection the message was sent on
+//! \param usMsgId is the message id returned by the library
+//!
+//! \return none
+//
+//****************************************************************************
+static void
+BrokerProbe(connect_config *pConf, unsigned short usMsgId)
+{
+    if(usMsgId != 0 && !pConf->link.bProbe)
+    {
+        pConf->link.bProbe = true;
+        pConf->link.usProbeMsgId = usMsgId;
+        pConf->link.ulProbeSentMs = GetTimeMs();
+    }
+}
+
+//****************************************************************************
+//
+//! Sends a copy of a message to every healthy broker besides the route.
+//! Copies are best effort: the queue does not track them, so a copy that a
+//! broker loses, or that fails to send, is not sent again. Their acks only
+//! time the brokers.
+//!
+//! \param pSlot is the message
+//! \param iRoute is the connection the message itself is published on
+//!
+//! \return none
+//
+//****************************************************************************
+static void
+BrokerFanOut(const PubQueueSlot_t *pSlot, int iRoute)
+{
+    connect_config *local_con_conf = (connect_config *)app_hndl;
+    int iNumBroker = sizeof(usr_connect_config)/sizeof(connect_config);
+    int iConn;
+    long lRetVal;
+
+    for(iConn = 0; iConn < iNumBroker; iConn++)
+    {
+        if(iConn == iRoute || !BrokerIsHealthy(&local_con_conf[iConn]))
+        {
+            continue;
+        }
+
+        lRetVal = sl_ExtLib_MqttClientSend(
+                      (void*)local_con_conf[iConn].clt_ctx, pSlot->pcTopic,
+                      pSlot->ucData, pSlot->usLen, pSlot->ucQos,
+                      pSlot->bRetain);
+        if(lRetVal > 0)
+        {
+            osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+            BrokerProbe(&local_con_conf[iConn], (unsigned short)lRetVal);
+            osi_LockObjUnlock(&g_PubOutLock);
+        }
+    }
+}
+
+//****************************************************************************
+//
+//! Task sending on the broker connections: it releases lost connections to
+//! their connect tasks and drains the outbound publish queue into the MQTT
+//! library. The library runs in non-blocking mode, so a send returns
+//! without waiting for the broker and up to PUB_MAX_INFLIGHT messages wait
+//! for their ack in sl_MqttEvt at a time. Each round publishes on the
+//! broker picked by BrokerSelect; when the route changes or its connection
+//! was re-established, or an ack is overdue, unacknowledged messages are
+//! sent again.
+//!
+//! Delivery on the route is at least once: a message in flight when the
+//! route moves is sent again on the new broker, whether or not the old one
+//! got it, and the old broker's late acks are ignored. Subscribers see such
+//! messages twice when the brokers are bridged.
+//!
+//! \param pvParameters is unused
+//!
+//! \return none
+//
+//****************************************************************************
+static void
+MqttSendTask(void *pvParameters)
+{
+    connect_config *local_con_conf = (connect_config *)app_hndl;
+    PubQueueSlot_t *pSlot;
+    int iNumBroker = sizeof(usr_connect_config)/sizeof(connect_config);
+    unsigned long ulSession = 0;
+    bool bFanOut;
+    int iConn;
+    int iRoute;
+    long lRetVal;
+
+    for(;;)
+    {
+        osi_SyncObjWait(&g_PubOutSync, PUB_RETRY_MS);
+
+        //
+        // Lost connections, reported by sl_MqttDisconnect, go back to their
+        // connect tasks
+        //
+        for(iConn = 0; iConn < iNumBroker; iConn++)
+        {
+            if(local_con_conf[iConn].link.eState == LINK_CONNECTED &&
+               !local_con_conf[iConn].is_connected)
+            {
+                BrokerLinkDown(&local_con_conf[iConn]);
+            }
+        }
+
+        osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+        iRoute = BrokerSelect(g_iPubRoute);
+        if(iRoute != g_iPubRoute ||
+           (iRoute >= 0 && local_con_conf[iRoute].link.ulSession != ulSession))
+        {
+            PubQueue_Rewind(&g_PubOutQueue);
+            g_iPubRoute = iRoute;
+            if(iRoute >= 0)
+            {
+                ulSession = local_con_conf[iRoute].link.ulSession;
+                LOG_INFO("Publishing via broker no. %d\n\r", iRoute+1);
+            }
+        }
+        else if(PubQueue_Expire(&g_PubOutQueue, GetTimeMs(),
+                                PUB_ACK_TIMEOUT_MS))
+        {
+            LOG_WARN("Publish ack overdue, sending again\n\r");
+        }
+        osi_LockObjUnlock(&g_PubOutLock);
+
+        while(iRoute >= 0 && local_con_conf[iRoute].is_connected)
+        {
+            osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+            pSlot = PubQueue_NextToSend(&g_PubOutQueue, PUB_MAX_INFLIGHT);
+            osi_LockObjUnlock(&g_PubOutLock);
+            if(pSlot == NULL)
+            {
+                break;
+            }
+
+            lRetVal = sl_ExtLib_MqttClientSend(
+                                        (void*)local_con_conf[iRoute].clt_ctx,
+                                        pSlot->pcTopic, pSlot->ucData,
+                                        pSlot->usLen, pSlot->ucQos,
+                                        pSlot->bRetain);
+            if(lRetVal < 0)
+            {
+                // keep the message queued, retry after PUB_RETRY_MS
+                osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+                PubQueue_Unsent(&g_PubOutQueue);
+                osi_LockObjUnlock(&g_PubOutLock);
+                break;
+            }
+
+            //
+            // A message queued again, or held over a reconnect, was stamped
+            // before the outage, possibly longer ago than the cycle counter
+            // wraps
+            //
+            if(!pSlot->bResend)
+            {
+                Latency_Record(&g_LatHist[LAT_PUB_SEND], pSlot->ulStamp);
+            }
+
+            //
+            // Record the message id first, the fan-out sends would widen
+            // the window in which its ack has to be kept as an early ack.
+            // PubQueue_Sent may free the slot, so the copies are sent from
+            // a copy of it.
+            //
+            bFanOut = pSlot->bFanOut;
+            if(bFanOut)
+            {
+                memcpy(&g_PubFanOutCopy, pSlot, sizeof(PubQueueSlot_t));
+            }
+
+            osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+            PubQueue_Sent(&g_PubOutQueue, (unsigned short)lRetVal,
+                          GetTimeMs());
+            BrokerProbe(&local_con_conf[iRoute], (unsigned short)lRetVal);
+            osi_LockObjUnlock(&g_PubOutLock);
+
+            if(bFanOut)
+            {
+                BrokerFanOut(&g_PubFanOutCopy, iRoute);
+            }
+        }
+    }
+}
+
+//****************************************************************************
+//
+//! Posts a push button edge to the button ring, from interrupt context. An
+//! edge within BUTTON_MIN_EDGE_MS of the last posted edge of the button is
+//! held for ButtonEventsDrain instead, in place of the edge held before, so
+//! bounces cannot flood the ring and the last edge of a burst still reaches
+//! the sampler. The sampler does the debouncing, the edges only date its
+//! changes.
+//!
+//! \param ucSource is the button, 0 for SW2 and 1 for SW3
+//! \param ulAtMs is the time of the edge in ms
+//!
+//! \return none
+//
+//****************************************************************************
+static void ButtonEdge(unsigned char ucSource, unsigned long ulAtMs)
+{
+    button_held *pHeld = &g_ButtonHeld[ucSource];
+    unsigned char ucEdge = Modbus_DiscreteInputRead(ucSource) ?
+                           ISR_EDGE_RISING : ISR_EDGE_FALLING;
+
+    if(g_bButtonPosted[ucSource] &&
+       ulAtMs - g_ulButtonLastMs[ucSource] < BUTTON_MIN_EDGE_MS)
+    {
+        pHeld->ulAtMs = ulAtMs;
+        pHeld->ucEdge = ucEdge;
+        pHeld->bHeld = true;
+        pHeld->ulSeq++;
+        g_ulButtonBounces++;
+        return;
+    }
+
+    //
+    // A held edge is older than this one, which supersedes it
+    //
+    pHeld->bHeld = false;
+    pHeld->ulSeq++;
+    g_bButtonPosted[ucSource] = true;
+    g_ulButtonLastMs[ucSource] = ulAtMs;
+    IsrRing_Post(&g_ButtonRing, ucSource, ucEdge, ulAtMs);
+}
+
+//****************************************************************************
+//
+//! Push Button Handler1(GPIOS2). Stamps the edge of push button2 (GPIOSW2)
+//! and posts it to the button ring. The interrupt, disabled by button_if
+//! before the handler runs, is enabled again at once so that no edge is
+//! missed while the network manager catches up; bounces are held back by
+//! ButtonEdge.
+//!
+//! \param none
+//!
+//! return none
+//
+//****************************************************************************
+void pushButtonInterruptHandler2()
+{
+    ButtonEdge(0, GetTimeMs());
+    Button_IF_EnableInterrupt(SW2);
+}
+
+//****************************************************************************
+//
+//! Push Button Handler3(GPIOS3). Stamps the edge of push button3 (GPIOSW3)
+//! and posts it to the button ring, see pushButtonInterruptHandler2
+//!
+//! \param none
+//!
+//! return none
+//
+//****************************************************************************
+void pushButtonInterruptHandler3()
+{
+    ButtonEdge(1, GetTimeMs());
+    Button_IF_EnableInterrupt(SW3);
+}
+
+//****************************************************************************
+//
+//! Topic handler of the LED toggle commands
+//!
+//! \param ulArg is the LED to toggle
+//!
+//! \return none
+//
+//****************************************************************************
+static void ToggleLedCmd(const char *pcTopic, long lTopLen,
+                         const void *pvPayload, long lPayLen,
+                         unsigned long ulArg)
+{
+    ToggleLedState((ledEnum)ulArg);
+}
+
+//****************************************************************************
+//
+//! Topic handler of the per device command filter. The last topic level
+//! names the point: led1, led2 or led3 toggles the corresponding LED,
+//! diag and lat request the memory diagnostics and latency reports, bench
+//! starts a publish benchmark and loop selects the link test mode.
+//!
+//! \param pcTopic points to the topic, not NUL terminated
+//! \param lTopLen is the topic length
+//! \param pvPayload points to the payload, the arguments of bench and loop
+//! \param lPayLen is the payload length
+//!
+//! \return none
+//
+//****************************************************************************
+static void DeviceCmd(const char *pcTopic, long lTopLen,
+                      const void *pvPayload, long lPayLen,
+                      unsigned long ulArg)
+{
+    static const ledEnum LedOfPoint[] = {LED1, LED2, LED3};
+    const char *pcPoint = pcTopic + lTopLen;
+    long lPointLen;
+
+    while(pcPoint > pcTopic && pcPoint[-1] != '/')
+    {
+        pcPoint--;
+    }
+    lPointLen = pcTopic + lTopLen - pcPoint;
+
+    if(lPointLen == 4 && strncmp(pcPoint, "led", 3) == 0 &&
+       pcPoint[3] >= '1' && pcPoint[3] <= '3')
+    {
+        ToggleLedState(LedOfPoint[pcPoint[3] - '1']);
+    }
+    else if(lPointLen == 4 && strncmp(pcPoint, "diag", 4) == 0)
+    {
+        g_bDiagRequest = true;
+    }
+    else if(lPointLen == 3 && strncmp(pcPoint, "lat", 3) == 0)
+    {
+        g_bLatRequest = true;
+    }
+    else if(lPointLen == 5 && strncmp(pcPoint, "bench", 5) == 0)
+    {
+        PubBenchStart((const char *)pvPayload, lPayLen);
+    }
+    else if(lPointLen == 4 && strncmp(pcPoint, "loop", 4) == 0)
+    {
+        LoopTestRequest((const char *)pvPayload, lPayLen);
+    }
+}
+
+//****************************************************************************
+//
+//! Parses a decimal number, skipping the spaces in front of it
+//!
+//! \param ppcPos points to the parse position, advanced past the number
+//! \param pcEnd is the end of the text
+//!
+//! \return the number, 0 if there is none
+//
+//****************************************************************************
+static unsigned long ParseNumber(const char **ppcPos, const char *pcEnd)
+{
+    const char *pcPos = *ppcPos;
+    unsigned long ulValue = 0;
+
+    while(pcPos < pcEnd && *pcPos == ' ')
+    {
+        pcPos++;
+    }
+    while(pcPos < pcEnd && *pcPos >= '0' && *pcPos <= '9')
+    {
+        ulValue = ulValue * 10 + (*pcPos - '0');
+        pcPos++;
+    }
+    *ppcPos = pcPos;
+    return ulValue;
+}
+
+//****************************************************************************
+//
+//! Starts a publish benchmark from the arguments "<count> <qos> [<length>]".
+//! The messages are queued by the network manager as fast as the queue
+//! drains; a request while one is running replaces it.
+//!
+//! \param pcArgs points to the arguments, not NUL terminated
+//! \param lArgsLen is their length
+//!
+//! \return none
+//
+//****************************************************************************
+static void PubBenchStart(const char *pcArgs, long lArgsLen)
+{
+    const char *pcEnd = pcArgs + lArgsLen;
+    unsigned long ulCount;
+    unsigned long ulQos;
+    unsigned long ulLen;
+
+    ulCount = ParseNumber(&pcArgs, pcEnd);
+    ulQos = ParseNumber(&pcArgs, pcEnd);
+    ulLen = ParseNumber(&pcArgs, pcEnd);
+    if(ulQos > QOS2)
+    {
+        LOG_WARN("Bench: invalid QoS %lu\n\r", ulQos);
+        return;
+    }
+    if(ulLen < PUB_BENCH_MIN_LEN)
+    {
+        ulLen = PUB_BENCH_MIN_LEN;
+    }
+    else if(ulLen > PUBQ_MAX_PAYLOAD_LEN)
+    {
+        ulLen = PUBQ_MAX_PAYLOAD_LEN;
+    }
+
+    osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+    g_PubBench.ulLeft = ulCount;
+    g_PubBench.ulSeq = 0;
+    g_PubBench.ulStartMs = GetTimeMs();
+    g_PubBench.usLen = (unsigned short)ulLen;
+    g_PubBench.ucQos = (unsigned char)ulQos;
+    osi_LockObjUnlock(&g_PubOutLock);
+    LOG_INFO("Bench: %lu messages, QoS%lu, %lu bytes\n\r", ulCount, ulQos,
+             ulLen);
+}
+
+//****************************************************************************
+//
+//!    Toggles the state of GPIOs(LEDs)
+//!
+//! \param LedNum is the enumeration for the GPIO to be toggled
+//!
+//!    \return none
+//
+//****************************************************************************
+void ToggleLedState(ledEnum LedNum)
+{
+    unsigned short usCoil;
+    switch(LedNum)
+    {
+    case LED1:
+        usCoil = 0;
+        break;
+    case LED2:
+        usCoil = 1;
+        break;
+    case LED3:
+        usCoil = 2;
+        break;
+    default:
+        return;
+    }
+    Modbus_CoilWrite(usCoil, (unsigned char)!Modbus_CoilRead(usCoil));
+}
+
+//****************************************************************************
+//
+//! Modbus coil read: returns the commanded state of the mapped LED, which
+//! the LED itself only shows once the status indication has ended
+//!
+//! \param usAddr is the zero based coil address
+//!
+//! \return 1 if the LED is on, 0 otherwise
+//
+//****************************************************************************
+static unsigned char Modbus_CoilRead(unsigned short usAddr)
+{
+    return g_ucCoilState[usAddr];
+}
+
+//****************************************************************************
+//
+//! Modbus coil write: switches the mapped LED on or off. While the status
+//! indication owns the red LED the write is only kept in the coil state and
+//! the LED timer applies it when the indication ends.
+//!
+//! \param usAddr is the zero based coil address
+//! \param ucValue is the new coil state
+//!
+//! \return none
+//
+//****************************************************************************
+static void Modbus_CoilWrite(unsigned short usAddr, unsigned char ucValue)
+{
+    g_ucCoilState[usAddr] = ucValue ? 1 : 0;
+    if(g_bLedIndication && g_ucCoilGpio[usAddr] == MCU_RED_LED_GPIO)
+    {
+        return;
+    }
+    if(ucValue)
+    {
+        GPIO_IF_LedOn(g_ucCoilGpio[usAddr]);
+    }
+    else
+    {
+        GPIO_IF_LedOff(g_ucCoilGpio[usAddr]);
+    }
+}
+
+//****************************************************************************
+//
+//! Modbus discrete input read: samples the mapped push button
+//!
+//! \param usAddr is the zero based discrete input address
+//!
+//! \return 1 if the button is pressed, 0 otherwise
+//
+//****************************************************************************
+static unsigned char Modbus_DiscreteInputRead(unsigned short usAddr)
+{
+    return MAP_GPIOPinRead(g_ulInputPort[usAddr],
+                           g_ucInputPin[usAddr]) ? 1 : 0;
+}
+
+//****************************************************************************
+//
+//! Modbus holding register read. Register 0 holds the LED states as a
+//! bitmask, bit n being coil n.
+//!
+//! \param usAddr is the zero based register address
+//!
+//! \return register value
+//
+//****************************************************************************
+static unsigned short Modbus_HoldingRegRead(unsigned short usAddr)
+{
+    unsigned short usValue = 0;
+    unsigned short usCoil;
+
+    for(usCoil = 0; usCoil < MB_NUM_COILS; usCoil++)
+    {
+        usValue |= (unsigned short)(Modbus_CoilRead(usCoil) << usCoil);
+    }
+    return usValue;
+}
+
+//****************************************************************************
+//
+//! Modbus holding register write. Writing register 0 sets all LEDs at once.
+//!
+//! \param usAddr is the zero based register address
+//! \param usValue is the new register value
+//!
+//! \return none
+//
+//****************************************************************************
+static void Modbus_HoldingRegWrite(unsigned short usAddr,
+                                   unsigned short usValue)
+{
+    unsigned short usCoil;
+
+    for(usCoil = 0; usCoil < MB_NUM_COILS; usCoil++)
+    {
+        Modbus_CoilWrite(usCoil, (unsigned char)((usValue >> usCoil) & 1));
+    }
+}
+
+//****************************************************************************
+//
+//! Modbus input register read. Register 0 holds the push button states as
+//! a bitmask, bit n being discrete input n.
+//!
+//! \param usAddr is the zero based register address
+//!
+//! \return register value
+//
+//****************************************************************************
+static unsigned short Modbus_InputRegRead(unsigned short usAddr)
+{
+    unsigned short usValue = 0;
+    unsigned short usInput;
+
+    for(usInput = 0; usInput < MB_NUM_DISCRETE_INPUTS; usInput++)
+    {
+        usValue |= (unsigned short)(Modbus_DiscreteInputRead(usInput) <<
+                                    usInput);
+    }
+    return usValue;
+}
+
+//****************************************************************************
+//
+//! Millisecond time base of the I/O sampling, derived from the 32.768 kHz
+//! slow clock counter. It does not wrap for 49 days and the button
+//! interrupt handlers read it too.
+//!
+//! \return time since power on in ms
+//
+//****************************************************************************
+static unsigned long GetTimeMs(void)
+{
+    return (unsigned long)((MAP_PRCMSlowClkCtrGet() * 1000) >> 15);
+}
+
+//****************************************************************************
+//
+//! Reads a sampled I/O point; point n is Modbus discrete input n
+//!
+//! \param usPointId is the point to read
+//!
+//! \return point value
+//
+//****************************************************************************
+static unsigned short IoReadInput(unsigned short usPointId)
+{
+    return Modbus_DiscreteInputRead(usPointId);
+}
+
+//****************************************************************************
+//
+//! Encodes the pending I/O changes as one binary telemetry message
+//!
+//! \param pSampler is the sampler holding the batch
+//! \param pucBuf is the payload buffer
+//! \param iBufLen is the size of pucBuf
+//!
+//! \return payload length
+//
+//****************************************************************************
+static int EncodeIoBatch(const IoSampler_t *pSampler, unsigned char *pucBuf,
+                         int iBufLen)
+{
+    TelemetryWriter_t sWriter;
+    TelemetryRecord_t sRecord;
+    int iChange;
+
+    Telemetry_Begin(&sWriter, pucBuf, iBufLen,
+                    pSampler->Changes[0].ulTimestamp);
+    sRecord.ucQuality = TLM_QUALITY_GOOD;
+    for(iChange = 0; iChange < pSampler->iNumChanges; iChange++)
+    {
+        sRecord.usPointId = pSampler->Changes[iChange].usPointId;
+        sRecord.usValue = pSampler->Changes[iChange].usValue;
+        sRecord.ulTimestamp = pSampler->Changes[iChange].ulTimestamp;
+        Telemetry_Add(&sWriter, &sRecord);
+    }
+    return Telemetry_End(&sWriter);
+}
+
+//****************************************************************************
+//
+//! Queues the pending I/O batch as a single message, encoded in place in a
+//! publish queue slot. Offline, or while older messages wait for replay,
+//! the batch goes to the store-and-forward buffer instead. When the publish
+//! queue is full the batch stays pending in the sampler for a later poll.
+//!
+//! \param bOnline tells whether the broker connection is up
+//!
+//! \return none
+//
+//****************************************************************************
+static void QueueIoBatch(bool bOnline)
+{
+    PubQueueSlot_t *pSlot;
+    unsigned char *pucBuf;
+    int iLen;
+
+    if(!bOnline || !StoreFwd_IsEmpty(&g_StoreFwd))
+    {
+        pucBuf = MemPool_Alloc(PUBQ_MAX_PAYLOAD_LEN);
+        if(pucBuf == NULL)
+        {
+            return;
+        }
+        iLen = EncodeIoBatch(&g_IoSampler, pucBuf, PUBQ_MAX_PAYLOAD_LEN);
+        StoreFwd_Push(&g_StoreFwd, PUB_POLICY_IO, pucBuf, iLen);
+        MemPool_Free(pucBuf);
+        LOG_DEBUG("Stored %d changes, %d bytes\n\r",
+                  g_IoSampler.iNumChanges, iLen);
+        IoSample_Clear(&g_IoSampler);
+        return;
+    }
+
+    osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+    pSlot = PubQueue_Reserve(&g_PubOutQueue);
+    osi_LockObjUnlock(&g_PubOutLock);
+    if(pSlot == NULL)
+    {
+        return;
+    }
+
+    ApplyPublishPolicy(pSlot, PUB_TOPIC_IO);
+    pSlot->usLen = EncodeIoBatch(&g_IoSampler, pSlot->ucData,
+                                 sizeof(pSlot->ucData));
+    LOG_DEBUG("\n\r CC3200 Publishes the following message \n\r");
+    LOG_DEBUG("Topic: %s\n\r",PUB_TOPIC_IO);
+    LOG_DEBUG("Data: %d changes, %d bytes\n\r",
+              g_IoSampler.iNumChanges, pSlot->usLen);
+
+    osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+    PubQueue_Commit(&g_PubOutQueue);
+    osi_LockObjUnlock(&g_PubOutLock);
+    osi_SyncObjSignal(&g_PubOutSync);
+    IoSample_Clear(&g_IoSampler);
+}
+
+//****************************************************************************
+//
+//! Moves the oldest stored message into the publish queue, at most one every
+//! SFWD_REPLAY_INTERVAL_MS
+//!
+//! \param bOnline tells whether the broker connection is up
+//!
+//! \return none
+//
+//****************************************************************************
+static void ReplayStored(bool bOnline)
+{
+    PubQueueSlot_t *pSlot;
+    unsigned char ucTopicId;
+    unsigned long ulNow = GetTimeMs();
+    int iLen;
+
+    if(!bOnline || StoreFwd_IsEmpty(&g_StoreFwd) ||
+       ulNow - g_ulLastReplayMs < SFWD_REPLAY_INTERVAL_MS)
+    {
+        return;
+    }
+
+    osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+    pSlot = PubQueue_Reserve(&g_PubOutQueue);
+    osi_LockObjUnlock(&g_PubOutLock);
+    if(pSlot == NULL)
+    {
+        return;
+    }
+    g_ulLastReplayMs = ulNow;
+
+    iLen = StoreFwd_Pop(&g_StoreFwd, &ucTopicId, pSlot->ucData,
+                        sizeof(pSlot->ucData));
+    if(iLen <= 0 ||
+       ucTopicId >= sizeof(g_PublishPolicy)/sizeof(publish_policy))
+    {
+        // lost record, the reserved slot is simply not committed
+        return;
+    }
+
+    ApplyPublishPolicy(pSlot, g_PublishPolicy[ucTopicId].pcTopic);
+    pSlot->usLen = iLen;
+
+    osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+    PubQueue_Commit(&g_PubOutQueue);
+    osi_LockObjUnlock(&g_PubOutLock);
+    osi_SyncObjSignal(&g_PubOutSync);
+}
+
+//****************************************************************************
+//
+//! Tops up the publish queue with the messages of a running benchmark. Only
+//! free slots are taken, so a benchmark does not count as queue overflow.
+//! Every message starts with its sequence number, most significant byte
+//! first, for the receiver to detect losses and reordering.
+//!
+//! \return none
+//
+//****************************************************************************
+static void PubBenchFill(void)
+{
+    PubQueueSlot_t *pSlot;
+    unsigned long ulElapsedMs = 0;
+    unsigned long ulCount = 0;
+    unsigned int uiQueued = 0;
+
+    osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+    while(g_PubBench.ulLeft > 0 &&
+          PubQueue_Count(&g_PubOutQueue) < PUBQ_NUM_SLOTS)
+    {
+        pSlot = PubQueue_Reserve(&g_PubOutQueue);
+        ApplyPublishPolicy(pSlot, PUB_TOPIC_BENCH);
+        pSlot->ucQos = g_PubBench.ucQos;
+        pSlot->usLen = g_PubBench.usLen;
+        pSlot->ucData[0] = (unsigned char)(g_PubBench.ulSeq >> 24);
+        pSlot->ucData[1] = (unsigned char)(g_PubBench.ulSeq >> 16);
+        pSlot->ucData[2] = (unsigned char)(g_PubBench.ulSeq >> 8);
+        pSlot->ucData[3] = (unsigned char)g_PubBench.ulSeq;
+        memset(&pSlot->ucData[PUB_BENCH_MIN_LEN], 'b',
+               pSlot->usLen - PUB_BENCH_MIN_LEN);
+        PubQueue_Commit(&g_PubOutQueue);
+
+        g_PubBench.ulSeq++;
+        g_PubBench.ulLeft--;
+        uiQueued++;
+        if(g_PubBench.ulLeft == 0)
+        {
+            ulCount = g_PubBench.ulSeq;
+            ulElapsedMs = GetTimeMs() - g_PubBench.ulStartMs;
+        }
+    }
+    osi_LockObjUnlock(&g_PubOutLock);
+
+    if(uiQueued > 0)
+    {
+        osi_SyncObjSignal(&g_PubOutSync);
+    }
+    if(ulCount > 0)
+    {
+        LOG_INFO("Bench: %lu messages queued in %lu ms\n\r", ulCount,
+                 ulElapsedMs);
+    }
+}
+
+#if SFWD_USE_FLASH
+//****************************************************************************
+//
+//! Builds the serial flash file name of a store-and-forward segment
+//
+//****************************************************************************
+static void StoreFwd_FileName(unsigned int uiSegment, unsigned char *pucName)
+{
+    memcpy(pucName, SFWD_FILE_NAME, sizeof(SFWD_FILE_NAME));
+    pucName[SFWD_FILE_DIGIT] = '0' + uiSegment % SFWD_MAX_SEGMENTS;
+}
+
+//****************************************************************************
+//
+//! Opens a store-and-forward segment file, creating it for writing
+//!
+//! \param uiSegment is the segment number
+//! \param bWrite selects create-and-write or read access
+//!
+//! \return file handle, or a negative value on error
+//
+//****************************************************************************
+static long StoreFwd_FlashOpen(unsigned int uiSegment, bool bWrite)
+{
+    unsigned char ucName[sizeof(SFWD_FILE_NAME)];
+    unsigned long ulToken = 0;
+    long lFileHandle;
+    long lRetVal;
+
+    StoreFwd_FileName(uiSegment, ucName);
+    lRetVal = sl_FsOpen(ucName,
+                        bWrite ? FS_MODE_OPEN_CREATE(SFWD_SEGMENT_LEN, 0) :
+                                 FS_MODE_OPEN_READ,
+                        &ulToken, &lFileHandle);
+    return (lRetVal < 0) ? lRetVal : lFileHandle;
+}
+
+//****************************************************************************
+//
+//! Remaining store-and-forward flash operations, thin wrappers of the
+//! SimpleLink file system calls
+//
+//****************************************************************************
+static long StoreFwd_FlashWrite(long lHandle, unsigned long ulOffset,
+                                const unsigned char *pucData,
+                                unsigned long ulLen)
+{
+    return sl_FsWrite(lHandle, ulOffset, (unsigned char *)pucData, ulLen);
+}
+
+static long StoreFwd_FlashRead(long lHandle, unsigned long ulOffset,
+                               unsigned char *pucData, unsigned long ulLen)
+{
+    return sl_FsRead(lHandle, ulOffset, pucData, ulLen);
+}
+
+static void StoreFwd_FlashClose(long lHandle)
+{
+    sl_FsClose(lHandle, NULL, NULL, 0);
+}
+
+static void StoreFwd_FlashErase(unsigned int uiSegment)
+{
+    unsigned char ucName[sizeof(SFWD_FILE_NAME)];
+
+    StoreFwd_FileName(uiSegment, ucName);
+    sl_FsDel(ucName, 0);
+}
+#endif
+
+//*****************************************************************************
+//
+//! Periodic Timer Interrupt Handler
+//!
+//! \param None
+//!
+//! \return None
+//
+//*****************************************************************************
+void
+TimerPeriodicIntHandler(void)
+{
+    unsigned long ulInts;
+
+    //
+    // Clear all pending interrupts from the timer we are
+    // currently using.
+    //
+    ulInts = MAP_TimerIntStatus(TIMERA0_BASE, true);
+    MAP_TimerIntClear(TIMERA0_BASE, ulInts);
+
+    //
+    // Increment our interrupt counter.
+    //
+    g_usTimerInts++;
+    if(g_ucLedMode == LED_MODE_IP_ACQUIRED)
+    {
+        //
+        // End of the IP acquired indication
+        //
+        if(g_usTimerInts >= LED_IP_IND_MS / LED_TIMER_PERIOD_MS)
+        {
+            LedTimerDeinitStop();
+            LedRestoreCoils();
+        }
+    }
+    else if(!(g_usTimerInts & 0x1))
+    {
+        //
+        // Off Led
+        //
+        GPIO_IF_LedOff(MCU_RED_LED_GPIO);
+    }
+    else
+    {
+        //
+        // On Led
+        //
+        GPIO_IF_LedOn(MCU_RED_LED_GPIO);
+    }
+}
+
+//****************************************************************************
+//
+//! Looks for the Wi-Fi profile of SSID_NAME among the stored ones
+//!
+//! \param none
+//!
+//! \return the index of the profile, or -1 if there is none
+//
+//****************************************************************************
+static short WlanProfileFind(void)
+{
+    signed char cName[32];
+    unsigned char ucMac[6];
+    SlSecParams_t sSecParams;
+    unsigned long ulPriority;
+    short sNameLen;
+    short sIndex;
+
+    for(sIndex = 0; sIndex < WLAN_MAX_PROFILES; sIndex++)
+    {
+        if(sl_WlanProfileGet(sIndex, cName, &sNameLen, ucMac, &sSecParams,
+                             NULL, &ulPriority) >= 0 &&
+           sNameLen == strlen(SSID_NAME) &&
+           memcmp(cName, SSID_NAME, sNameLen) == 0)
+        {
+            return sIndex;
+        }
+    }
+    return -1;
+}
+
+//****************************************************************************
+//
+//! Connects to the AP. With a stored profile the NWP is given
+//! WLAN_FAST_CONNECT_MS to rejoin by itself; otherwise, or if it did not,
+//! the AP is scanned for and joined explicitly.
+//!
+//! \param none
+//!
+//! \return 0 once an IP address is acquired, negative on failure
+//
+//****************************************************************************
+static long WlanConnect(void)
+{
+    unsigned long ulStart = GetTimeMs();
+    long lRetVal = 0;
+
+    g_WlanStats.sProfileIndex = WlanProfileFind();
+    g_WlanStats.bProfileStored = (g_WlanStats.sProfileIndex >= 0);
+    g_WlanStats.bFastConnect = false;
+    if(g_WlanStats.bProfileStored)
+    {
+        while(GetTimeMs() - ulStart < WLAN_FAST_CONNECT_MS)
+        {
+            if(IS_CONNECTED(g_ulStatus) && IS_IP_ACQUIRED(g_ulStatus))
+            {
+                g_WlanStats.bFastConnect = true;
+                break;
+            }
+            osi_Sleep(10);
+        }
+    }
+
+    if(!g_WlanStats.bFastConnect)
+    {
+        lRetVal = Network_IF_ConnectAP(SSID_NAME, SecurityParams);
+    }
+
+    g_WlanStats.ulConnectMs = GetTimeMs() - ulStart;
+    LOG_INFO("AP %s connect in %lu ms (profile %s)\n\r",
+             g_WlanStats.bFastConnect ? "fast" : "full",
+             g_WlanStats.ulConnectMs,
+             g_WlanStats.bProfileStored ? "stored" : "missing");
+    return lRetVal;
+}
+
+//****************************************************************************
+//
+//! Stores the profile and sets the auto + fast connection policy after a
+//! full connect, so the next boot can take the fast path. A stored profile
+//! of SSID_NAME that did not get the device connected is replaced, e.g.
+//! after the key changed; profiles of other networks, provisioned outside
+//! this firmware, are kept. Nothing is written when the fast path was
+//! taken.
+//!
+//! \param none
+//!
+//! \return none
+//
+//****************************************************************************
+static void WlanSaveProfile(void)
+{
+    if(g_WlanStats.bFastConnect)
+    {
+        return;
+    }
+
+    if(g_WlanStats.bProfileStored)
+    {
+        sl_WlanProfileDel(g_WlanStats.sProfileIndex);
+    }
+    sl_WlanProfileAdd(SSID_NAME,strlen(SSID_NAME),0,&SecurityParams,0,1,0);
+
+    //set AUTO and FAST policy
+    sl_WlanPolicySet(SL_POLICY_CONNECTION, SL_CONNECTION_POLICY(1,1,0,0,0),
+                     NULL, 0);
+}
+
+//****************************************************************************
+//
+//! Function to configure and start timer to blink the LED while device is
+//! trying to connect to an AP
+//!
+//! \param none
+//!
+//! return none
+//
+//****************************************************************************
+void LedTimerConfigNStart()
+{
+    //
+    // Configure Timer for blinking the LED for IP acquisition
+    //
+    Timer_IF_Init(PRCM_TIMERA0,TIMERA0_BASE,TIMER_CFG_PERIODIC,TIMER_A,0);
+    Timer_IF_IntSetup(TIMERA0_BASE,TIMER_A,TimerPeriodicIntHandler);
+    Timer_IF_Start(TIMERA0_BASE,TIMER_A,LED_TIMER_PERIOD_MS);
+}
+
+//****************************************************************************
+//
+//! Switches the LED timer from blinking to the IP acquired indication: the
+//! red LED stays lit for LED_IP_IND_MS, then the timer stops itself and
+//! puts the LEDs back to the coil state
+//!
+//! \param none
+//!
+//! return none
+//
+//****************************************************************************
+static void LedIndicateIpAcquired(void)
+{
+    g_bLedIndication = true;
+    GPIO_IF_LedOn(MCU_IP_ALLOC_IND);
+    g_usTimerInts = 0;
+    g_ucLedMode = LED_MODE_IP_ACQUIRED;
+}
+
+//****************************************************************************
+//
+//! Disable the LED blinking Timer as Device is connected to AP
+//!
+//! \param none
+//!
+//! return none
+//
+//****************************************************************************
+void LedTimerDeinitStop()
+{
+    //
+    // Disable the LED blinking Timer as Device is connected to AP
+    //
+    Timer_IF_Stop(TIMERA0_BASE,TIMER_A);
+    Timer_IF_DeInit(TIMERA0_BASE,TIMER_A);
+
+}
+
+//****************************************************************************
+//
+//! Ends the status indication: hands the LEDs back to the coils and drives
+//! each one to the state last written by Modbus or MQTT
+//!
+//! \param none
+//!
+//! return none
+//
+//****************************************************************************
+static void LedRestoreCoils(void)
+{
+    unsigned short usCoil;
+
+    g_bLedIndication = false;
+    for(usCoil = 0; usCoil < MB_NUM_COILS; usCoil++)
+    {
+        if(g_ucCoilState[usCoil])
+        {
+            GPIO_IF_LedOn(g_ucCoilGpio[usCoil]);
+        }
+        else
+        {
+            GPIO_IF_LedOff(g_ucCoilGpio[usCoil]);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! Board Initialization & Configuration
+//!
+//! \param  None
+//!
+//! \return None
+//
+//*****************************************************************************
+void BoardInit(void)
+{
+    /* In case of TI-RTOS vector table is initialize by OS itself */
+    #ifndef USE_TIRTOS
+    //
+    // Set vector table base
+    //
+    #if defined(ccs)
+        IntVTableBaseSet((unsigned long)&g_pfnVectors[0]);
+    #endif
+    #if defined(ewarm)
+        IntVTableBaseSet((unsigned long)&__vector_table);
+    #endif
+    #endif
+    //
+    // Enable Processor
+    //
+    MAP_IntMasterEnable();
+    MAP_IntEnable(FAULT_SYSTICK);
+
+    PRCMCC3200MCUInit();
+}
+
+//*****************************************************************************
+//
+//! Application startup display on UART
+//!
+//! \param  none
+//!
+//! \return none
+//!
+//*****************************************************************************
+static void
+DisplayBanner(char * AppName)
+{
+
+    UART_PRINT("\n\n\n\r");
+    UART_PRINT("\t\t *************************************************\n\r");
+    UART_PRINT("\t\t    CC3200 %s Application       \n\r", AppName);
+    UART_PRINT("\t\t *************************************************\n\r");
+    UART_PRINT("\n\n\n\r");
+}
+
+//*****************************************************************************
+//
+//! Closes a client connection and returns its frame to the pool
+//!
+//! \param pConn is the client connection
+//!
+//! \return none
+//
+//*****************************************************************************
+static void
+ModbusCloseClient(modbus_conn *pConn)
+{
+    sl_Close(pConn->iSockID);
+    pConn->iSockID = -1;
+    pConn->iRxLen = 0;
+    MemPool_Free(pConn->pucRx);
+    pConn->pucRx = NULL;
+}
+
+//*****************************************************************************
+//
+//! Accepts a pending connection on the Modbus listening socket. When all
+//! client slots are in use the least recently active connection is closed
+//! to make room, but only once it has been idle for MB_CLIENT_IDLE_MS, so
+//! sockets of masters that vanished without a FIN are recycled while busy
+//! masters keep their connections. Otherwise the new one is refused.
+//!
+//! \param iListenSockID is the listening socket
+//! \param pConn is the client connection table
+//! \param ulNowMs is the current time in ms
+//!
+//! \return none
+//
+//*****************************************************************************
+static void
+ModbusAcceptClient(int iListenSockID, modbus_conn *pConn,
+                   unsigned long ulNowMs)
+{
+    SlSockAddrIn_t  sAddr;
+    SlSocklen_t     iAddrSize = sizeof(SlSockAddrIn_t);
+    long            lNonBlocking = 1;
+    int             iNewSockID;
+    int             iSlot = -1;
+    int             iIndex;
+
+    iNewSockID = sl_Accept(iListenSockID, (SlSockAddr_t *)&sAddr, &iAddrSize);
+    if( iNewSockID < 0 )
+    {
+        // SL_EAGAIN or a transient error, the listener stays up
+        return;
+    }
+
+    for(iIndex = 0; iIndex < MB_MAX_CLIENTS; iIndex++)
+    {
+        if(pConn[iIndex].iSockID < 0)
+        {
+            iSlot = iIndex;
+            break;
+        }
+        if(iSlot < 0 || ulNowMs - pConn[iIndex].ulLastActive >
+                        ulNowMs - pConn[iSlot].ulLastActive)
+        {
+            iSlot = iIndex;
+        }
+    }
+    if(pConn[iSlot].iSockID >= 0)
+    {
+        if(ulNowMs - pConn[iSlot].ulLastActive < MB_CLIENT_IDLE_MS)
+        {
+            LOG_WARN("Modbus: all %d clients busy, connection refused\n\r",
+                     MB_MAX_CLIENTS);
+            sl_Close(iNewSockID);
+            return;
+        }
+        LOG_WARN("Modbus: dropping client %d, idle for %lu ms\n\r",
+                 pConn[iSlot].iSockID, ulNowMs - pConn[iSlot].ulLastActive);
+        ModbusCloseClient(&pConn[iSlot]);
+    }
+
+    pConn[iSlot].pucRx = MemPool_Alloc(MB_CONN_RX_LEN);
+    if(pConn[iSlot].pucRx == NULL)
+    {
+        sl_Close(iNewSockID);
+        return;
+    }
+
+    sl_SetSockOpt(iNewSockID, SL_SOL_SOCKET, SL_SO_NONBLOCKING,
+                  &lNonBlocking, sizeof(lNonBlocking));
+    pConn[iSlot].iSockID = iNewSockID;
+    pConn[iSlot].ulLastActive = ulNowMs;
+    pConn[iSlot].iRxLen = 0;
+}
+
+//*****************************************************************************
+//
+//! Sends a coalesced response, retrying while the socket is full
+//!
+//! \param iSockID is the client socket
+//! \param pucBuf is the data to send
+//! \param iLen is the number of bytes to send
+//!
+//! \return 0 on success, SEND_ERROR otherwise
+//
+//*****************************************************************************
+static int
+ModbusSend(int iSockID, const unsigned char *pucBuf, int iLen)
+{
+    int iStatus;
+    int iRetry = 0;
+
+    while(iLen > 0)
+    {
+        iStatus = sl_Send(iSockID, pucBuf, iLen, 0);
+        if( iStatus == SL_EAGAIN && iRetry++ < MB_SEND_RETRIES )
+        {
+            osi_Sleep(1);
+            continue;
+        }
+        if( iStatus <= 0 )
+        {
+            return SEND_ERROR;
+        }
+        pucBuf += iStatus;
+        iLen -= iStatus;
+    }
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Serves a client connection that select reported readable
+//!
+//! \param pConn is the client connection
+//!
+//! Appends the received bytes to the connection's reassembly buffer, so a
+//! request split over several segments is completed across calls, then
+//! answers every complete request in the buffer. Responses to pipelined
+//! requests are coalesced into a single send.
+//!
+//! \return 0 on success, negative if the connection has to be closed
+//
+//*****************************************************************************
+static int
+ModbusServeClient(modbus_conn *pConn)
+{
+    unsigned long ulStart;
+    int iStatus;
+    int iTxLen;
+
+    iStatus = sl_Recv(pConn->iSockID, &pConn->pucRx[pConn->iRxLen],
+                      MB_CONN_RX_LEN - pConn->iRxLen, 0);
+    if( iStatus == SL_EAGAIN )
+    {
+        return 0;
+    }
+    if( iStatus <= 0 )
+    {
+        // peer closed the connection or the socket failed
+        return RECV_ERROR;
+    }
+    pConn->iRxLen += iStatus;
+    ulStart = Latency_Stamp();
+
+    //
+    // Answer all complete requests; loops only when the responses did not
+    // fit in one transmit buffer
+    //
+    do
+    {
+        iTxLen = Modbus_ProcessStream(&g_ModbusDataMap, pConn->pucRx,
+                                      &pConn->iRxLen, g_ucModbusTx,
+                                      sizeof(g_ucModbusTx));
+        if( iTxLen < 0 )
+        {
+            // stream out of sync
+            return RECV_ERROR;
+        }
+        if( iTxLen > 0 )
+        {
+            if( ModbusSend(pConn->iSockID, g_ucModbusTx, iTxLen) < 0 )
+            {
+                return SEND_ERROR;
+            }
+            Latency_Record(&g_LatHist[LAT_MODBUS_RSP], ulStart);
+        }
+    } while( iTxLen > 0 );
+
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Opens the Modbus TCP listening socket on port 502
+//!
+//! \param  none
+//!
+//! \return the listening socket, or a negative error code
+//
+//*****************************************************************************
+static int ModbusListen(void)
+{
+    SlSockAddrIn_t  sLocalAddr;
+    int             iAddrSize;
+    int             iSockID;
+    int             iStatus;
+    long            lNonBlocking = 1;
+    unsigned short usPort = MB_TCP_PORT;
+
+    //filling the TCP server socket address
+    sLocalAddr.sin_family = SL_AF_INET;
+    sLocalAddr.sin_port = sl_Htons((unsigned short)usPort);
+    sLocalAddr.sin_addr.s_addr = 0;
+
+    // creating a TCP socket
+    iSockID = sl_Socket(SL_AF_INET,SL_SOCK_STREAM, 0);
+    if( iSockID < 0 )
+    {
+        // error
+        ASSERT_ON_ERROR(SOCKET_CREATE_ERROR);
+    }
+
+    iAddrSize = sizeof(SlSockAddrIn_t);
+
+    // binding the TCP socket to the TCP server address
+    iStatus = sl_Bind(iSockID, (SlSockAddr_t *)&sLocalAddr, iAddrSize);
+    if( iStatus < 0 )
+    {
+        // error
+        sl_Close(iSockID);
+        ASSERT_ON_ERROR(BIND_ERROR);
+    }
+
+    // putting the socket for listening to the incoming TCP connection
+    iStatus = sl_Listen(iSockID, MB_MAX_CLIENTS);
+    if( iStatus < 0 )
+    {
+        sl_Close(iSockID);
+        ASSERT_ON_ERROR(LISTEN_ERROR);
+    }
+
+    // non blocking, so a connection that was reset between select and
+    // accept cannot stall the loop
+    iStatus = sl_SetSockOpt(iSockID, SL_SOL_SOCKET, SL_SO_NONBLOCKING,
+                            &lNonBlocking, sizeof(lNonBlocking));
+    if( iStatus < 0 )
+    {
+        sl_Close(iSockID);
+        ASSERT_ON_ERROR(SOCKET_OPT_ERROR);
+    }
+    LOG_INFO("\r\nModbus listening after %lu ms\r\n", GetTimeMs());
+
+    return iSockID;
+}
+
+//*****************************************************************************
+//
+//! Serves the Modbus TCP server for up to ulTimeoutMs
+//!
+//! \param ulTimeoutMs is the longest time to wait for socket activity
+//!
+//! Serves up to MB_MAX_CLIENTS masters from a single sl_Select. A failing
+//! client connection is closed and its slot reused; the listener itself is
+//! never torn down. The link test socket shares the select.
+//!
+//! \return None
+//
+//*****************************************************************************
+static void ModbusPoll(unsigned long ulTimeoutMs)
+{
+    SlFdSet_t       sReadSet;
+    SlTimeval_t     sTimeout;
+    int             iStatus;
+    int             iMaxSockID;
+    int             iIndex;
+    unsigned long   ulNowMs;
+    modbus_conn     *sConn = g_ModbusConn;
+
+    if(g_iModbusListenSock < 0)
+    {
+        osi_Sleep(ulTimeoutMs);
+        return;
+    }
+
+    //
+    // Wait until the listener or any of the clients is readable
+    //
+    SL_FD_ZERO(&sReadSet);
+    SL_FD_SET(g_iModbusListenSock, &sReadSet);
+    iMaxSockID = g_iModbusListenSock;
+    for(iIndex = 0; iIndex < MB_MAX_CLIENTS; iIndex++)
+    {
+        if(sConn[iIndex].iSockID >= 0)
+        {
+            SL_FD_SET(sConn[iIndex].iSockID, &sReadSet);
+            if(sConn[iIndex].iSockID > iMaxSockID)
+            {
+                iMaxSockID = sConn[iIndex].iSockID;
+            }
+        }
+    }
+    iMaxSockID = LoopTestFdSet(&sReadSet, iMaxSockID);
+
+    sTimeout.tv_sec = 0;
+    sTimeout.tv_usec = ulTimeoutMs * 1000;
+    iStatus = sl_Select(iMaxSockID + 1, &sReadSet, NULL, NULL, &sTimeout);
+    if( iStatus <= 0 )
+    {
+        if( iStatus < 0 )
+        {
+            osi_Sleep(ulTimeoutMs);
+        }
+        return;
+    }
+    ulNowMs = GetTimeMs();
+
+    for(iIndex = 0; iIndex < MB_MAX_CLIENTS; iIndex++)
+    {
+        if(sConn[iIndex].iSockID < 0 ||
+           !SL_FD_ISSET(sConn[iIndex].iSockID, &sReadSet))
+        {
+            continue;
+        }
+        sConn[iIndex].ulLastActive = ulNowMs;
+        if(ModbusServeClient(&sConn[iIndex]) < 0)
+        {
+            ModbusCloseClient(&sConn[iIndex]);
+        }
+    }
+
+    if(SL_FD_ISSET(g_iModbusListenSock, &sReadSet))
+    {
+        ModbusAcceptClient(g_iModbusListenSock, sConn, ulNowMs);
+    }
+    LoopTestServe(&sReadSet);
+}
+
+//*****************************************************************************
+//
+//! Connection state subscriber of the Modbus server: listens once the
+//! network is up and drops the client connections when it goes down
+//
+//*****************************************************************************
+static void ModbusNetEvent(net_event eEvent)
+{
+    int iIndex;
+
+    if(eEvent == NET_EVENT_UP)
+    {
+        if(g_iModbusListenSock < 0)
+        {
+            g_iModbusListenSock = ModbusListen();
+        }
+        return;
+    }
+
+    for(iIndex = 0; iIndex < MB_MAX_CLIENTS; iIndex++)
+    {
+        if(g_ModbusConn[iIndex].iSockID >= 0)
+        {
+            ModbusCloseClient(&g_ModbusConn[iIndex]);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! Starts the link test service, off until a mode is requested. It runs on
+//! the network manager task, see LoopServicePoll.
+//!
+//! \param  none
+//!
+//! \return None
+//
+//*****************************************************************************
+static void LoopServiceStart(void)
+{
+    LoopTest_Start(&g_LoopTest, LOOP_MODE_OFF, LOOP_PROTO_TCP, GetTimeMs());
+    NetEventSubscribe(LoopNetEvent);
+}
+
+//*****************************************************************************
+//
+//! Connection state subscriber of the link test: closes its sockets when the
+//! network goes down, LoopServicePoll opens them again once it is back
+//
+//*****************************************************************************
+static void LoopNetEvent(net_event eEvent)
+{
+    if(eEvent != NET_EVENT_UP)
+    {
+        LoopTestClose();
+    }
+}
+
+//*****************************************************************************
+//
+//! Hands a mode request of the .../cmd/loop command to LoopServicePoll
+//!
+//! \param pcArgs points to the request, not NUL terminated
+//! \param lArgsLen is its length
+//!
+//! \return none
+//
+//*****************************************************************************
+static void LoopTestRequest(const char *pcArgs, long lArgsLen)
+{
+    unsigned char ucMode;
+    unsigned char ucProto;
+
+    if(LoopTest_Parse(pcArgs, lArgsLen, &ucMode, &ucProto) < 0)
+    {
+        LOG_WARN("Loop test: invalid request\n\r");
+        return;
+    }
+    g_ucLoopRequest = (ucProto << 4) | ucMode;
+}
+
+//*****************************************************************************
+//
+//! Logs the totals of a link test session, if it carried any traffic
+//
+//*****************************************************************************
+static void LoopTestSummary(void)
+{
+    LoopCounters_t *pTotal = &g_LoopTest.Session;
+
+    if(pTotal->ulRxPackets == 0 && pTotal->ulTxPackets == 0)
+    {
+        return;
+    }
+    LOG_INFO("Loop test done: rx %lu bytes in %lu packets, tx %lu bytes in "
+             "%lu packets, %lu errors, %lu ms\n\r", pTotal->ulRxBytes,
+             pTotal->ulRxPackets, pTotal->ulTxBytes, pTotal->ulTxPackets,
+             pTotal->ulErrors, GetTimeMs() - g_LoopTest.ulStartMs);
+}
+
+//*****************************************************************************
+//
+//! Ends the session of a TCP client; the listener is opened again by the
+//! next LoopTestOpen
+//
+//*****************************************************************************
+static void LoopTestEndClient(void)
+{
+    LoopTestSummary();
+    sl_Close(g_iLoopSock);
+    g_iLoopSock = -1;
+    LoopTest_Start(&g_LoopTest, g_LoopTest.ucMode, g_LoopTest.ucProto,
+                   GetTimeMs());
+}
+
+//*****************************************************************************
+//
+//! Closes the sockets of the link test
+//
+//*****************************************************************************
+static void LoopTestClose(void)
+{
+    if(g_iLoopSock >= 0)
+    {
+        LoopTestSummary();
+        sl_Close(g_iLoopSock);
+        g_iLoopSock = -1;
+    }
+    if(g_iLoopListenSock >= 0)
+    {
+        sl_Close(g_iLoopListenSock);
+        g_iLoopListenSock = -1;
+    }
+    g_bLoopPeer = false;
+}
+
+//*****************************************************************************
+//
+//! Opens the socket the current mode waits on: the TCP listener while no
+//! client is served, or the UDP socket
+//!
+//! \return 0, or a negative error code
+//
+//*****************************************************************************
+static int LoopTestOpen(void)
+{
+    SlSockAddrIn_t  sLocalAddr;
+    long            lNonBlocking = 1;
+    int             iSockID;
+    int             iStatus;
+    bool            bUdp = (g_LoopTest.ucProto == LOOP_PROTO_UDP);
+
+    if(g_iLoopSock >= 0 || g_iLoopListenSock >= 0)
+    {
+        return 0;
+    }
+
+    sLocalAddr.sin_family = SL_AF_INET;
+    sLocalAddr.sin_port = sl_Htons(LOOPBACK_PORT);
+    sLocalAddr.sin_addr.s_addr = 0;
+
+    iSockID = sl_Socket(SL_AF_INET, bUdp ? SL_SOCK_DGRAM : SL_SOCK_STREAM, 0);
+    if( iSockID < 0 )
+    {
+        ASSERT_ON_ERROR(SOCKET_CREATE_ERROR);
+    }
+    iStatus = sl_Bind(iSockID, (SlSockAddr_t *)&sLocalAddr,
+                      sizeof(SlSockAddrIn_t));
+    if( iStatus < 0 )
+    {
+        sl_Close(iSockID);
+        ASSERT_ON_ERROR(BIND_ERROR);
+    }
+    if( !bUdp && sl_Listen(iSockID, 1) < 0 )
+    {
+        sl_Close(iSockID);
+        ASSERT_ON_ERROR(LISTEN_ERROR);
+    }
+    iStatus = sl_SetSockOpt(iSockID, SL_SOL_SOCKET, SL_SO_NONBLOCKING,
+                            &lNonBlocking, sizeof(lNonBlocking));
+    if( iStatus < 0 )
+    {
+        sl_Close(iSockID);
+        ASSERT_ON_ERROR(SOCKET_OPT_ERROR);
+    }
+
+    if(bUdp)
+    {
+        g_iLoopSock = iSockID;
+    }
+    else
+    {
+        g_iLoopListenSock = iSockID;
+    }
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Accepts the client of a TCP test and closes the listener
+//
+//*****************************************************************************
+static void LoopTestAccept(void)
+{
+    SlSockAddrIn_t  sAddr;
+    SlSocklen_t     iAddrSize = sizeof(SlSockAddrIn_t);
+    long            lNonBlocking = 1;
+    int             iNewSockID;
+
+    iNewSockID = sl_Accept(g_iLoopListenSock, (SlSockAddr_t *)&sAddr,
+                           &iAddrSize);
+    if( iNewSockID < 0 )
+    {
+        return;
+    }
+    sl_SetSockOpt(iNewSockID, SL_SOL_SOCKET, SL_SO_NONBLOCKING,
+                  &lNonBlocking, sizeof(lNonBlocking));
+    sl_Close(g_iLoopListenSock);
+    g_iLoopListenSock = -1;
+    g_iLoopSock = iNewSockID;
+    LoopTest_Start(&g_LoopTest, g_LoopTest.ucMode, g_LoopTest.ucProto,
+                   GetTimeMs());
+    LOG_INFO("Loop test: client connected\n\r");
+}
+
+//*****************************************************************************
+//
+//! Reads a packet of the test socket and, in echo mode, sends it back
+//
+//*****************************************************************************
+static void LoopTestReceive(void)
+{
+    SlSocklen_t     iAddrSize = sizeof(SlSockAddrIn_t);
+    unsigned long   ulStamp;
+    int             iLen;
+
+    if(g_LoopTest.ucProto == LOOP_PROTO_UDP)
+    {
+        iLen = sl_RecvFrom(g_iLoopSock, g_ucLoopBuf, LOOP_BUF_LEN, 0,
+                           (SlSockAddr_t *)&g_LoopPeer, &iAddrSize);
+        if( iLen < 0 )
+        {
+            if( iLen != SL_EAGAIN )
+            {
+                LoopTest_CountError(&g_LoopTest);
+            }
+            return;
+        }
+        ulStamp = Latency_Stamp();
+        g_bLoopPeer = true;
+        g_ulLoopPeerMs = GetTimeMs();
+        LoopTest_CountRx(&g_LoopTest, iLen);
+        if(g_LoopTest.ucMode != LOOP_MODE_ECHO)
+        {
+            return;
+        }
+        if(sl_SendTo(g_iLoopSock, g_ucLoopBuf, iLen, 0,
+                     (SlSockAddr_t *)&g_LoopPeer, iAddrSize) != iLen)
+        {
+            LoopTest_CountError(&g_LoopTest);
+            return;
+        }
+    }
+    else
+    {
+        iLen = sl_Recv(g_iLoopSock, g_ucLoopBuf, LOOP_BUF_LEN, 0);
+        if( iLen == SL_EAGAIN )
+        {
+            return;
+        }
+        if( iLen <= 0 )
+        {
+            // peer closed the connection or the socket failed
+            LoopTestEndClient();
+            return;
+        }
+        ulStamp = Latency_Stamp();
+        LoopTest_CountRx(&g_LoopTest, iLen);
+        if(g_LoopTest.ucMode != LOOP_MODE_ECHO)
+        {
+            return;
+        }
+        if(ModbusSend(g_iLoopSock, g_ucLoopBuf, iLen) < 0)
+        {
+            LoopTest_CountError(&g_LoopTest);
+            LoopTestEndClient();
+            return;
+        }
+    }
+    LoopTest_CountTx(&g_LoopTest, iLen);
+    Latency_Record(&g_LoopTest.Turnaround, ulStamp);
+}
+
+//*****************************************************************************
+//
+//! Sends one packet in source mode. UDP datagrams start with their sequence
+//! number, most significant byte first, for the receiver to count losses.
+//!
+//! \return 0 if the packet was sent, -1 if the stack is out of buffers or
+//!         the send failed
+//
+//*****************************************************************************
+static int LoopTestSend(void)
 {
-    //
-    // Disable the LED blinking Timer as Device is connected to AP
-    //
-    Timer_IF_Stop(TIMERA0_BASE,TIMER_A);
-    Timer_IF_DeInit(TIMERA0_BASE,TIMER_A);
+    unsigned long ulSeq = g_LoopTest.Session.ulTxPackets;
+    int iStatus;
+
+    if(g_LoopTest.ucProto == LOOP_PROTO_UDP)
+    {
+        g_ucLoopBuf[0] = (unsigned char)(ulSeq >> 24);
+        g_ucLoopBuf[1] = (unsigned char)(ulSeq >> 16);
+        g_ucLoopBuf[2] = (unsigned char)(ulSeq >> 8);
+        g_ucLoopBuf[3] = (unsigned char)ulSeq;
+        iStatus = sl_SendTo(g_iLoopSock, g_ucLoopBuf, LOOP_UDP_LEN, 0,
+                            (SlSockAddr_t *)&g_LoopPeer,
+                            sizeof(SlSockAddrIn_t));
+    }
+    else
+    {
+        iStatus = sl_Send(g_iLoopSock, g_ucLoopBuf, LOOP_BUF_LEN, 0);
+    }
 
+    if( iStatus == SL_EAGAIN )
+    {
+        // the stack is out of buffers, the next pass goes on
+        return -1;
+    }
+    if( iStatus <= 0 )
+    {
+        // a TCP client ends the test by closing the connection
+        if(g_LoopTest.ucProto == LOOP_PROTO_TCP)
+        {
+            LoopTestEndClient();
+        }
+        else
+        {
+            LoopTest_CountError(&g_LoopTest);
+        }
+        return -1;
+    }
+    LoopTest_CountTx(&g_LoopTest, iStatus);
+    return 0;
 }
 
 //*****************************************************************************
 //
-//! Board Initialization & Configuration
+//! Adds the open link test sockets to the read set of ModbusPoll
 //!
-//! \param  None
+//! \param pReadSet is the read set
+//! \param iMaxSockID is the highest socket id in the set so far
 //!
-//! \return None
+//! \return the highest socket id in the set
 //
 //*****************************************************************************
-void BoardInit(void)
+static int LoopTestFdSet(SlFdSet_t *pReadSet, int iMaxSockID)
 {
-    /* In case of TI-RTOS vector table is initialize by OS itself */
-    #ifndef USE_TIRTOS
-    //
-    // Set vector table base
-    //
-    #if defined(ccs)
-        IntVTableBaseSet((unsigned long)&g_pfnVectors[0]);
-    #endif
-    #if defined(ewarm)
-        IntVTableBaseSet((unsigned long)&__vector_table);
-    #endif
-    #endif
-    //
-    // Enable Processor
-    //
-    MAP_IntMasterEnable();
-    MAP_IntEnable(FAULT_SYSTICK);
+    if(g_iLoopListenSock >= 0)
+    {
+        SL_FD_SET(g_iLoopListenSock, pReadSet);
+        if(g_iLoopListenSock > iMaxSockID)
+        {
+            iMaxSockID = g_iLoopListenSock;
+        }
+    }
+    if(g_iLoopSock >= 0)
+    {
+        SL_FD_SET(g_iLoopSock, pReadSet);
+        if(g_iLoopSock > iMaxSockID)
+        {
+            iMaxSockID = g_iLoopSock;
+        }
+    }
+    return iMaxSockID;
+}
 
-    PRCMCC3200MCUInit();
+//*****************************************************************************
+//
+//! Serves the link test sockets ModbusPoll found readable
+//!
+//! \param pReadSet is the read set returned by sl_Select
+//!
+//! \return none
+//
+//*****************************************************************************
+static void LoopTestServe(SlFdSet_t *pReadSet)
+{
+    if(g_iLoopSock >= 0 && SL_FD_ISSET(g_iLoopSock, pReadSet))
+    {
+        LoopTestReceive();
+    }
+    if(g_iLoopListenSock >= 0 && SL_FD_ISSET(g_iLoopListenSock, pReadSet))
+    {
+        LoopTestAccept();
+    }
 }
 
 //*****************************************************************************
 //
-//! Application startup display on UART
+//! Runs the link test service on LOOPBACK_PORT once per network manager
+//! pass: takes over a requested mode, opens the socket the mode waits on
+//! and logs the rates every LOOP_REPORT_MS. Received packets are served by
+//! ModbusPoll. In source mode up to LOOP_SOURCE_BURST packets are sent per
+//! pass, fewer once the stack runs out of buffers.
 //!
 //! \param  none
 //!
 //! \return none
-//!
+//
 //*****************************************************************************
-static void
-DisplayBanner(char * AppName)
+static void LoopServicePoll(void)
 {
+    LoopReport_t    sReport;
+    unsigned char   ucRequest;
+    bool            bSource;
+    int             iCount;
 
-    UART_PRINT("\n\n\n\r");
-    UART_PRINT("\t\t *************************************************\n\r");
-    UART_PRINT("\t\t    CC3200 %s Application       \n\r", AppName);
-    UART_PRINT("\t\t *************************************************\n\r");
-    UART_PRINT("\n\n\n\r");
+    ucRequest = g_ucLoopRequest;
+    if(ucRequest != LOOP_REQ_NONE)
+    {
+        g_ucLoopRequest = LOOP_REQ_NONE;
+        LoopTestClose();
+        LoopTest_Start(&g_LoopTest, ucRequest & 0x0F, ucRequest >> 4,
+                       GetTimeMs());
+        g_ulLoopOpenMs = GetTimeMs() - LOOP_RETRY_MS;
+        if(g_LoopTest.ucMode == LOOP_MODE_OFF)
+        {
+            LOG_INFO("Loop test: off\n\r");
+        }
+        else
+        {
+            LOG_INFO("Loop test: %s %s on port %d\n\r",
+                     LoopTest_ModeName(g_LoopTest.ucMode),
+                     (g_LoopTest.ucProto == LOOP_PROTO_UDP) ? "udp" : "tcp",
+                     LOOPBACK_PORT);
+        }
+    }
+
+    if(g_LoopTest.ucMode == LOOP_MODE_OFF || !g_bNetUp)
+    {
+        return;
+    }
+    if(g_iLoopSock < 0 && g_iLoopListenSock < 0)
+    {
+        if(GetTimeMs() - g_ulLoopOpenMs < LOOP_RETRY_MS)
+        {
+            return;
+        }
+        g_ulLoopOpenMs = GetTimeMs();
+        if(LoopTestOpen() < 0)
+        {
+            return;
+        }
+    }
+
+    bSource = (g_LoopTest.ucMode == LOOP_MODE_SOURCE &&
+               g_iLoopSock >= 0 &&
+               (g_LoopTest.ucProto == LOOP_PROTO_TCP ||
+                (g_bLoopPeer &&
+                 GetTimeMs() - g_ulLoopPeerMs < LOOP_UDP_SOURCE_MS)));
+    for(iCount = 0; bSource && iCount < LOOP_SOURCE_BURST; iCount++)
+    {
+        if(g_iLoopSock < 0 || LoopTestSend() < 0)
+        {
+            break;
+        }
+    }
+
+    if(LoopTest_Report(&g_LoopTest, GetTimeMs(), LOOP_REPORT_MS, &sReport))
+    {
+        LOG_INFO("Loop %s: rx %lu B/s %lu pkt/s, tx %lu B/s %lu pkt/s, "
+                 "%lu errors\n\r", LoopTest_ModeName(g_LoopTest.ucMode),
+                 sReport.ulRxBytesPerSec, sReport.ulRxPacketsPerSec,
+                 sReport.ulTxBytesPerSec, sReport.ulTxPacketsPerSec,
+                 sReport.ulErrors);
+        if(sReport.ulTurnCount > 0)
+        {
+            LOG_INFO("Loop turnaround: %lu packets, avg %lu us, max %lu "
+                     "us\n\r", sReport.ulTurnCount, sReport.ulTurnAvgUs,
+                     sReport.ulTurnMaxUs);
+        }
+    }
 }
-  
-extern volatile unsigned long g_ulStatus;
 
 //*****************************************************************************
 //
-//! Task implementing MQTT client communication to other web client through
-//!    a broker
+//! Starts the MQTT service: the publish path from the sampled inputs to the
+//! brokers, the task sending on the broker connections and one connect task
+//! per broker
 //!
 //! \param  none
 //!
-//! This function
-//!    1. Initializes network driver and connects to the default AP
-//!    2. Initializes the mqtt library and set up MQTT connection configurations
-//!    3. set up the button events and their callbacks(for publishing)
-//!    4. handles the callback signals
-//!
 //! \return None
-//!
+//
 //*****************************************************************************
-void MqttClient(void *pvParameters)
+static void MqttServiceStart(void)
 {
-    
-    long lRetVal = -1;
-    int iCount = 0;
-    int iNumBroker = 0;
-    int iConnBroker = 0;
-    event_msg RecvQue;
-    unsigned char policyVal;
-    
     connect_config *local_con_conf = (connect_config *)app_hndl;
+    int iNumBroker = sizeof(usr_connect_config)/sizeof(connect_config);
+    int iCount;
+    long lRetVal;
+
+    if(iNumBroker > MAX_BROKER_CONN)
+    {
+        UART_PRINT("Num of brokers are more then max num of brokers\n\r");
+        LOOP_FOREVER();
+    }
 
     //
-    // Configure LED
+    // Register Push Button Handlers, interrupting on presses and releases
     //
-    GPIO_IF_LedConfigure(LED1|LED2|LED3);
+    IsrRing_Init(&g_ButtonRing);
+    Button_IF_Init(pushButtonInterruptHandler2,pushButtonInterruptHandler3);
+    for(iCount = 0; iCount < MB_NUM_DISCRETE_INPUTS; iCount++)
+    {
+        MAP_GPIOIntTypeSet(g_ulInputPort[iCount], g_ucInputPin[iCount],
+                           GPIO_BOTH_EDGES);
+    }
 
-    GPIO_IF_LedOff(MCU_RED_LED_GPIO);
-    GPIO_IF_LedOff(MCU_GREEN_LED_GPIO);
+#if SFWD_USE_FLASH
+    StoreFwd_Init(&g_StoreFwd, &g_StoreFwdFlash);
+#else
+    StoreFwd_Init(&g_StoreFwd, NULL);
+#endif
 
     //
-    // Reset The state of the machine
+    // Start tracking the inputs for change-of-state publishing
     //
-    Network_IF_ResetMCUStateMachine();
+    IoSample_Init(&g_IoSampler, g_IoPoints,
+                  sizeof(g_IoPoints)/sizeof(IoPointCfg_t),
+                  IO_BATCH_WINDOW_MS, IO_BATCH_MAX_CHANGES, GetTimeMs());
 
     //
-    // Start the driver
+    // Initialze MQTT client lib
     //
-    lRetVal = Network_IF_InitDriver(ROLE_STA);
-    if(lRetVal < 0)
+    lRetVal = sl_ExtLib_MqttClientInit(&Mqtt_Client);
+    if(lRetVal != 0)
     {
-       UART_PRINT("Failed to start SimpleLink Device\n\r",lRetVal);
-       LOOP_FOREVER();
+        // lib initialization failed
+        UART_PRINT("MQTT Client lib initialization failed\n\r");
+        LOOP_FOREVER();
     }
 
-    // switch on Green LED to indicate Simplelink is properly up
-    GPIO_IF_LedOn(MCU_ON_IND);
-
-    // Start Timer to blink Red LED till AP connection
-    LedTimerConfigNStart();
-
-    // Initialize AP security params
-    SecurityParams.Key = (signed char *)SECURITY_KEY;
-    SecurityParams.KeyLen = strlen(SECURITY_KEY);
-    SecurityParams.Type = SECURITY_TYPE;
+    for(iCount = 0; iCount < CMD_DUP_ENTRIES; iCount++)
+    {
+        g_CmdSeen[iCount].iConn = -1;
+    }
+    osi_LockObjCreate(&g_CmdSeenLock);
 
     //
-    // Connect to the Access Point
+    // Build the topic lookup table used by Mqtt_Recv
     //
-    lRetVal = Network_IF_ConnectAP(SSID_NAME, SecurityParams);
-    if(lRetVal < 0)
+    if(MqttTopic_Init(g_MqttRoutes,
+                      sizeof(g_MqttRoutes)/sizeof(MqttTopicRoute_t)) < 0)
     {
-       UART_PRINT("Connection to an AP failed\n\r");
-       LOOP_FOREVER();
+        UART_PRINT("MQTT topic table initialization failed\n\r");
+        LOOP_FOREVER();
     }
 
-    lRetVal = sl_WlanProfileAdd(SSID_NAME,strlen(SSID_NAME),0,&SecurityParams,0,1,0);
-
-    //set AUTO policy
-    lRetVal = sl_WlanPolicySet(SL_POLICY_CONNECTION,
-                      SL_CONNECTION_POLICY(1,0,0,0,0),
-                      &policyVal, 1 /*PolicyValLen*/);    
-    
     //
-    // Disable the LED blinking Timer as Device is connected to AP
+    // Every broker starts with an immediate first connect attempt
     //
-    LedTimerDeinitStop();
+    srand((unsigned int)GetTimeMs());
+    osi_LockObjCreate(&g_DnsLock);
+    DnsCacheLoad();
+    for(iCount = 0; iCount < iNumBroker; iCount++)
+    {
+        if(local_con_conf[iCount].broker_config.server_info.netconn_info &
+           SL_MQTT_NETCONN_URL)
+        {
+            local_con_conf[iCount].host_name =
+                local_con_conf[iCount].broker_config.server_info.server_addr;
+        }
+        local_con_conf[iCount].link.eState = LINK_BACKOFF;
+        local_con_conf[iCount].link.ulRetryAtMs = GetTimeMs();
+        local_con_conf[iCount].link.ulDownSinceMs = GetTimeMs();
+        osi_SyncObjCreate(&local_con_conf[iCount].link.Wake);
+    }
 
     //
-    // Switch ON RED LED to indicate that Device acquired an IP
+    // Outbound publish queue and the task draining it
     //
-    GPIO_IF_LedOn(MCU_IP_ALLOC_IND);
+    PubQueue_Init(&g_PubOutQueue);
+    osi_LockObjCreate(&g_PubOutLock);
+    osi_SyncObjCreate(&g_PubOutSync);
+    lRetVal = DiagTaskCreate(MqttSendTask, "MqttSend", OSI_STACK_SIZE,
+                             NULL, PUB_TASK_PRIORITY);
+    if(lRetVal < 0)
+    {
+        UART_PRINT("MQTT send task creation failed\n\r");
+        LOOP_FOREVER();
+    }
+    for(iCount = 0; iCount < iNumBroker; iCount++)
+    {
+        lRetVal = DiagTaskCreate(BrokerConnectTask,
+                                 g_pcBrokerTaskNames[iCount], OSI_STACK_SIZE,
+                                 (void *)(long)iCount, BROKER_TASK_PRIORITY);
+        if(lRetVal < 0)
+        {
+            UART_PRINT("MQTT connect task creation failed\n\r");
+            LOOP_FOREVER();
+        }
+    }
 
-    UtilsDelay(20000000);
+    NetEventSubscribe(MqttNetEvent);
+}
 
-    GPIO_IF_LedOff(MCU_RED_LED_GPIO);
-    GPIO_IF_LedOff(MCU_ORANGE_LED_GPIO);
-    GPIO_IF_LedOff(MCU_GREEN_LED_GPIO);
-   
-    //
-    // Register Push Button Handlers
-    //
-    Button_IF_Init(pushButtonInterruptHandler2,pushButtonInterruptHandler3);
-    
-    //
-    // Initialze MQTT client lib
-    //
-    lRetVal = sl_ExtLib_MqttClientInit(&Mqtt_Client);
-    if(lRetVal != 0)
+//*****************************************************************************
+//
+//! Connection state subscriber of the MQTT service: wakes MqttSendTask so
+//! its reconnect state machines see the change right away
+//
+//*****************************************************************************
+static void MqttNetEvent(net_event eEvent)
+{
+    osi_SyncObjSignal(&g_PubOutSync);
+}
+
+//*****************************************************************************
+//
+//! Connection state subscriber of the status LEDs: the red LED blinks while
+//! the AP is searched and is lit for a moment once an IP is acquired
+//
+//*****************************************************************************
+static void LedNetEvent(net_event eEvent)
+{
+    if(eEvent == NET_EVENT_UP)
     {
-        // lib initialization failed
-        UART_PRINT("MQTT Client lib initialization failed\n\r");
-        LOOP_FOREVER();
+        LedIndicateIpAcquired();
     }
-    
-    /******************* connection to the broker ***************************/
-    iNumBroker = sizeof(usr_connect_config)/sizeof(connect_config);
-    if(iNumBroker > MAX_BROKER_CONN)
+    else
     {
-        UART_PRINT("Num of brokers are more then max num of brokers\n\r");
-        LOOP_FOREVER();
+        g_bLedIndication = true;
+        g_ucLedMode = LED_MODE_SEARCHING;
+        LedTimerConfigNStart();
     }
+}
 
-connect_to_broker:
-    while(iCount < iNumBroker)
+//*****************************************************************************
+//
+//! Registers a handler for network connection state changes. Handlers run
+//! in the network manager task and must not block.
+//!
+//! \param pfnHandler is the handler
+//!
+//! \return 0 on success, -1 if NET_MAX_SUBSCRIBERS are registered
+//
+//*****************************************************************************
+static int NetEventSubscribe(net_event_handler pfnHandler)
+{
+    if(g_iNumNetSubscribers >= NET_MAX_SUBSCRIBERS)
     {
-        //create client context
-        local_con_conf[iCount].clt_ctx =
-        sl_ExtLib_MqttClientCtxCreate(&local_con_conf[iCount].broker_config,
-                                      &local_con_conf[iCount].CallBAcks,
-                                      &(local_con_conf[iCount]));
+        return -1;
+    }
+    g_NetSubscribers[g_iNumNetSubscribers++] = pfnHandler;
+    return 0;
+}
 
-        //
-        // Set Client ID
-        //
-        sl_ExtLib_MqttClientSet((void*)local_con_conf[iCount].clt_ctx,
-                            SL_MQTT_PARAM_CLIENT_ID,
-                            local_con_conf[iCount].client_id,
-                            strlen((char*)(local_con_conf[iCount].client_id)));
+//*****************************************************************************
+//
+//! Publishes a change of the AP connection state, as tracked in g_ulStatus
+//! by the SimpleLink event handlers, to the subscribers
+//!
+//! \param  none
+//!
+//! \return None
+//
+//*****************************************************************************
+static void NetMonitor(void)
+{
+    bool bUp = IS_CONNECTED(g_ulStatus) && IS_IP_ACQUIRED(g_ulStatus);
+    int iIndex;
 
-        //
-        // Set will Params
-        //
-        if(local_con_conf[iCount].will_params.will_topic != NULL)
-        {
-            sl_ExtLib_MqttClientSet((void*)local_con_conf[iCount].clt_ctx,
-                                    SL_MQTT_PARAM_WILL_PARAM,
-                                    &(local_con_conf[iCount].will_params),
-                                    sizeof(SlMqttWill_t));
-        }
+    if(bUp == g_bNetUp)
+    {
+        return;
+    }
+    g_bNetUp = bUp;
 
-        //
-        // setting username and password
-        //
-        if(local_con_conf[iCount].usr_name != NULL)
-        {
-            sl_ExtLib_MqttClientSet((void*)local_con_conf[iCount].clt_ctx,
-                                SL_MQTT_PARAM_USER_NAME,
-                                local_con_conf[iCount].usr_name,
-                                strlen((char*)local_con_conf[iCount].usr_name));
+    if(bUp)
+    {
+        LOG_INFO("\r\nNetwork ready after %lu ms\r\n", GetTimeMs());
+    }
+    else
+    {
+        LOG_WARN("device has disconnected from AP \n\r");
+    }
+    for(iIndex = 0; iIndex < g_iNumNetSubscribers; iIndex++)
+    {
+        g_NetSubscribers[iIndex](bUp ? NET_EVENT_UP : NET_EVENT_DOWN);
+    }
+}
+
+//*****************************************************************************
+//
+//! Creates a task and registers it for the stack high-water report
+//!
+//! \param pEntry is the task function
+//! \param pcName is the task name
+//! \param usStackLen is the stack size in bytes
+//! \param pvParameters is passed to the task function
+//! \param ulPriority is the task priority
+//!
+//! \return the osi_TaskCreate result
+//
+//*****************************************************************************
+static long DiagTaskCreate(P_OSI_TASK_ENTRY pEntry, const char *pcName,
+                           unsigned short usStackLen, void *pvParameters,
+                           unsigned long ulPriority)
+{
+    OsiTaskHandle hTask = NULL;
+    long lRetVal;
 
-            if(local_con_conf[iCount].usr_pwd != NULL)
-            {
-                sl_ExtLib_MqttClientSet((void*)local_con_conf[iCount].clt_ctx,
-                                SL_MQTT_PARAM_PASS_WORD,
-                                local_con_conf[iCount].usr_pwd,
-                                strlen((char*)local_con_conf[iCount].usr_pwd));
-            }
-        }
+    lRetVal = osi_TaskCreate(pEntry, (const signed char *)pcName, usStackLen,
+                             pvParameters, ulPriority, &hTask);
+    if(lRetVal == 0 && g_iNumDiagTasks < DIAG_MAX_TASKS)
+    {
+        g_DiagTasks[g_iNumDiagTasks].pcName = pcName;
+        g_DiagTasks[g_iNumDiagTasks].usStackLen = usStackLen;
+        g_DiagTaskHandles[g_iNumDiagTasks] = hTask;
+        g_iNumDiagTasks++;
+    }
+    return lRetVal;
+}
 
-        //
-        // connectin to the broker
-        //
-        if((sl_ExtLib_MqttClientConnect((void*)local_con_conf[iCount].clt_ctx,
-                            local_con_conf[iCount].is_clean,
-                            local_con_conf[iCount].keep_alive_time) & 0xFF) != 0)
-        {
-            UART_PRINT("\n\rBroker connect fail for conn no. %d \n\r",iCount+1);
-            
-            //delete the context for this connection
-            sl_ExtLib_MqttClientCtxDelete(local_con_conf[iCount].clt_ctx);
-            
-            break;
-        }
-        else
-        {
-            UART_PRINT("\n\rSuccess: conn to Broker no. %d\n\r ", iCount+1);
-            local_con_conf[iCount].is_connected = true;
-            iConnBroker++;
-        }
+//*****************************************************************************
+//
+//! Logs the use of the buffer pools
+//!
+//! \param  none
+//!
+//! \return None
+//
+//*****************************************************************************
+static void PrintPoolStats(void)
+{
+    MemPoolStats_t sStats;
+    int iClass;
 
-        //
-        // Subscribe to topics
-        //
+    for(iClass = 0; MemPool_GetStats(iClass, &sStats) == 0; iClass++)
+    {
+        LOG_INFO("Pool %d: %u x %u bytes, in use %u, max %u, ", iClass,
+                 sStats.usNumBlocks, sStats.usBlockSize, sStats.usInUse,
+                 sStats.usHighWater);
+        LOG_INFO("allocs %lu, fails %lu, bad frees %lu\n\r", sStats.ulAllocs,
+                 sStats.ulFailures, sStats.ulBadFrees);
+    }
+}
 
-        if(sl_ExtLib_MqttClientSub((void*)local_con_conf[iCount].clt_ctx,
-                                   local_con_conf[iCount].topic,
-                                   local_con_conf[iCount].qos, TOPIC_COUNT) < 0)
-        {
-            UART_PRINT("\n\r Subscription Error for conn no. %d\n\r", iCount+1);
-            UART_PRINT("Disconnecting from the broker\r\n");
-            sl_ExtLib_MqttClientDisconnect(local_con_conf[iCount].clt_ctx);
-            local_con_conf[iCount].is_connected = false;
-            
-            //delete the context for this connection
-            sl_ExtLib_MqttClientCtxDelete(local_con_conf[iCount].clt_ctx);
-            iConnBroker--;
-            break;
-        }
-        else
+//*****************************************************************************
+//
+//! Takes the push button edges off the interrupt ring in batches and hands
+//! them to the I/O sampler with their time in ms, then hands over the edge
+//! each button holds since its last posted one. The held edge is read
+//! again if a button interrupt changed it meanwhile.
+//!
+//! \param  none
+//!
+//! \return None
+//
+//*****************************************************************************
+static void ButtonEventsDrain(void)
+{
+    IsrEvent_t sEvents[BUTTON_DRAIN_BATCH];
+    button_held *pHeld;
+    unsigned long ulSeq;
+    unsigned long ulAtMs;
+    unsigned char ucEdge;
+    bool bHeld;
+    int iNum;
+    int iIndex;
+
+    while((iNum = IsrRing_Drain(&g_ButtonRing, sEvents,
+                                BUTTON_DRAIN_BATCH)) > 0)
+    {
+        for(iIndex = 0; iIndex < iNum; iIndex++)
         {
-            int iSub;
-            UART_PRINT("Client subscribed on following topics:\n\r");
-            for(iSub = 0; iSub < local_con_conf[iCount].num_topics; iSub++)
+            if(sEvents[iIndex].ucFlags & ISR_EVT_AFTER_LOSS)
             {
-                UART_PRINT("%s\n\r", local_con_conf[iCount].topic[iSub]);
+                LOG_WARN("Button events lost, %lu in total\n\r",
+                         g_ButtonRing.ulOverflows);
             }
+            IoSample_Edge(&g_IoSampler, sEvents[iIndex].ucSource,
+                          sEvents[iIndex].ucEdge == ISR_EDGE_RISING,
+                          sEvents[iIndex].ulStamp);
         }
-        iCount++;
-    }
-
-    if(iConnBroker < 1)
-    {
-        //
-        // no succesful connection to broker
-        //
-        goto end;
     }
 
-    iCount = 0;
-
-    for(;;)
+    for(iIndex = 0; iIndex < BUTTON_NUM; iIndex++)
     {
-        osi_MsgQRead( &g_PBQueue, &RecvQue, OSI_WAIT_FOREVER);
-        
-        if(PUSH_BUTTON_SW2_PRESSED == RecvQue.event)
+        pHeld = &g_ButtonHeld[iIndex];
+        do
         {
-            Button_IF_EnableInterrupt(SW2);
-            //
-            // send publish message
-            //
-            sl_ExtLib_MqttClientSend((void*)local_con_conf[iCount].clt_ctx,
-                    pub_topic_sw2,data_sw2,strlen((char*)data_sw2),QOS2,RETAIN);
-            UART_PRINT("\n\r CC3200 Publishes the following message \n\r");
-            UART_PRINT("Topic: %s\n\r",pub_topic_sw2);
-            UART_PRINT("Data: %s\n\r",data_sw2);
-        }
-        else if(PUSH_BUTTON_SW3_PRESSED == RecvQue.event)
+            ulSeq = pHeld->ulSeq;
+            bHeld = pHeld->bHeld;
+            ulAtMs = pHeld->ulAtMs;
+            ucEdge = pHeld->ucEdge;
+        }while(ulSeq != pHeld->ulSeq);
+
+        if(bHeld && ulSeq != g_ulButtonTakenSeq[iIndex])
         {
-            Button_IF_EnableInterrupt(SW3);
-            //
-            // send publish message
-            //
-            sl_ExtLib_MqttClientSend((void*)local_con_conf[iCount].clt_ctx,
-                    pub_topic_sw3,data_sw3,strlen((char*)data_sw3),QOS2,RETAIN);
-            UART_PRINT("\n\r CC3200 Publishes the following message \n\r");
-            UART_PRINT("Topic: %s\n\r",pub_topic_sw3);
-            UART_PRINT("Data: %s\n\r",data_sw3);
-        }
-        else if(BROKER_DISCONNECTION == RecvQue.event)
-        {
-            iConnBroker--;
-            /* Derive the value of the local_con_conf or clt_ctx from the message */
-			sl_ExtLib_MqttClientCtxDelete(((connect_config*)(RecvQue.hndl))->clt_ctx);
-            
-            if(!IS_CONNECTED(g_ulStatus))
-            {
-                UART_PRINT("device has disconnected from AP \n\r");
-                
-                UART_PRINT("retry connection to the AP\n\r");
-                
-                while(!(IS_CONNECTED(g_ulStatus)) || !(IS_IP_ACQUIRED(g_ulStatus)))
-                {
-                    osi_Sleep(10);
-                }
-                goto connect_to_broker;
-                
-            }
-            if(iConnBroker < 1)
-            {
-                //
-                // device not connected to any broker
-                //
-                goto end;
-            }
+            g_ulButtonTakenSeq[iIndex] = ulSeq;
+            IoSample_Edge(&g_IoSampler, iIndex, ucEdge == ISR_EDGE_RISING,
+                          ulAtMs);
         }
     }
-end:
-    //
-    // Deinitializating the client library
-    //
-    sl_ExtLib_MqttClientExit();
-    UART_PRINT("\n\r Exiting the Application\n\r");
-    
-    LOOP_FOREVER();
 }
 
 //*****************************************************************************
 //
-//! Main 
-//!
-//! \param  none
+//! Reports the task stack and heap high-water marks and the pool counters
+//! on the diagnostics UART, and publishes them when a broker is connected
 //!
-//! This function
-//!    1. Invokes the SLHost task
-//!    2. Invokes the MqttClient
+//! \param  bProbeHeap also measures the heap fragmentation
 //!
 //! \return None
-//!
+//
 //*****************************************************************************
-
-void vTestTask1( void *pvParameters )
+static void DiagReport(bool bProbeHeap)
 {
-    UART_PRINT("\r\nTCP Wait\r\n");
-    int value = osi_SyncObjWait(&sync_obj, OSI_WAIT_FOREVER);
-    osi_SyncObjSignal(&sync_obj);
-
-    SlSockAddrIn_t  sAddr;
-    SlSockAddrIn_t  sLocalAddr;
-    int             iCounter;
-    int             iAddrSize;
-    int             iSockID;
-    int             iStatus;
-    int             iNewSockID;
-    long            lNonBlocking = 1;
-    int             iTestBufLen;
-    #define BUF_SIZE            1400
-    char g_cBsdBuf[BUF_SIZE];
-    unsigned short usPort = 502;
+    MemPoolStats_t sPools[MEMPOOL_MAX_CLASSES];
+    PubQueueSlot_t *pSlot;
+    int iNumPools = 0;
+    int iIndex;
+    int iLen;
 
-    UART_PRINT("\r\nTCP Task\r\n");
-
-    // filling the buffer
-    for (iCounter=0 ; iCounter<BUF_SIZE ; iCounter++)
+#ifdef USE_FREERTOS
+    for(iIndex = 0; iIndex < g_iNumDiagTasks; iIndex++)
     {
-        g_cBsdBuf[iCounter] = (char)(iCounter % 10);
+        g_DiagTasks[iIndex].usStackUnused =
+            uxTaskGetStackHighWaterMark(g_DiagTaskHandles[iIndex]) *
+            sizeof(portSTACK_TYPE);
     }
+    g_DiagHeap.ulSize = configTOTAL_HEAP_SIZE;
+    g_DiagHeap.ulFree = xPortGetFreeHeapSize();
+    g_DiagHeap.ulMinFree = xPortGetMinimumEverFreeHeapSize();
 
-    iTestBufLen  = BUF_SIZE;
-
-    //filling the TCP server socket address
-    sLocalAddr.sin_family = SL_AF_INET;
-    sLocalAddr.sin_port = sl_Htons((unsigned short)usPort);
-    sLocalAddr.sin_addr.s_addr = 0;
-
-    // creating a TCP socket
-    iSockID = sl_Socket(SL_AF_INET,SL_SOCK_STREAM, 0);
-    if( iSockID < 0 )
+    //
+    // The probe holds all of the free heap for a moment, so no other task
+    // may run meanwhile. Interrupt side allocations would still find the
+    // heap empty, which is why it only runs when asked for. It is the one
+    // deliberate heap use after init, so the seal is lifted around it.
+    //
+    if(bProbeHeap)
     {
-        // error
-        ASSERT_ON_ERROR(SOCKET_CREATE_ERROR);
+        osi_TaskDisable();
+        MemPool_SealHeap(NULL);
+        SysDiag_ProbeHeap(&g_DiagHeap, pvPortMalloc, vPortFree);
+        MemPool_SealHeap(HeapViolation);
+        osi_TaskEnable();
     }
+#endif
 
-    iAddrSize = sizeof(SlSockAddrIn_t);
-
-    // binding the TCP socket to the TCP server address
-    iStatus = sl_Bind(iSockID, (SlSockAddr_t *)&sLocalAddr, iAddrSize);
-    if( iStatus < 0 )
+    for(iIndex = 0; iIndex < g_iNumDiagTasks; iIndex++)
     {
-        // error
-        sl_Close(iSockID);
-        ASSERT_ON_ERROR(BIND_ERROR);
+        LOG_INFO("Task %s: stack %u bytes, %u never used\n\r",
+                 g_DiagTasks[iIndex].pcName, g_DiagTasks[iIndex].usStackLen,
+                 g_DiagTasks[iIndex].usStackUnused);
     }
-
-    // putting the socket for listening to the incoming TCP connection
-    iStatus = sl_Listen(iSockID, 0);
-    if( iStatus < 0 )
+    LOG_INFO("Heap: %lu of %lu bytes free (min %lu), largest %lu in %u "
+             "blocks\n\r", g_DiagHeap.ulFree, g_DiagHeap.ulSize,
+             g_DiagHeap.ulMinFree, g_DiagHeap.ulLargest,
+             g_DiagHeap.ucFragments);
+    PrintPoolStats();
+    LOG_INFO("Button events: %lu posted, %lu bounces, %lu lost, largest "
+             "batch %u\n\r", g_ButtonRing.ulPosted, g_ulButtonBounces,
+             g_ButtonRing.ulOverflows, g_ButtonRing.uiMaxBatch);
+
+    if(g_iPubRoute < 0)
     {
-        sl_Close(iSockID);
-        ASSERT_ON_ERROR(LISTEN_ERROR);
+        return;
+    }
+    while(iNumPools < MEMPOOL_MAX_CLASSES &&
+          MemPool_GetStats(iNumPools, &sPools[iNumPools]) == 0)
+    {
+        iNumPools++;
     }
 
-    // setting socket option to make the socket as non blocking
-    iStatus = sl_SetSockOpt(iSockID, SL_SOL_SOCKET, SL_SO_NONBLOCKING,
-                            &lNonBlocking, sizeof(lNonBlocking));
-    if( iStatus < 0 )
+    osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+    pSlot = PubQueue_Reserve(&g_PubOutQueue);
+    osi_LockObjUnlock(&g_PubOutLock);
+    if(pSlot == NULL)
     {
-        sl_Close(iSockID);
-        ASSERT_ON_ERROR(SOCKET_OPT_ERROR);
+        return;
     }
-    iNewSockID = SL_EAGAIN;
 
-    // waiting for an incoming TCP connection
-    while( iNewSockID < 0 )
+    ApplyPublishPolicy(pSlot, PUB_TOPIC_DIAG);
+    iLen = SysDiag_Encode(pSlot->ucData, sizeof(pSlot->ucData), GetTimeMs(),
+                          &g_DiagHeap, g_DiagTasks, g_iNumDiagTasks,
+                          sPools, iNumPools);
+    if(iLen < 0)
     {
-        // accepts a connection form a TCP client, if there is any
-        // otherwise returns SL_EAGAIN
-        iNewSockID = sl_Accept(iSockID, ( struct SlSockAddr_t *)&sAddr,
-                                (SlSocklen_t*)&iAddrSize);
-        if( iNewSockID == SL_EAGAIN )
-        {
-           MAP_UtilsDelay(10000);
-        }
-        else if( iNewSockID < 0 )
-        {
-            // error
-            sl_Close(iNewSockID);
-            sl_Close(iSockID);
-            ASSERT_ON_ERROR(ACCEPT_ERROR);
-        }
+        return;
     }
+    pSlot->usLen = iLen;
+
+    osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+    PubQueue_Commit(&g_PubOutQueue);
+    osi_LockObjUnlock(&g_PubOutLock);
+    osi_SyncObjSignal(&g_PubOutSync);
+}
+
+//*****************************************************************************
+//
+//! Reports the latency histograms on the diagnostics UART, and publishes
+//! them when a broker is connected
+//!
+//! \param  none
+//!
+//! \return None
+//
+//*****************************************************************************
+static void LatencyReport(void)
+{
+    PubQueueSlot_t *pSlot;
+    LatencyHist_t *pHist;
+    int iIndex;
+    int iBucket;
 
-    // waits for 1000 packets from the connected TCP client
-    while (true)
+    for(iIndex = 0; iIndex < sizeof(g_LatHist)/sizeof(LatencyHist_t); iIndex++)
     {
-        iStatus = sl_Recv(iNewSockID, g_cBsdBuf, iTestBufLen, 0);
-        if( iStatus <= 0 )
+        pHist = &g_LatHist[iIndex];
+        LOG_INFO("Latency %s: %lu samples, min %lu us, avg %lu us, max %lu "
+                 "us\n\r ", pHist->pcName, pHist->ulCount, pHist->ulMinUs,
+                 pHist->ulCount ? pHist->ulSumUs / pHist->ulCount : 0,
+                 pHist->ulMaxUs);
+        for(iBucket = 0; iBucket < LAT_NUM_BUCKETS; iBucket += 4)
         {
-          // error
-          sl_Close(iNewSockID);
-          sl_Close(iSockID);
-          ASSERT_ON_ERROR(RECV_ERROR);
+            LOG_INFO(" %lu %lu %lu %lu", pHist->ulBuckets[iBucket],
+                     pHist->ulBuckets[iBucket + 1],
+                     pHist->ulBuckets[iBucket + 2],
+                     pHist->ulBuckets[iBucket + 3]);
         }
-        int i;
-        UART_PRINT("Message: ");
-        for(i = 0; i < 15; i++){
-
-            UART_PRINT("%u", g_cBsdBuf[i]);
+        LOG_INFO("\n\r");
 
+        if(g_iPubRoute < 0)
+        {
+            continue;
         }
-        UART_PRINT("\n\r");
-
-//        int i;
-//        char* response = clientHandler(g_cBsdBuf);
-//        int len = response[0];
-//        for(i = 0; i < len; i++)
-//            g_cBsdBuf[i] = response[i+1];
-//        iStatus = sl_Send(iNewSockID, g_cBsdBuf, len, 0);
-        if( iStatus <= 0 )
+        osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+        pSlot = PubQueue_Reserve(&g_PubOutQueue);
+        osi_LockObjUnlock(&g_PubOutLock);
+        if(pSlot == NULL)
         {
-          // error
-          sl_Close(iNewSockID);
-          sl_Close(iSockID);
-          ASSERT_ON_ERROR(RECV_ERROR);
+            continue;
         }
+
+        ApplyPublishPolicy(pSlot, PUB_TOPIC_LATENCY);
+        pSlot->usLen = Latency_Encode(pHist, iIndex, pSlot->ucData,
+                                      sizeof(pSlot->ucData));
+
+        osi_LockObjLock(&g_PubOutLock, OSI_WAIT_FOREVER);
+        PubQueue_Commit(&g_PubOutQueue);
+        osi_LockObjUnlock(&g_PubOutLock);
+        osi_SyncObjSignal(&g_PubOutSync);
     }
 }
 
-void vTestTask2( void *pvParameters )
+//*****************************************************************************
+//
+//! Called on a malloc or free once the heap has been sealed. Runtime
+//! buffers have to come from the pools, so this is a programming error.
+//! Report allocates, so the message is formatted on the stack.
+//!
+//! \param uiSize is the requested size, 0 for a free
+//!
+//! \return None
+//
+//*****************************************************************************
+static void HeapViolation(size_t uiSize)
 {
-    UART_PRINT("T2 Wait");
-   osi_SyncObjWait(&sync_obj, OSI_WAIT_FOREVER);
-   osi_SyncObjSignal(&sync_obj);
-   for( ;; )
-     {
-       /* Queue a message for the print task to display on the UART CONSOLE. */
-       UART_PRINT("\r\nTest Task 2!\n\r");
-       osi_Sleep(2000);
-     }
+    char cLine[48];
+
+    snprintf(cLine, sizeof(cLine), "Heap use after init, %u bytes\n\r",
+             (unsigned int)uiSize);
+    Message(cLine);
+    LOOP_FOREVER();
 }
 
-OsiTaskHandle handle;
+#ifdef MEMPOOL_WRAP_HEAP
+//*****************************************************************************
+//
+//! Report of every object linked with -Wl,--wrap=Report. The SDK Report
+//! allocates its line on each call, which the sealed heap refuses, so the
+//! line is formatted on the stack of the caller instead.
+//!
+//! \param pcFormat is the format string, followed by its arguments
+//!
+//! \return the length of the formatted line
+//
+//*****************************************************************************
+int __wrap_Report(const char *pcFormat, ...)
+{
+    char cLine[LOG_LINE_LEN];
+    va_list vaArgs;
+    int iLen;
+
+    va_start(vaArgs, pcFormat);
+    iLen = vsnprintf(cLine, sizeof(cLine), pcFormat, vaArgs);
+    va_end(vaArgs);
+    Message(cLine);
+    return iLen;
+}
+#endif
 
-void ConnectToAP(void *pvParameters ){
+//*****************************************************************************
+//
+//! Network manager task
+//!
+//! \param  none
+//!
+//! This task
+//!    1. Starts the SimpleLink driver and connects to the AP
+//!    2. Publishes connection state changes to the subscribed services
+//!    3. Runs the Modbus TCP server
+//!    4. Samples the inputs and queues their changes for MQTT
+//!
+//! \return None
+//!
+//*****************************************************************************
+static void NetworkManagerTask(void *pvParameters)
+{
+    long lRetVal = -1;
+    bool bDiagProbe;
+    int iIndex;
 
-    int value = osi_SyncObjCreate(&sync_obj);
+    //
+    // Start the cycle counter of the latency histograms
+    //
+    Latency_Init(LAT_CPU_HZ);
 
-    long lRetVal = -1;
-    unsigned char policyVal;
+    //
+    // Runtime buffers come from the fixed-block pools
+    //
+    if(MemPool_Init(g_PoolClasses,
+                    sizeof(g_PoolClasses)/sizeof(MemPoolClassCfg_t),
+                    osi_EnterCritical, osi_ExitCritical) < 0)
+    {
+        UART_PRINT("Buffer pool initialization failed\n\r");
+        LOOP_FOREVER();
+    }
 
-    UART_PRINT("\r\nConnect to AP\r\n");
     //
     // Configure LED
     //
@@ -1118,44 +4096,149 @@ void ConnectToAP(void *pvParameters ){
     SecurityParams.KeyLen = strlen(SECURITY_KEY);
     SecurityParams.Type = SECURITY_TYPE;
 
+    for(iIndex = 0; iIndex < MB_MAX_CLIENTS; iIndex++)
+    {
+        g_ModbusConn[iIndex].iSockID = -1;
+        g_ModbusConn[iIndex].ulLastActive = 0;
+        g_ModbusConn[iIndex].iRxLen = 0;
+        g_ModbusConn[iIndex].pucRx = NULL;
+    }
+    NetEventSubscribe(LedNetEvent);
+    NetEventSubscribe(ModbusNetEvent);
+    LoopServiceStart();
+
     //
     // Connect to the Access Point
     //
-    lRetVal = Network_IF_ConnectAP(SSID_NAME, SecurityParams);
+    lRetVal = WlanConnect();
     if(lRetVal < 0)
     {
        UART_PRINT("Connection to an AP failed\n\r");
        LOOP_FOREVER();
     }
 
-    lRetVal = sl_WlanProfileAdd(SSID_NAME,strlen(SSID_NAME),0,&SecurityParams,0,1,0);
-
-    //set AUTO policy
-    lRetVal = sl_WlanPolicySet(SL_POLICY_CONNECTION,
-                      SL_CONNECTION_POLICY(1,0,0,0,0),
-                      &policyVal, 1 /*PolicyValLen*/);
+    //
+    // The IP address is all the Modbus server needs: it starts listening
+    // right away, the MQTT service follows
+    //
+    NetMonitor();
+    MqttServiceStart();
 
     //
-    // Disable the LED blinking Timer as Device is connected to AP
+    // Profile and policy are written to serial flash, which takes long
+    // enough to be kept off the startup path
     //
-    LedTimerDeinitStop();
+    WlanSaveProfile();
 
     //
-    // Switch ON RED LED to indicate that Device acquired an IP
+    // Initialization is over, from here on the heap is off limits
     //
-    GPIO_IF_LedOn(MCU_IP_ALLOC_IND);
+    MemPool_SealHeap(HeapViolation);
+    g_ulLastDiagMs = GetTimeMs();
+
+    for(;;)
+    {
+        //
+        // Serve Modbus and the link test for up to the sampling period
+        //
+        ModbusPoll(g_PubBench.ulLeft > 0 ? PUB_BENCH_POLL_MS :
+                                           IO_SAMPLE_PERIOD_MS);
+        LoopServicePoll();
+        NetMonitor();
 
-    UtilsDelay(20000000);
+        //
+        // The button edges date the changes the sampling below reports
+        //
+        ButtonEventsDrain();
 
-    GPIO_IF_LedOff(MCU_RED_LED_GPIO);
-    GPIO_IF_LedOff(MCU_ORANGE_LED_GPIO);
-    GPIO_IF_LedOff(MCU_GREEN_LED_GPIO);
+        //
+        // Batches go through the store-and-forward buffer while the broker
+        // is unreachable, and keep doing so until it has been replayed so
+        // that messages are delivered in the order they were produced
+        //
+        if(IoSample_Poll(&g_IoSampler, GetTimeMs()))
+        {
+            QueueIoBatch(g_iPubRoute >= 0);
+        }
+        ReplayStored(g_iPubRoute >= 0);
+
+        //
+        // At most one flash segment is written per pass, never while the
+        // Modbus clients or the sampler wait on a push
+        //
+        StoreFwd_Service(&g_StoreFwd);
+        PubBenchFill();
+
+        if(g_bDiagRequest || GetTimeMs() - g_ulLastDiagMs >= DIAG_INTERVAL_MS)
+        {
+            bDiagProbe = g_bDiagRequest;
+            g_bDiagRequest = false;
+            g_ulLastDiagMs = GetTimeMs();
+            DiagReport(bDiagProbe);
+        }
+        if(g_bLatRequest)
+        {
+            g_bLatRequest = false;
+            LatencyReport();
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! Formats a log record into a static line and writes it to the UART. Unlike
+//! Report it takes no heap, which is sealed at this point.
+//!
+//! \param pcFmt is the format string, followed by its arguments
+//!
+//! \return the length of the formatted line
+//
+//*****************************************************************************
+static int LogPrint(const char *pcFmt, ...)
+{
+    va_list vaArgs;
+    int iLen;
+
+    va_start(vaArgs, pcFmt);
+    iLen = vsnprintf(g_cLogLine, sizeof(g_cLogLine), pcFmt, vaArgs);
+    va_end(vaArgs);
+    Message(g_cLogLine);
+    return iLen;
+}
 
-    value = osi_SyncObjSignal(&sync_obj);
-    UART_PRINT("\r\nFinished AP\r\n");
-    osi_TaskDelete(&handle);
+//*****************************************************************************
+//
+//! Task formatting the deferred log records and writing them to the UART
+//!
+//! \param  none
+//!
+//! \return None
+//
+//*****************************************************************************
+static void LogDrainTask(void *pvParameters)
+{
+    for(;;)
+    {
+        LogRing_Drain(LogPrint);
+        osi_Sleep(LOG_DRAIN_PERIOD_MS);
+    }
 }
 
+//*****************************************************************************
+//
+//! Main 
+//!
+//! \param  none
+//!
+//! This function
+//!    1. Invokes the SLHost task
+//!    2. Invokes the log drain task
+//!    3. Invokes the network manager task
+//!
+//! \return None
+//!
+//*****************************************************************************
+
 void main()
 { 
     long lRetVal = -1;
@@ -1189,20 +4272,22 @@ void main()
         LOOP_FOREVER();
     }
     //
-    // Start the MQTT Client task
+    // Start the deferred logger, the log calls may come from any task
     //
-    osi_MsgQCreate(&g_PBQueue,"PBQueue",sizeof(event_msg),10);
-
-    lRetVal = osi_TaskCreate(ConnectToAP,
-                            (const signed char *)"Task0",
-                            OSI_STACK_SIZE, NULL, 3, &handle );
-
-    lRetVal = osi_TaskCreate(vTestTask1, (const signed char *)"Task1",
-                            OSI_STACK_SIZE, NULL, 1, NULL );
-
+    LogRing_Init(osi_EnterCritical, osi_ExitCritical);
+    lRetVal = DiagTaskCreate(LogDrainTask, "LogDrain", OSI_STACK_SIZE,
+                             NULL, LOG_TASK_PRIORITY);
+    if(lRetVal < 0)
+    {
+        ERR_PRINT(lRetVal);
+        LOOP_FOREVER();
+    }
 
-    lRetVal = osi_TaskCreate(vTestTask2, (const signed char *)"Task2",
-                            OSI_STACK_SIZE, NULL, 1, NULL );
+    //
+    // Start the network manager task
+    //
+    lRetVal = DiagTaskCreate(NetworkManagerTask, "NetMgr", OSI_STACK_SIZE,
+                             NULL, NET_TASK_PRIORITY);
 
     if(lRetVal < 0)
     {
@@ -0,0 +1,357 @@
+//*****************************************************************************
+// mem_pool.c
+//
+// Fixed-block pool allocator with size classes
+//
+// Each class is a free list of equally sized blocks carved out of caller
+// supplied static storage, so allocation and release are O(1) and cannot
+// fragment. A request is served from the smallest class that fits; when
+// that class is empty the request fails rather than borrowing a larger
+// block, which keeps the per-class high-water marks meaningful for sizing.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup mem_pool
+//! @{
+//
+//*****************************************************************************
+
+// Standard includes
+#include <stdlib.h>
+#include <string.h>
+
+#define __MEM_POOL_IMPL__
+#include "mem_pool.h"
+
+typedef struct MemPoolBlock
+{
+    struct MemPoolBlock *pNext;
+}MemPoolBlock_t;
+
+typedef struct
+{
+    unsigned char *pucStart;
+    unsigned char *pucEnd;
+    MemPoolBlock_t *pFree;
+    MemPoolStats_t Stats;
+}MemPoolClass_t;
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+static MemPoolClass_t g_PoolClasses[MEMPOOL_MAX_CLASSES];
+static int g_iNumPoolClasses;
+static unsigned long (*g_pfnPoolEnter)(void);
+static void (*g_pfnPoolExit)(unsigned long);
+static void (*g_pfnHeapViolation)(size_t uiSize);
+static volatile int g_bHeapSealed;
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+static unsigned long
+PoolEnter(void)
+{
+    return (g_pfnPoolEnter != NULL) ? g_pfnPoolEnter() : 0;
+}
+
+static void
+PoolExit(unsigned long ulKey)
+{
+    if(g_pfnPoolExit != NULL)
+    {
+        g_pfnPoolExit(ulKey);
+    }
+}
+
+//*****************************************************************************
+//
+//! Initializes the pool
+//!
+//! \param pCfg are the size classes, in increasing block size
+//! \param iNumClasses is the number of classes
+//! \param pfnEnter enters a critical section and returns a key, NULL if
+//!        the pool is only used by one task
+//! \param pfnExit leaves the critical section entered with the key
+//!
+//! \return 0 on success, -1 on an invalid configuration
+//
+//*****************************************************************************
+int
+MemPool_Init(const MemPoolClassCfg_t *pCfg, int iNumClasses,
+             unsigned long (*pfnEnter)(void), void (*pfnExit)(unsigned long))
+{
+    MemPoolClass_t *pClass;
+    MemPoolBlock_t *pBlock;
+    unsigned int uiSize;
+    int iClass;
+    int iBlock;
+
+    if(iNumClasses <= 0 || iNumClasses > MEMPOOL_MAX_CLASSES)
+    {
+        return -1;
+    }
+
+    memset(g_PoolClasses, 0, sizeof(g_PoolClasses));
+    for(iClass = 0; iClass < iNumClasses; iClass++)
+    {
+        uiSize = (pCfg[iClass].usBlockSize + 3) & ~3u;
+        if(uiSize < sizeof(MemPoolBlock_t) ||
+           ((unsigned long)pCfg[iClass].pvStorage & 3) != 0 ||
+           (iClass > 0 && uiSize <= g_PoolClasses[iClass - 1].Stats.usBlockSize))
+        {
+            return -1;
+        }
+
+        pClass = &g_PoolClasses[iClass];
+        pClass->pucStart = pCfg[iClass].pvStorage;
+        pClass->pucEnd = pClass->pucStart + uiSize * pCfg[iClass].usNumBlocks;
+        pClass->Stats.usBlockSize = uiSize;
+        pClass->Stats.usNumBlocks = pCfg[iClass].usNumBlocks;
+
+        for(iBlock = pCfg[iClass].usNumBlocks - 1; iBlock >= 0; iBlock--)
+        {
+            pBlock = (MemPoolBlock_t *)(pClass->pucStart + uiSize * iBlock);
+            pBlock->pNext = pClass->pFree;
+            pClass->pFree = pBlock;
+        }
+    }
+
+    g_iNumPoolClasses = iNumClasses;
+    g_pfnPoolEnter = pfnEnter;
+    g_pfnPoolExit = pfnExit;
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Allocates a block from the smallest class holding uiSize bytes
+//!
+//! \param uiSize is the number of bytes needed
+//!
+//! \return the block, or NULL if the class is exhausted or no class is
+//!         large enough
+//
+//*****************************************************************************
+void *
+MemPool_Alloc(size_t uiSize)
+{
+    MemPoolClass_t *pClass;
+    MemPoolBlock_t *pBlock = NULL;
+    unsigned long ulKey;
+    int iClass;
+
+    for(iClass = 0; iClass < g_iNumPoolClasses; iClass++)
+    {
+        if(uiSize <= g_PoolClasses[iClass].Stats.usBlockSize)
+        {
+            break;
+        }
+    }
+    if(iClass == g_iNumPoolClasses)
+    {
+        return NULL;
+    }
+    pClass = &g_PoolClasses[iClass];
+
+    ulKey = PoolEnter();
+    pBlock = pClass->pFree;
+    if(pBlock != NULL)
+    {
+        pClass->pFree = pBlock->pNext;
+        pClass->Stats.ulAllocs++;
+        if(++pClass->Stats.usInUse > pClass->Stats.usHighWater)
+        {
+            pClass->Stats.usHighWater = pClass->Stats.usInUse;
+        }
+    }
+    else
+    {
+        pClass->Stats.ulFailures++;
+    }
+    PoolExit(ulKey);
+
+    return pBlock;
+}
+
+//*****************************************************************************
+//
+//! Returns a block to its class. NULL and pointers outside the pool are
+//! ignored. A pointer that is not the start of a block, or a block that is
+//! already free, is not returned but counted in ulBadFrees, so a double
+//! free cannot hand one block out twice. The free list is short enough to
+//! be searched.
+//!
+//! \param pvBlock is the block
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+MemPool_Free(void *pvBlock)
+{
+    MemPoolClass_t *pClass;
+    MemPoolBlock_t *pBlock = pvBlock;
+    MemPoolBlock_t *pFree;
+    unsigned long ulKey;
+    int iClass;
+
+    for(iClass = 0; iClass < g_iNumPoolClasses; iClass++)
+    {
+        pClass = &g_PoolClasses[iClass];
+        if((unsigned char *)pvBlock >= pClass->pucStart &&
+           (unsigned char *)pvBlock < pClass->pucEnd)
+        {
+            ulKey = PoolEnter();
+            if(((unsigned char *)pvBlock - pClass->pucStart) %
+               pClass->Stats.usBlockSize != 0)
+            {
+                pClass->Stats.ulBadFrees++;
+                PoolExit(ulKey);
+                return;
+            }
+            for(pFree = pClass->pFree; pFree != NULL; pFree = pFree->pNext)
+            {
+                if(pFree == pBlock)
+                {
+                    pClass->Stats.ulBadFrees++;
+                    PoolExit(ulKey);
+                    return;
+                }
+            }
+            pBlock->pNext = pClass->pFree;
+            pClass->pFree = pBlock;
+            pClass->Stats.usInUse--;
+            PoolExit(ulKey);
+            return;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! Reads the counters of a size class
+//!
+//! \param iClass is the class index
+//! \param pStats receives the counters
+//!
+//! \return 0 on success, -1 if the class does not exist
+//
+//*****************************************************************************
+int
+MemPool_GetStats(int iClass, MemPoolStats_t *pStats)
+{
+    unsigned long ulKey;
+
+    if(iClass < 0 || iClass >= g_iNumPoolClasses)
+    {
+        return -1;
+    }
+    ulKey = PoolEnter();
+    *pStats = g_PoolClasses[iClass].Stats;
+    PoolExit(ulKey);
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Ends the initialization phase. From now on malloc and free in code
+//! built with MEMPOOL_NO_HEAP_AFTER_INIT, and in every object when linked
+//! with MEMPOOL_WRAP_HEAP, call pfnViolation, which is not expected to
+//! return. Sealing again with NULL lets a deliberate heap use through until
+//! the handler is set again.
+//!
+//! \param pfnViolation is the handler of a heap use
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+MemPool_SealHeap(void (*pfnViolation)(size_t uiSize))
+{
+    g_pfnHeapViolation = pfnViolation;
+    g_bHeapSealed = 1;
+}
+
+//*****************************************************************************
+//
+//! Checks a heap use against the seal. Besides the malloc and free wrappers
+//! below, FreeRTOSConfig.h can call it from traceMALLOC and traceFREE to
+//! seal the FreeRTOS heap, which the osi_* objects are allocated from.
+//!
+//! \param uiSize is the requested size, 0 for a free
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+MemPool_HeapCheck(size_t uiSize)
+{
+    if(g_bHeapSealed && g_pfnHeapViolation != NULL)
+    {
+        g_pfnHeapViolation(uiSize);
+    }
+}
+
+//*****************************************************************************
+//
+//! malloc of code built with MEMPOOL_NO_HEAP_AFTER_INIT
+//
+//*****************************************************************************
+void *
+MemPool_HeapAlloc(size_t uiSize)
+{
+    MemPool_HeapCheck(uiSize);
+    return malloc(uiSize);
+}
+
+//*****************************************************************************
+//
+//! free of code built with MEMPOOL_NO_HEAP_AFTER_INIT
+//
+//*****************************************************************************
+void
+MemPool_HeapFree(void *pvBlock)
+{
+    MemPool_HeapCheck(0);
+    free(pvBlock);
+}
+
+#ifdef MEMPOOL_WRAP_HEAP
+extern void *__real_malloc(size_t uiSize);
+extern void __real_free(void *pvBlock);
+
+//*****************************************************************************
+//
+//! malloc of every object linked with -Wl,--wrap=malloc, the SDK and the
+//! MQTT library included, which the header macros cannot reach
+//
+//*****************************************************************************
+void *
+__wrap_malloc(size_t uiSize)
+{
+    MemPool_HeapCheck(uiSize);
+    return __real_malloc(uiSize);
+}
+
+//*****************************************************************************
+//
+//! free of every object linked with -Wl,--wrap=free
+//
+//*****************************************************************************
+void
+__wrap_free(void *pvBlock)
+{
+    MemPool_HeapCheck(0);
+    __real_free(pvBlock);
+}
+#endif
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,71 @@
+//*****************************************************************************
+// mem_pool.h
+//
+// Fixed-block pool allocator with size classes
+//
+//*****************************************************************************
+
+#ifndef __MEM_POOL_H__
+#define __MEM_POOL_H__
+
+#include <stddef.h>
+
+#define MEMPOOL_MAX_CLASSES     4
+
+/* When set, application code including this header that calls malloc or
+   free after MemPool_SealHeap stops in the violation handler instead of
+   touching the general heap */
+#ifndef MEMPOOL_NO_HEAP_AFTER_INIT
+#define MEMPOOL_NO_HEAP_AFTER_INIT  1
+#endif
+
+/* The macros only reach code including this header. To seal the heap for
+   every object, the SDK and the MQTT library included, build with
+   MEMPOOL_WRAP_HEAP defined and link with -Wl,--wrap=malloc,--wrap=free.
+   The application then also links with -Wl,--wrap=Report, whose SDK
+   version allocates on every call */
+
+//*****************************************************************************
+//
+//! A size class: usNumBlocks blocks of usBlockSize bytes in pvStorage, which
+//! must be word aligned. Block sizes are rounded up to a multiple of four.
+//
+//*****************************************************************************
+typedef struct
+{
+    unsigned short usBlockSize;
+    unsigned short usNumBlocks;
+    void *pvStorage;
+}MemPoolClassCfg_t;
+
+typedef struct
+{
+    unsigned short usBlockSize;
+    unsigned short usNumBlocks;
+    unsigned short usInUse;
+    unsigned short usHighWater;
+    unsigned long ulAllocs;
+    unsigned long ulFailures;
+    unsigned long ulBadFrees;   /* double frees, pointers into a block */
+}MemPoolStats_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern int MemPool_Init(const MemPoolClassCfg_t *pCfg, int iNumClasses,
+                        unsigned long (*pfnEnter)(void),
+                        void (*pfnExit)(unsigned long));
+extern void *MemPool_Alloc(size_t uiSize);
+extern void MemPool_Free(void *pvBlock);
+extern int MemPool_GetStats(int iClass, MemPoolStats_t *pStats);
+extern void MemPool_SealHeap(void (*pfnViolation)(size_t uiSize));
+extern void MemPool_HeapCheck(size_t uiSize);
+extern void *MemPool_HeapAlloc(size_t uiSize);
+extern void MemPool_HeapFree(void *pvBlock);
+
+#if MEMPOOL_NO_HEAP_AFTER_INIT && !defined(__MEM_POOL_IMPL__)
+#define malloc(uiSize)          MemPool_HeapAlloc(uiSize)
+#define free(pvBlock)           MemPool_HeapFree(pvBlock)
+#endif
+
+#endif //  __MEM_POOL_H__
@@ -0,0 +1,519 @@
+//*****************************************************************************
+// modbus_tcp.c
+//
+// Modbus TCP server protocol engine
+//
+// Decodes Modbus TCP ADUs (MBAP header + PDU), dispatches them through a
+// table indexed by function code and encodes the responses in the caller's
+// buffer. No heap is used; the only state is the caller supplied data map
+// and receive buffer.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup modbus_tcp
+//! @{
+//
+//*****************************************************************************
+
+// Standard includes
+#include <string.h>
+
+#include "modbus_tcp.h"
+
+#define MB_GET_U16(p)           ((unsigned short)(((p)[0] << 8) | (p)[1]))
+#define MB_PUT_U16(p, v)        do { (p)[0] = (unsigned char)((v) >> 8); \
+                                     (p)[1] = (unsigned char)(v); } while(0)
+
+/* Quantity limits from the Modbus application protocol specification */
+#define MB_MAX_READ_BITS        2000
+#define MB_MAX_READ_REGS        125
+#define MB_MAX_WRITE_BITS       1968
+#define MB_MAX_WRITE_REGS       123
+
+#define MB_COIL_ON              0xFF00
+#define MB_COIL_OFF             0x0000
+
+typedef int (*ModbusHandler_t)(const ModbusDataMap_t *pMap,
+                               const unsigned char *pucPdu, int iPduLen,
+                               unsigned char *pucRsp);
+
+typedef struct
+{
+    ModbusHandler_t pfnHandler;
+    unsigned char ucMinPduLen;
+}ModbusDispatch_t;
+
+//*****************************************************************************
+//                      LOCAL FUNCTION PROTOTYPES
+//*****************************************************************************
+static int ReadBits(const ModbusDataMap_t *pMap, const unsigned char *pucPdu,
+                    int iPduLen, unsigned char *pucRsp);
+static int ReadRegisters(const ModbusDataMap_t *pMap,
+                         const unsigned char *pucPdu, int iPduLen,
+                         unsigned char *pucRsp);
+static int WriteSingleCoil(const ModbusDataMap_t *pMap,
+                           const unsigned char *pucPdu, int iPduLen,
+                           unsigned char *pucRsp);
+static int WriteSingleRegister(const ModbusDataMap_t *pMap,
+                               const unsigned char *pucPdu, int iPduLen,
+                               unsigned char *pucRsp);
+static int WriteMultipleCoils(const ModbusDataMap_t *pMap,
+                              const unsigned char *pucPdu, int iPduLen,
+                              unsigned char *pucRsp);
+static int WriteMultipleRegisters(const ModbusDataMap_t *pMap,
+                                  const unsigned char *pucPdu, int iPduLen,
+                                  unsigned char *pucRsp);
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+
+/* Dispatch table indexed directly by function code */
+static const ModbusDispatch_t g_ModbusDispatch[] =
+{
+    {NULL,                   0},    /* 0x00 */
+    {ReadBits,               5},    /* 0x01 Read Coils */
+    {ReadBits,               5},    /* 0x02 Read Discrete Inputs */
+    {ReadRegisters,          5},    /* 0x03 Read Holding Registers */
+    {ReadRegisters,          5},    /* 0x04 Read Input Registers */
+    {WriteSingleCoil,        5},    /* 0x05 Write Single Coil */
+    {WriteSingleRegister,    5},    /* 0x06 Write Single Register */
+    {NULL,                   0},    /* 0x07 */
+    {NULL,                   0},    /* 0x08 */
+    {NULL,                   0},    /* 0x09 */
+    {NULL,                   0},    /* 0x0A */
+    {NULL,                   0},    /* 0x0B */
+    {NULL,                   0},    /* 0x0C */
+    {NULL,                   0},    /* 0x0D */
+    {NULL,                   0},    /* 0x0E */
+    {WriteMultipleCoils,     7},    /* 0x0F Write Multiple Coils */
+    {WriteMultipleRegisters, 8},    /* 0x10 Write Multiple Registers */
+};
+
+#define MB_DISPATCH_SIZE (sizeof(g_ModbusDispatch)/sizeof(ModbusDispatch_t))
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! Handles Read Coils (0x01) and Read Discrete Inputs (0x02)
+//!
+//! \return length of the response PDU, or the negated exception code
+//
+//*****************************************************************************
+static int
+ReadBits(const ModbusDataMap_t *pMap, const unsigned char *pucPdu,
+         int iPduLen, unsigned char *pucRsp)
+{
+    unsigned short usAddr = MB_GET_U16(&pucPdu[1]);
+    unsigned short usQty = MB_GET_U16(&pucPdu[3]);
+    unsigned short usTableSize;
+    unsigned char (*pfnRead)(unsigned short);
+    unsigned char ucByteCount;
+    unsigned short usIndex;
+
+    if(pucPdu[0] == MB_FC_READ_COILS)
+    {
+        usTableSize = pMap->usNumCoils;
+        pfnRead = pMap->pfnCoilRead;
+    }
+    else
+    {
+        usTableSize = pMap->usNumDiscreteInputs;
+        pfnRead = pMap->pfnDiscreteInputRead;
+    }
+
+    if(iPduLen != 5 || usQty < 1 || usQty > MB_MAX_READ_BITS)
+    {
+        return -MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    if(pfnRead == NULL || (unsigned long)usAddr + usQty > usTableSize)
+    {
+        return -MB_EX_ILLEGAL_DATA_ADDRESS;
+    }
+
+    ucByteCount = (unsigned char)((usQty + 7) / 8);
+    pucRsp[1] = ucByteCount;
+    memset(&pucRsp[2], 0, ucByteCount);
+    for(usIndex = 0; usIndex < usQty; usIndex++)
+    {
+        if(pfnRead(usAddr + usIndex))
+        {
+            pucRsp[2 + (usIndex >> 3)] |= (unsigned char)(1 << (usIndex & 7));
+        }
+    }
+
+    return 2 + ucByteCount;
+}
+
+//*****************************************************************************
+//
+//! Handles Read Holding Registers (0x03) and Read Input Registers (0x04)
+//!
+//! \return length of the response PDU, or the negated exception code
+//
+//*****************************************************************************
+static int
+ReadRegisters(const ModbusDataMap_t *pMap, const unsigned char *pucPdu,
+              int iPduLen, unsigned char *pucRsp)
+{
+    unsigned short usAddr = MB_GET_U16(&pucPdu[1]);
+    unsigned short usQty = MB_GET_U16(&pucPdu[3]);
+    unsigned short usTableSize;
+    unsigned short (*pfnRead)(unsigned short);
+    unsigned short usIndex;
+    unsigned short usValue;
+
+    if(pucPdu[0] == MB_FC_READ_HOLDING_REGISTERS)
+    {
+        usTableSize = pMap->usNumHoldingRegs;
+        pfnRead = pMap->pfnHoldingRegRead;
+    }
+    else
+    {
+        usTableSize = pMap->usNumInputRegs;
+        pfnRead = pMap->pfnInputRegRead;
+    }
+
+    if(iPduLen != 5 || usQty < 1 || usQty > MB_MAX_READ_REGS)
+    {
+        return -MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    if(pfnRead == NULL || (unsigned long)usAddr + usQty > usTableSize)
+    {
+        return -MB_EX_ILLEGAL_DATA_ADDRESS;
+    }
+
+    pucRsp[1] = (unsigned char)(usQty * 2);
+    for(usIndex = 0; usIndex < usQty; usIndex++)
+    {
+        usValue = pfnRead(usAddr + usIndex);
+        MB_PUT_U16(&pucRsp[2 + usIndex * 2], usValue);
+    }
+
+    return 2 + usQty * 2;
+}
+
+//*****************************************************************************
+//
+//! Handles Write Single Coil (0x05). The response echoes the request.
+//!
+//! \return length of the response PDU, or the negated exception code
+//
+//*****************************************************************************
+static int
+WriteSingleCoil(const ModbusDataMap_t *pMap, const unsigned char *pucPdu,
+                int iPduLen, unsigned char *pucRsp)
+{
+    unsigned short usAddr = MB_GET_U16(&pucPdu[1]);
+    unsigned short usValue = MB_GET_U16(&pucPdu[3]);
+
+    if(iPduLen != 5 || (usValue != MB_COIL_ON && usValue != MB_COIL_OFF))
+    {
+        return -MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    if(pMap->pfnCoilWrite == NULL || usAddr >= pMap->usNumCoils)
+    {
+        return -MB_EX_ILLEGAL_DATA_ADDRESS;
+    }
+
+    pMap->pfnCoilWrite(usAddr, (unsigned char)(usValue == MB_COIL_ON));
+
+    memcpy(&pucRsp[1], &pucPdu[1], 4);
+    return 5;
+}
+
+//*****************************************************************************
+//
+//! Handles Write Single Register (0x06). The response echoes the request.
+//!
+//! \return length of the response PDU, or the negated exception code
+//
+//*****************************************************************************
+static int
+WriteSingleRegister(const ModbusDataMap_t *pMap, const unsigned char *pucPdu,
+                    int iPduLen, unsigned char *pucRsp)
+{
+    unsigned short usAddr = MB_GET_U16(&pucPdu[1]);
+
+    if(iPduLen != 5)
+    {
+        return -MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    if(pMap->pfnHoldingRegWrite == NULL || usAddr >= pMap->usNumHoldingRegs)
+    {
+        return -MB_EX_ILLEGAL_DATA_ADDRESS;
+    }
+
+    pMap->pfnHoldingRegWrite(usAddr, MB_GET_U16(&pucPdu[3]));
+
+    memcpy(&pucRsp[1], &pucPdu[1], 4);
+    return 5;
+}
+
+//*****************************************************************************
+//
+//! Handles Write Multiple Coils (0x0F)
+//!
+//! \return length of the response PDU, or the negated exception code
+//
+//*****************************************************************************
+static int
+WriteMultipleCoils(const ModbusDataMap_t *pMap, const unsigned char *pucPdu,
+                   int iPduLen, unsigned char *pucRsp)
+{
+    unsigned short usAddr = MB_GET_U16(&pucPdu[1]);
+    unsigned short usQty = MB_GET_U16(&pucPdu[3]);
+    unsigned char ucByteCount = pucPdu[5];
+    unsigned short usIndex;
+
+    if(usQty < 1 || usQty > MB_MAX_WRITE_BITS ||
+       ucByteCount != (usQty + 7) / 8 || iPduLen != 6 + ucByteCount)
+    {
+        return -MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    if(pMap->pfnCoilWrite == NULL ||
+       (unsigned long)usAddr + usQty > pMap->usNumCoils)
+    {
+        return -MB_EX_ILLEGAL_DATA_ADDRESS;
+    }
+
+    for(usIndex = 0; usIndex < usQty; usIndex++)
+    {
+        pMap->pfnCoilWrite(usAddr + usIndex,
+                   (unsigned char)((pucPdu[6 + (usIndex >> 3)] >>
+                                    (usIndex & 7)) & 1));
+    }
+
+    memcpy(&pucRsp[1], &pucPdu[1], 4);
+    return 5;
+}
+
+//*****************************************************************************
+//
+//! Handles Write Multiple Registers (0x10)
+//!
+//! \return length of the response PDU, or the negated exception code
+//
+//*****************************************************************************
+static int
+WriteMultipleRegisters(const ModbusDataMap_t *pMap,
+                       const unsigned char *pucPdu, int iPduLen,
+                       unsigned char *pucRsp)
+{
+    unsigned short usAddr = MB_GET_U16(&pucPdu[1]);
+    unsigned short usQty = MB_GET_U16(&pucPdu[3]);
+    unsigned char ucByteCount = pucPdu[5];
+    unsigned short usIndex;
+
+    if(usQty < 1 || usQty > MB_MAX_WRITE_REGS ||
+       ucByteCount != usQty * 2 || iPduLen != 6 + ucByteCount)
+    {
+        return -MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    if(pMap->pfnHoldingRegWrite == NULL ||
+       (unsigned long)usAddr + usQty > pMap->usNumHoldingRegs)
+    {
+        return -MB_EX_ILLEGAL_DATA_ADDRESS;
+    }
+
+    for(usIndex = 0; usIndex < usQty; usIndex++)
+    {
+        pMap->pfnHoldingRegWrite(usAddr + usIndex,
+                                 MB_GET_U16(&pucPdu[6 + usIndex * 2]));
+    }
+
+    memcpy(&pucRsp[1], &pucPdu[1], 4);
+    return 5;
+}
+
+//*****************************************************************************
+//
+//! Determines the length of the ADU at the start of a receive buffer
+//!
+//! \param pucBuf points to the first byte of the ADU
+//! \param iLen is the number of bytes received so far
+//!
+//! \return total ADU length once the MBAP header is available, 0 if more
+//!         bytes are needed to tell, MB_ERR_FRAME if the header is invalid
+//
+//*****************************************************************************
+int
+Modbus_AduLength(const unsigned char *pucBuf, int iLen)
+{
+    unsigned short usLength;
+
+    if(iLen < MB_MBAP_LEN - 1)
+    {
+        return 0;
+    }
+    usLength = MB_GET_U16(&pucBuf[4]);
+    if(MB_GET_U16(&pucBuf[2]) != 0 ||
+       usLength < 2 || usLength > MB_MAX_PDU_LEN + 1)
+    {
+        return MB_ERR_FRAME;
+    }
+    return MB_MBAP_LEN - 1 + usLength;
+}
+
+//*****************************************************************************
+//
+//! Processes a single Modbus TCP request ADU and builds the response ADU
+//!
+//! \param pMap is the mapping of the Modbus data tables to application I/O
+//! \param pucReq points to the request, starting at the MBAP header
+//! \param iReqLen is the number of valid bytes at pucReq
+//! \param pucRsp points to the response buffer
+//! \param iRspMax is the size of the response buffer, at least MB_MAX_ADU_LEN
+//!
+//! Requests for unsupported function codes or with invalid fields are
+//! answered with the corresponding Modbus exception response.
+//!
+//! \return length of the response ADU, MB_ERR_FRAME if the MBAP header is
+//!         invalid or the ADU is truncated, MB_ERR_BUFFER if pucRsp is too
+//!         small
+//
+//*****************************************************************************
+int
+Modbus_ProcessAdu(const ModbusDataMap_t *pMap,
+                  const unsigned char *pucReq, int iReqLen,
+                  unsigned char *pucRsp, int iRspMax)
+{
+    const unsigned char *pucPdu = &pucReq[MB_MBAP_LEN];
+    unsigned char *pucRspPdu = &pucRsp[MB_MBAP_LEN];
+    unsigned short usLength;
+    unsigned char ucFunc;
+    int iPduLen;
+    int iRspPduLen;
+
+    if(iRspMax < MB_MAX_ADU_LEN)
+    {
+        return MB_ERR_BUFFER;
+    }
+
+    //
+    // Validate the MBAP header: protocol id must be 0 (Modbus) and the
+    // length field covers the unit id plus a PDU of at least one byte
+    //
+    if(iReqLen < MB_MBAP_LEN + 1 || MB_GET_U16(&pucReq[2]) != 0)
+    {
+        return MB_ERR_FRAME;
+    }
+    usLength = MB_GET_U16(&pucReq[4]);
+    if(usLength < 2 || usLength > MB_MAX_PDU_LEN + 1 ||
+       iReqLen < MB_MBAP_LEN - 1 + usLength)
+    {
+        return MB_ERR_FRAME;
+    }
+    iPduLen = usLength - 1;
+
+    //
+    // Dispatch on the function code
+    //
+    ucFunc = pucPdu[0];
+    pucRspPdu[0] = ucFunc;
+    if(ucFunc >= MB_DISPATCH_SIZE || g_ModbusDispatch[ucFunc].pfnHandler == NULL)
+    {
+        iRspPduLen = -MB_EX_ILLEGAL_FUNCTION;
+    }
+    else if(iPduLen < g_ModbusDispatch[ucFunc].ucMinPduLen)
+    {
+        iRspPduLen = -MB_EX_ILLEGAL_DATA_VALUE;
+    }
+    else
+    {
+        iRspPduLen = g_ModbusDispatch[ucFunc].pfnHandler(pMap, pucPdu,
+                                                         iPduLen, pucRspPdu);
+    }
+
+    if(iRspPduLen < 0)
+    {
+        pucRspPdu[0] = (unsigned char)(ucFunc | 0x80);
+        pucRspPdu[1] = (unsigned char)(-iRspPduLen);
+        iRspPduLen = 2;
+    }
+
+    //
+    // MBAP header of the response: transaction and unit id are echoed
+    //
+    pucRsp[0] = pucReq[0];
+    pucRsp[1] = pucReq[1];
+    pucRsp[2] = 0;
+    pucRsp[3] = 0;
+    MB_PUT_U16(&pucRsp[4], iRspPduLen + 1);
+    pucRsp[6] = pucReq[6];
+
+    return MB_MBAP_LEN + iRspPduLen;
+}
+
+//*****************************************************************************
+//
+//! Processes every complete ADU in a connection's receive buffer
+//!
+//! \param pMap is the mapping of the Modbus data tables to application I/O
+//! \param pucRx is the connection's receive buffer
+//! \param piRxLen holds the number of buffered bytes; updated on return
+//! \param pucTx is the transmit buffer the responses are appended to
+//! \param iTxMax is the size of the transmit buffer, at least MB_MAX_ADU_LEN
+//!
+//! Pipelined requests are answered back to back and their responses are
+//! coalesced in pucTx so they go out in a single send. Processing stops
+//! when pucTx cannot hold another maximum sized response; the caller sends
+//! what was produced and calls again. A trailing partial ADU is moved to
+//! the start of pucRx to be completed by the next receive.
+//!
+//! \return number of response bytes in pucTx (0 when no complete ADU is
+//!         buffered), MB_ERR_FRAME if the stream is out of sync
+//
+//*****************************************************************************
+int
+Modbus_ProcessStream(const ModbusDataMap_t *pMap,
+                     unsigned char *pucRx, int *piRxLen,
+                     unsigned char *pucTx, int iTxMax)
+{
+    int iOffset = 0;
+    int iTxLen = 0;
+    int iAduLen;
+    int iRspLen;
+
+    while(iTxMax - iTxLen >= MB_MAX_ADU_LEN)
+    {
+        iAduLen = Modbus_AduLength(&pucRx[iOffset], *piRxLen - iOffset);
+        if(iAduLen < 0)
+        {
+            return MB_ERR_FRAME;
+        }
+        if(iAduLen == 0 || iAduLen > *piRxLen - iOffset)
+        {
+            break;
+        }
+
+        iRspLen = Modbus_ProcessAdu(pMap, &pucRx[iOffset], iAduLen,
+                                    &pucTx[iTxLen], iTxMax - iTxLen);
+        if(iRspLen < 0)
+        {
+            return iRspLen;
+        }
+        iTxLen += iRspLen;
+        iOffset += iAduLen;
+    }
+
+    if(iOffset > 0)
+    {
+        *piRxLen -= iOffset;
+        memmove(pucRx, &pucRx[iOffset], *piRxLen);
+    }
+
+    return iTxLen;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
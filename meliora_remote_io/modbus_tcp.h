@@ -0,0 +1,80 @@
+//*****************************************************************************
+// modbus_tcp.h
+//
+// Modbus TCP server protocol engine
+//
+// The engine has no dependency on SimpleLink or driverlib so it can be built
+// on a host machine and exercised with a regular Modbus TCP test client.
+//
+//*****************************************************************************
+
+#ifndef __MODBUS_TCP_H__
+#define __MODBUS_TCP_H__
+
+//*****************************************************************************
+// Protocol limits
+//*****************************************************************************
+#define MB_TCP_PORT             502
+#define MB_MBAP_LEN             7       /* transaction, protocol, length, unit */
+#define MB_MAX_PDU_LEN          253
+#define MB_MAX_ADU_LEN          (MB_MBAP_LEN + MB_MAX_PDU_LEN)  /* 260 */
+
+//*****************************************************************************
+// Function codes
+//*****************************************************************************
+#define MB_FC_READ_COILS                0x01
+#define MB_FC_READ_DISCRETE_INPUTS      0x02
+#define MB_FC_READ_HOLDING_REGISTERS    0x03
+#define MB_FC_READ_INPUT_REGISTERS      0x04
+#define MB_FC_WRITE_SINGLE_COIL         0x05
+#define MB_FC_WRITE_SINGLE_REGISTER     0x06
+#define MB_FC_WRITE_MULTIPLE_COILS      0x0F
+#define MB_FC_WRITE_MULTIPLE_REGISTERS  0x10
+
+//*****************************************************************************
+// Exception codes
+//*****************************************************************************
+#define MB_EX_ILLEGAL_FUNCTION          0x01
+#define MB_EX_ILLEGAL_DATA_ADDRESS      0x02
+#define MB_EX_ILLEGAL_DATA_VALUE        0x03
+#define MB_EX_SERVER_DEVICE_FAILURE     0x04
+
+//*****************************************************************************
+// Return codes of Modbus_ProcessAdu
+//*****************************************************************************
+#define MB_ERR_FRAME            -1      /* malformed MBAP, drop connection */
+#define MB_ERR_BUFFER           -2      /* response buffer too small */
+
+//*****************************************************************************
+//
+//! Mapping of the four Modbus data tables onto the application I/O.
+//! Addresses passed to the callbacks are zero based and already range
+//! checked against the table sizes.
+//
+//*****************************************************************************
+typedef struct
+{
+    unsigned short usNumCoils;
+    unsigned short usNumDiscreteInputs;
+    unsigned short usNumHoldingRegs;
+    unsigned short usNumInputRegs;
+    unsigned char (*pfnCoilRead)(unsigned short usAddr);
+    void (*pfnCoilWrite)(unsigned short usAddr, unsigned char ucValue);
+    unsigned char (*pfnDiscreteInputRead)(unsigned short usAddr);
+    unsigned short (*pfnHoldingRegRead)(unsigned short usAddr);
+    void (*pfnHoldingRegWrite)(unsigned short usAddr, unsigned short usValue);
+    unsigned short (*pfnInputRegRead)(unsigned short usAddr);
+}ModbusDataMap_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern int Modbus_AduLength(const unsigned char *pucBuf, int iLen);
+extern int Modbus_ProcessAdu(const ModbusDataMap_t *pMap,
+                             const unsigned char *pucReq, int iReqLen,
+                             unsigned char *pucRsp, int iRspMax);
+extern int Modbus_ProcessStream(const ModbusDataMap_t *pMap,
+                                unsigned char *pucRx, int *piRxLen,
+                                unsigned char *pucTx, int iTxMax);
+
+#endif //  __MODBUS_TCP_H__
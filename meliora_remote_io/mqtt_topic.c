@@ -0,0 +1,456 @@
+//*****************************************************************************
+// mqtt_topic.c
+//
+// Allocation free routing of received MQTT publishes to topic handlers
+//
+// The route table is compiled once at startup. Exact topics are hashed into
+// an open addressing table keyed on the raw topic bytes; wildcard filters
+// are compiled into a trie of topic levels held in a static node pool. A
+// received publish is resolved with one hash and one pass over the library
+// provided topic buffer, without copying it.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup mqtt_topic
+//! @{
+//
+//*****************************************************************************
+
+// Standard includes
+#include <string.h>
+
+#include "mqtt_topic.h"
+
+#define MQTT_TOPIC_HASH_MASK    (MQTT_TOPIC_TABLE_SIZE - 1)
+
+/* FNV-1a parameters */
+#define FNV_OFFSET_BASIS        2166136261UL
+#define FNV_PRIME               16777619UL
+
+#define NO_NODE                 (-1)
+
+typedef struct
+{
+    unsigned long ulHash;
+    long lTopLen;
+    const MqttTopicRoute_t *pRoute;     /* NULL when the slot is free */
+}MqttTopicSlot_t;
+
+typedef struct
+{
+    const char *pcLevel;                /* level text, points into a filter */
+    unsigned short usLevelLen;
+    short sChild;                       /* first literal child level */
+    short sSibling;                     /* next literal level, same parent */
+    short sPlus;                        /* '+' child level */
+    const MqttTopicRoute_t *pRoute;     /* filter ending at this level */
+    const MqttTopicRoute_t *pMultiRoute;/* filter ending in '#' below it */
+}MqttTopicNode_t;
+
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- Start
+//*****************************************************************************
+static MqttTopicSlot_t g_TopicTable[MQTT_TOPIC_TABLE_SIZE];
+static MqttTopicNode_t g_TopicNodes[MQTT_TOPIC_MAX_NODES];
+static short g_sNumNodes;
+//*****************************************************************************
+//                 GLOBAL VARIABLES -- End
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! FNV-1a hash over a topic that is not NUL terminated
+//
+//*****************************************************************************
+static unsigned long
+TopicHash(const char *pcTopic, long lTopLen)
+{
+    unsigned long ulHash = FNV_OFFSET_BASIS;
+
+    while(lTopLen-- > 0)
+    {
+        ulHash ^= (unsigned char)*pcTopic++;
+        ulHash = (ulHash * FNV_PRIME) & 0xFFFFFFFFUL;
+    }
+    return ulHash;
+}
+
+//*****************************************************************************
+//
+//! Returns the length of the topic level starting at pcLevel
+//
+//*****************************************************************************
+static long
+LevelLength(const char *pcLevel, long lRemaining)
+{
+    long lLen = 0;
+
+    while(lLen < lRemaining && pcLevel[lLen] != '/')
+    {
+        lLen++;
+    }
+    return lLen;
+}
+
+//*****************************************************************************
+//
+//! Allocates a trie node from the static pool
+//
+//*****************************************************************************
+static short
+NewNode(const char *pcLevel, long lLevelLen)
+{
+    MqttTopicNode_t *pNode;
+
+    if(g_sNumNodes >= MQTT_TOPIC_MAX_NODES)
+    {
+        return NO_NODE;
+    }
+    pNode = &g_TopicNodes[g_sNumNodes];
+    pNode->pcLevel = pcLevel;
+    pNode->usLevelLen = (unsigned short)lLevelLen;
+    pNode->sChild = NO_NODE;
+    pNode->sSibling = NO_NODE;
+    pNode->sPlus = NO_NODE;
+    pNode->pRoute = NULL;
+    pNode->pMultiRoute = NULL;
+    return g_sNumNodes++;
+}
+
+//*****************************************************************************
+//
+//! Returns the literal child of a node matching a topic level
+//
+//*****************************************************************************
+static short
+FindChild(short sNode, const char *pcLevel, long lLevelLen)
+{
+    short sChild = g_TopicNodes[sNode].sChild;
+
+    while(sChild != NO_NODE)
+    {
+        if(g_TopicNodes[sChild].usLevelLen == lLevelLen &&
+           memcmp(g_TopicNodes[sChild].pcLevel, pcLevel, lLevelLen) == 0)
+        {
+            break;
+        }
+        sChild = g_TopicNodes[sChild].sSibling;
+    }
+    return sChild;
+}
+
+//*****************************************************************************
+//
+//! Compiles a wildcard topic filter into the trie
+//!
+//! \return 0 on success, -1 if the filter is invalid, duplicated or the
+//!         node pool is exhausted
+//
+//*****************************************************************************
+static int
+TrieInsert(const MqttTopicRoute_t *pRoute)
+{
+    const char *pcLevel = pRoute->pcTopic;
+    long lRemaining = (long)strlen(pcLevel);
+    long lLevelLen;
+    short sNode = 0;
+    short sNext;
+
+    for(;;)
+    {
+        lLevelLen = LevelLength(pcLevel, lRemaining);
+
+        if(lLevelLen == 1 && pcLevel[0] == '#')
+        {
+            // '#' has to be the last level of the filter
+            if(lRemaining != 1 || g_TopicNodes[sNode].pMultiRoute != NULL)
+            {
+                return -1;
+            }
+            g_TopicNodes[sNode].pMultiRoute = pRoute;
+            return 0;
+        }
+
+        if(lLevelLen == 1 && pcLevel[0] == '+')
+        {
+            sNext = g_TopicNodes[sNode].sPlus;
+            if(sNext == NO_NODE)
+            {
+                sNext = NewNode(pcLevel, lLevelLen);
+                g_TopicNodes[sNode].sPlus = sNext;
+            }
+        }
+        else
+        {
+            if(memchr(pcLevel, '+', lLevelLen) != NULL ||
+               memchr(pcLevel, '#', lLevelLen) != NULL)
+            {
+                return -1;
+            }
+            sNext = FindChild(sNode, pcLevel, lLevelLen);
+            if(sNext == NO_NODE)
+            {
+                sNext = NewNode(pcLevel, lLevelLen);
+                if(sNext != NO_NODE)
+                {
+                    g_TopicNodes[sNext].sSibling = g_TopicNodes[sNode].sChild;
+                    g_TopicNodes[sNode].sChild = sNext;
+                }
+            }
+        }
+        if(sNext == NO_NODE)
+        {
+            return -1;
+        }
+        sNode = sNext;
+
+        if(lLevelLen == lRemaining)
+        {
+            break;
+        }
+        pcLevel += lLevelLen + 1;
+        lRemaining -= lLevelLen + 1;
+    }
+
+    if(g_TopicNodes[sNode].pRoute != NULL)
+    {
+        return -1;
+    }
+    g_TopicNodes[sNode].pRoute = pRoute;
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Matches a topic against the wildcard trie in one pass over the topic,
+//! advancing every trie path that is still alive level by level, and calls
+//! the handler of each matching filter.
+//!
+//! \return number of handlers called
+//
+//*****************************************************************************
+static int
+TrieDispatch(const char *pcTopic, long lTopLen,
+             const void *pvPayload, long lPayLen)
+{
+    short sActive[MQTT_TOPIC_MAX_ACTIVE];
+    short sNext[MQTT_TOPIC_MAX_ACTIVE];
+    const MqttTopicRoute_t *pRoute;
+    const char *pcLevel = pcTopic;
+    long lRemaining = lTopLen;
+    long lLevelLen;
+    int iNumActive = 1;
+    int iNumNext;
+    int iMatches = 0;
+    int iIndex;
+    short sChild;
+
+    if(g_sNumNodes == 0)
+    {
+        return 0;
+    }
+    sActive[0] = 0;
+
+    for(;;)
+    {
+        lLevelLen = LevelLength(pcLevel, lRemaining);
+        iNumNext = 0;
+
+        for(iIndex = 0; iIndex < iNumActive; iIndex++)
+        {
+            //
+            // Topics starting with '$' are not matched by a leading
+            // wildcard
+            //
+            if(pcLevel == pcTopic && lTopLen > 0 && pcTopic[0] == '$')
+            {
+                sChild = FindChild(sActive[iIndex], pcLevel, lLevelLen);
+                if(sChild != NO_NODE)
+                {
+                    sNext[iNumNext++] = sChild;
+                }
+                continue;
+            }
+
+            // 'a/#' also matches 'a', so the '#' route fires here
+            pRoute = g_TopicNodes[sActive[iIndex]].pMultiRoute;
+            if(pRoute != NULL)
+            {
+                pRoute->pfnHandler(pcTopic, lTopLen, pvPayload, lPayLen,
+                                   pRoute->ulArg);
+                iMatches++;
+            }
+
+            sChild = FindChild(sActive[iIndex], pcLevel, lLevelLen);
+            if(sChild != NO_NODE && iNumNext < MQTT_TOPIC_MAX_ACTIVE)
+            {
+                sNext[iNumNext++] = sChild;
+            }
+            sChild = g_TopicNodes[sActive[iIndex]].sPlus;
+            if(sChild != NO_NODE && iNumNext < MQTT_TOPIC_MAX_ACTIVE)
+            {
+                sNext[iNumNext++] = sChild;
+            }
+        }
+
+        memcpy(sActive, sNext, iNumNext * sizeof(short));
+        iNumActive = iNumNext;
+        if(iNumActive == 0 || lLevelLen == lRemaining)
+        {
+            break;
+        }
+        pcLevel += lLevelLen + 1;
+        lRemaining -= lLevelLen + 1;
+    }
+
+    //
+    // Paths that consumed the whole topic match their own filter and any
+    // '#' directly below them
+    //
+    for(iIndex = 0; iIndex < iNumActive; iIndex++)
+    {
+        pRoute = g_TopicNodes[sActive[iIndex]].pRoute;
+        if(pRoute != NULL)
+        {
+            pRoute->pfnHandler(pcTopic, lTopLen, pvPayload, lPayLen,
+                               pRoute->ulArg);
+            iMatches++;
+        }
+        pRoute = g_TopicNodes[sActive[iIndex]].pMultiRoute;
+        if(pRoute != NULL)
+        {
+            pRoute->pfnHandler(pcTopic, lTopLen, pvPayload, lPayLen,
+                               pRoute->ulArg);
+            iMatches++;
+        }
+    }
+
+    return iMatches;
+}
+
+//*****************************************************************************
+//
+//! Builds the topic lookup table. Must be called once before the MQTT
+//! client is connected; the route array must stay valid afterwards.
+//!
+//! \param pRoutes is the array of topic routes
+//! \param iNumRoutes is the number of entries in pRoutes
+//!
+//! \return 0 on success, -1 if the tables are too small or a filter is
+//!         invalid or listed twice
+//
+//*****************************************************************************
+int
+MqttTopic_Init(const MqttTopicRoute_t *pRoutes, int iNumRoutes)
+{
+    unsigned long ulHash;
+    unsigned long ulSlot;
+    long lTopLen;
+    int iRoute;
+
+    memset(g_TopicTable, 0, sizeof(g_TopicTable));
+    g_sNumNodes = 0;
+    if(iNumRoutes >= MQTT_TOPIC_TABLE_SIZE)
+    {
+        return -1;
+    }
+
+    for(iRoute = 0; iRoute < iNumRoutes; iRoute++)
+    {
+        lTopLen = (long)strlen(pRoutes[iRoute].pcTopic);
+        if(memchr(pRoutes[iRoute].pcTopic, '+', lTopLen) != NULL ||
+           memchr(pRoutes[iRoute].pcTopic, '#', lTopLen) != NULL)
+        {
+            // root of the trie is created with the first wildcard filter
+            if((g_sNumNodes == 0 && NewNode(NULL, 0) == NO_NODE) ||
+               TrieInsert(&pRoutes[iRoute]) < 0)
+            {
+                return -1;
+            }
+            continue;
+        }
+
+        if(MqttTopic_Lookup(pRoutes[iRoute].pcTopic, lTopLen) != NULL)
+        {
+            return -1;
+        }
+
+        ulHash = TopicHash(pRoutes[iRoute].pcTopic, lTopLen);
+        ulSlot = ulHash & MQTT_TOPIC_HASH_MASK;
+        while(g_TopicTable[ulSlot].pRoute != NULL)
+        {
+            ulSlot = (ulSlot + 1) & MQTT_TOPIC_HASH_MASK;
+        }
+        g_TopicTable[ulSlot].ulHash = ulHash;
+        g_TopicTable[ulSlot].lTopLen = lTopLen;
+        g_TopicTable[ulSlot].pRoute = &pRoutes[iRoute];
+    }
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Looks up the exact route of a topic; wildcard filters are not searched
+//!
+//! \param pcTopic points to the topic, not necessarily NUL terminated
+//! \param lTopLen is the topic length
+//!
+//! \return the matching route, or NULL if no exact route exists
+//
+//*****************************************************************************
+const MqttTopicRoute_t *
+MqttTopic_Lookup(const char *pcTopic, long lTopLen)
+{
+    unsigned long ulHash = TopicHash(pcTopic, lTopLen);
+    unsigned long ulSlot = ulHash & MQTT_TOPIC_HASH_MASK;
+
+    while(g_TopicTable[ulSlot].pRoute != NULL)
+    {
+        if(g_TopicTable[ulSlot].ulHash == ulHash &&
+           g_TopicTable[ulSlot].lTopLen == lTopLen &&
+           memcmp(g_TopicTable[ulSlot].pRoute->pcTopic, pcTopic, lTopLen) == 0)
+        {
+            return g_TopicTable[ulSlot].pRoute;
+        }
+        ulSlot = (ulSlot + 1) & MQTT_TOPIC_HASH_MASK;
+    }
+    return NULL;
+}
+
+//*****************************************************************************
+//
+//! Dispatches a received publish to the handlers of every route matching
+//! its topic: the exact route, if any, then the matching wildcard filters
+//!
+//! \param pcTopic points to the topic in the library's receive buffer
+//! \param lTopLen is the topic length
+//! \param pvPayload points to the payload in the library's receive buffer
+//! \param lPayLen is the payload length
+//!
+//! \return number of handlers called, 0 if the topic is not routed
+//
+//*****************************************************************************
+int
+MqttTopic_Dispatch(const char *pcTopic, long lTopLen,
+                   const void *pvPayload, long lPayLen)
+{
+    const MqttTopicRoute_t *pRoute = MqttTopic_Lookup(pcTopic, lTopLen);
+    int iMatches = 0;
+
+    if(pRoute != NULL)
+    {
+        pRoute->pfnHandler(pcTopic, lTopLen, pvPayload, lPayLen,
+                           pRoute->ulArg);
+        iMatches++;
+    }
+    return iMatches + TrieDispatch(pcTopic, lTopLen, pvPayload, lPayLen);
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,54 @@
+//*****************************************************************************
+// mqtt_topic.h
+//
+// Allocation free routing of received MQTT publishes to topic handlers
+//
+//*****************************************************************************
+
+#ifndef __MQTT_TOPIC_H__
+#define __MQTT_TOPIC_H__
+
+/* Size of the topic hash table, power of two and larger than the routes */
+#define MQTT_TOPIC_TABLE_SIZE   32
+
+/* Level nodes of the wildcard trie, shared by all wildcard routes */
+#define MQTT_TOPIC_MAX_NODES    64
+
+/* Trie nodes tracked at once while matching; each '+' can fork a path */
+#define MQTT_TOPIC_MAX_ACTIVE   8
+
+//*****************************************************************************
+//
+//! Topic handler. Topic and payload point into the MQTT library's receive
+//! buffer; neither is NUL terminated and both are only valid for the
+//! duration of the call.
+//
+//*****************************************************************************
+typedef void (*MqttTopicHandler_t)(const char *pcTopic, long lTopLen,
+                                   const void *pvPayload, long lPayLen,
+                                   unsigned long ulArg);
+
+//*****************************************************************************
+//
+//! A route binds a topic filter to its handler. Filters without wildcards
+//! go to the hash table; filters using the MQTT '+' (one level) and '#'
+//! (remaining levels) wildcards are compiled into the topic trie.
+//
+//*****************************************************************************
+typedef struct
+{
+    const char *pcTopic;
+    MqttTopicHandler_t pfnHandler;
+    unsigned long ulArg;
+}MqttTopicRoute_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern int MqttTopic_Init(const MqttTopicRoute_t *pRoutes, int iNumRoutes);
+extern const MqttTopicRoute_t *MqttTopic_Lookup(const char *pcTopic,
+                                                long lTopLen);
+extern int MqttTopic_Dispatch(const char *pcTopic, long lTopLen,
+                              const void *pvPayload, long lPayLen);
+
+#endif //  __MQTT_TOPIC_H__
@@ -0,0 +1,334 @@
+//*****************************************************************************
+// pub_queue.c
+//
+// Outbound MQTT publish queue
+//
+// Producers encode messages directly into a reserved slot and commit it; a
+// sender drains the queue into the MQTT library in non-blocking mode and
+// the library's ack events release the slots. The queue holds a bounded
+// backlog so input handling never waits for the broker round trip.
+//
+// The library's receive task may report an ack before the sender got the
+// message id back from the send call. Such acks are kept while a send is
+// pending and matched by PubQueue_Sent, and a message whose ack never comes
+// is sent again once it has been in flight for the ack timeout.
+//
+// The functions do no locking; callers running in different tasks must
+// serialize access to a queue.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup pub_queue
+//! @{
+//
+//*****************************************************************************
+
+// Standard includes
+#include <string.h>
+
+#include "pub_queue.h"
+
+#define PUBQ_SLOT(pQueue, uiIndex) \
+                        (&(pQueue)->Slots[(uiIndex) & (PUBQ_NUM_SLOTS - 1)])
+
+//*****************************************************************************
+//
+//! Releases the acknowledged messages at the tail of the ring
+//
+//*****************************************************************************
+static void
+ReleaseDone(PubQueue_t *pQueue)
+{
+    PubQueueSlot_t *pSlot;
+
+    while(pQueue->uiTail != pQueue->uiSend)
+    {
+        pSlot = PUBQ_SLOT(pQueue, pQueue->uiTail);
+        if(pSlot->ucState != PUBQ_SLOT_DONE)
+        {
+            break;
+        }
+        pSlot->ucState = PUBQ_SLOT_FREE;
+        pQueue->uiTail++;
+    }
+}
+
+//*****************************************************************************
+//
+//! Moves the messages in flight back to the queue, to be sent again
+//
+//*****************************************************************************
+static void
+Requeue(PubQueue_t *pQueue)
+{
+    unsigned int uiIndex;
+
+    for(uiIndex = pQueue->uiTail; uiIndex != pQueue->uiSend; uiIndex++)
+    {
+        PUBQ_SLOT(pQueue, uiIndex)->ucState = PUBQ_SLOT_QUEUED;
+        PUBQ_SLOT(pQueue, uiIndex)->bResend = true;
+        pQueue->ulResent++;
+    }
+    pQueue->uiSend = pQueue->uiTail;
+    pQueue->uiNumEarlyAcks = 0;
+}
+
+//*****************************************************************************
+//
+//! Initializes an empty queue
+//!
+//! \param pQueue is the queue
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+PubQueue_Init(PubQueue_t *pQueue)
+{
+    memset(pQueue, 0, sizeof(PubQueue_t));
+}
+
+//*****************************************************************************
+//
+//! Reserves the slot at the head of the queue for the producer to fill.
+//! The slot becomes visible to the sender with PubQueue_Commit.
+//!
+//! \param pQueue is the queue
+//!
+//! \return the slot, or NULL if the backlog is full
+//
+//*****************************************************************************
+PubQueueSlot_t *
+PubQueue_Reserve(PubQueue_t *pQueue)
+{
+    if(pQueue->uiHead - pQueue->uiTail >= PUBQ_NUM_SLOTS)
+    {
+        pQueue->ulFull++;
+        return NULL;
+    }
+    return PUBQ_SLOT(pQueue, pQueue->uiHead);
+}
+
+//*****************************************************************************
+//
+//! Queues the slot returned by the last PubQueue_Reserve
+//!
+//! \param pQueue is the queue
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+PubQueue_Commit(PubQueue_t *pQueue)
+{
+    PUBQ_SLOT(pQueue, pQueue->uiHead)->ucState = PUBQ_SLOT_QUEUED;
+    PUBQ_SLOT(pQueue, pQueue->uiHead)->bResend = false;
+    pQueue->uiHead++;
+    pQueue->ulQueued++;
+}
+
+//*****************************************************************************
+//
+//! Returns the next message to hand to the library and marks it SENDING.
+//! The send must be concluded with PubQueue_Sent or PubQueue_Unsent.
+//!
+//! \param pQueue is the queue
+//! \param uiMaxInflight is the maximum number of unacknowledged messages
+//!
+//! \return the slot to send, or NULL if nothing is queued or the in-flight
+//!         window is full
+//
+//*****************************************************************************
+PubQueueSlot_t *
+PubQueue_NextToSend(PubQueue_t *pQueue, unsigned int uiMaxInflight)
+{
+    PubQueueSlot_t *pSlot;
+
+    if(pQueue->uiSend == pQueue->uiHead ||
+       pQueue->uiSend - pQueue->uiTail >= uiMaxInflight)
+    {
+        return NULL;
+    }
+    pSlot = PUBQ_SLOT(pQueue, pQueue->uiSend);
+    pSlot->ucState = PUBQ_SLOT_SENDING;
+    pQueue->uiNumEarlyAcks = 0;
+    return pSlot;
+}
+
+//*****************************************************************************
+//
+//! Records that the message returned by PubQueue_NextToSend was accepted
+//! by the library. QoS0 messages are complete at this point, and so is a
+//! message whose ack already arrived. The slot may be released, so the
+//! caller must not use it afterwards.
+//!
+//! \param pQueue is the queue
+//! \param usMsgId is the message id assigned by the library
+//! \param ulNowMs is the current time in ms
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+PubQueue_Sent(PubQueue_t *pQueue, unsigned short usMsgId,
+              unsigned long ulNowMs)
+{
+    PubQueueSlot_t *pSlot = PUBQ_SLOT(pQueue, pQueue->uiSend);
+    unsigned int uiIndex;
+
+    pSlot->usMsgId = usMsgId;
+    pSlot->ulSentMs = ulNowMs;
+    pSlot->ucState = (pSlot->ucQos == 0) ? PUBQ_SLOT_DONE : PUBQ_SLOT_INFLIGHT;
+    for(uiIndex = 0; pSlot->ucQos != 0 && uiIndex < PUBQ_EARLY_ACKS &&
+                     uiIndex < pQueue->uiNumEarlyAcks; uiIndex++)
+    {
+        if(pQueue->usEarlyAcks[uiIndex] == usMsgId)
+        {
+            pSlot->ucState = PUBQ_SLOT_DONE;
+            pQueue->ulAcked++;
+            pQueue->ulEarlyAcks++;
+            break;
+        }
+    }
+    pQueue->uiNumEarlyAcks = 0;
+    pQueue->uiSend++;
+    ReleaseDone(pQueue);
+}
+
+//*****************************************************************************
+//
+//! Records that the library refused the message returned by
+//! PubQueue_NextToSend; it stays queued
+//!
+//! \param pQueue is the queue
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+PubQueue_Unsent(PubQueue_t *pQueue)
+{
+    PUBQ_SLOT(pQueue, pQueue->uiSend)->ucState = PUBQ_SLOT_QUEUED;
+    pQueue->uiNumEarlyAcks = 0;
+}
+
+//*****************************************************************************
+//
+//! Completes the in-flight message with the given id. While a send is
+//! pending an unknown id is kept, as it may be the ack of that send.
+//!
+//! \param pQueue is the queue
+//! \param usMsgId is the message id of the PUBACK or PUBCOMP
+//!
+//! \return 0 if a message was completed or the ack was kept, -1 if the id
+//!         is unknown
+//
+//*****************************************************************************
+int
+PubQueue_Ack(PubQueue_t *pQueue, unsigned short usMsgId)
+{
+    PubQueueSlot_t *pSlot;
+    unsigned int uiIndex;
+
+    for(uiIndex = pQueue->uiTail; uiIndex != pQueue->uiSend; uiIndex++)
+    {
+        pSlot = PUBQ_SLOT(pQueue, uiIndex);
+        if(pSlot->ucState == PUBQ_SLOT_INFLIGHT && pSlot->usMsgId == usMsgId)
+        {
+            pSlot->ucState = PUBQ_SLOT_DONE;
+            pQueue->ulAcked++;
+            ReleaseDone(pQueue);
+            return 0;
+        }
+    }
+
+    if(pQueue->uiSend != pQueue->uiHead &&
+       PUBQ_SLOT(pQueue, pQueue->uiSend)->ucState == PUBQ_SLOT_SENDING)
+    {
+        pQueue->usEarlyAcks[pQueue->uiNumEarlyAcks & (PUBQ_EARLY_ACKS - 1)] =
+                                                                    usMsgId;
+        pQueue->uiNumEarlyAcks++;
+        return 0;
+    }
+    return -1;
+}
+
+//*****************************************************************************
+//
+//! Queues the unacknowledged messages again, e.g. after the broker
+//! connection was lost. The messages that were not sent yet are flagged
+//! bResend as well, their stamps predate the outage.
+//!
+//! \param pQueue is the queue
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+PubQueue_Rewind(PubQueue_t *pQueue)
+{
+    unsigned int uiIndex;
+
+    for(uiIndex = pQueue->uiSend; uiIndex != pQueue->uiHead; uiIndex++)
+    {
+        PUBQ_SLOT(pQueue, uiIndex)->bResend = true;
+    }
+    Requeue(pQueue);
+}
+
+//*****************************************************************************
+//
+//! Queues the unacknowledged messages again once the oldest of them has
+//! waited for its ack for the timeout. The library assigns new message ids,
+//! so a broker that did get a message sees it twice.
+//!
+//! \param pQueue is the queue
+//! \param ulNowMs is the current time in ms
+//! \param ulTimeoutMs is the ack timeout
+//!
+//! \return 1 if messages were queued again, 0 otherwise
+//
+//*****************************************************************************
+int
+PubQueue_Expire(PubQueue_t *pQueue, unsigned long ulNowMs,
+                unsigned long ulTimeoutMs)
+{
+    PubQueueSlot_t *pSlot;
+    unsigned int uiIndex;
+
+    for(uiIndex = pQueue->uiTail; uiIndex != pQueue->uiSend; uiIndex++)
+    {
+        pSlot = PUBQ_SLOT(pQueue, uiIndex);
+        if(pSlot->ucState == PUBQ_SLOT_INFLIGHT)
+        {
+            if(ulNowMs - pSlot->ulSentMs < ulTimeoutMs)
+            {
+                return 0;
+            }
+            pQueue->ulTimeouts++;
+            Requeue(pQueue);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Returns the number of messages queued or in flight
+//
+//*****************************************************************************
+unsigned int
+PubQueue_Count(const PubQueue_t *pQueue)
+{
+    return pQueue->uiHead - pQueue->uiTail;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,90 @@
+//*****************************************************************************
+// pub_queue.h
+//
+// Outbound MQTT publish queue
+//
+//*****************************************************************************
+
+#ifndef __PUB_QUEUE_H__
+#define __PUB_QUEUE_H__
+
+#include <stdbool.h>
+
+/* Message slots, power of two; a slot holds a full telemetry batch */
+#define PUBQ_NUM_SLOTS          8
+#define PUBQ_MAX_PAYLOAD_LEN    176
+
+/* Acks kept while a send is pending, power of two */
+#define PUBQ_EARLY_ACKS         4
+
+/* Slot states */
+#define PUBQ_SLOT_FREE          0
+#define PUBQ_SLOT_QUEUED        1
+#define PUBQ_SLOT_INFLIGHT      2
+#define PUBQ_SLOT_DONE          3
+#define PUBQ_SLOT_SENDING       4   /* handed to the library, id unknown */
+
+//*****************************************************************************
+//
+//! A preallocated message slot. The topic is not copied and must be a
+//! string with static lifetime.
+//
+//*****************************************************************************
+typedef struct
+{
+    const char *pcTopic;
+    unsigned long ulStamp;  /* time stamp when queued, for the latency */
+    unsigned long ulSentMs; /* time handed to the library, for the timeout */
+    unsigned short usLen;
+    unsigned short usMsgId;
+    unsigned char ucQos;
+    bool bRetain;
+    bool bFanOut;           /* also sent to secondary brokers */
+    bool bResend;           /* queued again, ulStamp is older than this send */
+    unsigned char ucState;
+    unsigned char ucData[PUBQ_MAX_PAYLOAD_LEN];
+}PubQueueSlot_t;
+
+//*****************************************************************************
+//
+//! Ring of slots with three free running indices: messages in
+//! [uiTail, uiSend) were handed to the library and wait for their ack,
+//! messages in [uiSend, uiHead) wait to be sent. The slot at uiSend is
+//! SENDING while the library has it but its message id is not known yet;
+//! acks arriving meanwhile are kept in usEarlyAcks for PubQueue_Sent.
+//
+//*****************************************************************************
+typedef struct
+{
+    PubQueueSlot_t Slots[PUBQ_NUM_SLOTS];
+    unsigned int uiHead;
+    unsigned int uiSend;
+    unsigned int uiTail;
+    unsigned short usEarlyAcks[PUBQ_EARLY_ACKS];
+    unsigned int uiNumEarlyAcks;
+    unsigned long ulQueued;
+    unsigned long ulFull;
+    unsigned long ulAcked;
+    unsigned long ulResent;
+    unsigned long ulEarlyAcks;
+    unsigned long ulTimeouts;
+}PubQueue_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern void PubQueue_Init(PubQueue_t *pQueue);
+extern PubQueueSlot_t *PubQueue_Reserve(PubQueue_t *pQueue);
+extern void PubQueue_Commit(PubQueue_t *pQueue);
+extern PubQueueSlot_t *PubQueue_NextToSend(PubQueue_t *pQueue,
+                                           unsigned int uiMaxInflight);
+extern void PubQueue_Sent(PubQueue_t *pQueue, unsigned short usMsgId,
+                          unsigned long ulNowMs);
+extern void PubQueue_Unsent(PubQueue_t *pQueue);
+extern int PubQueue_Ack(PubQueue_t *pQueue, unsigned short usMsgId);
+extern void PubQueue_Rewind(PubQueue_t *pQueue);
+extern int PubQueue_Expire(PubQueue_t *pQueue, unsigned long ulNowMs,
+                           unsigned long ulTimeoutMs);
+extern unsigned int PubQueue_Count(const PubQueue_t *pQueue);
+
+#endif //  __PUB_QUEUE_H__
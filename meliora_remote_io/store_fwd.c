@@ -0,0 +1,411 @@
+//*****************************************************************************
+// store_fwd.c
+//
+// Store-and-forward buffering of publishes while the broker is unreachable
+//
+// Records are appended to a RAM byte ring. Appending never touches flash:
+// StoreFwd_Service, called once per pass of the owner's loop, spills the
+// oldest RAM records into a flash segment once the ring holds
+// SFWD_SPILL_LEN bytes, so a single pass never blocks on more than one
+// segment write. Records come back out oldest first: flash segments in the
+// order they were written, then the RAM ring.
+//
+// When the store runs full the oldest records are dropped: the oldest flash
+// segment gives way when all segments are in use, and without flash, or if
+// the flash fails, the oldest records of the RAM ring do.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup store_fwd
+//! @{
+//
+//*****************************************************************************
+
+// Standard includes
+#include <string.h>
+
+#include "store_fwd.h"
+
+#define SFWD_SEG(uiSegment)     ((uiSegment) % SFWD_MAX_SEGMENTS)
+
+//*****************************************************************************
+//
+//! Copies bytes out of the RAM ring starting at uiPos
+//
+//*****************************************************************************
+static void
+RingCopyOut(const StoreFwd_t *pStore, unsigned int uiPos,
+            unsigned char *pucDst, unsigned int uiLen)
+{
+    unsigned int uiFirst = SFWD_RAM_LEN - uiPos;
+
+    if(uiFirst > uiLen)
+    {
+        uiFirst = uiLen;
+    }
+    memcpy(pucDst, &pStore->ucRam[uiPos], uiFirst);
+    memcpy(&pucDst[uiFirst], pStore->ucRam, uiLen - uiFirst);
+}
+
+//*****************************************************************************
+//
+//! Copies bytes into the RAM ring at the head
+//
+//*****************************************************************************
+static void
+RingCopyIn(StoreFwd_t *pStore, const unsigned char *pucSrc, unsigned int uiLen)
+{
+    unsigned int uiFirst = SFWD_RAM_LEN - pStore->uiHead;
+
+    if(uiFirst > uiLen)
+    {
+        uiFirst = uiLen;
+    }
+    memcpy(&pStore->ucRam[pStore->uiHead], pucSrc, uiFirst);
+    memcpy(pStore->ucRam, &pucSrc[uiFirst], uiLen - uiFirst);
+    pStore->uiHead = (pStore->uiHead + uiLen) % SFWD_RAM_LEN;
+    pStore->uiUsed += uiLen;
+}
+
+//*****************************************************************************
+//
+//! Returns the total length of the record at the RAM tail
+//
+//*****************************************************************************
+static unsigned int
+TailRecordLen(const StoreFwd_t *pStore)
+{
+    unsigned char ucHdr[SFWD_RECORD_HDR_LEN];
+
+    RingCopyOut(pStore, pStore->uiTail, ucHdr, SFWD_RECORD_HDR_LEN);
+    return SFWD_RECORD_HDR_LEN + ((ucHdr[1] << 8) | ucHdr[2]);
+}
+
+//*****************************************************************************
+//
+//! Removes the record at the RAM tail
+//
+//*****************************************************************************
+static void
+DropTailRecord(StoreFwd_t *pStore)
+{
+    unsigned int uiLen = TailRecordLen(pStore);
+
+    pStore->uiTail = (pStore->uiTail + uiLen) % SFWD_RAM_LEN;
+    pStore->uiUsed -= uiLen;
+}
+
+//*****************************************************************************
+//
+//! Erases the oldest flash segment and moves replay to the next one
+//
+//*****************************************************************************
+static void
+EndOldestSegment(StoreFwd_t *pStore)
+{
+    const StoreFwdFlash_t *pFlash = pStore->pFlash;
+
+    if(pStore->lReadHandle >= 0)
+    {
+        pFlash->pfnClose(pStore->lReadHandle);
+        pStore->lReadHandle = -1;
+    }
+    pFlash->pfnErase(pStore->uiSegTail);
+    pStore->usSegRecords[SFWD_SEG(pStore->uiSegTail)] = 0;
+    pStore->uiSegTail++;
+    pStore->ulSegOffset = 0;
+}
+
+//*****************************************************************************
+//
+//! Writes the oldest RAM records, up to SFWD_SEGMENT_LEN bytes, into a new
+//! flash segment. When all segments are in use the oldest one is dropped.
+//!
+//! \return 0 if records were spilled, -1 if the flash write failed
+//
+//*****************************************************************************
+static int
+SpillOldest(StoreFwd_t *pStore)
+{
+    const StoreFwdFlash_t *pFlash = pStore->pFlash;
+    unsigned int uiSegment;
+    unsigned long ulOffset = 0;
+    unsigned int uiLen;
+    unsigned int uiFirst;
+    long lHandle;
+
+    if(pStore->uiSegHead - pStore->uiSegTail >= SFWD_MAX_SEGMENTS)
+    {
+        pStore->ulDropped += pStore->usSegRecords[SFWD_SEG(pStore->uiSegTail)];
+        EndOldestSegment(pStore);
+    }
+
+    uiSegment = pStore->uiSegHead;
+    pStore->usSegRecords[SFWD_SEG(uiSegment)] = 0;
+    lHandle = pFlash->pfnOpen(uiSegment, true);
+    if(lHandle < 0)
+    {
+        return -1;
+    }
+
+    while(pStore->uiUsed > 0)
+    {
+        uiLen = TailRecordLen(pStore);
+        if(ulOffset + uiLen > SFWD_SEGMENT_LEN)
+        {
+            break;
+        }
+
+        uiFirst = SFWD_RAM_LEN - pStore->uiTail;
+        if(uiFirst > uiLen)
+        {
+            uiFirst = uiLen;
+        }
+        if(pFlash->pfnWrite(lHandle, ulOffset,
+                            &pStore->ucRam[pStore->uiTail], uiFirst) < 0 ||
+           (uiLen > uiFirst &&
+            pFlash->pfnWrite(lHandle, ulOffset + uiFirst,
+                             pStore->ucRam, uiLen - uiFirst) < 0))
+        {
+            break;
+        }
+
+        ulOffset += uiLen;
+        DropTailRecord(pStore);
+        pStore->usSegRecords[SFWD_SEG(uiSegment)]++;
+        pStore->ulSpilled++;
+    }
+    pFlash->pfnClose(lHandle);
+
+    if(ulOffset == 0)
+    {
+        pFlash->pfnErase(uiSegment);
+        return -1;
+    }
+    pStore->ulSegLen[SFWD_SEG(uiSegment)] = ulOffset;
+    pStore->uiSegHead++;
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Reads the next record of the oldest flash segment
+//!
+//! \return payload length, or -1 if the record cannot be read
+//
+//*****************************************************************************
+static int
+PopFromFlash(StoreFwd_t *pStore, unsigned char *pucTopicId,
+             unsigned char *pucBuf, int iBufLen)
+{
+    const StoreFwdFlash_t *pFlash = pStore->pFlash;
+    unsigned int uiSegment = pStore->uiSegTail;
+    unsigned char ucHdr[SFWD_RECORD_HDR_LEN];
+    int iLen = -1;
+
+    if(pStore->lReadHandle < 0)
+    {
+        pStore->lReadHandle = pFlash->pfnOpen(uiSegment, false);
+    }
+    if(pStore->lReadHandle >= 0 &&
+       pFlash->pfnRead(pStore->lReadHandle, pStore->ulSegOffset, ucHdr,
+                       SFWD_RECORD_HDR_LEN) == SFWD_RECORD_HDR_LEN)
+    {
+        iLen = (ucHdr[1] << 8) | ucHdr[2];
+        if(iLen > iBufLen ||
+           pFlash->pfnRead(pStore->lReadHandle,
+                           pStore->ulSegOffset + SFWD_RECORD_HDR_LEN,
+                           pucBuf, iLen) != iLen)
+        {
+            iLen = -1;
+        }
+        *pucTopicId = ucHdr[0];
+    }
+
+    //
+    // Unreadable records are skipped together with the rest of the
+    // segment so a damaged file cannot stall the replay
+    //
+    if(iLen >= 0)
+    {
+        pStore->ulSegOffset += SFWD_RECORD_HDR_LEN + iLen;
+        pStore->usSegRecords[SFWD_SEG(uiSegment)]--;
+    }
+    else
+    {
+        pStore->ulSegOffset = pStore->ulSegLen[SFWD_SEG(uiSegment)];
+        pStore->ulDropped += pStore->usSegRecords[SFWD_SEG(uiSegment)];
+    }
+    if(pStore->ulSegOffset >= pStore->ulSegLen[SFWD_SEG(uiSegment)])
+    {
+        EndOldestSegment(pStore);
+    }
+    return iLen;
+}
+
+//*****************************************************************************
+//
+//! Initializes an empty store. Segments left over in flash from before a
+//! reset are erased since their order is no longer known.
+//!
+//! \param pStore is the store
+//! \param pFlash are the flash operations for spilling, NULL for RAM only
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+StoreFwd_Init(StoreFwd_t *pStore, const StoreFwdFlash_t *pFlash)
+{
+    unsigned int uiSegment;
+
+    memset(pStore, 0, sizeof(StoreFwd_t));
+    pStore->pFlash = pFlash;
+    pStore->lReadHandle = -1;
+    if(pFlash != NULL)
+    {
+        for(uiSegment = 0; uiSegment < SFWD_MAX_SEGMENTS; uiSegment++)
+        {
+            pFlash->pfnErase(uiSegment);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+//! Appends a record to the RAM ring, dropping its oldest records if it is
+//! full. Flash is not accessed.
+//!
+//! \param pStore is the store
+//! \param ucTopicId identifies the topic the record is published on
+//! \param pucData is the payload
+//! \param iLen is the payload length
+//!
+//! \return 0 on success, -1 if the record is larger than a segment
+//
+//*****************************************************************************
+int
+StoreFwd_Push(StoreFwd_t *pStore, unsigned char ucTopicId,
+              const unsigned char *pucData, int iLen)
+{
+    unsigned char ucHdr[SFWD_RECORD_HDR_LEN];
+    unsigned int uiLen = SFWD_RECORD_HDR_LEN + iLen;
+
+    if(iLen < 0 || uiLen > SFWD_SEGMENT_LEN)
+    {
+        return -1;
+    }
+
+    //
+    // StoreFwd_Service keeps room in the ring while the flash works
+    //
+    while(SFWD_RAM_LEN - pStore->uiUsed < uiLen)
+    {
+        DropTailRecord(pStore);
+        pStore->ulDropped++;
+    }
+
+    ucHdr[0] = ucTopicId;
+    ucHdr[1] = (unsigned char)(iLen >> 8);
+    ucHdr[2] = (unsigned char)iLen;
+    RingCopyIn(pStore, ucHdr, SFWD_RECORD_HDR_LEN);
+    RingCopyIn(pStore, pucData, iLen);
+    pStore->ulStored++;
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Spills the oldest RAM records to a flash segment once the ring holds
+//! SFWD_SPILL_LEN bytes. Called once per loop pass, it writes at most one
+//! segment.
+//!
+//! \param pStore is the store
+//!
+//! \return 1 if records were spilled, 0 if nothing was due, -1 if the
+//!         flash write failed
+//
+//*****************************************************************************
+int
+StoreFwd_Service(StoreFwd_t *pStore)
+{
+    if(pStore->pFlash == NULL || pStore->uiUsed < SFWD_SPILL_LEN)
+    {
+        return 0;
+    }
+    return (SpillOldest(pStore) == 0) ? 1 : -1;
+}
+
+//*****************************************************************************
+//
+//! Removes the oldest record from the store
+//!
+//! \param pStore is the store
+//! \param pucTopicId receives the topic id of the record
+//! \param pucBuf receives the payload
+//! \param iBufLen is the size of pucBuf
+//!
+//! \return payload length, 0 if the store is empty, -1 if the record was
+//!         lost (too large for pucBuf or unreadable)
+//
+//*****************************************************************************
+int
+StoreFwd_Pop(StoreFwd_t *pStore, unsigned char *pucTopicId,
+             unsigned char *pucBuf, int iBufLen)
+{
+    unsigned char ucHdr[SFWD_RECORD_HDR_LEN];
+    int iLen;
+
+    if(pStore->uiSegTail != pStore->uiSegHead)
+    {
+        iLen = PopFromFlash(pStore, pucTopicId, pucBuf, iBufLen);
+    }
+    else if(pStore->uiUsed > 0)
+    {
+        RingCopyOut(pStore, pStore->uiTail, ucHdr, SFWD_RECORD_HDR_LEN);
+        iLen = (ucHdr[1] << 8) | ucHdr[2];
+        *pucTopicId = ucHdr[0];
+        if(iLen <= iBufLen)
+        {
+            RingCopyOut(pStore,
+                        (pStore->uiTail + SFWD_RECORD_HDR_LEN) % SFWD_RAM_LEN,
+                        pucBuf, iLen);
+        }
+        else
+        {
+            pStore->ulDropped++;
+            iLen = -1;
+        }
+        DropTailRecord(pStore);
+    }
+    else
+    {
+        return 0;
+    }
+
+    if(iLen >= 0)
+    {
+        pStore->ulReplayed++;
+    }
+    return iLen;
+}
+
+//*****************************************************************************
+//
+//! Tells whether records are waiting for replay
+//
+//*****************************************************************************
+bool
+StoreFwd_IsEmpty(const StoreFwd_t *pStore)
+{
+    return (pStore->uiUsed == 0 && pStore->uiSegTail == pStore->uiSegHead);
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
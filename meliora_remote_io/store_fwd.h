@@ -0,0 +1,74 @@
+//*****************************************************************************
+// store_fwd.h
+//
+// Store-and-forward buffering of publishes while the broker is unreachable
+//
+//*****************************************************************************
+
+#ifndef __STORE_FWD_H__
+#define __STORE_FWD_H__
+
+#include <stdbool.h>
+
+/* RAM ring of stored records */
+#define SFWD_RAM_LEN            2048
+
+/* Flash spill: the oldest records move out of RAM in segments of at most
+   SFWD_SEGMENT_LEN bytes, one file per segment, once SFWD_SPILL_LEN bytes
+   are stored in RAM */
+#define SFWD_SEGMENT_LEN        (SFWD_RAM_LEN / 2)
+#define SFWD_SPILL_LEN          SFWD_SEGMENT_LEN
+#define SFWD_MAX_SEGMENTS       8
+
+/* Record header: topic id, 16 bit payload length */
+#define SFWD_RECORD_HDR_LEN     3
+
+//*****************************************************************************
+//
+//! Flash operations used for spilling. Each segment is a separate file that
+//! is written once, read back in order and erased after replay. The segment
+//! being replayed stays open for reading until it is done.
+//
+//*****************************************************************************
+typedef struct
+{
+    long (*pfnOpen)(unsigned int uiSegment, bool bWrite);
+    long (*pfnWrite)(long lHandle, unsigned long ulOffset,
+                     const unsigned char *pucData, unsigned long ulLen);
+    long (*pfnRead)(long lHandle, unsigned long ulOffset,
+                    unsigned char *pucData, unsigned long ulLen);
+    void (*pfnClose)(long lHandle);
+    void (*pfnErase)(unsigned int uiSegment);
+}StoreFwdFlash_t;
+
+typedef struct
+{
+    const StoreFwdFlash_t *pFlash;      /* NULL to buffer in RAM only */
+    unsigned char ucRam[SFWD_RAM_LEN];
+    unsigned int uiHead;                /* byte offsets into ucRam */
+    unsigned int uiTail;
+    unsigned int uiUsed;
+    unsigned long ulSegLen[SFWD_MAX_SEGMENTS];
+    unsigned short usSegRecords[SFWD_MAX_SEGMENTS];    /* not replayed yet */
+    unsigned int uiSegHead;             /* free running segment numbers */
+    unsigned int uiSegTail;
+    unsigned long ulSegOffset;          /* replay position in uiSegTail */
+    long lReadHandle;                   /* uiSegTail open for replay, or -1 */
+    unsigned long ulStored;
+    unsigned long ulReplayed;
+    unsigned long ulSpilled;
+    unsigned long ulDropped;
+}StoreFwd_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern void StoreFwd_Init(StoreFwd_t *pStore, const StoreFwdFlash_t *pFlash);
+extern int StoreFwd_Push(StoreFwd_t *pStore, unsigned char ucTopicId,
+                         const unsigned char *pucData, int iLen);
+extern int StoreFwd_Service(StoreFwd_t *pStore);
+extern int StoreFwd_Pop(StoreFwd_t *pStore, unsigned char *pucTopicId,
+                        unsigned char *pucBuf, int iBufLen);
+extern bool StoreFwd_IsEmpty(const StoreFwd_t *pStore);
+
+#endif //  __STORE_FWD_H__
@@ -0,0 +1,206 @@
+//*****************************************************************************
+// sys_diag.c
+//
+// Memory diagnostics: task stack and heap high-water marks
+//
+// The free and minimum free heap come from the allocator's counters. Its
+// fragmentation is only known by probing: the largest block that can be
+// allocated is found by binary search and kept, and the search is repeated
+// for the next one, up to DIAG_MAX_FRAGMENTS blocks. All blocks are
+// released at the end. The probe holds the whole free heap meanwhile, so
+// it is only run on request and the caller has to keep other allocators
+// out of the heap during the probe.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup sys_diag
+//! @{
+//
+//*****************************************************************************
+
+// Standard includes
+#include <string.h>
+
+#include "sys_diag.h"
+
+#define DIAG_HEADER_LEN         24
+#define DIAG_TASK_LEN           (4 + DIAG_NAME_LEN + 1)
+#define DIAG_POOL_LEN           12
+
+static unsigned char *
+Put16(unsigned char *pucOut, unsigned int uiValue)
+{
+    *pucOut++ = (unsigned char)(uiValue >> 8);
+    *pucOut++ = (unsigned char)uiValue;
+    return pucOut;
+}
+
+static unsigned char *
+Put32(unsigned char *pucOut, unsigned long ulValue)
+{
+    pucOut = Put16(pucOut, (unsigned int)(ulValue >> 16));
+    return Put16(pucOut, (unsigned int)(ulValue & 0xFFFF));
+}
+
+//*****************************************************************************
+//
+//! Finds the largest block of at most ulMax bytes the heap can provide
+//
+//*****************************************************************************
+static unsigned long
+LargestBlock(unsigned long ulMax, void *(*pfnAlloc)(size_t),
+             void (*pfnFree)(void *))
+{
+    unsigned long ulLow = 0;
+    unsigned long ulMid;
+    void *pvBlock;
+
+    while(ulLow < ulMax)
+    {
+        ulMid = ulLow + (ulMax - ulLow + 1) / 2;
+        pvBlock = pfnAlloc(ulMid);
+        if(pvBlock != NULL)
+        {
+            pfnFree(pvBlock);
+            ulLow = ulMid;
+        }
+        else
+        {
+            ulMax = ulMid - 1;
+        }
+    }
+    return ulLow;
+}
+
+//*****************************************************************************
+//
+//! Measures the largest block of the heap and its fragmentation. Blocks
+//! smaller than DIAG_MIN_BLOCK are not counted.
+//!
+//! \param pHeap holds the heap size and receives the figures
+//! \param pfnAlloc is the allocator of the heap
+//! \param pfnFree is its release function
+//!
+//! \return none
+//
+//*****************************************************************************
+void
+SysDiag_ProbeHeap(SysDiagHeap_t *pHeap, void *(*pfnAlloc)(size_t),
+                  void (*pfnFree)(void *))
+{
+    void *pvChain = NULL;
+    void *pvBlock;
+    unsigned long ulMax = pHeap->ulSize;
+    unsigned long ulLen;
+
+    pHeap->ulLargest = 0;
+    pHeap->ucFragments = 0;
+
+    while(pHeap->ucFragments < DIAG_MAX_FRAGMENTS)
+    {
+        ulLen = LargestBlock(ulMax, pfnAlloc, pfnFree);
+        if(ulLen < DIAG_MIN_BLOCK)
+        {
+            break;
+        }
+        pvBlock = pfnAlloc(ulLen);
+        if(pvBlock == NULL)
+        {
+            break;
+        }
+
+        // keep the block, linked through its first word
+        *(void **)pvBlock = pvChain;
+        pvChain = pvBlock;
+
+        if(pHeap->ucFragments == 0)
+        {
+            pHeap->ulLargest = ulLen;
+        }
+        pHeap->ucFragments++;
+        ulMax = ulLen;
+    }
+
+    while(pvChain != NULL)
+    {
+        pvBlock = pvChain;
+        pvChain = *(void **)pvBlock;
+        pfnFree(pvBlock);
+    }
+}
+
+//*****************************************************************************
+//
+//! Encodes a report
+//!
+//! \param pucBuf is the output buffer
+//! \param iBufLen is the size of pucBuf
+//! \param ulUptime is the time since boot in ms
+//! \param pHeap are the heap figures
+//! \param pTasks are the task stack figures
+//! \param iNumTasks is the number of tasks
+//! \param pPools are the pool counters
+//! \param iNumPools is the number of pools
+//!
+//! \return the report length, or -1 if the buffer is too small
+//
+//*****************************************************************************
+int
+SysDiag_Encode(unsigned char *pucBuf, int iBufLen, unsigned long ulUptime,
+               const SysDiagHeap_t *pHeap, const SysDiagTask_t *pTasks,
+               int iNumTasks, const MemPoolStats_t *pPools, int iNumPools)
+{
+    unsigned char *pucOut = pucBuf;
+    size_t uiNameLen;
+    int iIndex;
+
+    if(iBufLen < DIAG_HEADER_LEN + 1 + iNumTasks * DIAG_TASK_LEN +
+                 iNumPools * DIAG_POOL_LEN)
+    {
+        return -1;
+    }
+
+    *pucOut++ = DIAG_VERSION;
+    pucOut = Put32(pucOut, ulUptime);
+    pucOut = Put32(pucOut, pHeap->ulSize);
+    pucOut = Put32(pucOut, pHeap->ulFree);
+    pucOut = Put32(pucOut, pHeap->ulMinFree);
+    pucOut = Put32(pucOut, pHeap->ulLargest);
+    *pucOut++ = pHeap->ucFragments;
+
+    *pucOut++ = (unsigned char)iNumTasks;
+    for(iIndex = 0; iIndex < iNumTasks; iIndex++)
+    {
+        pucOut = Put16(pucOut, pTasks[iIndex].usStackLen);
+        pucOut = Put16(pucOut, pTasks[iIndex].usStackUnused);
+        uiNameLen = strlen(pTasks[iIndex].pcName);
+        if(uiNameLen > DIAG_NAME_LEN)
+        {
+            uiNameLen = DIAG_NAME_LEN;
+        }
+        memcpy(pucOut, pTasks[iIndex].pcName, uiNameLen);
+        pucOut += uiNameLen;
+        *pucOut++ = 0;
+    }
+
+    *pucOut++ = (unsigned char)iNumPools;
+    for(iIndex = 0; iIndex < iNumPools; iIndex++)
+    {
+        pucOut = Put16(pucOut, pPools[iIndex].usBlockSize);
+        pucOut = Put16(pucOut, pPools[iIndex].usNumBlocks);
+        pucOut = Put16(pucOut, pPools[iIndex].usInUse);
+        pucOut = Put16(pucOut, pPools[iIndex].usHighWater);
+        pucOut = Put32(pucOut, pPools[iIndex].ulFailures);
+    }
+
+    return (int)(pucOut - pucBuf);
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
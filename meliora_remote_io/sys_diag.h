@@ -0,0 +1,76 @@
+//*****************************************************************************
+// sys_diag.h
+//
+// Memory diagnostics: task stack and heap high-water marks
+//
+// Report layout, multi byte fields big endian:
+//
+//   version     1 byte   DIAG_VERSION
+//   uptime      4 bytes  ms
+//   heap size   4 bytes
+//   heap free   4 bytes
+//   heap min    4 bytes  lowest free since boot
+//   largest     4 bytes  largest allocatable block, 0 if never probed
+//   fragments   1 byte   free blocks found, at most DIAG_MAX_FRAGMENTS
+//   tasks       1 byte   number of task records
+//     stack     2 bytes  stack size in bytes
+//     unused    2 bytes  stack never touched since the task started
+//     name      NUL terminated, at most DIAG_NAME_LEN characters
+//   pools       1 byte   number of pool records
+//     size      2 bytes  block size
+//     blocks    2 bytes
+//     in use    2 bytes
+//     max       2 bytes  high-water mark
+//     fails     4 bytes
+//
+//*****************************************************************************
+
+#ifndef __SYS_DIAG_H__
+#define __SYS_DIAG_H__
+
+#include <stddef.h>
+
+#include "mem_pool.h"
+
+#define DIAG_VERSION            1
+#define DIAG_NAME_LEN           8
+#define DIAG_MAX_FRAGMENTS      8
+
+/* Blocks smaller than this are not worth reporting */
+#define DIAG_MIN_BLOCK          16
+
+typedef struct
+{
+    const char *pcName;
+    unsigned short usStackLen;
+    unsigned short usStackUnused;
+}SysDiagTask_t;
+
+//*****************************************************************************
+//
+//! Heap figures. ulSize, ulFree and ulMinFree are read from the allocator
+//! by the caller; ulLargest and ucFragments are measured by
+//! SysDiag_ProbeHeap and stay 0 until the first probe.
+//
+//*****************************************************************************
+typedef struct
+{
+    unsigned long ulSize;
+    unsigned long ulFree;
+    unsigned long ulMinFree;
+    unsigned long ulLargest;
+    unsigned char ucFragments;
+}SysDiagHeap_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern void SysDiag_ProbeHeap(SysDiagHeap_t *pHeap,
+                              void *(*pfnAlloc)(size_t),
+                              void (*pfnFree)(void *));
+extern int SysDiag_Encode(unsigned char *pucBuf, int iBufLen,
+                          unsigned long ulUptime, const SysDiagHeap_t *pHeap,
+                          const SysDiagTask_t *pTasks, int iNumTasks,
+                          const MemPoolStats_t *pPools, int iNumPools);
+
+#endif //  __SYS_DIAG_H__
@@ -0,0 +1,255 @@
+//*****************************************************************************
+// telemetry.c
+//
+// Compact binary encoding of I/O telemetry
+//
+// The writer encodes records straight into the caller's fixed send buffer;
+// the reader walks a received message record by record. Neither allocates.
+//
+//*****************************************************************************
+
+//*****************************************************************************
+//
+//! \addtogroup telemetry
+//! @{
+//
+//*****************************************************************************
+
+#include "telemetry.h"
+
+#define TLM_FLAG_QUALITY_MASK   0x03
+#define TLM_FLAG_WIDE_ID        0x40
+#define TLM_FLAG_WIDE_VALUE     0x80
+
+//*****************************************************************************
+//
+//! Initializes a writer and reserves the message header
+//!
+//! \param pWriter is the writer
+//! \param pucBuf is the send buffer
+//! \param iBufLen is the size of pucBuf
+//! \param ulBaseTime is the reference time of the records in ms
+//!
+//! \return 0 on success, -1 if the buffer cannot hold the header
+//
+//*****************************************************************************
+int
+Telemetry_Begin(TelemetryWriter_t *pWriter, unsigned char *pucBuf,
+                int iBufLen, unsigned long ulBaseTime)
+{
+    if(iBufLen < TLM_HEADER_LEN)
+    {
+        return -1;
+    }
+
+    pWriter->pucBuf = pucBuf;
+    pWriter->iBufLen = iBufLen;
+    pWriter->iLen = TLM_HEADER_LEN;
+    pWriter->ulBaseTime = ulBaseTime;
+
+    pucBuf[0] = TLM_VERSION;
+    pucBuf[1] = 0;
+    pucBuf[2] = (unsigned char)(ulBaseTime >> 24);
+    pucBuf[3] = (unsigned char)(ulBaseTime >> 16);
+    pucBuf[4] = (unsigned char)(ulBaseTime >> 8);
+    pucBuf[5] = (unsigned char)ulBaseTime;
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Appends a record to the message
+//!
+//! \param pWriter is the writer
+//! \param pRecord is the record to encode
+//!
+//! \return 0 on success, -1 if the message is full
+//
+//*****************************************************************************
+int
+Telemetry_Add(TelemetryWriter_t *pWriter, const TelemetryRecord_t *pRecord)
+{
+    unsigned char *pucOut = &pWriter->pucBuf[pWriter->iLen];
+    unsigned char *pucStart = pucOut;
+    unsigned char ucFlags = pRecord->ucQuality & TLM_FLAG_QUALITY_MASK;
+    unsigned long ulDelta;
+
+    if(pWriter->pucBuf[1] == TLM_MAX_RECORDS ||
+       pWriter->iBufLen - pWriter->iLen < TLM_MAX_RECORD_LEN)
+    {
+        return -1;
+    }
+
+    if(pRecord->usPointId > 0xFF)
+    {
+        ucFlags |= TLM_FLAG_WIDE_ID;
+    }
+    if(pRecord->usValue > 0xFF)
+    {
+        ucFlags |= TLM_FLAG_WIDE_VALUE;
+    }
+    *pucOut++ = ucFlags;
+
+    if(ucFlags & TLM_FLAG_WIDE_ID)
+    {
+        *pucOut++ = (unsigned char)(pRecord->usPointId >> 8);
+    }
+    *pucOut++ = (unsigned char)pRecord->usPointId;
+
+    if(ucFlags & TLM_FLAG_WIDE_VALUE)
+    {
+        *pucOut++ = (unsigned char)(pRecord->usValue >> 8);
+    }
+    *pucOut++ = (unsigned char)pRecord->usValue;
+
+    //
+    // Time offset modulo 2^32, zigzag so records older than the base stay
+    // small
+    //
+    ulDelta = (pRecord->ulTimestamp - pWriter->ulBaseTime) & 0xFFFFFFFFUL;
+    ulDelta = (ulDelta & 0x80000000UL) ? ((~ulDelta & 0x7FFFFFFFUL) << 1) | 1 :
+                                         ulDelta << 1;
+    while(ulDelta >= 0x80)
+    {
+        *pucOut++ = (unsigned char)(ulDelta | 0x80);
+        ulDelta >>= 7;
+    }
+    *pucOut++ = (unsigned char)ulDelta;
+
+    pWriter->iLen += (int)(pucOut - pucStart);
+    pWriter->pucBuf[1]++;
+    return 0;
+}
+
+//*****************************************************************************
+//
+//! Completes the message
+//!
+//! \param pWriter is the writer
+//!
+//! \return length of the encoded message
+//
+//*****************************************************************************
+int
+Telemetry_End(TelemetryWriter_t *pWriter)
+{
+    return pWriter->iLen;
+}
+
+//*****************************************************************************
+//
+//! Initializes a reader on a received message
+//!
+//! \param pReader is the reader
+//! \param pucBuf is the message
+//! \param iLen is the message length
+//!
+//! \return number of records in the message, -1 if the header is invalid
+//!         or of an unknown version
+//
+//*****************************************************************************
+int
+Telemetry_ReaderInit(TelemetryReader_t *pReader, const unsigned char *pucBuf,
+                     int iLen)
+{
+    if(iLen < TLM_HEADER_LEN || pucBuf[0] != TLM_VERSION)
+    {
+        return -1;
+    }
+
+    pReader->pucBuf = pucBuf;
+    pReader->iLen = iLen;
+    pReader->iPos = TLM_HEADER_LEN;
+    pReader->iRemaining = pucBuf[1];
+    pReader->ulBaseTime = ((unsigned long)pucBuf[2] << 24) |
+                          ((unsigned long)pucBuf[3] << 16) |
+                          ((unsigned long)pucBuf[4] << 8) |
+                          (unsigned long)pucBuf[5];
+    return pReader->iRemaining;
+}
+
+//*****************************************************************************
+//
+//! Decodes the next record of a message
+//!
+//! \param pReader is the reader
+//! \param pRecord receives the decoded record
+//!
+//! \return 1 if a record was decoded, 0 at the end of the message, -1 if
+//!         the message is truncated or malformed
+//
+//*****************************************************************************
+int
+Telemetry_Next(TelemetryReader_t *pReader, TelemetryRecord_t *pRecord)
+{
+    const unsigned char *pucIn = &pReader->pucBuf[pReader->iPos];
+    const unsigned char *pucEnd = &pReader->pucBuf[pReader->iLen];
+    unsigned char ucFlags;
+    unsigned long ulDelta = 0;
+    int iShift = 0;
+
+    if(pReader->iRemaining == 0)
+    {
+        return 0;
+    }
+
+    if(pucEnd - pucIn < 4)
+    {
+        return -1;
+    }
+    ucFlags = *pucIn++;
+    pRecord->ucQuality = ucFlags & TLM_FLAG_QUALITY_MASK;
+
+    pRecord->usPointId = *pucIn++;
+    if(ucFlags & TLM_FLAG_WIDE_ID)
+    {
+        pRecord->usPointId = (unsigned short)((pRecord->usPointId << 8) |
+                                              *pucIn++);
+    }
+    if(pucIn >= pucEnd)
+    {
+        return -1;
+    }
+    pRecord->usValue = *pucIn++;
+    if(ucFlags & TLM_FLAG_WIDE_VALUE)
+    {
+        if(pucIn >= pucEnd)
+        {
+            return -1;
+        }
+        pRecord->usValue = (unsigned short)((pRecord->usValue << 8) |
+                                            *pucIn++);
+    }
+
+    do
+    {
+        if(pucIn >= pucEnd || iShift > 28)
+        {
+            return -1;
+        }
+        ulDelta |= (unsigned long)(*pucIn & 0x7F) << iShift;
+        iShift += 7;
+    } while(*pucIn++ & 0x80);
+
+    if(ulDelta & 1)
+    {
+        pRecord->ulTimestamp = (pReader->ulBaseTime - (ulDelta >> 1) - 1) &
+                               0xFFFFFFFFUL;
+    }
+    else
+    {
+        pRecord->ulTimestamp = (pReader->ulBaseTime + (ulDelta >> 1)) &
+                               0xFFFFFFFFUL;
+    }
+
+    pReader->iPos = (int)(pucIn - pReader->pucBuf);
+    pReader->iRemaining--;
+    return 1;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
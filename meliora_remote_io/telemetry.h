@@ -0,0 +1,74 @@
+//*****************************************************************************
+// telemetry.h
+//
+// Compact binary encoding of I/O telemetry
+//
+// Message layout, multi byte fields big endian:
+//
+//   version     1 byte   TLM_VERSION
+//   count       1 byte   number of records
+//   base time   4 bytes  ms, reference of the record time offsets
+//   records     count times:
+//     flags     1 byte   bits 0-1 quality, bit 6 16 bit point id,
+//                        bit 7 16 bit value
+//     point id  1 or 2 bytes
+//     value     1 or 2 bytes
+//     time      1 to 5 bytes, zigzag LEB128 offset from base time in ms
+//
+// A digital point update takes 4 bytes. The decoder has no target
+// dependency and builds on a host to inspect captured payloads.
+//
+//*****************************************************************************
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#define TLM_VERSION             1
+#define TLM_HEADER_LEN          6
+#define TLM_MAX_RECORD_LEN      10
+#define TLM_MAX_RECORDS         255
+
+/* Record quality */
+#define TLM_QUALITY_GOOD        0
+#define TLM_QUALITY_UNCERTAIN   1
+#define TLM_QUALITY_BAD         2
+
+typedef struct
+{
+    unsigned short usPointId;
+    unsigned short usValue;
+    unsigned char ucQuality;
+    unsigned long ulTimestamp;
+}TelemetryRecord_t;
+
+typedef struct
+{
+    unsigned char *pucBuf;
+    int iBufLen;
+    int iLen;
+    unsigned long ulBaseTime;
+}TelemetryWriter_t;
+
+typedef struct
+{
+    const unsigned char *pucBuf;
+    int iLen;
+    int iPos;
+    int iRemaining;
+    unsigned long ulBaseTime;
+}TelemetryReader_t;
+
+//*****************************************************************************
+//                      API FUNCTION PROTOTYPES
+//*****************************************************************************
+extern int Telemetry_Begin(TelemetryWriter_t *pWriter, unsigned char *pucBuf,
+                           int iBufLen, unsigned long ulBaseTime);
+extern int Telemetry_Add(TelemetryWriter_t *pWriter,
+                         const TelemetryRecord_t *pRecord);
+extern int Telemetry_End(TelemetryWriter_t *pWriter);
+extern int Telemetry_ReaderInit(TelemetryReader_t *pReader,
+                                const unsigned char *pucBuf, int iLen);
+extern int Telemetry_Next(TelemetryReader_t *pReader,
+                          TelemetryRecord_t *pRecord);
+
+#endif //  __TELEMETRY_H__